@@ -19,6 +19,7 @@
 
 #include "Engine.h"
 
+#include "core/CacheManager.h"
 #include "core/Logger.h"
 #include "core/ResourceMap.h"
 #include "mechanics/GameState.h"
@@ -163,13 +164,16 @@ void Engine::start()
             renderWindow_->clear(sf::Color::Green);
             m_mapRenderer->display();
 
-            std::vector<std::weak_ptr<Entity>> visibleEntities;
-            visibleEntities = state->map()->entitiesBetween(m_mapRenderer->firstVisibleColumn(),
-                                                            m_mapRenderer->firstVisibleRow(),
-                                                            m_mapRenderer->lastVisibleColumn(),
-                                                            m_mapRenderer->lastVisibleRow());
+            m_visibleEntities.clear();
+            state->map()->forEachEntityBetween(m_mapRenderer->firstVisibleColumn(),
+                                               m_mapRenderer->firstVisibleRow(),
+                                               m_mapRenderer->lastVisibleColumn(),
+                                               m_mapRenderer->lastVisibleRow(),
+                                               [this](Entity &entity) {
+                m_visibleEntities.push_back(&entity);
+            });
 
-            state->unitManager()->render(renderTarget_, visibleEntities);
+            state->unitManager()->render(renderTarget_, m_visibleEntities, state->tickProgress());
 
             state->draw();
 
@@ -199,6 +203,7 @@ void Engine::start()
 
     }
     DBG << "avg fps:" << (totalFps / fpsSamples);
+    CacheManager::Inst().printStats();
 }
 
 void Engine::addMessage(const std::string &message)
@@ -38,6 +38,7 @@
 #include <vector>
 
 class GameState;
+struct Entity;
 class SfmlRenderTarget;
 namespace genie {
 class ScnFile;
@@ -115,6 +116,9 @@ private:
     std::unique_ptr<UnitInfoPanel> m_unitInfoPanel;
     std::unique_ptr<MapRenderer> m_mapRenderer;
 
+    /// Kept around so we don't allocate it every frame
+    std::vector<Entity*> m_visibleEntities;
+
     std::array<sf::Text, s_numMessagesLines> m_visibleText;
 
     Drawable::Image::Ptr m_uiOverlay;
@@ -3,6 +3,7 @@
 #include "ActionMove.h"
 #include "core/Constants.h"
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "mechanics/Civilization.h"
 #include "mechanics/Missile.h"
 #include "mechanics/Player.h"
@@ -55,7 +56,7 @@ IAction::UnitState ActionAttack::unitState() const
     }
 }
 
-IAction::UpdateResult ActionAttack::update(Time time)
+IAction::UpdateResult ActionAttack::update(Time /*time*/)
 {
     Unit::Ptr unit = m_unit.lock();
     if (!unit) {
@@ -121,7 +122,7 @@ IAction::UpdateResult ActionAttack::update(Time time)
     ScreenPos targetScreenPosition = m_targetPosition.toScreen();
     unit->setAngle(screenPosition.angleTo(targetScreenPosition));
 
-    float timeSinceLastAttack = (time - m_lastAttackTime) * 0.0015;
+    const float timeSinceLastAttack = unit->timeSinceAttack() * 0.0015;
 
     if (timeSinceLastAttack < unit->data()->Combat.DisplayedReloadTime) {
         m_firing = true;
@@ -136,7 +137,7 @@ IAction::UpdateResult ActionAttack::update(Time time)
     if (targetUnit && targetUnit->healthLeft() <= 0.f) {
         return IAction::UpdateResult::Completed;
     }
-    m_lastAttackTime = time;
+    unit->resetAttackTimer();
 
     // TODO: Create a flare here owned by the owner of the targeted unit, to show where the attack is coming from
 
@@ -178,7 +179,7 @@ void ActionAttack::spawnMissiles(const Unit::Ptr &source, const int unitId, cons
         MapPos individualTarget = target;
         individualTarget.x +=  -cos(source->angle()) * i*widthDispersion - spawnArea[0]/2.;
         individualTarget.y +=  sin(source->angle()) * i*widthDispersion - spawnArea[1]/2.;
-        Missile::Ptr missile = std::make_shared<Missile>(gunit, source, individualTarget, targetUnit);
+        Missile::Ptr missile = makePooled<Missile>(gunit, source, individualTarget, targetUnit);
         missile->setMap(source->map());
 
         missile->setBlastType(Missile::BlastType(source->data()->Combat.BlastAttackLevel), source->data()->Combat.BlastWidth);
@@ -192,8 +193,9 @@ void ActionAttack::spawnMissiles(const Unit::Ptr &source, const int unitId, cons
         pos.z += graphicDisplacement[2] * Constants::TILE_SIZE_HEIGHT;
 
         if (spawnArea[2] > 0) {
-            pos.x += (rand() % int((100 - spawnArea[2]) * spawnArea[0] * Constants::TILE_SIZE)) / 100.;
-            pos.y += (rand() % int((100 - spawnArea[2]) * spawnArea[1] * Constants::TILE_SIZE)) / 100.;
+            Random &random = source->unitManager().random();
+            pos.x += random.nextInt((100 - spawnArea[2]) * spawnArea[0] * Constants::TILE_SIZE) / 100.;
+            pos.y += random.nextInt((100 - spawnArea[2]) * spawnArea[1] * Constants::TILE_SIZE) / 100.;
         }
         missile->setPosition(pos);
         source->unitManager().addMissile(missile);
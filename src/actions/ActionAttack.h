@@ -26,7 +26,6 @@ private:
 
     MapPos m_targetPosition;
     std::weak_ptr<Unit> m_targetUnit;
-    Time m_lastAttackTime = 0;
     bool m_firing = false;
     bool m_attackGround = false;
 };
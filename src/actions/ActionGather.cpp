@@ -4,6 +4,7 @@
 #include "ActionAttack.h"
 #include "ActionMove.h"
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "core/ResourceMap.h"
 #include "mechanics/Player.h"
 #include "mechanics/UnitManager.h"
@@ -54,7 +55,7 @@ IAction::UpdateResult ActionGather::update(Time time)
 
     if (target->healthLeft() > 0 && target->playerId != unit->playerId) {
         DBG << "Unit isn't dead, attacking first";
-        unit->actions.prependAction(std::make_shared<ActionAttack>(unit, m_task));
+        unit->actions.prependAction(makePooled<ActionAttack>(unit, m_task));
         return UpdateResult::NotUpdated;
     }
 
@@ -130,12 +131,12 @@ IAction::UpdateResult ActionGather::maybeDropOff(const std::shared_ptr<Unit> &un
     unit->actions.queueAction(ActionMove::moveUnitTo(unit, dropSite));
     Task dropoffTask = m_task;
     dropoffTask.target = dropSite;
-    unit->actions.queueAction(std::make_shared<ActionDropOff>(unit, dropoffTask));
+    unit->actions.queueAction(makePooled<ActionDropOff>(unit, dropoffTask));
     unit->actions.queueAction(ActionMove::moveUnitTo(unit, unit->position(), m_task));
 
     Unit::Ptr target = m_target.lock();
     if (target && target->resources[m_resourceType] > 0) {
-        unit->actions.queueAction(std::make_shared<ActionGather>(unit, m_task));
+        unit->actions.queueAction(makePooled<ActionGather>(unit, m_task));
     }
 
     return UpdateResult::Completed;
@@ -19,29 +19,22 @@
 #include "ActionMove.h"
 
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "core/Utility.h"
 #include "mechanics/Unit.h"
 #include "mechanics/UnitManager.h"
 #include "mechanics/MapTile.h"
 #include "mechanics/Map.h"
-#include "resource/DataManager.h"
 
 #include <genie/Types.h>
-#include <genie/dat/TerrainRestriction.h>
 #include <genie/dat/Unit.h>
 
-#include <SFML/System/Clock.hpp>
-#include <SFML/System/Time.hpp>
-
 #include <algorithm>
 #include <iosfwd>
 #include <limits>
-#include <queue>
 #include <stack>
 
 #include <system_error>
-#include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 #include <math.h>
@@ -52,63 +45,6 @@
 std::vector<MapPos> ActionMove::testedPoints;
 #endif
 
-struct SimplePathPoint {
-    SimplePathPoint(const int x_, const int y_) : x(x_), y(y_) {}
-    int x = 0;
-    int y = 0;
-
-    bool operator==(const SimplePathPoint &other) const noexcept {
-        return x == other.x || y == other.y;
-    }
-};
-
-namespace { // anonymous namespace, don't export this
-struct PathPoint {
-    PathPoint() = default;
-
-    int8_t dx = 0;
-    int8_t dy = 0;
-
-    PathPoint(int64_t _x, int64_t _y) : x(_x), y(_y) {}
-
-    int32_t x = 0;
-    int32_t y = 0;
-    float pathLength = 0;
-    float distance = 0;
-
-    bool operator==(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
-        return x == other.x && y == other.y;
-    }
-    bool operator!=(const PathPoint &other) const noexcept {
-        return x != other.x || y != other.y;
-    }
-    bool operator<(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
-        return other.distance < distance;
-    }
-
-    inline operator SimplePathPoint () const {
-        return {x, y};
-    }
-};
-} //namespace
-template<> struct std::hash<PathPoint>
-{
-    std::size_t operator()(const PathPoint& point) const noexcept DUMB_CLANG_IT_IS_USED
-    {
-        return point.y * 255 * 48 + point.x;
-    }
-};
-
-template<> struct std::hash<SimplePathPoint>
-{
-    std::size_t operator()(const SimplePathPoint& point) const noexcept
-    {
-        return point.y * 255 * 48 + point.x;
-    }
-};
-
-static const float PATHFINDING_HEURISTIC_WEIGHT = 10;
-
 ActionMove::ActionMove(MapPos destination, const Unit::Ptr &unit, const Task &task) :
     IAction(Type::Move, unit, task),
     m_map(unit->map()),
@@ -116,7 +52,9 @@ ActionMove::ActionMove(MapPos destination, const Unit::Ptr &unit, const Task &ta
 {
     m_destination = destination;
 
-    m_terrainMoveMultipliers = DataManager::Inst().getTerrainRestriction(unit->data()->TerrainRestriction).PassableBuildableDmgMultiplier;
+    m_terrainRestriction = unit->data()->TerrainRestriction;
+    m_footprint = std::max(unit->data()->Size.x, unit->data()->Size.y) * Constants::TILE_SIZE;
+    m_unitId = unit->id;
     m_speed = unit->data()->Speed;
 }
 
@@ -149,39 +87,26 @@ MapPos ActionMove::findClosestWalkableBorder(const MapPos &start, const MapPos &
 
     const int tileX = target.x / Constants::TILE_SIZE;
     const int tileY = target.y / Constants::TILE_SIZE;
-    for (int dx = tileX-1; dx<=tileX+1; dx++) {
-        for (int dy = tileY-1; dy<=tileY+1; dy++) {
-            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_map->columnCount() || dy >= m_map->rowCount())) {
-                continue;
-            }
-            const std::vector<std::weak_ptr<Entity>> &entities = m_map->entitiesAt(dx, dy);
+    m_map->forEachEntityBetween(tileX - 1, tileY - 1, tileX + 2, tileY + 2, [&](Entity &entity) {
+        const Unit *otherUnit = Unit::fromEntity(&entity);
+        if (IS_UNLIKELY(!otherUnit)) {
+            return;
+        }
 
-            if (entities.empty()) {
-                continue;
-            }
+        if (IS_UNLIKELY(otherUnit->id == unit->id)) {
+            return;
+        }
 
-            for (const std::weak_ptr<Entity> &entity : entities) {
-                Unit::Ptr otherUnit = Unit::fromEntity(entity);
-                if (IS_UNLIKELY(!otherUnit)) {
-                    continue;
-                }
-
-                if (IS_UNLIKELY(otherUnit->id == unit->id)) {
-                    continue;
-                }
-
-                if (otherUnit->data()->Size.z == 0) {
-                    continue;
-                }
-
-                if (otherUnit->distanceTo(otherUnit) < 0.1f) {// radius + otherUnit->clearanceSize().width) {
-                    const Size targetSize = otherUnit->clearanceSize();
-                    const float targetRadius = std::max(targetSize.width, targetSize.height);
-                    clearanceLength = std::max(targetRadius + std::max(targetRadius, radius), clearanceLength);
-                }
-            }
+        if (otherUnit->data()->Size.z == 0) {
+            return;
         }
-    }
+
+        if (otherUnit->distanceTo(otherUnit->position()) < 0.1f) {// radius + otherUnit->clearanceSize().width) {
+            const Size targetSize = otherUnit->clearanceSize();
+            const float targetRadius = std::max(targetSize.width, targetSize.height);
+            clearanceLength = std::max(targetRadius + std::max(targetRadius, radius), clearanceLength);
+        }
+    });
 
     MapPos newPos = target;
     if (clearanceLength > 0.f) {
@@ -315,11 +240,6 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
         return UpdateResult::Failed;
     }
 
-    if (m_passableDirty) {
-        m_passable.reset();
-        m_passableCached.reset();
-    }
-
     // TODO differentiate between max manhattan distance (square obstruction type) and euclidian distance (round obstruction type)
     MapRect targetRect(m_destination, Size(maxDistance + 1, maxDistance + 1));
     MapPos unitPosition = unit->position();
@@ -338,7 +258,7 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
 
         m_prevTime = time;
         updatePath();
-        if (m_path.empty()) {
+        if (m_path.empty() && !m_pendingPath) {
             return UpdateResult::Failed;
         }
 
@@ -397,6 +317,28 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
         return UpdateResult::Completed;
     }
 
+    if (m_pendingPath && m_pendingPath->isFinished() && !handlePathResult(unitPosition)) {
+        WARN << "failed to find intermediary path";
+        m_targetReached = true;
+        m_prevTime = time;
+        return UpdateResult::Failed;
+    }
+
+    if (m_path.empty() && m_flowField) {
+        followFlowField(unitPosition);
+    }
+
+    // Find the next part of a long path before we get there
+    if (!m_pendingPath && !m_abstractPath.empty()) {
+        requestNextSegment(m_path.empty() ? unitPosition : m_path.front());
+    }
+
+    // Hold position until we know where to go
+    if (m_pendingPath && (m_path.empty() || m_pendingType == PathType::Detour)) {
+        m_prevTime = time;
+        return UpdateResult::NotUpdated;
+    }
+
     if (m_path.empty()) {
         m_targetReached = true;
 
@@ -431,6 +373,18 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
         distanceLeft = util::hypot(m_path.back().x - unitPosition.x, m_path.back().y - unitPosition.y);
     }
 
+    if (m_path.empty() && m_flowField) {
+        followFlowField(unitPosition);
+    }
+
+    // Reached the end of what we have so far, wait for the next part
+    if (m_path.empty() && m_pendingPath) {
+        m_prevTime = time;
+        unitPosition.z = m_map->elevationAt(unitPosition);
+        unit->setPosition(unitPosition);
+        return UpdateResult::Updated;
+    }
+
     if (m_path.empty()) {
         m_targetReached = true;
         if (!isPassable(unitPosition.x, unitPosition.y)) {
@@ -457,7 +411,7 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
             return UpdateResult::Completed;
         }
 
-        if (m_path.empty()) {
+        if (m_path.empty() && !m_pendingPath) {
             WARN << "failed to find new target path";
             m_targetReached = true;
             return UpdateResult::Failed;
@@ -517,33 +471,17 @@ IAction::UpdateResult ActionMove::update(Time time) noexcept
 
         DBG << "can't move forward, finding intermediat path for" << unit->debugName;
 
-        std::vector<MapPos> partial = findPath(unitPosition, nextPos, 1);
-        if (partial.size() < 1) {
-            WARN << "failed to find intermediary path";
-            m_targetReached = true;
-            m_prevTime = time;
+        requestPath(unitPosition, nextPos, PathType::Detour);
 
-            if (!isPassable(unitPosition.x, unitPosition.y)) {
-                WARN << "ended up in unpassable land";
-                return UpdateResult::Failed;
-            }
-            unitPosition.z = m_map->elevationAt(unitPosition);
-            unit->setPosition(unitPosition);
-            return UpdateResult::Failed;
-        } else {
-            DBG << "found intermediary from" << unitPosition << "to" << nextPos;
-            m_path.insert(m_path.begin(), ++partial.begin(), partial.end());
-
-            m_prevTime = time;
+        m_prevTime = time;
 
-            if (!isPassable(unitPosition.x, unitPosition.y)) {
-                WARN << "ended up in unpassable land";
-                return UpdateResult::Failed;
-            }
-            unitPosition.z = m_map->elevationAt(unitPosition);
-            unit->setPosition(unitPosition);
-            return UpdateResult::Updated;
+        if (!isPassable(unitPosition.x, unitPosition.y)) {
+            WARN << "ended up in unpassable land";
+            return UpdateResult::Failed;
         }
+        unitPosition.z = m_map->elevationAt(unitPosition);
+        unit->setPosition(unitPosition);
+        return UpdateResult::NotUpdated;
     }
 
 
@@ -587,7 +525,7 @@ std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const Ta
         return nullptr;
     }
 
-    std::shared_ptr<ActionMove> action (new ActionMove(targetUnit->position(), unit, task));
+    std::shared_ptr<ActionMove> action = makePooled<ActionMove>(targetUnit->position(), unit, task);
     action->m_targetUnit = targetUnit;
 
     return action;
@@ -601,12 +539,32 @@ std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos
     }
 
 
-    std::shared_ptr<ActionMove> action (new ActionMove(destination, unit, task));
+    std::shared_ptr<ActionMove> action = makePooled<ActionMove>(destination, unit, task);
     action->m_targetUnit = task.target;
 
     return action;
 }
 
+std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const UnitPtr &unit, const FlowField::Ptr &flowField) noexcept
+{
+    if (!flowField) {
+        WARN << "Handed null flow field";
+        return nullptr;
+    }
+
+    if (flowField->terrainRestriction() != unit->data()->TerrainRestriction) {
+        WARN << "Flow field is for a different terrain restriction";
+        return moveUnitTo(unit, flowField->goal());
+    }
+
+    std::shared_ptr<ActionMove> action = moveUnitTo(unit, flowField->goal());
+    if (action) {
+        action->m_flowField = flowField;
+    }
+
+    return action;
+}
+
 std::shared_ptr<ActionMove> ActionMove::moveUnitTo(const Unit::Ptr &unit, MapPos destination) noexcept
 {
     static genie::Task defaultGenieMoveTask;
@@ -695,365 +653,196 @@ static std::vector<MapPos> simplifyRdp(const std::vector<MapPos> &path, const fl
 }
 #endif
 
-std::vector<MapPos> ActionMove::findPath(MapPos start, MapPos end, int coarseness) noexcept
+bool ActionMove::isPassable(const float x, const float y) noexcept
 {
-#ifdef DEBUG
-    testedPoints.clear();
-#endif
-    if (start == end) {
-        return {};
-    }
-
-    sf::Clock clock;
-
-    std::vector<MapPos> path;
-
-    int startX = std::round(start.x / coarseness);
-    int startY = std::round(start.y / coarseness);
-    int endX = std::round(end.x / coarseness);
-    int endY = std::round(end.y / coarseness);
-    if (startX == endX && startY == endY) {
-        DBG << "Already at right position" << start << end;
-        return {start};
-    }
-    if (!isPassable(startX * coarseness, startY * coarseness)) {
-        WARN << "handed unpassable start, attempting to get out";
-        start = findClosestWalkableBorder(MapPos(endX * coarseness, endY * coarseness), MapPos(startX * coarseness, startY * coarseness), coarseness);
-        startX = std::round(start.x / coarseness);
-        startY = std::round(start.y / coarseness);
-    }
-
-    if (!isPassable(startX * coarseness, startY * coarseness)) {
-        WARN << "handed unpassable start, failed to find new";
-        return path;
-    }
-
-    if (!isPassable(endX * coarseness, endY * coarseness)) {
-//        WARN << "handed unpassable target, attempting to get out";
-        start = findClosestWalkableBorder(start, end, coarseness);
-        startX = std::round(start.x / coarseness);
-        startY = std::round(start.y / coarseness);
+    if (IS_UNLIKELY(x < 0 || y < 0)) {
+        return false;
     }
-
-    if (!isPassable(endX * coarseness, endY * coarseness)) {
-        WARN << "handed unpassable target";
-        return path;
+    const int tileX = x / Constants::TILE_SIZE;
+    const int tileY = y / Constants::TILE_SIZE;
+    if (IS_UNLIKELY(tileX >= m_map->columnCount() || tileY >= m_map->rowCount())) {
+        return false;
     }
 
-
-    MapRect targetRect(MapPos(endX-coarseness/2, endY-coarseness/2), Size(maxDistance / coarseness + coarseness, maxDistance / coarseness + coarseness));
-    const Unit::Ptr targetUnit = m_targetUnit.lock();
-    if (targetUnit) {
-        const Size size = targetUnit->clearanceSize() / coarseness;
-        targetRect.width += size.width;
-        targetRect.height += size.height;
-        targetRect.x -= targetRect.width/2;
-        targetRect.y -= targetRect.height/2;
+    const PassabilityMap &passability = m_map->passability();
+    if (!passability.isTerrainPassable(tileX, tileY, m_terrainRestriction)) {
+        return false;
     }
 
-    PathPoint currentPosition(startX, startY);
-
-    std::unordered_map<PathPoint, PathPoint> cameFrom;
-
-    // STL is a steaming pile of shit
-    std::priority_queue<PathPoint> queue;
-    currentPosition.distance = util::hypot(startX - endX, startY - endY);
-    currentPosition.pathLength = 0;
-    queue.push(currentPosition);
-
-    std::unordered_set<SimplePathPoint> visited;
-    visited.insert(currentPosition);
-
-    PathPoint parent;
-    size_t tried = 0;
-    while (!queue.empty()) {
-        tried++;
-        parent = queue.top();
-        queue.pop();
-
-        if (targetRect.contains(parent.x, parent.y)) {// && (minDistance <= 0.f || parent.distance > minDistance/coarseness)) {
-            break;
-        }
-
-        visited.insert(parent);
+    const MapPos position(x, y, m_map->elevationAt(MapPos(x, y)));
+    return passability.isFree(position, m_footprint, m_unitId);
+}
 
+void ActionMove::updatePath() noexcept
+{
 #ifdef DEBUG
-        testedPoints.push_back(MapPos(parent.x * coarseness, parent.y * coarseness));
+    testedPoints.clear();
 #endif
+    TIME_THIS;
 
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                if (!dx && !dy) {
-                    continue;
-                }
-
-                // Check if we're checking backwards
-                if (parent.dy == 0 && dy != 0 && parent.dx * dx < 0)  {
-                    continue;
-                }
-                if (parent.dx == 0 && dx != 0 && parent.dy * dy < 0) {
-                    continue;
-                }
-
-                const int nx = parent.x + dx;
-                const int ny = parent.y + dy;
-
-                // looking up in visited is expensive, try to avoid that
-                if (nx == parent.x && ny == parent.y) {
-                    continue;
-                }
-
-                // We already came from there
-                if (nx == parent.x + parent.dx && ny == parent.y + parent.dy) {
-                    continue;
-                }
-
-
-                SimplePathPoint position(nx, ny);
-                if (visited.find(position) != visited.end()) {
-                    continue;
-                }
-
-                if (!isPassable(nx * coarseness, ny * coarseness)) {
-                    visited.insert(position);
-                    continue;
-                }
-                PathPoint pathPoint(nx, ny);
-
-
-                if (cameFrom.find(pathPoint) != cameFrom.end()) {
-                    if ((cameFrom[pathPoint].pathLength < parent.pathLength)) {
-                        continue;
-                    }
-                }
-
-                pathPoint.dx = dx;
-                pathPoint.dy = dx;
-
-                const int diagCost = 3;
-                const int straightCost = 2;
-                if (!dx || !dy) {
-                    pathPoint.pathLength = parent.pathLength + straightCost;
-                } else {
-                    pathPoint.pathLength = parent.pathLength + diagCost;
-                }
-//                pathPoint.pathLength = parent.pathLength + 1.; // chebychev
-//                pathPoint.pathLength = parent.pathLength + std::abs(dx) + std::abs(dy); // manhattan
-//                pathPoint.pathLength = parent.pathLength + util::hypot(dx, dy); // euclidian
-
-//                pathPoint.distance = pathPoint.pathLength + (std::abs(nx - endX) + std::abs(ny - endY)) * PATHFINDING_HEURISTIC_WEIGHT; // manhattan
-                pathPoint.distance = pathPoint.pathLength + util::hypot(nx - endX, ny - endY) * PATHFINDING_HEURISTIC_WEIGHT * straightCost;
-                queue.push(pathPoint);
-
-                cameFrom[pathPoint] = parent;
-            }
-        }
+    m_path.clear();
+    m_abstractPath.clear();
+    m_pendingPath.reset();
 
-        if (clock.getElapsedTime().asMilliseconds() > 50) {
-            WARN << "Timeout while pathing (" << tried << "nodes in" << clock.getElapsedTime().asMilliseconds() << "ms)";
-            DBG << "visited" << visited.size();
-            DBG << "queue size" << queue.size();
-            return path;
-        }
-    }
-    const int32_t elapsed = clock.getElapsedTime().asMilliseconds();
-    if (elapsed > 10) {
-        DBG << "walked" << tried << "nodes in" << elapsed << "ms";
-        DBG << "visited" << visited.size();
+    std::shared_ptr<Unit> unit = m_unit.lock();
+    if (!unit) {
+        WARN << "Lost our unit";
+        return;
     }
 
-    if (cameFrom.find(parent) == cameFrom.end()) {
-        WARN << "Failed to find path from" << startX << "," << startY << "to" << endX << "," << endY;
-        DBG << parent.x << parent.y;
-        return path;
+    // Falls back to the normal pathfinding itself if it doesn't work out
+    if (m_flowField) {
+        followFlowField(unit->position());
+        return;
     }
 
-    path.push_back(end);
+    MapPos newDest = m_destination;
+    if (!isPassable(m_destination.x, m_destination.y)) {
+//        WARN << "target not passable, finding closest possible position";
+        newDest = findClosestWalkableBorder(unit->position(), m_destination, 2);
+        m_destination = newDest;
+    }
 
-    while (cameFrom[parent] != currentPosition) {
-        parent = cameFrom[parent];
-        path.emplace_back(parent.x * coarseness, parent.y * coarseness);
+    TIME_TICK;
 
-        if (cameFrom.find(parent) == cameFrom.end()) {
-            WARN << "invalid path, failed to find previous step";
-            return path;
+    // Far away, so find the way on the cluster graph first, and only refine
+    // the start of it. The rest is refined as we get there.
+    if (unit->position().distance(newDest) > 2 * HierarchicalPathfinder::ClusterSize * Constants::TILE_SIZE) {
+        m_abstractPath = m_map->pathfinder().findPath(unit->position(), newDest, m_terrainRestriction);
+        if (!m_abstractPath.empty()) {
+            requestNextSegment(unit->position());
+            return;
         }
     }
-//    DBG << "final path length" << path.size();
-
-    return path;
-
-//    return simplifyRdp(simplifyAngles(path), coarseness);
-//    return simplifyAngles(path);
-//    return simplifyRdp(path, coarseness*1.5);
 
+    requestPath(unit->position(), newDest, PathType::Full);
 }
 
-bool ActionMove::isPassable(const float x, const float y) noexcept
+void ActionMove::requestPath(MapPos from, MapPos to, const PathType type) noexcept
 {
-    if (IS_UNLIKELY(x < 0 || y < 0)) {
-        return false;
-    }
-    const int tileX = x / Constants::TILE_SIZE;
-    const int tileY = y / Constants::TILE_SIZE;
-    if (IS_UNLIKELY(tileX >= m_map->columnCount() || tileY >= m_map->rowCount())) {
-        return false;
-    }
-
-    const unsigned cacheIndex = x  + y * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE;
-    if (m_passableCached[cacheIndex]) {
-        return m_passable[cacheIndex];
+    std::shared_ptr<Unit> unit = m_unit.lock();
+    if (!unit) {
+        WARN << "Lost our unit";
+        return;
     }
 
-    m_passableDirty = true;
-    m_passableCached[cacheIndex] = true;
+    const int coarseness = type == PathType::Detour ? 1 : 2;
 
-    const MapTile &tile = m_map->getTileAt(tileX, tileY);
-    if (m_terrainMoveMultipliers[tile.terrainId] == 0) {
-        m_passable[cacheIndex] = false;
-        return false;
+    // The workers only see a snapshot of the map, so fix these up here
+    if (!isPassable(from.x, from.y)) {
+        WARN << "handed unpassable start, attempting to get out";
+        from = findClosestWalkableBorder(to, from, coarseness);
+    }
+    if (!isPassable(to.x, to.y)) {
+        to = findClosestWalkableBorder(from, to, coarseness);
     }
 
-    const double z = m_map->elevationAt(MapPos(x, y));
-    const Unit::Ptr unit = m_unit.lock();
-    genie::XYZF size = unit->data()->Size;
-    size.x *= Constants::TILE_SIZE;
-    size.y *= Constants::TILE_SIZE;
+    PathRequest request;
+    request.start = from;
+    request.end = to;
+    request.terrainRestriction = m_terrainRestriction;
+    request.footprint = m_footprint;
+    request.unitId = m_unitId;
+    request.coarseness = coarseness;
+    request.allowCoarser = type == PathType::Full;
 
-    for (int dx = tileX-1; dx<=tileX+1; dx++) {
-        for (int dy = tileY-1; dy<=tileY+1; dy++) {
-            if (IS_UNLIKELY(dx < 0 || dy < 0 || dx >= m_map->columnCount() || dy >= m_map->rowCount())) {
-                continue;
-            }
-            const std::vector<std::weak_ptr<Entity>> &entities = m_map->entitiesAt(dx, dy);
-
-            for (size_t i=0; i<entities.size(); i++) {
-                const Unit::Ptr otherUnit = Unit::fromEntity(entities[i]);
-                if (IS_UNLIKELY(!otherUnit)) {
-                    continue;
-                }
-
-                if (IS_UNLIKELY(otherUnit->id == unit->id)) {
-                    continue;
-                }
-
-                if (otherUnit->data()->Size.z == 0) {
-                    continue;
-                }
-
-                switch (otherUnit->data()->ObstructionType) {
-                case genie::Unit::PassableObstruction:
-                case genie::Unit::PassableObstruction2:
-                case genie::Unit::PassableNoOutlineObstruction:
-                    continue;
-                case genie::Unit::BuildingObstruction:
-                case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
-                    if (dx == tileX && dy == tileY) { // TODO: need to check the distance from the tile
-                        m_passable[cacheIndex] = false;
-                        return false;
-                    }
-                    break;
-                case genie::Unit::UnitObstruction:
-                default: {
-                    const MapPos &otherPos = otherUnit->position();
-
-                    const double centreDistance = util::hypot(x - otherPos.x, y - otherPos.y, z - otherPos.z);
-                    const Size otherSize = otherUnit->clearanceSize();
-                    const double clearance = std::max(std::max(size.x, size.y), std::max(otherSize.width, otherSize.height));
-                    if (centreDistance < clearance) {
-                        m_passable[cacheIndex] = false;
-                        return false;
-                    }
-                    break;
-                }
-                }
-            }
+    // We only need to get close to the final destination
+    if (type != PathType::NextSegment) {
+        request.maxDistance = maxDistance;
+
+        const Unit::Ptr targetUnit = m_targetUnit.lock();
+        if (targetUnit) {
+            request.targetSize = targetUnit->clearanceSize();
         }
     }
 
-    m_passable[cacheIndex] = true;
-    return true;
+    m_pendingPath = unit->unitManager().pathfindingQueue().submit(request);
+    m_pendingType = type;
 }
 
-void ActionMove::updatePath() noexcept
+void ActionMove::requestNextSegment(const MapPos &from) noexcept
 {
-#ifdef DEBUG
-    testedPoints.clear();
-#endif
-    TIME_THIS;
-
-    m_path.clear();
-    std::shared_ptr<Unit> unit = m_unit.lock();
-    if (!unit) {
-        WARN << "Lost our unit";
+    if (m_abstractPath.empty()) {
         return;
     }
 
-    if (false) { // TODO use this and run the pathfinding in a background thread
-        TIME_THIS;
-        std::vector<MapUnit> mapUnits;
-        MapUnit mapUnit;
-        for (const Unit::Ptr &unit : unit->unitManager().units()) {
-            mapUnit.pos = unit->position();
-            mapUnit.size = unit->data()->ClearanceSize;
-
-            switch (unit->data()->ObstructionType) {
-            case genie::Unit::PassableObstruction:
-            case genie::Unit::PassableObstruction2:
-            case genie::Unit::PassableNoOutlineObstruction:
-                continue;
-            case genie::Unit::BuildingObstruction:
-            case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
-                mapUnit.rectangular = true;
-                break;
-            case genie::Unit::UnitObstruction:
-            default:
-                mapUnit.rectangular = false;
-                break;
-            }
+    // Go a bit further than the next waypoint, so we don't walk strangely around it
+    static const size_t waypointsAhead = 4;
+    const size_t count = std::min(waypointsAhead, m_abstractPath.size());
+    const MapPos target = m_abstractPath[m_abstractPath.size() - count];
+    m_abstractPath.resize(m_abstractPath.size() - count);
+
+    requestPath(from, target, PathType::NextSegment);
+}
+
+bool ActionMove::handlePathResult(const MapPos &unitPosition) noexcept
+{
+    PathfindingQueue::JobPtr job = std::move(m_pendingPath);
+    std::vector<MapPos> &path = job->path();
 
-            mapUnits.push_back(std::move(mapUnit));
+    switch(m_pendingType) {
+    case PathType::Full:
+        if (path.empty()) {
+            WARN << "Failed to find path to" << m_destination;
         }
-        DBG << mapUnits.size();
-    }
+        m_path = std::move(path);
+        return true;
 
-    TIME_TICK;
+    case PathType::NextSegment:
+        if (path.empty()) {
+            DBG << "Failed to refine path to" << job->request().end << ", searching the whole way";
+            m_path.clear();
+            m_abstractPath.clear();
+            requestPath(unitPosition, m_destination, PathType::Full);
+            return true;
+        }
 
-    MapPos newDest = m_destination;
-    if (!isPassable(m_destination.x, m_destination.y)) {
-//        WARN << "target not passable, finding closest possible position";
-        newDest = findClosestWalkableBorder(unit->position(), m_destination, 2);
-        m_destination = newDest;
-    }
+        // It continues from the end of what we have
+        m_path.insert(m_path.begin(), path.begin(), path.end());
+        return true;
 
-    TIME_TICK;
-    m_path = findPath(unit->position(), newDest, 2);
+    case PathType::Detour:
+        if (path.size() < 1) {
+            return false;
+        }
 
-    // Try coarser
-    // Uglier, but hopefully faster
-    if (m_path.empty()) {
-        WARN << "failed to find path, trying 0.2 resolution";
-        if (newDest != m_destination) {
-            newDest = findClosestWalkableBorder(unit->position(), m_destination, 5);
-            m_destination = newDest;
+        // The first one is the waypoint we were trying to get to, and in case we changed our mind meanwhile
+        if (m_path.empty() || m_path.back() != job->request().end) {
+            return true;
         }
-        m_path = findPath(unit->position(), newDest, 5);
+
+        DBG << "found intermediary from" << job->request().start << "to" << job->request().end;
+        m_path.insert(m_path.end(), path.begin() + 1, path.end());
+        return true;
     }
 
-    TIME_TICK;
+    return true;
+}
 
-    if (m_path.empty()) {
-        WARN << "failed to find path, trying 0.1 resolution";
-        if (newDest != m_destination) {
-            newDest = findClosestWalkableBorder(unit->position(), m_destination, 10);
-            m_destination = newDest;
-        }
-        m_path = findPath(unit->position(), newDest, 10);
+void ActionMove::followFlowField(const MapPos &unitPosition) noexcept
+{
+    const int col = unitPosition.x / Constants::TILE_SIZE;
+    const int row = unitPosition.y / Constants::TILE_SIZE;
+
+    // The last bit is just a normal move
+    if (m_flowField->isGoalTile(col, row)) {
+        m_flowField.reset();
+        m_path = { m_destination };
+        return;
     }
 
-    if (m_path.empty()) {
-        DBG << "Failed to find path for" << unit->debugName;
+    std::vector<MapPos> waypoints;
+    m_flowField->nextWaypoints(unitPosition, &waypoints);
+
+    // Take the first one that isn't crowded
+    for (const MapPos &waypoint : waypoints) {
+        if (isPassable(waypoint.x, waypoint.y)) {
+            m_path = { waypoint };
+            return;
+        }
     }
 
-    TIME_TICK;
+    DBG << "Can't follow the flow field, finding our own way";
+    m_flowField.reset();
+    updatePath();
 }
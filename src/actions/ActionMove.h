@@ -21,11 +21,11 @@
 #include "actions/IAction.h"
 
 #include "core/Constants.h"
+#include "mechanics/FlowField.h"
+#include "mechanics/PathfindingQueue.h"
 
-#include <bitset>
 #include <memory>
 #include <vector>
-#include <thread>
 
 struct Unit;
 using UnitPtr = std::shared_ptr<Unit>;
@@ -35,10 +35,10 @@ using MapPtr = std::shared_ptr<Map>;
 
 class ActionMove : public IAction
 {
-    struct MapUnit {
-        MapPos pos;
-        Size size;
-        bool rectangular = false;
+    enum class PathType {
+        Full,
+        NextSegment,
+        Detour
     };
 
 public:
@@ -56,31 +56,50 @@ public:
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, MapPos destination) noexcept;
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, const UnitPtr &targetUnit) noexcept;
     static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, const Task &task) noexcept;
+
+    /// For moving a group to the same place, they all follow the same flow field
+    static std::shared_ptr<ActionMove> moveUnitTo(const UnitPtr &unit, const FlowField::Ptr &flowField) noexcept;
     const std::vector<MapPos> &path() const noexcept { return m_path; }
     genie::ActionType taskType() const noexcept override { return genie::ActionType::MoveTo; }
 
 private:
+    template<typename> friend class PoolAllocator;
     ActionMove(MapPos destination, const UnitPtr &unit, const Task &task);
 
     MapPos findClosestWalkableBorder(const MapPos &start, const MapPos &target, int coarseness) noexcept;
 
-    std::vector<MapPos> findPath(MapPos start, MapPos end, int coarseness) noexcept;
     bool isPassable(const float x, const float y) noexcept;
 
     void updatePath() noexcept;
+    void requestPath(MapPos from, MapPos to, const PathType type) noexcept;
+
+    /// Requests the detailed path to the next few waypoints of the coarse path
+    void requestNextSegment(const MapPos &from) noexcept;
+
+    /// @return false if we failed to find a way around something blocking us
+    bool handlePathResult(const MapPos &unitPosition) noexcept;
+
+    /// Sets the next waypoint from the flow field, or drops it and finds a path the normal way
+    void followFlowField(const MapPos &unitPosition) noexcept;
 
     MapPtr m_map;
     MapPos m_destination;
     std::vector<MapPos> m_path;
-    std::vector<float> m_terrainMoveMultipliers;
+
+    /// Coarse path for long distances, the part we have reached is refined into m_path
+    std::vector<MapPos> m_abstractPath;
+
+    FlowField::Ptr m_flowField;
+    int m_terrainRestriction = -1;
+    float m_footprint = 0.f;
+    size_t m_unitId = 0;
     float m_speed;
 
     bool m_targetReached;
-    std::bitset<Constants::TILE_SIZE * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE * Constants::MAP_MAX_SIZE> m_passable;
-    std::bitset<Constants::TILE_SIZE * Constants::TILE_SIZE * Constants::MAP_MAX_SIZE * Constants::MAP_MAX_SIZE> m_passableCached;
-    bool m_passableDirty = false;
 
-    std::thread m_pathfindingThread;
+    PathfindingQueue::JobPtr m_pendingPath;
+    PathType m_pendingType = PathType::Full;
+
     std::weak_ptr<Unit> m_targetUnit;
     MapPos m_lastTargetUnitPosition;
     MapPos m_prevPathPoint;
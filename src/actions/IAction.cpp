@@ -29,6 +29,7 @@
 #include "ActionMove.h"
 #include "actions/IAction.h"
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "global/EventManager.h"
 #include "mechanics/Player.h"
 #include "mechanics/Unit.h"
@@ -59,13 +60,13 @@ void IAction::assignTask(const Task &task, const std::shared_ptr<Unit> &unit)
 
         unit->actions.queueAction(ActionMove::moveUnitTo(unit, target->position(), task));
 
-        ActionPtr buildAction = std::make_shared<ActionBuild>(unit, task);
+        ActionPtr buildAction = makePooled<ActionBuild>(unit, task);
         buildAction->requiredUnitID = task.unitId;
         unit->actions.queueAction(buildAction);
 
         if (target->data()->Class == genie::Unit::Farm) {
             Task farmTask = unit->actions.findAnyTask(genie::ActionType::GatherRebuild, target->data()->ID);
-            ActionPtr farmAction = std::make_shared<ActionGather>(unit, farmTask);
+            ActionPtr farmAction = makePooled<ActionGather>(unit, farmTask);
             farmAction->requiredUnitID = farmTask.unitId;
             unit->actions.queueAction(farmAction);
         }
@@ -78,7 +79,7 @@ void IAction::assignTask(const Task &task, const std::shared_ptr<Unit> &unit)
             return;
         }
         unit->actions.queueAction(ActionMove::moveUnitTo(unit, task));
-        ActionPtr gatherAction = std::make_shared<ActionGather>(unit, task);
+        ActionPtr gatherAction = makePooled<ActionGather>(unit, task);
         gatherAction->requiredUnitID = task.unitId;
         unit->actions.queueAction(gatherAction);
         break;
@@ -88,7 +89,7 @@ void IAction::assignTask(const Task &task, const std::shared_ptr<Unit> &unit)
             DBG << "attacking" << target->debugName;
         }
 
-        ActionPtr combatAction = std::make_shared<ActionAttack>(unit, task);
+        ActionPtr combatAction = makePooled<ActionAttack>(unit, task);
         combatAction->requiredUnitID = task.unitId;
         unit->actions.queueAction(combatAction);
         break;
@@ -7,19 +7,10 @@ namespace ai {
 
 AiRule::~AiRule()
 {
-    for (const std::shared_ptr<ai::Condition> &condition : m_conditions) {
-        condition->disconnect(this);
-    }
 }
 
-void ai::AiRule::onConditionSatisfied()
+void ai::AiRule::execute()
 {
-    for (const std::shared_ptr<Condition> &condition : m_conditions) {
-        if (!condition->satisfied(this)) {
-            return;
-        }
-    }
-
     DBG << "rule triggered";
 
     for (const std::shared_ptr<Action> &action : m_actions) {
@@ -30,7 +21,6 @@ void ai::AiRule::onConditionSatisfied()
 void AiRule::addCondition(const std::shared_ptr<ai::Condition> &condition)
 {
     m_conditions.push_back(condition);
-    condition->connect(Condition::SatisfiedChanged, this, &AiRule::onConditionSatisfied);
 }
 
 void AiRule::addAction(const std::shared_ptr<Action> &action)
@@ -19,15 +19,23 @@ struct AiRule
 
     AiScript *m_owner = nullptr;
 
-    void onConditionSatisfied();
+    /// Runs the actions, the conditions are checked by the RuleNetwork
+    void execute();
 
     void addCondition(const std::shared_ptr<Condition> &condition);
     void addAction(const std::shared_ptr<Action> &action);
 
+    const std::vector<std::shared_ptr<Condition>> &conditions() const { return m_conditions; }
+
+    void disable() { m_enabled = false; }
+    bool isEnabled() const { return m_enabled; }
+
 private:
     // should really have unique_ptr, but bison is a pile of shit
     std::vector<std::shared_ptr<Condition>> m_conditions;
     std::vector<std::shared_ptr<Action>> m_actions;
+
+    bool m_enabled = true;
 };
 
 } // namespace ai
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ai/gen/enums.h"
+#include "ai/RuleNetwork.h"
 #include "core/SignalEmitter.h"
 
 #include <memory>
@@ -40,8 +41,18 @@ struct AiScript : public SignalEmitter<AiScript>
 
     int goal(int goalId) { return m_goals[goalId]; }
 
+    /// Call when all the rules are added
+    void compile() { m_ruleNetwork.build(rules); }
+
+    /// Once per tick, fires the rules that became true since last time
+    bool update() { return m_ruleNetwork.update(); }
+
+    const RuleNetwork &ruleNetwork() const { return m_ruleNetwork; }
+
 private:
     std::unordered_map<int, int> m_goals;
+
+    RuleNetwork m_ruleNetwork;
 };
 
 } // namespace ai
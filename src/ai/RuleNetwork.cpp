@@ -0,0 +1,144 @@
+#include "RuleNetwork.h"
+
+#include "AiRule.h"
+#include "ai/conditions/Conditions.h"
+#include "core/Logger.h"
+
+#include <unordered_map>
+
+namespace ai {
+
+RuleNetwork::~RuleNetwork()
+{
+    clear();
+}
+
+void RuleNetwork::build(const std::vector<std::shared_ptr<AiRule>> &rules)
+{
+    TIME_THIS;
+
+    clear();
+
+    std::unordered_map<Condition*, ConditionNode*> nodes;
+
+    for (const std::shared_ptr<AiRule> &rule : rules) {
+        if (!rule->isEnabled()) {
+            continue;
+        }
+        if (rule->conditions().empty()) {
+            WARN << "rule without conditions";
+            continue;
+        }
+
+        const size_t ruleIndex = m_rules.size();
+
+        RuleNode ruleNode;
+        ruleNode.rule = rule;
+        ruleNode.conditionCount = rule->conditions().size();
+        m_rules.push_back(ruleNode);
+
+        for (const std::shared_ptr<Condition> &condition : rule->conditions()) {
+            ConditionNode *&node = nodes[condition.get()];
+            if (!node) {
+                m_conditions.push_back(std::make_unique<ConditionNode>());
+                node = m_conditions.back().get();
+                node->network = this;
+                node->condition = condition;
+                node->evaluatedFor = rule.get();
+                condition->connect(Condition::SatisfiedChanged, node, &ConditionNode::onSatisfiedChanged);
+            }
+
+            node->rules.push_back(ruleIndex);
+            m_stats.conditionReferences++;
+        }
+    }
+
+    m_stats.rules = m_rules.size();
+    m_stats.conditions = m_conditions.size();
+
+    // Nothing is known yet, so everything is checked in the first update
+    for (const std::unique_ptr<ConditionNode> &node : m_conditions) {
+        node->onSatisfiedChanged();
+    }
+
+    DBG << "compiled" << m_stats.rules << "rules with" << m_stats.conditionReferences << "conditions into" << m_stats.conditions << "nodes";
+}
+
+void RuleNetwork::clear()
+{
+    for (const std::unique_ptr<ConditionNode> &node : m_conditions) {
+        node->condition->disconnect(node.get());
+    }
+
+    m_conditions.clear();
+    m_rules.clear();
+    m_dirty.clear();
+    m_firing.clear();
+    m_stats = {};
+}
+
+bool RuleNetwork::update()
+{
+    // Conditions can signal while others are checked, those are just appended
+    for (size_t i=0; i<m_dirty.size(); i++) {
+        ConditionNode *node = m_dirty[i];
+        node->dirty = false;
+
+        const bool satisfied = node->condition->satisfied(node->evaluatedFor);
+        m_stats.evaluations++;
+
+        if (satisfied == node->satisfied) {
+            continue;
+        }
+        node->satisfied = satisfied;
+
+        for (const size_t ruleIndex : node->rules) {
+            RuleNode &rule = m_rules[ruleIndex];
+            if (!satisfied) {
+                rule.satisfiedCount--;
+                continue;
+            }
+
+            rule.satisfiedCount++;
+            if (rule.satisfiedCount == rule.conditionCount && !rule.queued) {
+                rule.queued = true;
+                m_firing.push_back(ruleIndex);
+            }
+        }
+    }
+    m_dirty.clear();
+
+    // Actions can change things the conditions look at (goals etc.), those
+    // are picked up in the next update
+    bool fired = false;
+    for (const size_t ruleIndex : m_firing) {
+        RuleNode &rule = m_rules[ruleIndex];
+        rule.queued = false;
+
+        // Might have flipped back while checking the rest
+        if (rule.satisfiedCount != rule.conditionCount) {
+            continue;
+        }
+        if (!rule.rule->isEnabled()) {
+            continue;
+        }
+
+        rule.rule->execute();
+        m_stats.firings++;
+        fired = true;
+    }
+    m_firing.clear();
+
+    return fired;
+}
+
+void RuleNetwork::ConditionNode::onSatisfiedChanged()
+{
+    if (dirty) {
+        return;
+    }
+    dirty = true;
+    network->m_dirty.push_back(this);
+}
+
+} // namespace ai
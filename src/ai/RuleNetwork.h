@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace ai {
+
+struct AiRule;
+struct Condition;
+
+/// All the rules of a script compiled together, so conditions aren't checked
+/// over and over.
+///
+/// The loader hands out the same condition instance for the same fact with
+/// the same parameters, so each of them is only one node here no matter how
+/// many rules use it. A node is only checked in update(), and only if it has
+/// signalled a change since the last time, so it is checked at most once per
+/// tick. Each rule keeps count of how many of its conditions hold, and fires
+/// when that goes up to all of them.
+class RuleNetwork
+{
+public:
+    struct Stats {
+        size_t rules = 0;
+        size_t conditions = 0;
+        size_t conditionReferences = 0;
+        size_t evaluations = 0;
+        size_t firings = 0;
+    };
+
+    RuleNetwork() = default;
+    ~RuleNetwork();
+
+    RuleNetwork(const RuleNetwork&) = delete;
+    RuleNetwork &operator=(const RuleNetwork&) = delete;
+
+    void build(const std::vector<std::shared_ptr<AiRule>> &rules);
+    void clear();
+
+    /// Checks the conditions that have changed, and fires the rules where
+    /// all of them became true. Returns true if any rules fired.
+    bool update();
+
+    const Stats &stats() const noexcept { return m_stats; }
+
+private:
+    struct ConditionNode {
+        RuleNetwork *network = nullptr;
+        std::shared_ptr<Condition> condition;
+
+        /// Conditions want a rule to look up the script and player from,
+        /// they're the same for all of them
+        AiRule *evaluatedFor = nullptr;
+
+        std::vector<size_t> rules;
+        bool satisfied = false;
+        bool dirty = false;
+
+        void onSatisfiedChanged();
+    };
+
+    struct RuleNode {
+        std::shared_ptr<AiRule> rule;
+        size_t conditionCount = 0;
+        size_t satisfiedCount = 0;
+        bool queued = false;
+    };
+
+    /// Nodes are connected to the conditions, so they can't move around
+    std::vector<std::unique_ptr<ConditionNode>> m_conditions;
+    std::vector<RuleNode> m_rules;
+
+    std::vector<ConditionNode*> m_dirty;
+    std::vector<size_t> m_firing;
+
+    Stats m_stats;
+};
+
+} // namespace ai
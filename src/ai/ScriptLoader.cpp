@@ -7,11 +7,23 @@
 #include "core/Logger.h"
 #include "EnumLogDefs.h"
 
+#include "AiRule.h"
+#include "AiScript.h"
 #include "conditions/Conditions.h"
 #include "actions/Actions.h"
 
 namespace ai {
 
+ScriptLoader::ScriptLoader(AiScript *script, const int playerId) :
+    m_playerId(playerId),
+    m_script(script)
+{
+}
+
+ScriptLoader::~ScriptLoader()
+{
+}
+
 int ScriptLoader::parse(std::istream& in, std::ostream& out) {
 
     ScriptTokenizer scanner {in, *this};
@@ -21,11 +33,58 @@ int ScriptLoader::parse(std::istream& in, std::ostream& out) {
 
     int res = parser.parse();
 
+    if (m_script) {
+        m_script->compile();
+    }
+
     return res;
 }
 
+void ScriptLoader::addRuleCondition(const std::shared_ptr<Condition> &condition)
+{
+    if (!condition) {
+        // Unimplemented or not parsed, so we can't know when it is true
+        m_ruleIsValid = false;
+        return;
+    }
+
+    m_ruleConditions.push_back(condition);
+}
+
+void ScriptLoader::addRuleAction(const std::shared_ptr<Action> &action)
+{
+    if (!action) {
+        return;
+    }
+
+    m_ruleActions.push_back(action);
+}
+
+void ScriptLoader::finishRule()
+{
+    if (!m_ruleIsValid) {
+        DBG << "skipping rule with unsupported conditions";
+    } else if (m_script) {
+        std::shared_ptr<AiRule> rule = std::make_shared<AiRule>(m_script);
+
+        // The parser gives us everything from the back
+        for (size_t i=m_ruleConditions.size(); i-- > 0;) {
+            rule->addCondition(m_ruleConditions[i]);
+        }
+        for (size_t i=m_ruleActions.size(); i-- > 0;) {
+            rule->addAction(m_ruleActions[i]);
+        }
+
+        m_script->rules.push_back(rule);
+    }
+
+    m_ruleConditions.clear();
+    m_ruleActions.clear();
+    m_ruleIsValid = true;
+}
+
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type)
 {
     switch(type) {
     case Fact::Trueval:
@@ -40,7 +99,7 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type)
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Age age)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Age age)
 {
     switch (type) {
     case Fact::CanResearch:
@@ -54,7 +113,7 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Building building)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Building building)
 {
     switch(type) {
     case Fact::CanBuild:
@@ -68,7 +127,7 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Building building, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Building building, const RelOp comparison, const int number)
 {
     switch(type) {
     case Fact::BuildingTypeCount:
@@ -83,13 +142,13 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Civ civ)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Civ civ)
 {
     WARN << "unimplemented condition" << type << civ;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Commodity commodity)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Commodity commodity)
 {
     switch(type) {
     case Fact::CanSellCommodity:
@@ -104,7 +163,7 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Commodity commodity, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Commodity commodity, const RelOp comparison, const int number)
 {
     switch(type) {
     case Fact::CommodityBuyingPrice:
@@ -119,73 +178,73 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const MapSizeType mapsize)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const MapSizeType mapsize)
 {
     WARN << "unimplemented condition" << type << mapsize;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const MapTypeName maptype)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const MapTypeName maptype)
 {
     WARN << "unimplemented condition" << type << maptype;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber)
 {
     WARN << "unimplemented condition" << type << playerNumber;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const int number)
 {
     WARN << "unimplemented condition" << type << playerNumber << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const int number)
 {
     WARN << "unimplemented condition" << type << playerNumber << comparison << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const Building building, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const Building building, const RelOp comparison, const int number)
 {
     WARN << "unimplemented condition" << type << playerNumber << building << comparison << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const Civ civ)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const Civ civ)
 {
     WARN << "unimplemented condition" << type << playerNumber << civ;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const Commodity commodity, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const Commodity commodity, const RelOp comparison, const int number)
 {
     WARN << "unimplemented condition" << type << playerNumber << commodity << comparison << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const DiplomaticStance stance)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const DiplomaticStance stance)
 {
     WARN << "unimplemented condition" << type << playerNumber << stance;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const Age age)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const Age age)
 {
     WARN << "unimplemented condition" << type << playerNumber << comparison << age;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const PlayerNumberType playerNumber, const Unit unit, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const PlayerNumberType playerNumber, const Unit unit, const RelOp comparison, const int number)
 {
     WARN << "unimplemented condition" << type << playerNumber << unit << comparison << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const RelOp comparison, const Age age)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const RelOp comparison, const Age age)
 {
     switch(type) {
     case Fact::CurrentAge:
@@ -198,25 +257,25 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const RelOp comparison, const DifficultyLevel level)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const RelOp comparison, const DifficultyLevel level)
 {
     WARN << "unimplemented condition" << type << comparison << level;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const RelOp comparison, const StartingResourcesType startingResources)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const RelOp comparison, const StartingResourcesType startingResources)
 {
     WARN << "unimplemented condition" << type << comparison << startingResources;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const StrategicNumberName strategicNumber, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const StrategicNumberName strategicNumber, const RelOp comparison, const int number)
 {
     WARN << "unimplemented condition" << type << strategicNumber << comparison << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Unit unit, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Unit unit, const RelOp comparison, const int number)
 {
     switch(type) {
     case Fact::UnitTypeCount:
@@ -231,13 +290,13 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const int number1, const RelOp comparison, const int number2)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const int number1, const RelOp comparison, const int number2)
 {
     WARN << "unimplemented condition" << type << number1 << comparison << number2;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const int number1, const int number2)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const int number1, const int number2)
 {
     switch(type) {
     case Fact::Goal:
@@ -251,19 +310,19 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const int number, const WallType wallType)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const int number, const WallType wallType)
 {
     WARN << "unimplemented condition" << type << number << wallType;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const int number)
 {
     WARN << "unimplemented condition" << type << number;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const ResearchItem research)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const ResearchItem research)
 {
     switch (type) {
     case Fact::CanResearch: // todo handle cost
@@ -278,7 +337,7 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const Unit unit)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const Unit unit)
 {
     switch(type) {
     case Fact::CanTrain:
@@ -291,13 +350,13 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact type, const VictoryConditionName condition)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact type, const VictoryConditionName condition)
 {
     WARN << "unimplemented condition" << type << condition;
     return nullptr;
 }
 
-std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact fact, const RelOp comparison, const int number)
+std::shared_ptr<Condition> ScriptLoader::buildCondition(const Fact fact, const RelOp comparison, const int number)
 {
     genie::ResourceType type = genie::ResourceType::InvalidResource;
     switch(fact) {
@@ -339,7 +398,17 @@ std::shared_ptr<Condition> ScriptLoader::createCondition(const Fact fact, const
 
 std::shared_ptr<Condition> ScriptLoader::createOrCondition(std::shared_ptr<Condition> &condition1, std::shared_ptr<Condition> &condition2)
 {
-    return std::make_shared<Conditions::OrCondition>(condition1, condition2);
+    // OrCondition would treat a missing one as always true, and fire the rule
+    // without knowing, so it's as unsupported as its parts
+    if (!condition1 || !condition2) {
+        return nullptr;
+    }
+
+    std::shared_ptr<Condition> &condition = m_orConditions[{condition1.get(), condition2.get()}];
+    if (!condition) {
+        condition = std::make_shared<Conditions::OrCondition>(condition1, condition2);
+    }
+    return condition;
 }
 
 std::shared_ptr<Condition> ScriptLoader::createNotCondition(const RelOp type, std::shared_ptr<Condition> &condition)
@@ -2,12 +2,15 @@
 
 #include "ai/gen/enums.h"
 
-#include "ai/gen/enums.h"
-
 #include <string>
 #include <map>
 #include <iostream>
 #include <memory>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
 struct Player;
 
@@ -15,45 +18,39 @@ namespace ai {
 
 struct Condition;
 struct Action;
+struct AiScript;
 
 class ScriptLoader {
 public:
-    ScriptLoader(const int playerId) : m_playerId(playerId) {};
-    virtual ~ScriptLoader() {};
+    /// Without a script it only checks that it can be parsed
+    ScriptLoader(const int playerId) : ScriptLoader(nullptr, playerId) {}
+    ScriptLoader(AiScript *script, const int playerId);
+    virtual ~ScriptLoader();
 
+    /// Adds the rules to the script and compiles it
     int parse(std::istream& in, std::ostream& out);
 
-    std::shared_ptr<Condition> createCondition(const Fact type);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Age age);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Building building);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Building building, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Civ civ);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Commodity commodity);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Commodity commodity, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const MapSizeType mapsize);
-    std::shared_ptr<Condition> createCondition(const Fact type, const MapTypeName maptype);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const Building building, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const Civ civ);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const Commodity commodity, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const DiplomaticStance stance);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const Age age);
-    std::shared_ptr<Condition> createCondition(const Fact type, const PlayerNumberType playerNumber, const Unit unit, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const RelOp comparison, const Age age);
-    std::shared_ptr<Condition> createCondition(const Fact type, const RelOp comparison, const DifficultyLevel level);
-    std::shared_ptr<Condition> createCondition(const Fact type, const RelOp comparison, const StartingResourcesType startingResources);
-    std::shared_ptr<Condition> createCondition(const Fact type, const StrategicNumberName strategicNumber, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Unit unit, const RelOp comparison, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const int number1, const RelOp comparison, const int number2);
-    std::shared_ptr<Condition> createCondition(const Fact type, const int number1, const int number2);
-    std::shared_ptr<Condition> createCondition(const Fact type, const int number, const WallType wallType);
-    std::shared_ptr<Condition> createCondition(const Fact type, const int number);
-    std::shared_ptr<Condition> createCondition(const Fact type, const ResearchItem research);
-    std::shared_ptr<Condition> createCondition(const Fact type, const Unit unit);
-    std::shared_ptr<Condition> createCondition(const Fact type, const VictoryConditionName condition);
-    std::shared_ptr<Condition> createCondition(const Fact fact, const RelOp comparison, const int number);
+    /// The same fact with the same parameters gets the same instance, so it
+    /// is only checked once no matter how many rules use it.
+    template<typename... Args>
+    std::shared_ptr<Condition> createCondition(const Fact type, const Args... args)
+    {
+        const ConditionKey key(std::type_index(typeid(std::tuple<Args...>)), {int(type), int(args)...});
+
+        std::map<ConditionKey, std::shared_ptr<Condition>>::const_iterator it = m_conditions.find(key);
+        if (it != m_conditions.end()) {
+            return it->second;
+        }
+
+        std::shared_ptr<Condition> condition = buildCondition(type, args...);
+        m_conditions[key] = condition;
+        return condition;
+    }
+
+    // Called by the parser for each rule
+    void addRuleCondition(const std::shared_ptr<Condition> &condition);
+    void addRuleAction(const std::shared_ptr<Action> &action);
+    void finishRule();
 
     std::shared_ptr<Condition> createOrCondition(std::shared_ptr<Condition> &condition1, std::shared_ptr<Condition> &condition2);
     std::shared_ptr<Condition> createNotCondition(const RelOp type, std::shared_ptr<Condition> &condition);
@@ -79,7 +76,49 @@ public:
     std::shared_ptr<Action> createAction(const ActionType type, const PlayerNumberType playernumber, const int number1, const int number2);
 
 private:
+    using ConditionKey = std::pair<std::type_index, std::vector<int>>;
+
+    std::shared_ptr<Condition> buildCondition(const Fact type);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Age age);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Building building);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Building building, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Civ civ);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Commodity commodity);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Commodity commodity, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const MapSizeType mapsize);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const MapTypeName maptype);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const Building building, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const Civ civ);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const Commodity commodity, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const DiplomaticStance stance);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const RelOp comparison, const Age age);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const PlayerNumberType playerNumber, const Unit unit, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const RelOp comparison, const Age age);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const RelOp comparison, const DifficultyLevel level);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const RelOp comparison, const StartingResourcesType startingResources);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const StrategicNumberName strategicNumber, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Unit unit, const RelOp comparison, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const int number1, const RelOp comparison, const int number2);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const int number1, const int number2);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const int number, const WallType wallType);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const int number);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const ResearchItem research);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const Unit unit);
+    std::shared_ptr<Condition> buildCondition(const Fact type, const VictoryConditionName condition);
+    std::shared_ptr<Condition> buildCondition(const Fact fact, const RelOp comparison, const int number);
+
     const int m_playerId;
+    AiScript *m_script = nullptr;
+
+    std::map<ConditionKey, std::shared_ptr<Condition>> m_conditions;
+    std::map<std::pair<Condition*, Condition*>, std::shared_ptr<Condition>> m_orConditions;
+
+    std::vector<std::shared_ptr<Condition>> m_ruleConditions;
+    std::vector<std::shared_ptr<Action>> m_ruleActions;
+    bool m_ruleIsValid = true;
 };
 
 }
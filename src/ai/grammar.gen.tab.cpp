@@ -2244,25 +2244,25 @@ namespace  ai  {
 
   case 6:
 #line 609 "grammar.gen.ypp"
-    { printf("got rule\n====\n\n"); }
+    { driver.finishRule(); }
 #line 2248 "grammar.gen.tab.cpp"
     break;
 
   case 7:
 #line 612 "grammar.gen.ypp"
-    {  /*printf("got single condition\n"); */ }
+    { driver.addRuleCondition(yystack_[0].value.as < std::shared_ptr<ai::Condition> > ()); /*printf("got single condition\n"); */ }
 #line 2254 "grammar.gen.tab.cpp"
     break;
 
   case 8:
 #line 613 "grammar.gen.ypp"
-    {  /*printf("got multiple conditions\n");*/ }
+    { driver.addRuleCondition(yystack_[1].value.as < std::shared_ptr<ai::Condition> > ()); /*printf("got multiple conditions\n");*/ }
 #line 2260 "grammar.gen.tab.cpp"
     break;
 
   case 9:
 #line 616 "grammar.gen.ypp"
-    { /*printf("condition\n");*/ }
+    { yylhs.value.as < std::shared_ptr<ai::Condition> > () = yystack_[1].value.as < std::shared_ptr<ai::Condition> > (); /*printf("condition\n");*/ }
 #line 2266 "grammar.gen.tab.cpp"
     break;
 
@@ -2286,13 +2286,13 @@ namespace  ai  {
 
   case 13:
 #line 625 "grammar.gen.ypp"
-    {  /*printf("got single action\n");*/ }
+    { driver.addRuleAction(yystack_[0].value.as < std::shared_ptr<ai::Action> > ()); /*printf("got single action\n");*/ }
 #line 2290 "grammar.gen.tab.cpp"
     break;
 
   case 14:
 #line 626 "grammar.gen.ypp"
-    {  /*printf("got multiple actions\n");*/ }
+    { driver.addRuleAction(yystack_[1].value.as < std::shared_ptr<ai::Action> > ()); /*printf("got multiple actions\n");*/ }
 #line 2296 "grammar.gen.tab.cpp"
     break;
 
@@ -10,14 +10,14 @@ rules:
     | rule rules { /*printf("got multiple rules\n");*/ }
 
 rule:
-    OpenParen RuleStart conditions ConditionActionSeparator actions CloseParen { printf("got rule\n====\n\n"); }
+    OpenParen RuleStart conditions ConditionActionSeparator actions CloseParen { driver.finishRule(); }
 
 conditions:
-    condition {  /*printf("got single condition\n"); */ }
-    | condition conditions {  /*printf("got multiple conditions\n");*/ }
+    condition { driver.addRuleCondition($1); /*printf("got single condition\n"); */ }
+    | condition conditions { driver.addRuleCondition($1); /*printf("got multiple conditions\n");*/ }
 
 condition:
-    OpenParen conditiontype CloseParen { /*printf("condition\n");*/ }
+    OpenParen conditiontype CloseParen { $$ = $2; /*printf("condition\n");*/ }
 
 conditiontype:
     Not condition { /*printf("got negated condition\n");*/ }
@@ -26,8 +26,8 @@ conditiontype:
 
 
 actions:
-    singleaction {  /*printf("got single action\n");*/ }
-    | singleaction actions {  /*printf("got multiple actions\n");*/ }
+    singleaction { driver.addRuleAction($1); /*printf("got single action\n");*/ }
+    | singleaction actions { driver.addRuleAction($1); /*printf("got multiple actions\n");*/ }
 
 singleaction:
       OpenParen action CloseParen { $$ = $2; /*printf("got action without arguments\n");*/ }
@@ -0,0 +1,144 @@
+#include "CacheManager.h"
+
+#include "core/Logger.h"
+#include "core/LruCache.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <sstream>
+
+CacheManager &CacheManager::Inst()
+{
+    // Never destroyed, caches owned by other statics unregister during teardown
+    static CacheManager *instance = new CacheManager;
+    return *instance;
+}
+
+CacheManager::CacheManager()
+{
+    m_budgets[size_t(CacheType::TerrainTiles)] = 128 * 1024 * 1024;
+    m_budgets[size_t(CacheType::MapMasks)] = 32 * 1024 * 1024;
+    m_budgets[size_t(CacheType::Graphics)] = 128 * 1024 * 1024;
+    m_budgets[size_t(CacheType::Terrains)] = 16 * 1024 * 1024;
+}
+
+const char *CacheManager::cacheName(const CacheType type) noexcept
+{
+    switch(type) {
+    case CacheType::TerrainTiles:
+        return "terrain-tiles";
+    case CacheType::MapMasks:
+        return "map-masks";
+    case CacheType::Graphics:
+        return "graphics";
+    case CacheType::Terrains:
+        return "terrains";
+    default:
+        return "invalid";
+    }
+}
+
+size_t CacheManager::budget(const CacheType type) const noexcept
+{
+    if (IS_UNLIKELY(type >= CacheType::CacheTypeCount)) {
+        return 0;
+    }
+    return m_budgets[size_t(type)];
+}
+
+void CacheManager::setBudget(const CacheType type, const size_t bytes)
+{
+    if (IS_UNLIKELY(type >= CacheType::CacheTypeCount)) {
+        WARN << "Invalid cache type" << int(type);
+        return;
+    }
+
+    m_budgets[size_t(type)] = bytes;
+
+    for (LruCacheBase *cache : m_caches) {
+        if (cache->type() == type) {
+            cache->evictToBudget();
+        }
+    }
+}
+
+bool CacheManager::parseBudgets(const std::string &budgets)
+{
+    std::istringstream stream(budgets);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        const size_t separator = entry.find(':');
+        if (separator == std::string::npos) {
+            WARN << "Invalid cache budget" << entry << ", should be name:megabytes";
+            return false;
+        }
+
+        const std::string name = entry.substr(0, separator);
+        const std::string value = entry.substr(separator + 1);
+
+        size_t megabytes = 0;
+        try {
+            megabytes = std::stoul(value);
+        } catch (const std::exception &) {
+            WARN << "Invalid size for cache" << name << ":" << value;
+            return false;
+        }
+
+        bool found = false;
+        for (size_t i=0; i<size_t(CacheType::CacheTypeCount); i++) {
+            if (name == cacheName(CacheType(i))) {
+                setBudget(CacheType(i), megabytes * 1024 * 1024);
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            WARN << "Unknown cache" << name;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CacheStats CacheManager::stats(const CacheType type) const
+{
+    CacheStats total;
+    for (const LruCacheBase *cache : m_caches) {
+        if (cache->type() != type) {
+            continue;
+        }
+        const CacheStats &stats = cache->stats();
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.evictions += stats.evictions;
+        total.entries += stats.entries;
+        total.bytesUsed += stats.bytesUsed;
+    }
+    return total;
+}
+
+void CacheManager::printStats() const
+{
+    for (size_t i=0; i<size_t(CacheType::CacheTypeCount); i++) {
+        const CacheType type = CacheType(i);
+        const CacheStats total = stats(type);
+        DBG << cacheName(type) << ":"
+            << total.entries << "entries,"
+            << (total.bytesUsed / 1024) << "of" << (budget(type) / 1024) << "KB,"
+            << total.hits << "hits,"
+            << total.misses << "misses,"
+            << total.evictions << "evictions";
+    }
+}
+
+void CacheManager::add(LruCacheBase *cache)
+{
+    m_caches.push_back(cache);
+}
+
+void CacheManager::remove(LruCacheBase *cache)
+{
+    m_caches.erase(std::remove(m_caches.begin(), m_caches.end(), cache), m_caches.end());
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// Counters for how well a cache is doing
+struct CacheStats
+{
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    size_t entries = 0;
+    size_t bytesUsed = 0;
+};
+
+class LruCacheBase;
+
+/// Keeps track of all the LruCaches, and the memory budget for each kind of
+/// cache. If there are several caches of the same kind (e.g. one per map
+/// renderer) each of them gets the full budget.
+class CacheManager
+{
+public:
+    enum class CacheType {
+        TerrainTiles,
+        MapMasks,
+        Graphics,
+        Terrains,
+        CacheTypeCount
+    };
+
+    static CacheManager &Inst();
+
+    static const char *cacheName(const CacheType type) noexcept;
+
+    size_t budget(const CacheType type) const noexcept;
+    void setBudget(const CacheType type, const size_t bytes);
+
+    /// Parses something like "terrain-tiles:64,map-masks:16", in MB
+    bool parseBudgets(const std::string &budgets);
+
+    /// Summed up for all the caches of the type
+    CacheStats stats(const CacheType type) const;
+
+    void printStats() const;
+
+private:
+    friend class LruCacheBase;
+
+    CacheManager();
+
+    void add(LruCacheBase *cache);
+    void remove(LruCacheBase *cache);
+
+    size_t m_budgets[size_t(CacheType::CacheTypeCount)];
+    std::vector<LruCacheBase*> m_caches;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/// Keeps track of when square regions of tiles last changed, so whatever
+/// caches a region (like the terrain chunks in MapRenderer) can tell if it is
+/// out of date by comparing the generation it was drawn with.
+class DirtyRegions
+{
+public:
+    static constexpr int RegionSize = 16;
+
+    void resize(const int cols, const int rows) {
+        m_regionCols = (cols + RegionSize - 1) / RegionSize;
+        m_regionRows = (rows + RegionSize - 1) / RegionSize;
+
+        // New numbers, so anyone who cached something from before notices
+        m_generations.assign(m_regionCols * m_regionRows, ++m_counter);
+    }
+
+    /// Also marks the regions next to it if the tile is on the border,
+    /// because the edges of the tiles depend on their neighbors.
+    inline void markDirty(const int col, const int row) noexcept {
+        if (IS_UNLIKELY(col < 0 || row < 0)) {
+            return;
+        }
+
+        const int firstRegionCol = std::max(col - 1, 0) / RegionSize;
+        const int firstRegionRow = std::max(row - 1, 0) / RegionSize;
+        const int lastRegionCol = std::min((col + 1) / RegionSize, m_regionCols - 1);
+        const int lastRegionRow = std::min((row + 1) / RegionSize, m_regionRows - 1);
+
+        m_counter++;
+        for (int regionRow = firstRegionRow; regionRow <= lastRegionRow; regionRow++) {
+            for (int regionCol = firstRegionCol; regionCol <= lastRegionCol; regionCol++) {
+                m_generations[regionRow * m_regionCols + regionCol] = m_counter;
+            }
+        }
+    }
+
+    void markAllDirty() noexcept {
+        std::fill(m_generations.begin(), m_generations.end(), ++m_counter);
+    }
+
+    inline uint32_t generation(const int regionCol, const int regionRow) const noexcept {
+        if (IS_UNLIKELY(regionCol < 0 || regionRow < 0 || regionCol >= m_regionCols || regionRow >= m_regionRows)) {
+            return 0;
+        }
+        return m_generations[regionRow * m_regionCols + regionCol];
+    }
+
+    int regionColumns() const noexcept { return m_regionCols; }
+    int regionRows() const noexcept { return m_regionRows; }
+
+private:
+    int m_regionCols = 0;
+    int m_regionRows = 0;
+    uint32_t m_counter = 0;
+    std::vector<uint32_t> m_generations;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "core/CacheManager.h"
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/// The parts that don't depend on the types, so the CacheManager can keep
+/// track of them.
+class LruCacheBase
+{
+public:
+    LruCacheBase(const LruCacheBase&) = delete;
+    LruCacheBase &operator=(const LruCacheBase&) = delete;
+
+    CacheManager::CacheType type() const noexcept { return m_type; }
+    const CacheStats &stats() const noexcept { return m_stats; }
+    size_t budget() const noexcept { return CacheManager::Inst().budget(m_type); }
+
+    virtual void clear() = 0;
+
+protected:
+    friend class CacheManager;
+
+    explicit LruCacheBase(const CacheManager::CacheType type) :
+        m_type(type)
+    {
+        CacheManager::Inst().add(this);
+    }
+
+    virtual ~LruCacheBase()
+    {
+        CacheManager::Inst().remove(this);
+    }
+
+    virtual void evictToBudget() = 0;
+
+    const CacheManager::CacheType m_type;
+    CacheStats m_stats;
+};
+
+/// Keeps track of roughly how much memory the entries use (the size is
+/// passed in when inserting), and throws out the least recently used ones
+/// when it goes over the budget for its type.
+///
+/// Pointers and references to values stay valid until the entry is evicted,
+/// which only happens when inserting or when the budget changes. Not thread
+/// safe.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache : public LruCacheBase
+{
+public:
+    /// Return true for entries that can't be thrown out right now, e.g.
+    /// because they are still in use somewhere else
+    using PinnedCheck = std::function<bool(const Value&)>;
+
+    explicit LruCache(const CacheManager::CacheType type, PinnedCheck isPinned = nullptr) :
+        LruCacheBase(type),
+        m_isPinned(std::move(isPinned))
+    {
+    }
+
+    /// Returns nullptr if it isn't cached, counts as a use
+    Value *find(const Key &key)
+    {
+        const typename Index::iterator it = m_index.find(key);
+        if (it == m_index.end()) {
+            m_stats.misses++;
+            return nullptr;
+        }
+
+        m_stats.hits++;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return &it->second->value;
+    }
+
+    /// Same as above, but throws out the entry (and counts it as a miss) if
+    /// @p isValid returns false for it
+    template<typename Validator>
+    Value *find(const Key &key, const Validator &isValid)
+    {
+        const typename Index::iterator it = m_index.find(key);
+        if (it != m_index.end() && !isValid(it->second->value)) {
+            removeEntry(it);
+        }
+
+        return find(key);
+    }
+
+    /// Doesn't count as a use, and doesn't change anything, so it's safe to
+    /// call from several threads as long as nothing else touches the cache
+    const Value *peek(const Key &key) const
+    {
+        const typename Index::const_iterator it = m_index.find(key);
+        if (it == m_index.end()) {
+            return nullptr;
+        }
+        return &it->second->value;
+    }
+
+    bool contains(const Key &key) const
+    {
+        return m_index.find(key) != m_index.end();
+    }
+
+    /// Replaces it if it already exists, and evicts other entries if we go over budget
+    Value &insert(const Key &key, Value value, const size_t bytes)
+    {
+        const typename Index::iterator it = m_index.find(key);
+        if (it != m_index.end()) {
+            removeEntry(it);
+        }
+
+        m_entries.push_front({key, std::move(value), bytes});
+        m_index[key] = m_entries.begin();
+
+        m_stats.bytesUsed += bytes;
+        m_stats.entries = m_entries.size();
+
+        evictToBudget();
+
+        return m_entries.front().value;
+    }
+
+    void erase(const Key &key)
+    {
+        const typename Index::iterator it = m_index.find(key);
+        if (it != m_index.end()) {
+            removeEntry(it);
+        }
+    }
+
+    void clear() override
+    {
+        m_entries.clear();
+        m_index.clear();
+        m_stats.bytesUsed = 0;
+        m_stats.entries = 0;
+    }
+
+    size_t size() const noexcept { return m_entries.size(); }
+
+protected:
+    void evictToBudget() override
+    {
+        const size_t maxBytes = budget();
+
+        // Go from the least recently used, but never throw out the one we just added
+        typename EntryList::iterator it = m_entries.end();
+        while (m_stats.bytesUsed > maxBytes && it != m_entries.begin()) {
+            --it;
+            if (it == m_entries.begin()) {
+                break;
+            }
+
+            if (m_isPinned && m_isPinned(it->value)) {
+                continue;
+            }
+
+            m_stats.bytesUsed -= it->bytes;
+            m_stats.evictions++;
+            m_index.erase(it->key);
+            it = m_entries.erase(it);
+        }
+
+        m_stats.entries = m_entries.size();
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t bytes = 0;
+    };
+    using EntryList = std::list<Entry>;
+    using Index = std::unordered_map<Key, typename EntryList::iterator, Hash>;
+
+    void removeEntry(const typename Index::iterator &it)
+    {
+        m_stats.bytesUsed -= it->second->bytes;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+        m_stats.entries = m_entries.size();
+    }
+
+    EntryList m_entries;
+    Index m_index;
+    PinnedCheck m_isPinned;
+};
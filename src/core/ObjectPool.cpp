@@ -0,0 +1,67 @@
+#include "ObjectPool.h"
+
+#include <algorithm>
+
+/// Never destroyed, same as the pools in it
+static std::vector<SlabPool*> &allPools()
+{
+    static std::vector<SlabPool*> *pools = new std::vector<SlabPool*>;
+    return *pools;
+}
+
+/// Free blocks store the pointer to the next one
+static size_t blockAlignment(const size_t alignment) noexcept
+{
+    return std::max(alignment, alignof(void*));
+}
+
+/// Big enough for the pointer to the next free block, and keeps the next block aligned
+static size_t paddedBlockSize(const size_t size, const size_t alignment) noexcept
+{
+    const size_t align = blockAlignment(alignment);
+    return (std::max(size, sizeof(void*)) + align - 1) / align * align;
+}
+
+SlabPool::SlabPool(const size_t size, const size_t alignment, const size_t blocksPerSlab) :
+    m_blockSize(paddedBlockSize(size, alignment)),
+    m_alignment(blockAlignment(alignment)),
+    m_blocksPerSlab(std::max<size_t>(blocksPerSlab, 1))
+{
+    allPools().push_back(this);
+}
+
+SlabPool::~SlabPool()
+{
+    for (void *slab : m_slabs) {
+        ::operator delete(slab, std::align_val_t(m_alignment));
+    }
+
+    std::vector<SlabPool*> &pools = allPools();
+    pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+}
+
+SlabPool::Stats SlabPool::totalStats() noexcept
+{
+    Stats total;
+    for (const SlabPool *pool : allPools()) {
+        total.allocations += pool->m_stats.allocations;
+        total.slabAllocations += pool->m_stats.slabAllocations;
+        total.liveBlocks += pool->m_stats.liveBlocks;
+        total.peakBlocks += pool->m_stats.peakBlocks;
+    }
+    return total;
+}
+
+void SlabPool::addSlab()
+{
+    uint8_t *slab = static_cast<uint8_t*>(::operator new(m_blockSize * m_blocksPerSlab, std::align_val_t(m_alignment)));
+    m_slabs.push_back(slab);
+    m_stats.slabAllocations++;
+
+    // Link them up backwards, so they are handed out in order
+    for (size_t i = m_blocksPerSlab; i > 0; i--) {
+        FreeBlock *block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * m_blockSize);
+        block->next = m_freeList;
+        m_freeList = block;
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Hands out fixed size blocks carved out of bigger slabs. Freed blocks are
+/// kept in a list threaded through the blocks themselves, so creating and
+/// throwing away lots of short lived objects (missiles, smoke puffs,
+/// actions) doesn't go through malloc every time.
+///
+/// Slabs are never given back, so the memory use stays at the peak. Not
+/// thread safe, only used from the simulation.
+class SlabPool
+{
+public:
+    struct Stats {
+        size_t allocations = 0;
+        size_t slabAllocations = 0;
+        size_t liveBlocks = 0;
+        size_t peakBlocks = 0;
+    };
+
+    SlabPool(const size_t size, const size_t alignment, const size_t blocksPerSlab = 256);
+    ~SlabPool();
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool &operator=(const SlabPool&) = delete;
+
+    inline void *allocate()
+    {
+        if (!m_freeList) {
+            addSlab();
+        }
+
+        FreeBlock *block = m_freeList;
+        m_freeList = block->next;
+
+        m_stats.allocations++;
+        m_stats.liveBlocks++;
+        if (m_stats.liveBlocks > m_stats.peakBlocks) {
+            m_stats.peakBlocks = m_stats.liveBlocks;
+        }
+
+        return block;
+    }
+
+    inline void deallocate(void *pointer) noexcept
+    {
+        FreeBlock *block = static_cast<FreeBlock*>(pointer);
+        block->next = m_freeList;
+        m_freeList = block;
+        m_stats.liveBlocks--;
+    }
+
+    size_t blockSize() const noexcept { return m_blockSize; }
+    const Stats &stats() const noexcept { return m_stats; }
+
+    /// All the pools for the different sizes added together
+    static Stats totalStats() noexcept;
+
+    /// One pool per size and alignment, shared by everything that size.
+    /// Never destroyed, so objects can outlive other static objects.
+    template<size_t Size, size_t Alignment>
+    static SlabPool &forSize()
+    {
+        static SlabPool *pool = new SlabPool(Size, Alignment);
+        return *pool;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    void addSlab();
+
+    const size_t m_blockSize;
+    const size_t m_alignment;
+    const size_t m_blocksPerSlab;
+
+    FreeBlock *m_freeList = nullptr;
+    std::vector<void*> m_slabs;
+
+    Stats m_stats;
+};
+
+/// For std::allocate_shared, so the object and the reference count end up in
+/// the same pooled block.
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T *allocate(const size_t count)
+    {
+        if (count != 1) {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        return static_cast<T*>(SlabPool::forSize<sizeof(T), alignof(T)>().allocate());
+    }
+
+    void deallocate(T *pointer, const size_t count) noexcept
+    {
+        if (count != 1) {
+            ::operator delete(pointer, std::align_val_t(alignof(T)));
+            return;
+        }
+        SlabPool::forSize<sizeof(T), alignof(T)>().deallocate(pointer);
+    }
+
+    /// So classes with private constructors can make us a friend
+    template<typename U, typename... Args>
+    void construct(U *pointer, Args&&... args)
+    {
+        ::new(static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U *pointer) noexcept
+    {
+        pointer->~U();
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+/// Like std::make_shared, but from the pool
+template<typename T, typename... Args>
+inline std::shared_ptr<T> makePooled(Args&&... args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+/// Small and fast seeded PRNG (xoshiro128**), so the simulation gives the
+/// same results every time it is run with the same seed, unlike rand().
+class Random
+{
+public:
+    explicit Random(const uint64_t seed = 0) noexcept { setSeed(seed); }
+
+    void setSeed(uint64_t seed) noexcept {
+        // splitmix64 to spread the seed out over the state
+        for (uint32_t &part : m_state) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            part = uint32_t(z ^ (z >> 31));
+        }
+    }
+
+    inline uint32_t next() noexcept {
+        const uint32_t result = rotl(m_state[1] * 5, 7) * 9;
+        const uint32_t t = m_state[1] << 9;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 11);
+
+        return result;
+    }
+
+    /// From 0 to @p max, not including @p max
+    inline int nextInt(const int max) noexcept {
+        if (max <= 0) {
+            return 0;
+        }
+        return int(next() % uint32_t(max));
+    }
+
+    /// From 0 to 1, not including 1
+    inline float nextFloat() noexcept {
+        return (next() >> 8) * (1.f / 16777216.f);
+    }
+
+private:
+    static inline uint32_t rotl(const uint32_t x, const int k) noexcept {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint32_t m_state[4];
+};
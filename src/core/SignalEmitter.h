@@ -1,26 +1,29 @@
 #pragma once
 
-#include <unordered_map>
-#include <functional>
 #include <algorithm>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
 
-template<class Emitter>
-struct SignalHolder;
-
-struct SignalReceptacle
+/// A connected member function, stored without std::function so connecting
+/// and emitting doesn't allocate anything
+struct SignalConnection
 {
-    SignalReceptacle(uintptr_t o, std::function<void()> f) : targetObject(o), targetFunction(f) {}
-    uintptr_t targetObject;
-    std::function<void()> targetFunction;
-};
+    static constexpr size_t FunctionSize = 4 * sizeof(void*);
 
+    int signal = 0;
+    void *receiver = nullptr;
+    void (*invoke)(void *receiver, const unsigned char *function) = nullptr;
+    alignas(void*) unsigned char function[FunctionSize];
+};
 
+/// Receivers can be connected and disconnected while a signal is emitted,
+/// disconnected ones are just cleared and removed afterwards.
 template<class Emitter>
 struct SignalEmitter
 {
-    virtual ~SignalEmitter() {
-        delete d;
-    }
+    virtual ~SignalEmitter() = default;
 
     enum class Signals {
 
@@ -32,7 +35,20 @@ struct SignalEmitter
              typename Function>
     void connect(const Signal sig, Receiver *receiver, Function func) {
         static_assert(std::is_enum<Signal>());
-        d->connections.insert({sig, {uintptr_t(receiver), std::bind(func, receiver)}});
+        static_assert(std::is_member_function_pointer<Function>());
+        static_assert(sizeof(Function) <= SignalConnection::FunctionSize);
+
+        SignalConnection connection;
+        connection.signal = int(sig);
+        connection.receiver = receiver;
+        connection.invoke = [](void *target, const unsigned char *function) {
+            Function memberFunction;
+            memcpy(&memberFunction, function, sizeof(memberFunction));
+            std::invoke(memberFunction, static_cast<Receiver*>(target));
+        };
+        memcpy(connection.function, &func, sizeof(func));
+
+        m_connections.push_back(connection);
     }
 
     template< typename Signal, class Receiver>
@@ -45,14 +61,11 @@ struct SignalEmitter
     void emit(const Signal sig);
 
 private:
-    SignalHolder<Emitter> *d = new SignalHolder<Emitter>();
-};
-
+    void removeDisconnected();
 
-template<class Emitter>
-struct SignalHolder {
-    typedef std::unordered_multimap<typename Emitter::Signals, SignalReceptacle> SignalMap;
-    SignalMap connections;
+    std::vector<SignalConnection> m_connections;
+    int m_emitDepth = 0;
+    bool m_hasDisconnected = false;
 };
 
 template<class Emitter>
@@ -61,12 +74,23 @@ void SignalEmitter<Emitter>::emit(const Signal sig)
 {
     static_assert(std::is_enum<Signal>());
 
-    typedef typename SignalHolder<Emitter>::SignalMap SignalMap;
+    m_emitDepth++;
+
+    // Ones connected while emitting don't get this one
+    const size_t count = m_connections.size();
+    for (size_t i=0; i<count; i++) {
+        const SignalConnection &connection = m_connections[i];
+        if (connection.signal != int(sig) || !connection.receiver) {
+            continue;
+        }
+        connection.invoke(connection.receiver, connection.function);
+    }
+
+    m_emitDepth--;
 
-    const std::pair<typename SignalMap::iterator, typename SignalMap::iterator> range = d->connections.equal_range(sig);
-    std::for_each(range.first, range.second, [](typename SignalMap::value_type &func) {
-        func.second.targetFunction();
-    });
+    if (m_emitDepth == 0 && m_hasDisconnected) {
+        removeDisconnected();
+    }
 }
 
 template<class Emitter>
@@ -75,29 +99,39 @@ void SignalEmitter<Emitter>::disconnect(Signal sig, Receiver *receiver)
 {
     static_assert(std::is_enum<Signal>());
 
-    typedef typename SignalHolder<Emitter>::SignalMap SignalMap;
-
-    for (typename SignalMap::iterator it = d->connections.begin(); it != d->connections.end();) {
-        if (it->first == sig && it->second.targetObject == receiver) {
-            it = d->connections.erase(it);
-        } else {
-            it++;
+    for (SignalConnection &connection : m_connections) {
+        if (connection.signal == int(sig) && connection.receiver == static_cast<void*>(receiver)) {
+            connection.receiver = nullptr;
+            m_hasDisconnected = true;
         }
     }
+
+    if (m_emitDepth == 0 && m_hasDisconnected) {
+        removeDisconnected();
+    }
 }
 
 template<class Emitter>
 template<class Receiver>
 void SignalEmitter<Emitter>::disconnect(Receiver *receiver)
 {
-    typedef typename SignalHolder<Emitter>::SignalMap SignalMap;
-    const uintptr_t receiverId  = uintptr_t(receiver);
-
-    for (typename SignalMap::iterator it = d->connections.begin(); it != d->connections.end();) {
-        if (it->second.targetObject == receiverId) {
-            it = d->connections.erase(it);
-        } else {
-            it++;
+    for (SignalConnection &connection : m_connections) {
+        if (connection.receiver == static_cast<void*>(receiver)) {
+            connection.receiver = nullptr;
+            m_hasDisconnected = true;
         }
     }
+
+    if (m_emitDepth == 0 && m_hasDisconnected) {
+        removeDisconnected();
+    }
+}
+
+template<class Emitter>
+void SignalEmitter<Emitter>::removeDisconnected()
+{
+    m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(), [](const SignalConnection &connection) {
+        return connection.receiver == nullptr;
+    }), m_connections.end());
+    m_hasDisconnected = false;
 }
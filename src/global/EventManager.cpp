@@ -2,8 +2,11 @@
 
 #include "EventListener.h"
 
+#include "core/Logger.h"
 #include "core/Types.h"
 
+#include <algorithm>
+
 struct MapPos;
 
 EventManager::EventManager()
@@ -20,7 +23,7 @@ EventManager *EventManager::instance()
 
 void EventManager::registerListener(EventListener *listener, const EventManager::EventType type)
 {
-    instance()->m_entityEventListeners[type].push_back(listener);
+    instance()->m_listeners[type].push_back(listener);
 }
 
 void EventManager::deregisterListener(EventListener *listener)
@@ -37,7 +40,51 @@ void EventManager::onListenerDestroyed(EventListener *listener)
 
 void EventManager::deregisterListener(EventListener *listener, const EventManager::EventType type)
 {
-    instance()->m_entityEventListeners[type].remove(listener);
+    EventManager *self = instance();
+    for (EventListener *&registered : self->m_listeners[type]) {
+        if (registered == listener) {
+            registered = nullptr;
+            self->m_hasDeregistered = true;
+        }
+    }
+
+    if (self->m_dispatchDepth == 0 && self->m_hasDeregistered) {
+        self->removeDeregistered();
+    }
+}
+
+void EventManager::removeDeregistered()
+{
+    for (std::vector<EventListener*> &listeners : m_listeners) {
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), nullptr), listeners.end());
+    }
+    m_hasDeregistered = false;
+}
+
+void EventManager::setDeferred(const EventType type, const bool deferred)
+{
+    if (type != PlayerResourceChanged) {
+        WARN << "Can only defer resource changes, not" << type;
+        return;
+    }
+
+    EventManager *self = instance();
+    if (self->m_deferred[type] && !deferred) {
+        flushDeferred();
+    }
+    self->m_deferred[type] = deferred;
+}
+
+void EventManager::flushDeferred()
+{
+    EventManager *self = instance();
+
+    // Changes from the listeners go into the next batch
+    self->m_flushingResourceChanges.swap(self->m_pendingResourceChanges);
+    for (const PendingResourceChange &change : self->m_flushingResourceChanges) {
+        call(PlayerResourceChanged, [&](EventListener *l) { l->onPlayerResourceChanged(change.player, change.type, change.newValue); });
+    }
+    self->m_flushingResourceChanges.clear();
 }
 
 void EventManager::unitCreated(Unit *unit)
@@ -132,6 +179,18 @@ void EventManager::unitDisappeared(Player *player, Unit *unit)
 
 void EventManager::playerResourceChanged(Player *player, const genie::ResourceType type, const float newValue)
 {
+    EventManager *self = instance();
+    if (self->m_deferred[PlayerResourceChanged]) {
+        for (PendingResourceChange &pending : self->m_pendingResourceChanges) {
+            if (pending.player == player && pending.type == type) {
+                pending.newValue = newValue;
+                return;
+            }
+        }
+        self->m_pendingResourceChanges.push_back({player, type, newValue});
+        return;
+    }
+
     call(PlayerResourceChanged, [=](EventListener *l) { l->onPlayerResourceChanged(player, type, newValue); });
 }
 
@@ -2,8 +2,9 @@
 #define EVENTMANAGER_H
 
 #include <array>
-#include <functional>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 struct EventListener;
 struct MapPos;
@@ -85,18 +86,60 @@ public:
 
     static void tradingPriceChanged(const genie::ResourceType type, const int newPrice);
 
+    /// Resource changes can be held back until flushDeferred(), and then only
+    /// the last value for each player and resource is delivered, instead of
+    /// every change during a tick. Everything else is always delivered right
+    /// away, attribute changes too because some listeners add them up.
+    static void setDeferred(const EventType type, const bool deferred);
+    static void flushDeferred();
+
 private:
-    static void call(const EventType type, std::function<void(EventListener *listener)> function)
+    struct PendingResourceChange {
+        Player *player;
+        genie::ResourceType type;
+        float newValue;
+    };
+
+    /// Listeners can be registered and deregistered while we go through them,
+    /// deregistered ones are just cleared and removed afterwards
+    template<typename Function>
+    static void call(const EventType type, const Function &function)
     {
-        for (EventListener *listener : instance()->m_entityEventListeners[type]) {
-            function(listener);
+        EventManager *self = instance();
+        const std::vector<EventListener*> &listeners = self->m_listeners[type];
+
+        self->m_dispatchDepth++;
+
+        // Ones registered while we're going through don't get this one
+        const size_t count = listeners.size();
+        for (size_t i=0; i<count; i++) {
+            EventListener *listener = listeners[i];
+            if (listener) {
+                function(listener);
+            }
+        }
+
+        self->m_dispatchDepth--;
+
+        if (self->m_dispatchDepth == 0 && self->m_hasDeregistered) {
+            self->removeDeregistered();
         }
     }
 
+    void removeDeregistered();
+
     EventManager();
     static EventManager *instance();
 
-    std::array<std::list<EventListener*>, EventTypeCount> m_entityEventListeners;
+    std::array<std::vector<EventListener*>, EventTypeCount> m_listeners;
+    int m_dispatchDepth = 0;
+    bool m_hasDeregistered = false;
+
+    std::array<bool, EventTypeCount> m_deferred {};
+
+    /// Swapped when flushing, so they keep their memory
+    std::vector<PendingResourceChange> m_pendingResourceChanges;
+    std::vector<PendingResourceChange> m_flushingResourceChanges;
 
 };
 
@@ -24,11 +24,13 @@
 
 #include "Engine.h"
 #include "audio/AudioPlayer.h"
+#include "core/CacheManager.h"
 #include "core/Logger.h"
 #include "core/Utility.h"
 #include "debug/SampleGameFactory.h"
 #include "global/Config.h"
 #include "resource/AssetManager.h"
+#include "resource/DiskCache.h"
 #include "resource/DataManager.h"
 #include "resource/LanguageManager.h"
 #include "ui/FileDialog.h"
@@ -49,7 +51,10 @@ int main(int argc, char **argv) try
             {"game-path", "Path to AoE installation with data files", Config::Stored },
             {"scenario-file", "Path to scenario file to load", Config::NotStored },
             {"single-player", "Launch a simple test map", Config::NotStored },
-            {"game-sample", "Game samples to load", Config::NotStored }
+            {"game-sample", "Game samples to load", Config::NotStored },
+            {"texture-memory", "Max size of the graphics textures in MB", Config::Stored },
+            {"cache-path", "Where to store decoded graphics and game data between runs, \"none\" to disable", Config::Stored },
+            {"cache-memory", "Memory budgets for the caches in MB, like terrain-tiles:128,map-masks:32", Config::Stored }
             });
     if (!config.parseOptions(argc, argv)) {
         return 1;
@@ -71,7 +76,14 @@ int main(int argc, char **argv) try
                 throw std::runtime_error("Failed to load language.dll");
             }
 
-            if (!DataManager::Inst().initialize(config.getValue("game-path"))) {
+            std::string cachePath = config.getValue("cache-path");
+            if (cachePath.empty()) {
+                cachePath = DiskCache::defaultPath();
+            } else if (cachePath == "none") {
+                cachePath.clear();
+            }
+
+            if (!DataManager::Inst().initialize(config.getValue("game-path"), cachePath)) {
                 throw std::runtime_error("Failed to load game data");
             }
             DBG << "Loaded game data";
@@ -81,6 +93,19 @@ int main(int argc, char **argv) try
                 throw std::runtime_error("Failed to load game assets");
             }
 
+            if (!config.getValue("texture-memory").empty()) {
+                const size_t megabytes = std::stoul(config.getValue("texture-memory"));
+                AssetManager::Inst()->textureAtlas().setMemoryBudget(megabytes * 1024 * 1024);
+            }
+
+            if (!config.getValue("cache-memory").empty()) {
+                CacheManager::Inst().parseBudgets(config.getValue("cache-memory"));
+            }
+
+            if (!cachePath.empty()) {
+                AssetManager::Inst()->enableDiskCache(cachePath);
+            }
+
         } catch(const std::exception &e) {
             dataPath = "";
 
@@ -0,0 +1,178 @@
+#include "AutoTargetTracker.h"
+
+#include "Unit.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <genie/dat/Unit.h>
+
+#include <algorithm>
+
+AutoTargetTracker::AutoTargetTracker()
+{
+    m_bucketCols = (Constants::MAP_MAX_SIZE + BucketSize - 1) / BucketSize;
+    m_buckets.resize(m_bucketCols * m_bucketCols);
+}
+
+void AutoTargetTracker::addWatcher(const std::shared_ptr<Unit> &unit)
+{
+    Watcher &watcher = m_watchers[unit->id];
+    watcher.unit = unit;
+
+    // Stagger them, so they don't all get checked in the same update
+    watcher.nextCheck = m_updateCount + unit->id % CheckInterval;
+
+    const int col = unit->position().x / Constants::TILE_SIZE;
+    const int row = unit->position().y / Constants::TILE_SIZE;
+    updateRegion(unit->id, watcher, col, row, unit->data()->LineOfSight);
+
+    markDirty(unit->id, watcher);
+}
+
+void AutoTargetTracker::removeWatcher(const size_t unitId)
+{
+    std::unordered_map<size_t, Watcher>::iterator it = m_watchers.find(unitId);
+    if (it == m_watchers.end()) {
+        return;
+    }
+
+    // Clears the buckets
+    updateRegion(unitId, it->second, 0, 0, -1);
+
+    // It is skipped if it is in the dirty list
+    m_watchers.erase(it);
+}
+
+void AutoTargetTracker::onUnitMoved(const Unit &unit, const int oldCol, const int oldRow, const int newCol, const int newRow)
+{
+    std::unordered_map<size_t, Watcher>::iterator it = m_watchers.find(unit.id);
+    if (it != m_watchers.end()) {
+        updateRegion(unit.id, it->second, newCol, newRow, unit.data()->LineOfSight);
+        markDirty(unit.id, it->second);
+    }
+
+    // Only things that can be targeted are interesting for the others
+    if (unit.data()->Type < genie::Unit::CombatantType) {
+        return;
+    }
+
+    // Newly placed units don't come from anywhere, and -1 / BucketSize is 0
+    if (oldCol < 0 || oldRow < 0) {
+        markBucketDirty(newCol, newRow);
+        return;
+    }
+
+    markBucketDirty(oldCol, oldRow);
+
+    if (oldCol / BucketSize != newCol / BucketSize || oldRow / BucketSize != newRow / BucketSize) {
+        markBucketDirty(newCol, newRow);
+    }
+}
+
+void AutoTargetTracker::onUnitIdle(const Unit &unit)
+{
+    std::unordered_map<size_t, Watcher>::iterator it = m_watchers.find(unit.id);
+    if (it != m_watchers.end()) {
+        markDirty(unit.id, it->second);
+    }
+}
+
+void AutoTargetTracker::collectDue(std::vector<std::shared_ptr<Unit>> *units)
+{
+    units->clear();
+    m_updateCount++;
+
+    size_t remaining = 0;
+    for (size_t i=0; i<m_dirty.size(); i++) {
+        const size_t unitId = m_dirty[i];
+
+        std::unordered_map<size_t, Watcher>::iterator it = m_watchers.find(unitId);
+        if (it == m_watchers.end()) {
+            continue;
+        }
+
+        Watcher &watcher = it->second;
+        if (watcher.nextCheck > m_updateCount) {
+            m_dirty[remaining++] = unitId;
+            continue;
+        }
+
+        watcher.dirty = false;
+        watcher.nextCheck = m_updateCount + CheckInterval;
+
+        std::shared_ptr<Unit> unit = watcher.unit.lock();
+        if (unit) {
+            units->push_back(std::move(unit));
+        }
+    }
+    m_dirty.resize(remaining);
+}
+
+void AutoTargetTracker::markDirty(const size_t unitId, Watcher &watcher)
+{
+    if (watcher.dirty) {
+        return;
+    }
+
+    watcher.dirty = true;
+    m_dirty.push_back(unitId);
+}
+
+void AutoTargetTracker::markBucketDirty(const int col, const int row)
+{
+    const int bucketX = col / BucketSize;
+    const int bucketY = row / BucketSize;
+    if (IS_UNLIKELY(bucketX < 0 || bucketY < 0 || bucketX >= m_bucketCols || bucketY >= m_bucketCols)) {
+        return;
+    }
+
+    for (const size_t watcherId : m_buckets[bucketY * m_bucketCols + bucketX]) {
+        std::unordered_map<size_t, Watcher>::iterator it = m_watchers.find(watcherId);
+        if (IS_UNLIKELY(it == m_watchers.end())) {
+            continue;
+        }
+        markDirty(watcherId, it->second);
+    }
+}
+
+void AutoTargetTracker::updateRegion(const size_t unitId, Watcher &watcher, const int col, const int row, const int lineOfSight)
+{
+    int firstBucketX = 0, firstBucketY = 0, lastBucketX = -1, lastBucketY = -1;
+
+    // Same area as checkForAutoTargets() looks at
+    if (lineOfSight >= 0) {
+        firstBucketX = std::clamp((col - lineOfSight) / BucketSize, 0, m_bucketCols - 1);
+        firstBucketY = std::clamp((row - lineOfSight) / BucketSize, 0, m_bucketCols - 1);
+        lastBucketX = std::clamp((col + lineOfSight) / BucketSize, 0, m_bucketCols - 1);
+        lastBucketY = std::clamp((row + lineOfSight) / BucketSize, 0, m_bucketCols - 1);
+    }
+
+    if (firstBucketX == watcher.firstBucketX && firstBucketY == watcher.firstBucketY &&
+            lastBucketX == watcher.lastBucketX && lastBucketY == watcher.lastBucketY) {
+        return;
+    }
+
+    for (int y = watcher.firstBucketY; y <= watcher.lastBucketY; y++) {
+        for (int x = watcher.firstBucketX; x <= watcher.lastBucketX; x++) {
+            std::vector<size_t> &bucket = m_buckets[y * m_bucketCols + x];
+            std::vector<size_t>::iterator it = std::find(bucket.begin(), bucket.end(), unitId);
+            if (it != bucket.end()) {
+                *it = bucket.back();
+                bucket.pop_back();
+            }
+        }
+    }
+
+    for (int y = firstBucketY; y <= lastBucketY; y++) {
+        for (int x = firstBucketX; x <= lastBucketX; x++) {
+            m_buckets[y * m_bucketCols + x].push_back(unitId);
+        }
+    }
+
+    watcher.firstBucketX = firstBucketX;
+    watcher.firstBucketY = firstBucketY;
+    watcher.lastBucketX = lastBucketX;
+    watcher.lastBucketY = lastBucketY;
+}
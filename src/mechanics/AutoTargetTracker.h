@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct Unit;
+
+/// Keeps track of which units with automatic targeting (attacking enemies
+/// in sight, villagers hunting etc.) need to look around for new targets.
+///
+/// Each of them registers the area it can see as a watch region, and only
+/// gets checked again when a unit enters or leaves a region it is watching,
+/// when it moves itself, or when it runs out of things to do. To spread the
+/// work out they are checked at most once every CheckInterval updates.
+///
+/// The regions are tracked in buckets of tiles, so it is a bit conservative.
+class AutoTargetTracker
+{
+public:
+    static constexpr int BucketSize = 8;
+    static constexpr uint32_t CheckInterval = 4;
+
+    AutoTargetTracker();
+
+    void addWatcher(const std::shared_ptr<Unit> &unit);
+    void removeWatcher(const size_t unitId);
+
+    /// Pass -1 for the old position if it just appeared
+    void onUnitMoved(const Unit &unit, const int oldCol, const int oldRow, const int newCol, const int newRow);
+
+    void onUnitIdle(const Unit &unit);
+
+    /// Fills @p units with the ones that should look for targets now
+    void collectDue(std::vector<std::shared_ptr<Unit>> *units);
+
+private:
+    struct Watcher {
+        std::weak_ptr<Unit> unit;
+
+        int firstBucketX = 0;
+        int firstBucketY = 0;
+        int lastBucketX = -1;
+        int lastBucketY = -1;
+
+        uint32_t nextCheck = 0;
+        bool dirty = false;
+    };
+
+    void markDirty(const size_t unitId, Watcher &watcher);
+    void markBucketDirty(const int col, const int row);
+    void updateRegion(const size_t unitId, Watcher &watcher, const int col, const int row, const int lineOfSight);
+
+    std::unordered_map<size_t, Watcher> m_watchers;
+
+    /// The IDs of the watchers that can see (parts of) each bucket
+    std::vector<std::vector<size_t>> m_buckets;
+    int m_bucketCols = 0;
+
+    std::vector<size_t> m_dirty;
+    uint32_t m_updateCount = 0;
+};
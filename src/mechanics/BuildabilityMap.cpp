@@ -0,0 +1,197 @@
+#include "BuildabilityMap.h"
+
+#include "core/Constants.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// We don't need many, it's usually just the human player placing a single kind of building
+static const size_t s_maxBuildableAreas = 8;
+
+BuildabilityMap::BuildabilityMap(const PassabilityMap &passability) :
+    m_passability(passability)
+{
+}
+
+void BuildabilityMap::resize(const int cols, const int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+
+    m_blockedCounts.assign(size_t(cols) * size_t(rows), 0);
+    m_unitCounts.clear();
+    m_totalUnitCounts.assign(size_t(cols) * size_t(rows), 0);
+
+    m_areas.clear();
+}
+
+void BuildabilityMap::invalidateTile(const int col, const int row) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    for (BuildableArea &area : m_areas) {
+        area.dirtyRows[row] = 1;
+    }
+}
+
+void BuildabilityMap::invalidateAll() noexcept
+{
+    for (BuildableArea &area : m_areas) {
+        std::fill(area.dirtyRows.begin(), area.dirtyRows.end(), 1);
+    }
+}
+
+void BuildabilityMap::addObstruction(const int col, const int row, const PassabilityMap::Obstruction &obstruction) noexcept
+{
+    if (obstruction.blocksTile) {
+        addBlockedFootprint(obstruction, 1);
+    } else {
+        addUnitCount(col, row, obstruction.playerId, 1);
+    }
+}
+
+void BuildabilityMap::removeObstruction(const int col, const int row, const PassabilityMap::Obstruction &obstruction) noexcept
+{
+    if (obstruction.blocksTile) {
+        addBlockedFootprint(obstruction, -1);
+    } else {
+        addUnitCount(col, row, obstruction.playerId, -1);
+    }
+}
+
+bool BuildabilityMap::isAreaBuildable(const int col, const int row, const int width, const int height, const int terrainRestriction, const int playerId) const noexcept
+{
+    if (IS_UNLIKELY(terrainRestriction < 0)) {
+        return false;
+    }
+    if (IS_UNLIKELY(width <= 0 || height <= 0)) {
+        return false;
+    }
+    if (col < 0 || row < 0 || col + width > m_cols || row + height > m_rows) {
+        return false;
+    }
+
+    BuildableArea *area = nullptr;
+    for (BuildableArea &candidate : m_areas) {
+        if (candidate.terrainRestriction == terrainRestriction && candidate.playerId == playerId) {
+            area = &candidate;
+            break;
+        }
+    }
+
+    if (!area) {
+        if (m_areas.size() >= s_maxBuildableAreas) {
+            m_areas.erase(m_areas.begin());
+        }
+
+        m_areas.emplace_back();
+        area = &m_areas.back();
+        area->terrainRestriction = terrainRestriction;
+        area->playerId = playerId;
+        area->rowSums.assign(size_t(m_cols + 1) * size_t(m_rows), 0);
+        area->dirtyRows.assign(m_rows, 1);
+    }
+
+    const size_t stride = m_cols + 1;
+    for (int r = row; r < row + height; r++) {
+        if (area->dirtyRows[r]) {
+            updateRow(area, r);
+        }
+
+        const uint32_t *sums = &area->rowSums[size_t(r) * stride];
+        if (sums[col + width] != sums[col]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BuildabilityMap::updateRow(BuildableArea *area, const int row) const noexcept
+{
+    uint32_t *sums = &area->rowSums[size_t(row) * (m_cols + 1)];
+
+    uint32_t rowSum = 0;
+    for (int col = 0; col < m_cols; col++) {
+        const size_t index = size_t(row) * m_cols + col;
+
+        const bool buildable = m_passability.isTerrainPassable(col, row, area->terrainRestriction) &&
+                m_blockedCounts[index] == 0 &&
+                m_totalUnitCounts[index] == unitCount(index, area->playerId);
+        rowSum += buildable ? 0 : 1;
+
+        sums[col + 1] = rowSum;
+    }
+
+    area->dirtyRows[row] = 0;
+}
+
+void BuildabilityMap::addBlockedFootprint(const PassabilityMap::Obstruction &obstruction, const int delta) noexcept
+{
+    // The position is in the middle, a bit of slack so float noise doesn't spill over into the neighbours
+    const float centerX = obstruction.position.x / Constants::TILE_SIZE;
+    const float centerY = obstruction.position.y / Constants::TILE_SIZE;
+    const int left = std::max(int(std::floor(centerX - obstruction.footprint.width + 0.01f)), 0);
+    const int top = std::max(int(std::floor(centerY - obstruction.footprint.height + 0.01f)), 0);
+    const int right = std::min(int(std::ceil(centerX + obstruction.footprint.width - 0.01f)), m_cols);
+    const int bottom = std::min(int(std::ceil(centerY + obstruction.footprint.height - 0.01f)), m_rows);
+
+    for (int row = top; row < bottom; row++) {
+        for (int col = left; col < right; col++) {
+            m_blockedCounts[size_t(row) * m_cols + col] += delta;
+        }
+
+        for (BuildableArea &area : m_areas) {
+            area.dirtyRows[row] = 1;
+        }
+    }
+}
+
+void BuildabilityMap::addUnitCount(const int col, const int row, const int playerId, const int delta) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+    const size_t index = size_t(row) * m_cols + col;
+
+    // Only matters for the others if it goes from no other units to some or back
+    for (BuildableArea &area : m_areas) {
+        if (area.playerId == playerId) {
+            continue;
+        }
+
+        const int others = m_totalUnitCounts[index] - unitCount(index, area.playerId);
+        if ((others == 0) != (others + delta == 0)) {
+            area.dirtyRows[row] = 1;
+        }
+    }
+
+    m_totalUnitCounts[index] += delta;
+
+    if (playerId < 0) {
+        return;
+    }
+
+    if (size_t(playerId) >= m_unitCounts.size()) {
+        m_unitCounts.resize(playerId + 1);
+    }
+
+    std::vector<uint16_t> &counts = m_unitCounts[playerId];
+    if (counts.empty()) {
+        counts.assign(m_totalUnitCounts.size(), 0);
+    }
+
+    counts[index] += delta;
+}
+
+int BuildabilityMap::unitCount(const size_t index, const int playerId) const noexcept
+{
+    if (playerId < 0 || size_t(playerId) >= m_unitCounts.size() || m_unitCounts[playerId].empty()) {
+        return 0;
+    }
+
+    return m_unitCounts[playerId][index];
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "PassabilityMap.h"
+
+#include <cstdint>
+#include <vector>
+
+/// Where buildings can be placed, so dragging out walls and moving buildings
+/// around with the mouse doesn't need to look at every tile each time.
+///
+/// Kept up to date by Map next to the PassabilityMap, but separate from it
+/// so the pathfinding doesn't need to carry it around. For each terrain
+/// restriction and player that asks, we keep the number of unbuildable tiles
+/// along each row. Changes only mark the rows they touch, and those are only
+/// counted again when a query needs them.
+class BuildabilityMap
+{
+public:
+    BuildabilityMap(const PassabilityMap &passability);
+
+    void resize(const int cols, const int rows);
+
+    /// Call when the terrain changes
+    void invalidateTile(const int col, const int row) noexcept;
+    void invalidateAll() noexcept;
+
+    void addObstruction(const int col, const int row, const PassabilityMap::Obstruction &obstruction) noexcept;
+    void removeObstruction(const int col, const int row, const PassabilityMap::Obstruction &obstruction) noexcept;
+
+    /// Checks if @p playerId can place something with @p terrainRestriction on
+    /// all the tiles from @p col, @p row and @p width x @p height tiles out,
+    /// i. e. the terrain allows it, there are no buildings and no units from
+    /// other players. Only call it from the main thread.
+    bool isAreaBuildable(const int col, const int row, const int width, const int height, const int terrainRestriction, const int playerId) const noexcept;
+
+private:
+    struct BuildableArea {
+        int terrainRestriction = -1;
+        int playerId = -1;
+
+        /// Number of unbuildable tiles in each row before each column, with
+        /// one extra column of zeros at the start of each row
+        std::vector<uint32_t> rowSums;
+        std::vector<uint8_t> dirtyRows;
+    };
+
+    void updateRow(BuildableArea *area, const int row) const noexcept;
+    void addBlockedFootprint(const PassabilityMap::Obstruction &obstruction, const int delta) noexcept;
+    void addUnitCount(const int col, const int row, const int playerId, const int delta) noexcept;
+    int unitCount(const size_t index, const int playerId) const noexcept;
+
+    const PassabilityMap &m_passability;
+
+    int m_cols = 0;
+    int m_rows = 0;
+
+    /// Buildings and mountains covering each tile
+    std::vector<uint16_t> m_blockedCounts;
+
+    /// Units (not buildings) on each tile, for each player
+    std::vector<std::vector<uint16_t>> m_unitCounts;
+    std::vector<uint16_t> m_totalUnitCounts;
+
+    mutable std::vector<BuildableArea> m_areas;
+};
@@ -257,7 +257,7 @@ void Building::setPosition(const MapPos &pos, const bool initial) noexcept
     Unit::setPosition(Unit::snapPositionToGrid(pos, m_map.lock(), data()), initial);
 }
 
-bool Building::canPlace(const MapPos &position, const MapPtr &map, const genie::Unit *data) noexcept
+bool Building::canPlace(const MapPos &position, const MapPtr &map, const genie::Unit *data, const int playerId) noexcept
 {
     if (!map) {
         WARN << "No map available";
@@ -268,35 +268,27 @@ bool Building::canPlace(const MapPos &position, const MapPtr &map, const genie::
         return false;
     }
 
-    std::vector<float> passable = DataManager::Inst().getTerrainRestriction(data->TerrainRestriction).PassableBuildableDmgMultiplier;
-
     const int tileX = position.x / Constants::TILE_SIZE;
     const int tileY = position.y / Constants::TILE_SIZE;
 
-    const int valid1 = data->PlacementTerrain.first;
-    const int valid2 = data->PlacementTerrain.first;
-
     const int width = data->ClearanceSize.x + data->Size.x;
-    const int height = data->ClearanceSize.x + data->Size.x;
+    const int left = tileX - width/2;
+    const int top = tileY - width/2;
 
-    if (!map->isValidTile(tileX - width/2, tileY - width/2)) {
+    // Terrain, buildings and other players' units, all in one lookup
+    if (!map->buildability().isAreaBuildable(left, top, width, width, data->TerrainRestriction, playerId)) {
         return false;
     }
 
-    if (!map->isValidTile(tileX + width/2, tileY + height/2)) {
-        return false;
+    // Few buildings need a specific terrain, so no point in keeping a table for it
+    const int validTerrain = data->PlacementTerrain.first;
+    if (validTerrain == -1) {
+        return true;
     }
 
     for (int dx = 0; dx < width; dx++) {
         for (int dy = 0; dy < width; dy++) {
-            const int terrainId = map->getTileAt(tileX + dx - width/2, tileY + dy - height/2).terrainId;
-            if (valid1 != -1 && terrainId != valid1) {
-                return false;
-            }
-            if (valid2 != -1 && terrainId != valid2) {
-                return false;
-            }
-            if (!passable[terrainId]) {
+            if (map->getTileAt(left + dx, top + dy).terrainId != validTerrain) {
                 return false;
             }
         }
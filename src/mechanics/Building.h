@@ -45,7 +45,8 @@ struct Building : public Unit
 
     MapPos waypoint;
 
-    static bool canPlace(const MapPos &pos, const MapPtr &map, const genie::Unit *data) noexcept;
+    /// Units owned by @p playerId don't block it, they can move out of the way
+    static bool canPlace(const MapPos &pos, const MapPtr &map, const genie::Unit *data, const int playerId) noexcept;
 
 private:
     void finalizeUnit() noexcept;
@@ -103,18 +103,27 @@ void Entity::setPosition(const MapPos &pos, const bool initial) noexcept
 
     m_position = pos;
 
-    if (!isUnit() && !isMissile() && !isDecayingEntity()) {
-        return;
+    // Don't slide in from wherever
+    if (initial) {
+        m_hasPreviousPosition = false;
     }
-    if (newTileX == oldTileX && newTileY == oldTileY) {
+
+    if (!isUnit() && !isMissile() && !isDecayingEntity()) {
         return;
     }
 
-
     MapPtr map = m_map.lock();
     if (!map) {
         return;
     }
+
+    if (newTileX == oldTileX && newTileY == oldTileY) {
+        if (!initial) {
+            map->updateEntityAt(newTileX, newTileY, *this);
+        }
+        return;
+    }
+
     if (!initial) {
         map->removeEntityAt(oldTileX, oldTileY, id);
     }
@@ -65,6 +65,20 @@ struct Entity : std::enable_shared_from_this<Entity>, SignalEmitter<Entity>
     inline const MapPos &position() const noexcept { return m_position; }
     virtual void setPosition(const MapPos &pos, const bool initial = false) noexcept;
 
+    /// Remembers where we were at the start of a simulation tick
+    inline void storePreviousPosition() noexcept {
+        m_previousPosition = m_position;
+        m_hasPreviousPosition = true;
+    }
+
+    /// Where to draw it between two ticks, @p progress from 0 (last tick) to 1 (current)
+    inline MapPos interpolatedPosition(const float progress) const noexcept {
+        if (!m_hasPreviousPosition) {
+            return m_position;
+        }
+        return m_previousPosition + (m_position - m_previousPosition) * progress;
+    }
+
     inline bool isUnit() const noexcept { return m_type >= Type::Unit; }
     inline bool isBuilding() const noexcept { return m_type >= Type::Building; }
     inline bool isMissile() const noexcept { return m_type == Type::Missile; }
@@ -92,6 +106,8 @@ private:
 
     friend struct MoveTargetMarker;
     MapPos m_position;
+    MapPos m_previousPosition;
+    bool m_hasPreviousPosition = false;
 };
 
 
@@ -0,0 +1,55 @@
+#include "EntityGrid.h"
+
+#include "core/Logger.h"
+
+void EntityGrid::resize(const int cols, const int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+
+    m_cells.clear();
+    m_cells.resize(size_t(cols) * size_t(rows));
+
+    for (Slot &slot : m_slots) {
+        slot.cell = -1;
+    }
+}
+
+void EntityGrid::add(const int col, const int row, Entity *entity) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        WARN << "Trying to add entity out of range" << col << row;
+        return;
+    }
+
+    // just to be sure
+    remove(entity->id);
+
+    if (entity->id >= m_slots.size()) {
+        m_slots.resize(entity->id + 1);
+    }
+
+    const int cell = row * m_cols + col;
+    Slot &slot = m_slots[entity->id];
+    slot.cell = cell;
+    slot.index = m_cells[cell].size();
+    m_cells[cell].push_back(entity);
+}
+
+void EntityGrid::remove(const size_t entityId) noexcept
+{
+    if (!contains(entityId)) {
+        return;
+    }
+
+    Slot &slot = m_slots[entityId];
+    std::vector<Entity*> &cell = m_cells[slot.cell];
+
+    // Fill the hole with the last one, and tell it where it ended up
+    Entity *last = cell.back();
+    cell[slot.index] = last;
+    m_slots[last->id].index = slot.index;
+    cell.pop_back();
+
+    slot.cell = -1;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Entity.h"
+
+#include "core/Constants.h"
+#include "core/Types.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Spatial index of the entities on the map, one bucket per tile.
+///
+/// Only raw pointers are stored, the entities remove themselves when they
+/// are destroyed, so lookups don't need to touch any reference counts. Each
+/// entity remembers where in its bucket it is, so adding, removing and moving
+/// are all constant time.
+///
+/// Don't add or remove entities from inside the visitors.
+class EntityGrid
+{
+public:
+    void resize(const int cols, const int rows);
+
+    void add(const int col, const int row, Entity *entity) noexcept;
+    void remove(const size_t entityId) noexcept;
+
+    inline bool contains(const size_t entityId) const noexcept {
+        return entityId < m_slots.size() && m_slots[entityId].cell != -1;
+    }
+
+    template<typename Visitor>
+    inline void forEachAt(const int col, const int row, Visitor &&visit) const {
+        if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+            return;
+        }
+
+        for (Entity *entity : m_cells[row * m_cols + col]) {
+            visit(*entity);
+        }
+    }
+
+    /// The last column and row are not included
+    template<typename Visitor>
+    inline void forEachBetween(int firstCol, int firstRow, int lastCol, int lastRow, Visitor &&visit) const {
+        firstCol = std::max(firstCol, 0);
+        firstRow = std::max(firstRow, 0);
+        lastCol = std::min(lastCol, m_cols);
+        lastRow = std::min(lastRow, m_rows);
+
+        for (int col=firstCol; col<lastCol; col++) {
+            for (int row=firstRow; row<lastRow; row++) {
+                for (Entity *entity : m_cells[row * m_cols + col]) {
+                    visit(*entity);
+                }
+            }
+        }
+    }
+
+    /// Entities with their position within @p radius pixels from @p center
+    template<typename Visitor>
+    inline void forEachInRadius(const MapPos &center, const float radius, Visitor &&visit) const {
+        const int firstCol = (center.x - radius) / Constants::TILE_SIZE;
+        const int firstRow = (center.y - radius) / Constants::TILE_SIZE;
+        const int lastCol = (center.x + radius) / Constants::TILE_SIZE + 1;
+        const int lastRow = (center.y + radius) / Constants::TILE_SIZE + 1;
+
+        const float radiusSquared = radius * radius;
+        forEachBetween(firstCol, firstRow, lastCol, lastRow, [&](Entity &entity) {
+            const float dx = entity.position().x - center.x;
+            const float dy = entity.position().y - center.y;
+            if (dx * dx + dy * dy > radiusSquared) {
+                return;
+            }
+            visit(entity);
+        });
+    }
+
+private:
+    struct Slot {
+        int32_t cell = -1;
+        uint32_t index = 0;
+    };
+
+    int m_cols = 0;
+    int m_rows = 0;
+
+    std::vector<std::vector<Entity*>> m_cells;
+
+    /// Indexed by entity ID, they are just counted upwards
+    std::vector<Slot> m_slots;
+};
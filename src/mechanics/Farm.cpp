@@ -1,7 +1,5 @@
 #include "Farm.h"
 
-#include <SFML/Graphics/RenderTarget.hpp>
-#include <SFML/Graphics/Sprite.hpp>
 #include <genie/Types.h>
 #include <genie/dat/Unit.h>
 #include <genie/dat/unit/../ResourceUsage.h>
@@ -16,6 +14,7 @@
 #include "core/Logger.h"
 #include "core/ResourceMap.h"
 #include "core/Utility.h"
+#include "render/SpriteBatch.h"
 #include "resource/AssetManager.h"
 #include "resource/Graphic.h"
 
@@ -33,11 +32,11 @@ Farm::Farm(const genie::Unit &data_, const std::shared_ptr<Player> &player_, Uni
 
 void Farm::setCreationProgress(float progress) noexcept
 {
-    if (progress == m_creationProgress) {
+    if (progress == m_store->creationProgress(m_storeHandle)) {
         return;
     }
 
-    m_creationProgress = std::min(progress, float(data()->Creatable.TrainTime));
+    m_store->setCreationProgress(m_storeHandle, std::min(progress, float(data()->Creatable.TrainTime)));
 
     if (progress >= data()->Creatable.TrainTime) {
         setTerrain(FarmFinished);
@@ -131,17 +130,18 @@ FarmRender::FarmRender(const Size &size) :
     m_unavailableTexture.loadFromImage(Graphic::slpFrameToImage(frame, 0, ImageType::ConstructionUnavailable));
 }
 
-void FarmRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass) noexcept
+void FarmRender::render(SpriteBatch &batch, const ScreenPos screenPos, const RenderType pass) noexcept
 {
-    sf::Sprite sprite;
+    const sf::Texture *texture = nullptr;
     if (pass == RenderType::ConstructAvailable) {
-        sprite.setTexture(m_availableTexture);
+        texture = &m_availableTexture;
     } else if (pass == RenderType::ConstructUnavailable) {
-        sprite.setTexture(m_unavailableTexture);
+        texture = &m_unavailableTexture;
     } else {
         return;
     }
 
+    const sf::IntRect textureRect(0, 0, texture->getSize().x, texture->getSize().y);
 
     const ScreenPos pos = screenPos - ScreenPos(Constants::TILE_SIZE_HORIZONTAL / 2., Constants::TILE_SIZE_VERTICAL / 2.);
 
@@ -151,8 +151,7 @@ void FarmRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPo
     for (int x = -m_size.width; x < m_size.width; x++) {
         for (int y = -m_size.height; y < m_size.height; y++) {
             const ScreenPos offset = MapPos(x*tileWidth, y*tileHeight).toScreen();
-            sprite.setPosition(pos + offset);
-            renderTarget.draw(sprite);
+            batch.addSprite(*texture, textureRect, pos + offset);
         }
     }
 }
@@ -11,9 +11,7 @@ class UnitManager;
 namespace genie {
 class Unit;
 }  // namespace genie
-namespace sf {
-class RenderTarget;
-}  // namespace sf
+class SpriteBatch;
 struct Player;
 
 class FarmRender : public GraphicRender
@@ -21,7 +19,8 @@ class FarmRender : public GraphicRender
 public:
     FarmRender(const Size &size);
 
-    void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType pass) noexcept override;
+    using GraphicRender::render;
+    void render(SpriteBatch &batch, const ScreenPos screenPos, const RenderType pass) noexcept override;
 
 private:
     sf::Texture m_availableTexture;
@@ -0,0 +1,150 @@
+#include "FlowField.h"
+
+#include "PassabilityMap.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+static const float s_infinity = std::numeric_limits<float>::infinity();
+
+static const int s_dx[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int s_dy[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+FlowField::FlowField(const PassabilityMap &passability, const MapPos &goal, const int terrainRestriction) :
+    m_goal(goal),
+    m_goalCol(goal.x / Constants::TILE_SIZE),
+    m_goalRow(goal.y / Constants::TILE_SIZE),
+    m_terrainRestriction(terrainRestriction),
+    m_cols(passability.columnCount()),
+    m_rows(passability.rowCount())
+{
+    TIME_THIS;
+
+    const size_t tileCount = size_t(m_cols) * size_t(m_rows);
+    m_costs.assign(tileCount, s_infinity);
+    m_directions.assign(tileCount, NoDirection);
+
+    if (IS_UNLIKELY(m_goalCol < 0 || m_goalRow < 0 || m_goalCol >= m_cols || m_goalRow >= m_rows)) {
+        WARN << "Goal out of range" << goal;
+        return;
+    }
+
+    const auto isWalkable = [&](const int col, const int row) {
+        return passability.isTerrainPassable(col, row, terrainRestriction) && !passability.isTileBlocked(col, row);
+    };
+
+    // Integration field, Dijkstra outwards from the goal. The goal itself
+    // might be blocked, the units will have to find the closest spot then.
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    const int goalIndex = m_goalRow * m_cols + m_goalCol;
+    m_costs[goalIndex] = 0.f;
+    queue.emplace(0.f, goalIndex);
+
+    while (!queue.empty()) {
+        const float cost = queue.top().first;
+        const int index = queue.top().second;
+        queue.pop();
+
+        if (cost > m_costs[index]) {
+            continue;
+        }
+
+        const int col = index % m_cols;
+        const int row = index / m_cols;
+
+        for (int direction = 0; direction < 8; direction++) {
+            const int nextCol = col + s_dx[direction];
+            const int nextRow = row + s_dy[direction];
+            if (!isWalkable(nextCol, nextRow)) {
+                continue;
+            }
+
+            const bool diagonal = s_dx[direction] && s_dy[direction];
+
+            // Don't cut corners
+            if (diagonal && (!isWalkable(col + s_dx[direction], row) || !isWalkable(col, row + s_dy[direction]))) {
+                continue;
+            }
+
+            const int nextIndex = nextRow * m_cols + nextCol;
+            const float nextCost = cost + (diagonal ? float(M_SQRT2) : 1.f);
+            if (nextCost >= m_costs[nextIndex]) {
+                continue;
+            }
+
+            m_costs[nextIndex] = nextCost;
+
+            // Walking back the way we came is the way to the goal
+            m_directions[nextIndex] = (direction + 2) % 4 + (diagonal ? 4 : 0);
+
+            queue.emplace(nextCost, nextIndex);
+        }
+    }
+}
+
+float FlowField::costAt(const int col, const int row) const noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return s_infinity;
+    }
+
+    return m_costs[row * m_cols + col];
+}
+
+void FlowField::nextWaypoints(const MapPos &position, std::vector<MapPos> *waypoints) const
+{
+    waypoints->clear();
+
+    const int col = position.x / Constants::TILE_SIZE;
+    const int row = position.y / Constants::TILE_SIZE;
+
+    const float cost = costAt(col, row);
+    if (cost == s_infinity) {
+        return;
+    }
+
+    if (isGoalTile(col, row)) {
+        waypoints->push_back(m_goal);
+        return;
+    }
+
+    const auto tileCentre = [](const int col, const int row) {
+        return MapPos((col + 0.5f) * Constants::TILE_SIZE, (row + 0.5f) * Constants::TILE_SIZE);
+    };
+
+    const int8_t bestDirection = m_directions[row * m_cols + col];
+    if (bestDirection != NoDirection) {
+        waypoints->push_back(tileCentre(col + s_dx[bestDirection], row + s_dy[bestDirection]));
+    }
+
+    // In case the best one is crowded
+    std::pair<float, int> alternatives[8];
+    int alternativeCount = 0;
+    for (int direction = 0; direction < 8; direction++) {
+        if (direction == bestDirection) {
+            continue;
+        }
+
+        const float neighborCost = costAt(col + s_dx[direction], row + s_dy[direction]);
+        if (neighborCost >= cost) {
+            continue;
+        }
+
+        alternatives[alternativeCount++] = {neighborCost, direction};
+    }
+    std::sort(alternatives, alternatives + alternativeCount);
+
+    for (int i=0; i<alternativeCount; i++) {
+        const int direction = alternatives[i].second;
+        waypoints->push_back(tileCentre(col + s_dx[direction], row + s_dy[direction]));
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class PassabilityMap;
+
+/// Shared pathfinding for a group of units moving to the same place.
+///
+/// Holds the walking distance from every tile on the map to the goal
+/// (integration field), and for each tile the neighbor to go to next (flow
+/// field), so the units only need to look up where to go from where they are.
+///
+/// Like HierarchicalPathfinder it only considers terrain and buildings, units
+/// are avoided by the ActionMove following it.
+class FlowField
+{
+public:
+    typedef std::shared_ptr<const FlowField> Ptr;
+
+    FlowField(const PassabilityMap &passability, const MapPos &goal, const int terrainRestriction);
+
+    const MapPos &goal() const noexcept { return m_goal; }
+    int terrainRestriction() const noexcept { return m_terrainRestriction; }
+
+    bool isGoalTile(const int col, const int row) const noexcept { return col == m_goalCol && row == m_goalRow; }
+
+    /// Walking distance in tiles, infinite if the goal can't be reached from here
+    float costAt(const int col, const int row) const noexcept;
+
+    /// Centres of the neighboring tiles that are closer to the goal, best one first.
+    /// Empty if the goal can't be reached from @p position.
+    void nextWaypoints(const MapPos &position, std::vector<MapPos> *waypoints) const;
+
+private:
+    static constexpr int8_t NoDirection = -1;
+
+    MapPos m_goal;
+    int m_goalCol = 0;
+    int m_goalRow = 0;
+    int m_terrainRestriction = -1;
+
+    int m_cols = 0;
+    int m_rows = 0;
+
+    std::vector<float> m_costs;
+
+    /// Index into the neighbor offsets, NoDirection at the goal and where it can't be reached
+    std::vector<int8_t> m_directions;
+};
@@ -43,6 +43,8 @@
 
 #include <SFML/Graphics/RenderTarget.hpp>
 
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <render/GraphicRender.h>
 
@@ -102,10 +104,14 @@ GameState::GameState(const std::shared_ptr<SfmlRenderTarget> &renderTarget)
     m_unitManager = std::make_shared<UnitManager>();
     renderTarget_ = renderTarget;
     m_scenarioController = std::make_unique<ScenarioController>(this);
+
+    // Only the last value per tick matters for these, delivered in tick()
+    EventManager::setDeferred(EventManager::PlayerResourceChanged, true);
 }
 
 GameState::~GameState()
 {
+    EventManager::setDeferred(EventManager::PlayerResourceChanged, false);
 }
 
 void GameState::setScenario(const std::shared_ptr<genie::ScnFile> &scenario)
@@ -126,6 +132,8 @@ bool GameState::init()
         WARN << "Failed to load waypoint animation";
     }
 
+    m_unitManager->random().setSeed(m_randomSeed);
+
     map_ = std::make_shared<Map>();
     m_unitManager->setMap(map_);
 
@@ -144,16 +152,63 @@ bool GameState::init()
 
 bool GameState::update(Time time)
 {
+    if (m_lastUpdateTime < 0) {
+        m_lastUpdateTime = time;
+    }
+
+    m_timeAccumulated += time - m_lastUpdateTime;
+    m_lastUpdateTime = time;
+
+    bool updated = false;
+
+    int ticks = 0;
+    while (m_timeAccumulated >= TickLength) {
+        if (ticks >= MaxTicksPerUpdate) {
+            DBG << "falling behind, dropping" << m_timeAccumulated << "ms";
+            m_timeAccumulated = 0;
+            break;
+        }
+
+        m_timeAccumulated -= TickLength;
+        m_lastTickUpdated = tick();
+        updated = m_lastTickUpdated || updated;
+        ticks++;
+    }
+
+    // Things are moving, so we need to render the interpolated positions
+    return updated || m_lastTickUpdated;
+}
+
+bool GameState::tick()
+{
+    m_tickCount++;
+    const Time time = simulationTime();
+
     bool updated = false;
 
     updated = m_unitManager->update(time) || updated;
+    EventManager::flushDeferred();
+
     if (m_scenarioController) {
+        const std::chrono::steady_clock::time_point scenarioStart = std::chrono::steady_clock::now();
         updated = m_scenarioController->update(time) || updated;
+        m_scenarioTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scenarioStart).count();
     }
 
     //game_server_->update();
     //game_client_->update();
 
+    uint64_t hash = m_unitManager->stateHash();
+    for (const Player::Ptr &player : m_players) {
+        for (const genie::ResourceType type : {genie::ResourceType::FoodStorage, genie::ResourceType::WoodStorage, genie::ResourceType::StoneStorage, genie::ResourceType::GoldStorage}) {
+            const float amount = player->resourcesAvailable(type);
+            uint32_t bits;
+            memcpy(&bits, &amount, sizeof bits);
+            hash = (hash ^ bits) * 1099511628211ULL;
+        }
+    }
+    m_stateHash = hash;
+
     return updated;
 }
 
@@ -168,6 +223,11 @@ Player::Ptr GameState::player(int id)
 
 void GameState::moveCameraTo(const MapPos &newTarget)
 {
+    // Running headless
+    if (!renderTarget_) {
+        return;
+    }
+
     renderTarget_->camera()->setTargetPosition(newTarget);
 }
 
@@ -272,7 +332,7 @@ void GameState::setupScenario()
     } else {
         cameraPos = MapPos (scenario_->players[humanPlayerId].initCameraX * Constants::TILE_SIZE, map_->pixelHeight() - scenario_->players[humanPlayerId].initCameraY * Constants::TILE_SIZE);
     }
-    renderTarget_->camera()->setTargetPosition(cameraPos);
+    moveCameraTo(cameraPos);
 
     if (!m_humanPlayer) {
         WARN << "no human player defined, setting to 1. player";
@@ -296,5 +356,5 @@ void GameState::setupGame(const GameType /*gameType*/)
     m_players.push_back(sampleGameSetup->getEnemyPlayer());
 
     MapPos cameraPos(map_->pixelWidth() / 2, map_->pixelHeight()  / 2);
-    renderTarget_->camera()->setTargetPosition(cameraPos);
+    moveCameraTo(cameraPos);
 }
@@ -73,6 +73,13 @@ public:
 
     static std::unordered_map<GameType, ResourceMap> defaultStartingResources;
 
+    /// The simulation always advances in steps this long (20 Hz), regardless of the frame rate
+    static constexpr Time TickLength = 50;
+
+    /// If we fall further behind than this we slow down instead of trying to catch up
+    static constexpr int MaxTicksPerUpdate = 5;
+
+    /// @p renderTarget can be null to run without any window, e. g. for benchmarking
     GameState(const std::shared_ptr<SfmlRenderTarget> &renderTarget);
     virtual ~GameState();
 
@@ -81,8 +88,27 @@ public:
 
     bool init() override;
 
+    /// Runs as many simulation ticks as are due since last time, @p time is the real time
     bool update(Time time) override;
 
+    /// Advances the simulation by exactly one tick
+    bool tick();
+
+    /// How far we are towards the next tick, for interpolating when rendering
+    float tickProgress() const noexcept { return float(m_timeAccumulated) / TickLength; }
+
+    uint64_t tickCount() const noexcept { return m_tickCount; }
+    Time simulationTime() const noexcept { return m_tickCount * TickLength; }
+
+    /// Hash of the game state after the last tick, same seed and input gives the same hashes
+    uint64_t stateHash() const noexcept { return m_stateHash; }
+
+    /// Must be set before init()
+    void setRandomSeed(const uint64_t seed) { m_randomSeed = seed; }
+
+    /// Total time spent updating the scenario triggers, in microseconds
+    int64_t scenarioTime() const noexcept { return m_scenarioTime; }
+
     const std::shared_ptr<Player> &humanPlayer() { return m_humanPlayer; }
 
     std::shared_ptr<Player> player(int id);
@@ -124,6 +150,14 @@ private:
 
     GameType m_gameType = GameType::Default;
 
+    uint64_t m_randomSeed = 0;
+    uint64_t m_tickCount = 0;
+    uint64_t m_stateHash = 0;
+    Time m_lastUpdateTime = -1;
+    Time m_timeAccumulated = 0;
+    bool m_lastTickUpdated = false;
+    int64_t m_scenarioTime = 0;
+
     std::unique_ptr<ScenarioController> m_scenarioController;
 
     ResourceMap m_tradingPrices = {
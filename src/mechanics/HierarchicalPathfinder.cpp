@@ -0,0 +1,468 @@
+#include "HierarchicalPathfinder.h"
+
+#include "PassabilityMap.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+static const float s_infinity = std::numeric_limits<float>::infinity();
+
+HierarchicalPathfinder::HierarchicalPathfinder(const PassabilityMap &passability) :
+    m_passability(passability)
+{
+}
+
+void HierarchicalPathfinder::resize(const int cols, const int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+    m_clusterCols = (cols + ClusterSize - 1) / ClusterSize;
+    m_clusterRows = (rows + ClusterSize - 1) / ClusterSize;
+
+    // Built again lazily
+    m_layers.clear();
+}
+
+void HierarchicalPathfinder::invalidateTile(const int col, const int row) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    const int cluster = clusterAt(col, row);
+
+    for (std::pair<const int, Layer> &it : m_layers) {
+        Layer &layer = it.second;
+        layer.dirty = true;
+        layer.dirtyClusters[cluster] = true;
+
+        // The entrances on the borders are shared with the neighbors
+        if (col % ClusterSize == 0 && col > 0) {
+            layer.dirtyClusters[cluster - 1] = true;
+        }
+        if (col % ClusterSize == ClusterSize - 1 && col < m_cols - 1) {
+            layer.dirtyClusters[cluster + 1] = true;
+        }
+        if (row % ClusterSize == 0 && row > 0) {
+            layer.dirtyClusters[cluster - m_clusterCols] = true;
+        }
+        if (row % ClusterSize == ClusterSize - 1 && row < m_rows - 1) {
+            layer.dirtyClusters[cluster + m_clusterCols] = true;
+        }
+    }
+}
+
+std::vector<MapPos> HierarchicalPathfinder::findPath(const MapPos &start, const MapPos &end, const int terrainRestriction)
+{
+    if (IS_UNLIKELY(start.x < 0 || start.y < 0 || end.x < 0 || end.y < 0)) {
+        return {};
+    }
+
+    Tile startTile;
+    startTile.col = start.x / Constants::TILE_SIZE;
+    startTile.row = start.y / Constants::TILE_SIZE;
+
+    Tile goalTile;
+    goalTile.col = end.x / Constants::TILE_SIZE;
+    goalTile.row = end.y / Constants::TILE_SIZE;
+
+    if (!isWalkable(startTile.col, startTile.row, terrainRestriction) || !isWalkable(goalTile.col, goalTile.row, terrainRestriction)) {
+        return {};
+    }
+
+    Layer &graph = layer(terrainRestriction);
+    rebuild(graph, terrainRestriction);
+
+    const int startCluster = clusterAt(startTile.col, startTile.row);
+    const int goalCluster = clusterAt(goalTile.col, goalTile.row);
+
+    std::vector<float> startDistances;
+    clusterDistances(startTile, startCluster, terrainRestriction, &startDistances);
+
+    std::vector<float> goalDistances;
+    clusterDistances(goalTile, goalCluster, terrainRestriction, &goalDistances);
+
+    // The start and goal are inserted as two extra nodes at the end
+    const int startNode = graph.nodes.size();
+    const int goalNode = startNode + 1;
+
+    std::vector<float> costs(graph.nodes.size() + 2, s_infinity);
+    std::vector<int> cameFrom(graph.nodes.size() + 2, -1);
+    std::vector<bool> closed(graph.nodes.size() + 2, false);
+
+    const auto tileOf = [&](const int node) -> const Tile & {
+        if (node == startNode) {
+            return startTile;
+        }
+        if (node == goalNode) {
+            return goalTile;
+        }
+        return graph.nodes[node].tile;
+    };
+
+    // octile distance
+    const auto heuristic = [&](const Tile &tile) {
+        const float dx = std::abs(tile.col - goalTile.col);
+        const float dy = std::abs(tile.row - goalTile.row);
+        return std::max(dx, dy) + (M_SQRT2 - 1.) * std::min(dx, dy);
+    };
+
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    const auto relax = [&](const int from, const int to, const float edgeCost) {
+        if (edgeCost == s_infinity || closed[to]) {
+            return;
+        }
+        const float cost = costs[from] + edgeCost;
+        if (cost >= costs[to]) {
+            return;
+        }
+        costs[to] = cost;
+        cameFrom[to] = from;
+        queue.emplace(cost + heuristic(tileOf(to)), to);
+    };
+
+    costs[startNode] = 0.f;
+    queue.emplace(heuristic(startTile), startNode);
+
+    while (!queue.empty()) {
+        const int current = queue.top().second;
+        queue.pop();
+
+        if (current == goalNode) {
+            break;
+        }
+
+        if (closed[current]) {
+            continue;
+        }
+        closed[current] = true;
+
+        if (current == startNode) {
+            const Cluster &cluster = graph.clusters[startCluster];
+            for (int i=0; i<cluster.nodeCount; i++) {
+                const int node = cluster.firstNode + i;
+                relax(current, node, startDistances[localIndex(graph.nodes[node].tile)]);
+            }
+
+            if (startCluster == goalCluster) {
+                relax(current, goalNode, startDistances[localIndex(goalTile)]);
+            }
+            continue;
+        }
+
+        const Node &node = graph.nodes[current];
+        const Cluster &cluster = graph.clusters[node.cluster];
+
+        for (int i=0; i<cluster.nodeCount; i++) {
+            if (i == node.local) {
+                continue;
+            }
+            relax(current, cluster.firstNode + i, cluster.distances[node.local * cluster.nodeCount + i]);
+        }
+
+        if (node.pair >= 0) {
+            relax(current, node.pair, 1.f);
+        }
+
+        if (node.cluster == goalCluster) {
+            relax(current, goalNode, goalDistances[localIndex(node.tile)]);
+        }
+    }
+
+    if (cameFrom[goalNode] == -1) {
+        return {};
+    }
+
+    std::vector<MapPos> path;
+    path.push_back(end);
+
+    for (int node = cameFrom[goalNode]; node != startNode && node != -1; node = cameFrom[node]) {
+        const Tile &tile = graph.nodes[node].tile;
+        path.emplace_back((tile.col + 0.5f) * Constants::TILE_SIZE, (tile.row + 0.5f) * Constants::TILE_SIZE);
+    }
+
+    return path;
+}
+
+HierarchicalPathfinder::Layer &HierarchicalPathfinder::layer(const int terrainRestriction)
+{
+    std::unordered_map<int, Layer>::iterator it = m_layers.find(terrainRestriction);
+    if (it != m_layers.end()) {
+        return it->second;
+    }
+
+    const size_t clusterCount = size_t(m_clusterCols) * size_t(m_clusterRows);
+
+    Layer &layer = m_layers[terrainRestriction];
+    layer.horizontalBorders.resize(clusterCount);
+    layer.verticalBorders.resize(clusterCount);
+    layer.clusters.resize(clusterCount);
+    layer.dirtyClusters.resize(clusterCount, true);
+    layer.dirty = true;
+
+    return layer;
+}
+
+void HierarchicalPathfinder::rebuild(Layer &layer, const int terrainRestriction)
+{
+    if (!layer.dirty) {
+        return;
+    }
+    TIME_THIS;
+
+    const size_t clusterCount = size_t(m_clusterCols) * size_t(m_clusterRows);
+
+    // Find the entrances on all borders of the changed clusters,
+    // and remember which clusters need to have their distances updated
+    std::vector<bool> changedClusters(clusterCount, false);
+    for (int clusterY = 0; clusterY < m_clusterRows; clusterY++) {
+        for (int clusterX = 0; clusterX < m_clusterCols; clusterX++) {
+            const int cluster = clusterY * m_clusterCols + clusterX;
+            if (!layer.dirtyClusters[cluster]) {
+                continue;
+            }
+            changedClusters[cluster] = true;
+
+            const int left = clusterX * ClusterSize;
+            const int top = clusterY * ClusterSize;
+            const int width = std::min(ClusterSize, m_cols - left);
+            const int height = std::min(ClusterSize, m_rows - top);
+
+            if (clusterY > 0) {
+                changedClusters[cluster - m_clusterCols] = true;
+                findEntrances(&layer.horizontalBorders[cluster - m_clusterCols], {int16_t(left), int16_t(top - 1)}, 1, 0, width, terrainRestriction);
+            }
+            if (clusterY < m_clusterRows - 1) {
+                changedClusters[cluster + m_clusterCols] = true;
+                findEntrances(&layer.horizontalBorders[cluster], {int16_t(left), int16_t(top + height - 1)}, 1, 0, width, terrainRestriction);
+            }
+            if (clusterX > 0) {
+                changedClusters[cluster - 1] = true;
+                findEntrances(&layer.verticalBorders[cluster - 1], {int16_t(left - 1), int16_t(top)}, 0, 1, height, terrainRestriction);
+            }
+            if (clusterX < m_clusterCols - 1) {
+                changedClusters[cluster + 1] = true;
+                findEntrances(&layer.verticalBorders[cluster], {int16_t(left + width - 1), int16_t(top)}, 0, 1, height, terrainRestriction);
+            }
+
+            layer.dirtyClusters[cluster] = false;
+        }
+    }
+
+    // Cheap enough to just recreate all the nodes, the distances are the expensive part
+    layer.nodes.clear();
+    std::vector<Tile> tiles;
+    for (int clusterY = 0; clusterY < m_clusterRows; clusterY++) {
+        for (int clusterX = 0; clusterX < m_clusterCols; clusterX++) {
+            const int clusterIndex = clusterY * m_clusterCols + clusterX;
+            collectNodes(layer, clusterX, clusterY, &tiles);
+
+            Cluster &cluster = layer.clusters[clusterIndex];
+            cluster.firstNode = layer.nodes.size();
+            cluster.nodeCount = tiles.size();
+
+            for (size_t i=0; i<tiles.size(); i++) {
+                Node node;
+                node.tile = tiles[i];
+                node.cluster = clusterIndex;
+                node.local = i;
+                layer.nodes.push_back(node);
+            }
+        }
+    }
+
+    // Connect the nodes on each side of the entrances, the order is given by collectNodes()
+    for (int clusterY = 0; clusterY < m_clusterRows; clusterY++) {
+        for (int clusterX = 0; clusterX < m_clusterCols; clusterX++) {
+            const int clusterIndex = clusterY * m_clusterCols + clusterX;
+            const Cluster &cluster = layer.clusters[clusterIndex];
+
+            const int topCount = clusterY > 0 ? layer.horizontalBorders[clusterIndex - m_clusterCols].size() : 0;
+            const int bottomCount = clusterY < m_clusterRows - 1 ? layer.horizontalBorders[clusterIndex].size() : 0;
+            const int leftCount = clusterX > 0 ? layer.verticalBorders[clusterIndex - 1].size() : 0;
+            const int rightCount = clusterX < m_clusterCols - 1 ? layer.verticalBorders[clusterIndex].size() : 0;
+
+            // The bottom entrances are the top entrances of the one below
+            for (int i=0; i<bottomCount; i++) {
+                const int node = cluster.firstNode + topCount + i;
+                const int other = layer.clusters[clusterIndex + m_clusterCols].firstNode + i;
+                layer.nodes[node].pair = other;
+                layer.nodes[other].pair = node;
+            }
+
+            // And the right entrances are the left entrances of the one to the right
+            if (rightCount > 0) {
+                const int otherIndex = clusterIndex + 1;
+                const int otherTopCount = clusterY > 0 ? layer.horizontalBorders[otherIndex - m_clusterCols].size() : 0;
+                const int otherBottomCount = clusterY < m_clusterRows - 1 ? layer.horizontalBorders[otherIndex].size() : 0;
+
+                for (int i=0; i<rightCount; i++) {
+                    const int node = cluster.firstNode + topCount + bottomCount + leftCount + i;
+                    const int other = layer.clusters[otherIndex].firstNode + otherTopCount + otherBottomCount + i;
+                    layer.nodes[node].pair = other;
+                    layer.nodes[other].pair = node;
+                }
+            }
+        }
+    }
+
+    std::vector<float> distances;
+    for (size_t clusterIndex = 0; clusterIndex < clusterCount; clusterIndex++) {
+        if (!changedClusters[clusterIndex]) {
+            continue;
+        }
+
+        Cluster &cluster = layer.clusters[clusterIndex];
+        cluster.distances.assign(cluster.nodeCount * cluster.nodeCount, s_infinity);
+
+        for (int i=0; i<cluster.nodeCount; i++) {
+            clusterDistances(layer.nodes[cluster.firstNode + i].tile, clusterIndex, terrainRestriction, &distances);
+
+            for (int j=0; j<cluster.nodeCount; j++) {
+                cluster.distances[i * cluster.nodeCount + j] = distances[localIndex(layer.nodes[cluster.firstNode + j].tile)];
+            }
+        }
+    }
+
+    layer.dirty = false;
+}
+
+void HierarchicalPathfinder::findEntrances(std::vector<Tile> *entrances, const Tile &first, const int dx, const int dy, const int length, const int terrainRestriction) const
+{
+    entrances->clear();
+
+    // Long openings get an entrance at each end, short ones only in the middle
+    static const int maxSingleEntranceLength = 6;
+
+    int runStart = -1;
+    for (int i=0; i<=length; i++) {
+        const int col = first.col + i * dx;
+        const int row = first.row + i * dy;
+
+        // The other side is the tile below or to the right
+        const bool isOpen = i < length &&
+                isWalkable(col, row, terrainRestriction) &&
+                isWalkable(col + dy, row + dx, terrainRestriction);
+
+        if (isOpen) {
+            if (runStart == -1) {
+                runStart = i;
+            }
+            continue;
+        }
+
+        if (runStart == -1) {
+            continue;
+        }
+
+        const int runLength = i - runStart;
+        if (runLength < maxSingleEntranceLength) {
+            const int middle = runStart + runLength / 2;
+            entrances->push_back({int16_t(first.col + middle * dx), int16_t(first.row + middle * dy)});
+        } else {
+            entrances->push_back({int16_t(first.col + runStart * dx), int16_t(first.row + runStart * dy)});
+            entrances->push_back({int16_t(first.col + (i - 1) * dx), int16_t(first.row + (i - 1) * dy)});
+        }
+
+        runStart = -1;
+    }
+}
+
+void HierarchicalPathfinder::collectNodes(const Layer &layer, const int clusterX, const int clusterY, std::vector<Tile> *tiles) const
+{
+    tiles->clear();
+
+    const int cluster = clusterY * m_clusterCols + clusterX;
+
+    // top, bottom, left, right, the entrance tiles are stored from the upper/left side
+    if (clusterY > 0) {
+        for (const Tile &tile : layer.horizontalBorders[cluster - m_clusterCols]) {
+            tiles->push_back({tile.col, int16_t(tile.row + 1)});
+        }
+    }
+    if (clusterY < m_clusterRows - 1) {
+        tiles->insert(tiles->end(), layer.horizontalBorders[cluster].begin(), layer.horizontalBorders[cluster].end());
+    }
+    if (clusterX > 0) {
+        for (const Tile &tile : layer.verticalBorders[cluster - 1]) {
+            tiles->push_back({int16_t(tile.col + 1), tile.row});
+        }
+    }
+    if (clusterX < m_clusterCols - 1) {
+        tiles->insert(tiles->end(), layer.verticalBorders[cluster].begin(), layer.verticalBorders[cluster].end());
+    }
+}
+
+void HierarchicalPathfinder::clusterDistances(const Tile &start, const int cluster, const int terrainRestriction, std::vector<float> *distances) const
+{
+    distances->assign(ClusterSize * ClusterSize, s_infinity);
+
+    const int left = (cluster % m_clusterCols) * ClusterSize;
+    const int top = (cluster / m_clusterCols) * ClusterSize;
+    const int right = std::min(left + ClusterSize, m_cols);
+    const int bottom = std::min(top + ClusterSize, m_rows);
+
+    typedef std::pair<float, Tile> QueueEntry;
+    const auto compare = [](const QueueEntry &a, const QueueEntry &b) { return a.first > b.first; };
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, decltype(compare)> queue(compare);
+
+    (*distances)[localIndex(start)] = 0.f;
+    queue.emplace(0.f, start);
+
+    while (!queue.empty()) {
+        const float distance = queue.top().first;
+        const Tile tile = queue.top().second;
+        queue.pop();
+
+        if (distance > (*distances)[localIndex(tile)]) {
+            continue;
+        }
+
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if (!dx && !dy) {
+                    continue;
+                }
+
+                const int col = tile.col + dx;
+                const int row = tile.row + dy;
+                if (col < left || row < top || col >= right || row >= bottom) {
+                    continue;
+                }
+
+                if (!isWalkable(col, row, terrainRestriction)) {
+                    continue;
+                }
+
+                // Don't cut corners
+                if (dx && dy && (!isWalkable(tile.col + dx, tile.row, terrainRestriction) || !isWalkable(tile.col, tile.row + dy, terrainRestriction))) {
+                    continue;
+                }
+
+                const Tile next = {int16_t(col), int16_t(row)};
+                const float newDistance = distance + ((dx && dy) ? float(M_SQRT2) : 1.f);
+                float &oldDistance = (*distances)[localIndex(next)];
+                if (newDistance >= oldDistance) {
+                    continue;
+                }
+
+                oldDistance = newDistance;
+                queue.emplace(newDistance, next);
+            }
+        }
+    }
+}
+
+bool HierarchicalPathfinder::isWalkable(const int col, const int row, const int terrainRestriction) const noexcept
+{
+    return m_passability.isTerrainPassable(col, row, terrainRestriction) && !m_passability.isTileBlocked(col, row);
+}
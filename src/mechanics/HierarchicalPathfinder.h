@@ -0,0 +1,100 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class PassabilityMap;
+
+/// Coarse pathfinding over the whole map (HPA*).
+///
+/// The map is split into square clusters of tiles, and for each terrain
+/// restriction we keep a graph of the entrances between neighboring clusters
+/// with the precomputed walking distances between the entrances of each
+/// cluster. Long paths are then searched for in this graph instead of on the
+/// pixel grid, and only the first part needs to be refined by the caller.
+///
+/// Only static obstructions are considered (terrain and buildings), units
+/// walking around are left for the refinement.
+class HierarchicalPathfinder
+{
+public:
+    static constexpr int ClusterSize = 10;
+
+    HierarchicalPathfinder(const PassabilityMap &passability);
+
+    void resize(const int cols, const int rows);
+
+    /// Call when the terrain or a building at a tile changes, the affected
+    /// clusters are rebuilt on the next search.
+    void invalidateTile(const int col, const int row) noexcept;
+
+    /// @return waypoints in map coordinates from @p end back to the first
+    /// one after @p start (so the next waypoint is at the back, like ActionMove
+    /// wants it), or empty if there is no path.
+    std::vector<MapPos> findPath(const MapPos &start, const MapPos &end, const int terrainRestriction);
+
+private:
+    struct Tile {
+        int16_t col = 0;
+        int16_t row = 0;
+    };
+
+    struct Node {
+        Tile tile;
+        int cluster = 0;
+        int local = 0;
+
+        /// The node on the other side of the entrance
+        int pair = -1;
+    };
+
+    struct Cluster {
+        int firstNode = 0;
+        int nodeCount = 0;
+
+        /// nodeCount * nodeCount, walking distances between the entrances
+        std::vector<float> distances;
+    };
+
+    struct Layer {
+        /// Entrances between cluster (x, y) and (x, y+1), the tile stored is on the upper side
+        std::vector<std::vector<Tile>> horizontalBorders;
+
+        /// Entrances between cluster (x, y) and (x+1, y), the tile stored is on the left side
+        std::vector<std::vector<Tile>> verticalBorders;
+
+        std::vector<Cluster> clusters;
+        std::vector<Node> nodes;
+
+        std::vector<bool> dirtyClusters;
+        bool dirty = true;
+    };
+
+    Layer &layer(const int terrainRestriction);
+    void rebuild(Layer &layer, const int terrainRestriction);
+    void findEntrances(std::vector<Tile> *entrances, const Tile &first, const int dx, const int dy, const int length, const int terrainRestriction) const;
+    void collectNodes(const Layer &layer, const int clusterX, const int clusterY, std::vector<Tile> *tiles) const;
+
+    /// Dijkstra from @p start constrained to one cluster, returns the distance to each tile in it
+    void clusterDistances(const Tile &start, const int cluster, const int terrainRestriction, std::vector<float> *distances) const;
+
+    inline bool isWalkable(const int col, const int row, const int terrainRestriction) const noexcept;
+    inline int clusterAt(const int col, const int row) const noexcept {
+        return (row / ClusterSize) * m_clusterCols + col / ClusterSize;
+    }
+    inline int localIndex(const Tile &tile) const noexcept {
+        return (tile.row % ClusterSize) * ClusterSize + tile.col % ClusterSize;
+    }
+
+    const PassabilityMap &m_passability;
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_clusterCols = 0;
+    int m_clusterRows = 0;
+
+    std::unordered_map<int, Layer> m_layers;
+};
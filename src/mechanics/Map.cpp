@@ -34,6 +34,7 @@
 #include "resource/TerrainSprite.h"
 #include "mechanics/Entity.h"
 
+#include <genie/dat/Unit.h>
 #include <genie/script/scn/MapDescription.h>
 
 Map::Map() //: map_txt_(0)
@@ -63,7 +64,11 @@ void Map::setupBasic() noexcept
 
     const size_t tileCount = size_t(cols_) * size_t(rows_); // explicit casting to silence static analyzers
     tiles_.resize(tileCount, grass);
-    m_tileUnits.resize(tileCount);
+    m_entities.resize(cols_, rows_);
+    m_dirtyRegions.resize(cols_, rows_);
+    m_passability.resize(cols_, rows_);
+    m_buildability.resize(cols_, rows_);
+    m_pathfinder.resize(cols_, rows_);
 
     for (int i=6; i<10; i++) {
         getTileAt(0, i).terrainId = 2;
@@ -102,7 +107,11 @@ void Map::setupAllunitsMap() noexcept
 
     const size_t tileCount = size_t(cols_) * size_t(rows_); // explicit cast -> silent static analyzers
     tiles_.resize(tileCount, water);
-    m_tileUnits.resize(tileCount);
+    m_entities.resize(cols_, rows_);
+    m_dirtyRegions.resize(cols_, rows_);
+    m_passability.resize(cols_, rows_);
+    m_buildability.resize(cols_, rows_);
+    m_pathfinder.resize(cols_, rows_);
 
     // add some grass
     for (int i = 0; i < 20; i++) {
@@ -163,7 +172,11 @@ void Map::create(const genie::ScnMap &mapDescription) noexcept
 
     const size_t tileCount = size_t(cols_) * size_t(rows_); // explicit casts make static analyzers (lgtm) happy
     tiles_.resize(tileCount);
-    m_tileUnits.resize(tileCount);
+    m_entities.resize(cols_, rows_);
+    m_dirtyRegions.resize(cols_, rows_);
+    m_passability.resize(cols_, rows_);
+    m_buildability.resize(cols_, rows_);
+    m_pathfinder.resize(cols_, rows_);
 
     for (size_t i = 0; i < tiles_.size(); i++) {
         const int col = i % cols_;
@@ -243,6 +256,10 @@ void Map::setTileAt(unsigned col, unsigned row, unsigned id) noexcept
     }
 
     tiles_[index].terrainId = id;
+    m_passability.setTerrain(index % cols_, index / cols_, id);
+    m_pathfinder.invalidateTile(index % cols_, index / cols_);
+    m_buildability.invalidateTile(index % cols_, index / cols_);
+    m_dirtyRegions.markDirty(index % cols_, index / cols_);
     m_updated = true;
 }
 
@@ -255,10 +272,14 @@ bool Map::updateTileAt(const int col, const int row, unsigned id) noexcept
     }
 
     tiles_[index].terrainId = id;
+    m_passability.setTerrain(index % cols_, index / cols_, id);
+    m_pathfinder.invalidateTile(index % cols_, index / cols_);
+    m_buildability.invalidateTile(index % cols_, index / cols_);
     tiles_[index].frame = AssetManager::Inst()->getTerrain(tiles_[index].terrainId)->coordinatesToFrame(col, row);
     for (int col_ = std::max(col - 1, 0); col_ < std::min(col + 2, cols_); col_++) {
         for (int row_ = std::max(row - 1, 0); row_ < std::min(row + 2, rows_); row_++) {
             getTileAt(col_, row_).reset();
+            m_dirtyRegions.markDirty(col_, row_);
         }
     }
 
@@ -278,36 +299,63 @@ bool Map::updateTileAt(const int col, const int row, unsigned id) noexcept
     return true;
 }
 
+static bool obstructionFor(const Unit &unit, PassabilityMap::Obstruction *obstruction)
+{
+    if (unit.data()->Size.z == 0) {
+        return false;
+    }
+
+    switch (unit.data()->ObstructionType) {
+    case genie::Unit::PassableObstruction:
+    case genie::Unit::PassableObstruction2:
+    case genie::Unit::PassableNoOutlineObstruction:
+        return false;
+    case genie::Unit::BuildingObstruction:
+    case genie::Unit::MountainObstruction: // TOOD:  apparently uses the selection mask?
+        obstruction->blocksTile = true;
+        break;
+    case genie::Unit::UnitObstruction:
+    default:
+        obstruction->blocksTile = false;
+        break;
+    }
+
+    const Size size = unit.clearanceSize();
+    obstruction->entityId = unit.id;
+    obstruction->playerId = unit.playerId;
+    obstruction->position = unit.position();
+    obstruction->radius = std::max(size.width, size.height);
+    obstruction->footprint = Size(unit.data()->Size.x, unit.data()->Size.y);
+
+    return true;
+}
+
 void Map::removeEntityAt(unsigned int col, unsigned int row, const int entityId) noexcept
 {
+    // The grid only holds raw pointers, so make sure it is gone even if the position is weird
+    const bool wasOnMap = m_entities.contains(entityId);
+    m_entities.remove(entityId);
+
     unsigned int index = row * cols_ + col;
 
-    if (IS_UNLIKELY(index >= m_tileUnits.size())) {
+    if (IS_UNLIKELY(index >= tiles_.size())) {
         WARN << "Trying to remove unit out of range" << col << row;
         return;
     }
 
-    std::vector<std::weak_ptr<Entity>>::iterator it=m_tileUnits[index].begin();
-    while (it != m_tileUnits[index].end()) {
-        if (it->expired()) {
-            it = m_tileUnits[index].erase(it);
-            continue;
-        }
-        EntityPtr entity = it->lock();
-        if (!entity) {
-            it = m_tileUnits[index].erase(it);
-            continue;
-        }
-
-        if (entity->id == entityId) {
-            m_tileUnits[index].erase(it);
-
-            emit(Signals::UnitsChanged);
+    const PassabilityMap::Obstruction *obstruction = m_passability.obstruction(col, row, entityId);
+    if (obstruction) {
+        m_buildability.removeObstruction(col, row, *obstruction);
+    }
 
-            return;
-        }
+    const bool wasBlocked = m_passability.isTileBlocked(col, row);
+    m_passability.removeObstruction(col, row, entityId);
+    if (wasBlocked != m_passability.isTileBlocked(col, row)) {
+        m_pathfinder.invalidateTile(col, row);
+    }
 
-        it++;
+    if (wasOnMap) {
+        emit(Signals::UnitsChanged);
     }
 }
 
@@ -315,7 +363,7 @@ void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
 {
     unsigned int index = row * cols_ + col;
 
-    if (IS_UNLIKELY(index >= m_tileUnits.size())) {
+    if (IS_UNLIKELY(index >= tiles_.size())) {
         WARN << "Trying to add unit out of range" << col << row;
         return;
     }
@@ -323,7 +371,7 @@ void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
     // just to be sure
     removeEntityAt(col, row, entity->id);
 
-    m_tileUnits[index].push_back(entity);
+    m_entities.add(col, row, entity.get());
 
     emit(Signals::UnitsChanged);
 
@@ -332,6 +380,17 @@ void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
     }
 
     Unit::Ptr unit = Unit::fromEntity(entity);
+
+    PassabilityMap::Obstruction obstruction;
+    if (obstructionFor(*unit, &obstruction)) {
+        const bool wasBlocked = m_passability.isTileBlocked(col, row);
+        m_passability.addObstruction(col, row, obstruction);
+        m_buildability.addObstruction(col, row, obstruction);
+        if (wasBlocked != m_passability.isTileBlocked(col, row)) {
+            m_pathfinder.invalidateTile(col, row);
+        }
+    }
+
     const int newTerrain = unit->data()->Building.FoundationTerrainID;
 
     if (newTerrain < 0) {
@@ -364,6 +423,15 @@ void Map::addEntityAt(int col, int row, const EntityPtr &entity) noexcept
 
 
 
+void Map::updateEntityAt(int col, int row, const Entity &entity) noexcept
+{
+    if (!entity.isUnit()) {
+        return;
+    }
+
+    m_passability.moveObstruction(col, row, entity.id, entity.position());
+}
+
 void Map::updateMapData() noexcept
 {
     TIME_THIS;
@@ -373,9 +441,14 @@ void Map::updateMapData() noexcept
             MapTile &tile = tiles_[row * cols_ + col];
             tile.reset();
             tile.frame = AssetManager::Inst()->getTerrain(tile.terrainId)->coordinatesToFrame(col, row);
+            m_passability.setTerrain(col, row, tile.terrainId);
         }
     }
 
+    // Everything changed, so just throw away the cached graphs
+    m_pathfinder.resize(cols_, rows_);
+    m_buildability.invalidateAll();
+
     for (int col = 0; col < cols_; col++) {
         for (int row = 0; row < rows_; row++) {
             updateTileBlend(col, row);
@@ -386,8 +459,10 @@ void Map::updateMapData() noexcept
     for (int col = 0; col < cols_; col++) {
         for (int row = 0; row < rows_; row++) {
             updateTileSlopes(col, row);
+            m_passability.setElevation(col, row, elevationAt(MapPos((col + 0.5) * Constants::TILE_SIZE, (row + 0.5) * Constants::TILE_SIZE)));
         }
     }
+    m_dirtyRegions.markAllDirty();
     m_updated = true;
 
     emit(Signals::TerrainChanged);
@@ -20,10 +20,16 @@
 
 #include <assert.h>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "BuildabilityMap.h"
+#include "EntityGrid.h"
+#include "HierarchicalPathfinder.h"
 #include "MapTile.h"
+#include "PassabilityMap.h"
 #include "core/Constants.h"
+#include "core/DirtyRegions.h"
 #include "core/SignalEmitter.h"
 #include "core/Utility.h"
 #include "core/Types.h"
@@ -112,23 +118,27 @@ public:
     void removeEntityAt(unsigned int col, unsigned int row, const int entityId) noexcept;
     void addEntityAt(int col, int row, const EntityPtr &entity) noexcept;
 
-    inline const std::vector<std::weak_ptr<Entity>> &entitiesAt(unsigned int col, unsigned int row) const noexcept {
-        unsigned int index = row * cols_ + col;
-        if (IS_UNLIKELY(index >= m_tileUnits.size())) {
-            static const std::vector<std::weak_ptr<Entity>> nullVector;
-            return nullVector;
-        }
-        return m_tileUnits[index];
+    /// For when an entity moves without changing tile
+    void updateEntityAt(int col, int row, const Entity &entity) noexcept;
+
+    const PassabilityMap &passability() const noexcept { return m_passability; }
+    const BuildabilityMap &buildability() const noexcept { return m_buildability; }
+    HierarchicalPathfinder &pathfinder() noexcept { return m_pathfinder; }
+
+    template<typename Visitor>
+    inline void forEachEntityAt(const int col, const int row, Visitor &&visit) const {
+        m_entities.forEachAt(col, row, std::forward<Visitor>(visit));
     }
 
-    inline const std::vector<std::weak_ptr<Entity>> entitiesBetween(int firstCol, int firstRow, int lastCol, int lastRow) const noexcept {
-        std::vector<std::weak_ptr<Entity>> entities;
-        for (int col=firstCol; col<lastCol; col++) {
-            for (int row=firstRow; row<lastRow; row++) {
-                entities.insert(entities.end(), entitiesAt(col, row).begin(), entitiesAt(col, row).end());
-            }
-        }
-        return entities;
+    /// The last column and row are not included
+    template<typename Visitor>
+    inline void forEachEntityBetween(const int firstCol, const int firstRow, const int lastCol, const int lastRow, Visitor &&visit) const {
+        m_entities.forEachBetween(firstCol, firstRow, lastCol, lastRow, std::forward<Visitor>(visit));
+    }
+
+    template<typename Visitor>
+    inline void forEachEntityInRadius(const MapPos &center, const float radius, Visitor &&visit) const {
+        m_entities.forEachInRadius(center, radius, std::forward<Visitor>(visit));
     }
 
     void updateMapData() noexcept;
@@ -136,6 +146,9 @@ public:
     bool tilesUpdated() const noexcept { return m_updated; }
     void flushDirty() noexcept { m_updated = false; }
 
+    /// Which parts of the terrain have changed, for caching the rendering
+    const DirtyRegions &dirtyRegions() const noexcept { return m_dirtyRegions; }
+
     inline bool isValidTile(const unsigned col, const unsigned row) const {
         if (IS_UNLIKELY(row * cols_ + col >= tiles_.size())) {
             return false;
@@ -164,7 +177,12 @@ private:
     typedef std::vector<MapTile> MapTileArray;
     MapTileArray tiles_;
 
-    std::vector<std::vector<std::weak_ptr<Entity>>> m_tileUnits;
+    EntityGrid m_entities;
+    DirtyRegions m_dirtyRegions;
+
+    PassabilityMap m_passability;
+    HierarchicalPathfinder m_pathfinder{m_passability};
+    BuildabilityMap m_buildability{m_passability};
 
     bool m_updated = false;
 };
@@ -13,6 +13,7 @@
 #include <utility>
 
 #include "audio/AudioPlayer.h"
+#include "core/ObjectPool.h"
 #include "resource/LanguageManager.h"
 #include "resource/AssetManager.h"
 #include "mechanics/UnitManager.h"
@@ -137,12 +138,12 @@ bool Missile::update(Time time) noexcept
         return false;
     }
 
-    if (m_data.Moving.TrackingUnit != -1&& rand() % 100 < m_data.Moving.TrackingUnitDensity * 100 * 0.15) {
+    if (m_data.Moving.TrackingUnit != -1&& m_unitManager.random().nextInt(100) < m_data.Moving.TrackingUnitDensity * 100 * 0.15) {
 //        DBG << (m_data.Moving.TrackingUnitDensity / 0.015) << time - m_previousSmokeTime ;
         m_previousSmokeTime = time;
         if (player) {
             const genie::Unit &trailingData = player->civilization.unitData(m_data.Moving.TrackingUnit);
-            DecayingEntity::Ptr trailingUnit = std::make_shared<DecayingEntity>(trailingData.StandingGraphic.first, 0.f);
+            DecayingEntity::Ptr trailingUnit = makePooled<DecayingEntity>(trailingData.StandingGraphic.first, 0.f);
             trailingUnit->setMap(m_map.lock());
             trailingUnit->setPosition(position());
             m_unitManager.addDecayingEntity(trailingUnit);
@@ -179,26 +180,28 @@ bool Missile::update(Time time) noexcept
 
         hitUnits.push_back(targetUnit);
     } else {
-        Unit::Ptr sourceUnit = m_sourceUnit.lock();
+        const Unit::Ptr sourceUnit = m_sourceUnit.lock();
         for (int dx = tileX-1; dx<=tileX+1; dx++) {
             for (int dy = tileY-1; dy<=tileY+1; dy++) {
-                const std::vector<std::weak_ptr<Entity>> &entities = map->entitiesAt(dx, dy);
-                if (entities.empty()) {
-                    continue;
-                }
+                // Only one hit per tile
+                bool hitInTile = false;
+
+                map->forEachEntityAt(dx, dy, [&](Entity &entity) {
+                    if (hitInTile) {
+                        return;
+                    }
 
-                for (const std::weak_ptr<Entity> &entity : entities) {
-                    Unit::Ptr otherUnit = Unit::fromEntity(entity);
+                    Unit *otherUnit = Unit::fromEntity(&entity);
                     if (IS_UNLIKELY(!otherUnit)) {
-                        continue;
+                        return;
                     }
 
-                    if (IS_UNLIKELY(otherUnit == sourceUnit)) {
-                        continue;
+                    if (IS_UNLIKELY(otherUnit == sourceUnit.get())) {
+                        return;
                     }
 
                     if (newPos.z > otherUnit->data()->Size.z) {
-                        continue;
+                        return;
                     }
 
                     const float xSize = (otherUnit->data()->Size.x + m_data.Size.x + m_blastRadius) * Constants::TILE_SIZE;
@@ -207,10 +210,10 @@ bool Missile::update(Time time) noexcept
                     const float yDistance = std::abs(otherUnit->position().y - newPos.y);
 
                     if (IS_UNLIKELY(xDistance < xSize && yDistance < ySize)) {
-                        hitUnits.push_back(otherUnit);
-                        break;
+                        hitUnits.push_back(Unit::fromEntity(otherUnit->shared_from_this()));
+                        hitInTile = true;
                     }
-                }
+                });
             }
         }
     }
@@ -0,0 +1,209 @@
+#include "PassabilityMap.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+#include "resource/DataManager.h"
+
+#include <genie/dat/TerrainRestriction.h>
+
+#include <algorithm>
+
+void PassabilityMap::resize(const int cols, const int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+
+    const size_t tileCount = size_t(cols) * size_t(rows);
+
+    // Copies might still be looking at the old ones
+    m_terrain = std::make_shared<Terrain>();
+
+    const size_t restrictionCount = DataManager::Inst().terrainRestrictions().size();
+    m_terrain->passable.assign(restrictionCount, std::vector<bool>(tileCount, false));
+    m_terrain->elevations.assign(tileCount, 0.f);
+
+    m_chunkCols = (cols + ChunkSize - 1) / ChunkSize;
+    const int chunkRows = (rows + ChunkSize - 1) / ChunkSize;
+    m_chunks.clear();
+    for (int i=0; i<m_chunkCols * chunkRows; i++) {
+        m_chunks.push_back(std::make_shared<Chunk>());
+    }
+
+    m_generation++;
+}
+
+void PassabilityMap::setTerrain(const int col, const int row, const int terrainId) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        WARN << "Trying to set terrain out of range" << col << row;
+        return;
+    }
+    const size_t index = row * m_cols + col;
+    Terrain &terrain = mutableTerrain();
+
+    const std::vector<genie::TerrainRestriction> &restrictions = DataManager::Inst().terrainRestrictions();
+    for (size_t i=0; i<terrain.passable.size() && i<restrictions.size(); i++) {
+        const std::vector<float> &multipliers = restrictions[i].PassableBuildableDmgMultiplier;
+        if (IS_UNLIKELY(terrainId < 0 || size_t(terrainId) >= multipliers.size())) {
+            terrain.passable[i][index] = false;
+            continue;
+        }
+
+        terrain.passable[i][index] = multipliers[terrainId] != 0;
+    }
+
+    m_generation++;
+}
+
+void PassabilityMap::setElevation(const int col, const int row, const float elevation) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    mutableTerrain().elevations[row * m_cols + col] = elevation;
+    m_generation++;
+}
+
+void PassabilityMap::addObstruction(const int col, const int row, const Obstruction &obstruction) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    Chunk &chunk = mutableChunk(col, row);
+    const size_t index = tileIndex(col, row);
+    std::vector<Obstruction> &obstructions = chunk.obstructions[index];
+    m_generation++;
+
+    // just to be sure
+    for (Obstruction &existing : obstructions) {
+        if (existing.entityId == obstruction.entityId) {
+            chunk.blocking[index] += int(obstruction.blocksTile) - int(existing.blocksTile);
+            existing = obstruction;
+            return;
+        }
+    }
+
+    obstructions.push_back(obstruction);
+    if (obstruction.blocksTile) {
+        chunk.blocking[index]++;
+    }
+}
+
+void PassabilityMap::removeObstruction(const int col, const int row, const size_t entityId) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    // Don't copy the chunk if there's nothing to remove
+    if (!obstruction(col, row, entityId)) {
+        return;
+    }
+
+    Chunk &chunk = mutableChunk(col, row);
+    const size_t index = tileIndex(col, row);
+    std::vector<Obstruction> &obstructions = chunk.obstructions[index];
+    for (size_t i=0; i<obstructions.size(); i++) {
+        if (obstructions[i].entityId != entityId) {
+            continue;
+        }
+
+        if (obstructions[i].blocksTile) {
+            chunk.blocking[index]--;
+        }
+        m_generation++;
+
+        // Order doesn't matter, so avoid shuffling everything around
+        obstructions[i] = obstructions.back();
+        obstructions.pop_back();
+        return;
+    }
+}
+
+void PassabilityMap::moveObstruction(const int col, const int row, const size_t entityId, const MapPos &position) noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return;
+    }
+
+    const Obstruction *existing = obstruction(col, row, entityId);
+    if (!existing || existing->position == position) {
+        return;
+    }
+
+    for (Obstruction &obstruction : mutableChunk(col, row).obstructions[tileIndex(col, row)]) {
+        if (obstruction.entityId == entityId) {
+            obstruction.position = position;
+            m_generation++;
+            return;
+        }
+    }
+}
+
+bool PassabilityMap::isFree(const MapPos &position, const float footprint, const size_t ignoredEntity) const noexcept
+{
+    const int tileX = position.x / Constants::TILE_SIZE;
+    const int tileY = position.y / Constants::TILE_SIZE;
+
+    for (int col = std::max(tileX - 1, 0); col <= std::min(tileX + 1, m_cols - 1); col++) {
+        for (int row = std::max(tileY - 1, 0); row <= std::min(tileY + 1, m_rows - 1); row++) {
+            for (const Obstruction &other : m_chunks[chunkIndex(col, row)]->obstructions[tileIndex(col, row)]) {
+                if (IS_UNLIKELY(other.entityId == ignoredEntity)) {
+                    continue;
+                }
+
+                if (other.blocksTile) {
+                    if (col == tileX && row == tileY) { // TODO: need to check the distance from the tile
+                        return false;
+                    }
+                    continue;
+                }
+
+                const float centreDistance = util::hypot(position.x - other.position.x, position.y - other.position.y, position.z - other.position.z);
+                if (centreDistance < std::max(footprint, other.radius)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+const PassabilityMap::Obstruction *PassabilityMap::obstruction(const int col, const int row, const size_t entityId) const noexcept
+{
+    if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+        return nullptr;
+    }
+
+    for (const Obstruction &obstruction : m_chunks[chunkIndex(col, row)]->obstructions[tileIndex(col, row)]) {
+        if (obstruction.entityId == entityId) {
+            return &obstruction;
+        }
+    }
+
+    return nullptr;
+}
+
+PassabilityMap::Terrain &PassabilityMap::mutableTerrain()
+{
+    // Only copies on this thread can add references, so this can't go up behind our back
+    if (m_terrain.use_count() > 1) {
+        m_terrain = std::make_shared<Terrain>(*m_terrain);
+    }
+
+    return *m_terrain;
+}
+
+PassabilityMap::Chunk &PassabilityMap::mutableChunk(const int col, const int row)
+{
+    std::shared_ptr<Chunk> &chunk = m_chunks[chunkIndex(col, row)];
+    if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+
+    return *chunk;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Map-wide passability information, shared between everything that moves.
+///
+/// Terrain passability is kept per terrain restriction at tile resolution,
+/// and units that obstruct movement are tracked per tile with their position
+/// and clearance, so lookups never need to touch (or lock) the entities.
+/// Everything is updated incrementally by Map, lookups are read only.
+///
+/// The data is kept in shared blocks, so copying the map for the pathfinding
+/// workers is cheap. A block is only copied when it is changed while a copy
+/// still holds on to it.
+class PassabilityMap
+{
+public:
+    struct Obstruction {
+        size_t entityId = 0;
+        MapPos position;
+        float radius = 0.f;
+
+        /// Buildings and mountains, blocks the whole tile they are on
+        bool blocksTile = false;
+
+        /// Half width and height in tiles, for the ones blocking tiles nothing
+        /// can be built anywhere inside it
+        Size footprint;
+
+        /// Units of other players prevent buildings from being placed on top of them
+        int playerId = -1;
+    };
+
+    void resize(const int cols, const int rows);
+    int columnCount() const noexcept { return m_cols; }
+    int rowCount() const noexcept { return m_rows; }
+
+    void setTerrain(const int col, const int row, const int terrainId) noexcept;
+    void setElevation(const int col, const int row, const float elevation) noexcept;
+
+    void addObstruction(const int col, const int row, const Obstruction &obstruction) noexcept;
+    void removeObstruction(const int col, const int row, const size_t entityId) noexcept;
+    void moveObstruction(const int col, const int row, const size_t entityId, const MapPos &position) noexcept;
+
+    inline bool isTerrainPassable(const int col, const int row, const int terrainRestriction) const noexcept {
+        if (IS_UNLIKELY(terrainRestriction < 0 || size_t(terrainRestriction) >= m_terrain->passable.size())) {
+            return false;
+        }
+        if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+            return false;
+        }
+
+        return m_terrain->passable[terrainRestriction][row * m_cols + col];
+    }
+
+    /// If there's a building or something else that blocks the entire tile
+    inline bool isTileBlocked(const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+            return true;
+        }
+
+        return m_chunks[chunkIndex(col, row)]->blocking[tileIndex(col, row)] > 0;
+    }
+
+    /// Elevation at the centre of the tile, close enough for clearance checks
+    inline float elevationAt(const int col, const int row) const noexcept {
+        if (IS_UNLIKELY(col < 0 || row < 0 || col >= m_cols || row >= m_rows)) {
+            return 0.f;
+        }
+
+        return m_terrain->elevations[row * m_cols + col];
+    }
+
+    /// Checks if something with the given footprint (radius in pixels) can stand at @p position,
+    /// @p ignoredEntity is the one asking, so it doesn't obstruct itself.
+    bool isFree(const MapPos &position, const float footprint, const size_t ignoredEntity) const noexcept;
+
+    /// The obstruction for @p entityId on the tile, if any
+    const Obstruction *obstruction(const int col, const int row, const size_t entityId) const noexcept;
+
+    /// Changes every time anything is changed, to know if a copy is outdated
+    uint64_t generation() const noexcept { return m_generation; }
+
+private:
+    static constexpr int ChunkSize = 16;
+
+    struct Terrain {
+        /// Indexed by terrain restriction, then tile
+        std::vector<std::vector<bool>> passable;
+
+        std::vector<float> elevations;
+    };
+
+    struct Chunk {
+        std::vector<Obstruction> obstructions[ChunkSize * ChunkSize];
+        uint16_t blocking[ChunkSize * ChunkSize] = {};
+    };
+
+    inline size_t chunkIndex(const int col, const int row) const noexcept {
+        return size_t(row / ChunkSize) * m_chunkCols + col / ChunkSize;
+    }
+    inline size_t tileIndex(const int col, const int row) const noexcept {
+        return (row % ChunkSize) * ChunkSize + col % ChunkSize;
+    }
+
+    /// Copies the terrain or chunk first if someone else is looking at it
+    Terrain &mutableTerrain();
+    Chunk &mutableChunk(const int col, const int row);
+
+    int m_cols = 0;
+    int m_rows = 0;
+    int m_chunkCols = 0;
+
+    uint64_t m_generation = 0;
+
+    std::shared_ptr<Terrain> m_terrain = std::make_shared<Terrain>();
+    std::vector<std::shared_ptr<Chunk>> m_chunks;
+};
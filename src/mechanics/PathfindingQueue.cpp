@@ -0,0 +1,382 @@
+#include "PathfindingQueue.h"
+
+#include "PassabilityMap.h"
+
+#include "core/Constants.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+struct SimplePathPoint {
+    SimplePathPoint(const int x_, const int y_) : x(x_), y(y_) {}
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const SimplePathPoint &other) const noexcept {
+        return x == other.x || y == other.y;
+    }
+};
+
+namespace { // anonymous namespace, don't export this
+struct PathPoint {
+    PathPoint() = default;
+
+    int8_t dx = 0;
+    int8_t dy = 0;
+
+    PathPoint(int64_t _x, int64_t _y) : x(_x), y(_y) {}
+
+    int32_t x = 0;
+    int32_t y = 0;
+    float pathLength = 0;
+    float distance = 0;
+
+    bool operator==(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
+        return x == other.x && y == other.y;
+    }
+    bool operator!=(const PathPoint &other) const noexcept {
+        return x != other.x || y != other.y;
+    }
+    bool operator<(const PathPoint &other) const noexcept DUMB_CLANG_IT_IS_USED {
+        return other.distance < distance;
+    }
+
+    inline operator SimplePathPoint () const {
+        return {x, y};
+    }
+};
+} //namespace
+template<> struct std::hash<PathPoint>
+{
+    std::size_t operator()(const PathPoint& point) const noexcept DUMB_CLANG_IT_IS_USED
+    {
+        return point.y * 255 * 48 + point.x;
+    }
+};
+
+template<> struct std::hash<SimplePathPoint>
+{
+    std::size_t operator()(const SimplePathPoint& point) const noexcept
+    {
+        return point.y * 255 * 48 + point.x;
+    }
+};
+
+static const float PATHFINDING_HEURISTIC_WEIGHT = 10;
+
+// Not a time limit, so the results don't depend on how fast the machine is
+static const size_t PATHFINDING_MAX_NODES = 100000;
+
+PathfindingQueue::PathfindingQueue()
+{
+    // Leave one for the main thread
+    const int workerCount = std::clamp(int(std::thread::hardware_concurrency()) - 1, 1, 4);
+    for (int i=0; i<workerCount; i++) {
+        m_workers.emplace_back(&PathfindingQueue::runWorker, this);
+    }
+}
+
+PathfindingQueue::~PathfindingQueue()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_jobsAvailable.notify_all();
+
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+PathfindingQueue::JobPtr PathfindingQueue::submit(const PathRequest &request)
+{
+    JobPtr job = std::make_shared<Job>();
+    job->m_request = request;
+    m_submitted.push_back(job);
+    return job;
+}
+
+void PathfindingQueue::dispatch(const PassabilityMap &passability)
+{
+    if (m_submitted.empty()) {
+        return;
+    }
+
+    // The ones asking might have given up already
+    m_submitted.erase(std::remove_if(m_submitted.begin(), m_submitted.end(), [](const JobPtr &job) {
+        return job.use_count() == 1;
+    }), m_submitted.end());
+
+    if (m_submitted.empty()) {
+        return;
+    }
+
+    TIME_THIS;
+
+    // Shared by all the jobs in this batch, and cheap to make because it
+    // shares everything with the live map until that changes
+    if (!m_lastSnapshot || m_lastSnapshot->generation() != passability.generation()) {
+        m_lastSnapshot = std::make_shared<PassabilityMap>(passability);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_snapshot = m_lastSnapshot;
+        m_queue.insert(m_queue.end(), m_submitted.begin(), m_submitted.end());
+        m_unfinished += m_submitted.size();
+    }
+    m_jobsAvailable.notify_all();
+
+    m_dispatched.insert(m_dispatched.end(), m_submitted.begin(), m_submitted.end());
+    m_submitted.clear();
+}
+
+void PathfindingQueue::collect()
+{
+    if (m_dispatched.empty()) {
+        return;
+    }
+
+    TIME_THIS;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobsDone.wait(lock, [this]() { return m_unfinished == 0; });
+        m_snapshot.reset();
+    }
+
+    for (const JobPtr &job : m_dispatched) {
+        job->m_finished = true;
+    }
+    m_dispatched.clear();
+}
+
+void PathfindingQueue::runWorker()
+{
+    while (true) {
+        JobPtr job;
+        std::shared_ptr<const PassabilityMap> snapshot;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobsAvailable.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+            if (m_quit) {
+                return;
+            }
+
+            job = m_queue.front();
+            m_queue.pop_front();
+            snapshot = m_snapshot;
+        }
+
+        const PathRequest &request = job->m_request;
+        job->m_path = findPath(*snapshot, request, request.coarseness);
+
+        // Uglier, but hopefully faster
+        if (job->m_path.empty() && request.allowCoarser) {
+            DBG << "failed to find path, trying 0.2 resolution";
+            job->m_path = findPath(*snapshot, request, 5);
+        }
+
+        if (job->m_path.empty() && request.allowCoarser) {
+            DBG << "failed to find path, trying 0.1 resolution";
+            job->m_path = findPath(*snapshot, request, 10);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_unfinished--;
+        }
+        m_jobsDone.notify_all();
+    }
+}
+
+bool PathfindingQueue::isPassable(const PassabilityMap &passability, const PathRequest &request, const float x, const float y) noexcept
+{
+    if (IS_UNLIKELY(x < 0 || y < 0)) {
+        return false;
+    }
+    const int tileX = x / Constants::TILE_SIZE;
+    const int tileY = y / Constants::TILE_SIZE;
+
+    if (!passability.isTerrainPassable(tileX, tileY, request.terrainRestriction)) {
+        return false;
+    }
+
+    const MapPos position(x, y, passability.elevationAt(tileX, tileY));
+    return passability.isFree(position, request.footprint, request.unitId);
+}
+
+std::vector<MapPos> PathfindingQueue::findPath(const PassabilityMap &passability, const PathRequest &request, const int coarseness) noexcept
+{
+    const MapPos &start = request.start;
+    const MapPos &end = request.end;
+
+    if (start == end) {
+        return {};
+    }
+
+    sf::Clock clock;
+
+    std::vector<MapPos> path;
+
+    const int startX = std::round(start.x / coarseness);
+    const int startY = std::round(start.y / coarseness);
+    const int endX = std::round(end.x / coarseness);
+    const int endY = std::round(end.y / coarseness);
+    if (startX == endX && startY == endY) {
+        DBG << "Already at right position" << start << end;
+        return {start};
+    }
+
+    if (!isPassable(passability, request, startX * coarseness, startY * coarseness)) {
+        WARN << "handed unpassable start";
+        return path;
+    }
+
+    if (!isPassable(passability, request, endX * coarseness, endY * coarseness)) {
+        WARN << "handed unpassable target";
+        return path;
+    }
+
+    MapRect targetRect(MapPos(endX-coarseness/2, endY-coarseness/2), Size(request.maxDistance / coarseness + coarseness, request.maxDistance / coarseness + coarseness));
+    if (request.targetSize.width > 0 || request.targetSize.height > 0) {
+        const Size size = request.targetSize / coarseness;
+        targetRect.width += size.width;
+        targetRect.height += size.height;
+        targetRect.x -= targetRect.width/2;
+        targetRect.y -= targetRect.height/2;
+    }
+
+    PathPoint currentPosition(startX, startY);
+
+    std::unordered_map<PathPoint, PathPoint> cameFrom;
+
+    // STL is a steaming pile of shit
+    std::priority_queue<PathPoint> queue;
+    currentPosition.distance = util::hypot(startX - endX, startY - endY);
+    currentPosition.pathLength = 0;
+    queue.push(currentPosition);
+
+    std::unordered_set<SimplePathPoint> visited;
+    visited.insert(currentPosition);
+
+    PathPoint parent;
+    size_t tried = 0;
+    while (!queue.empty()) {
+        tried++;
+        parent = queue.top();
+        queue.pop();
+
+        if (targetRect.contains(parent.x, parent.y)) {
+            break;
+        }
+
+        visited.insert(parent);
+
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if (!dx && !dy) {
+                    continue;
+                }
+
+                // Check if we're checking backwards
+                if (parent.dy == 0 && dy != 0 && parent.dx * dx < 0)  {
+                    continue;
+                }
+                if (parent.dx == 0 && dx != 0 && parent.dy * dy < 0) {
+                    continue;
+                }
+
+                const int nx = parent.x + dx;
+                const int ny = parent.y + dy;
+
+                // looking up in visited is expensive, try to avoid that
+                if (nx == parent.x && ny == parent.y) {
+                    continue;
+                }
+
+                // We already came from there
+                if (nx == parent.x + parent.dx && ny == parent.y + parent.dy) {
+                    continue;
+                }
+
+
+                SimplePathPoint position(nx, ny);
+                if (visited.find(position) != visited.end()) {
+                    continue;
+                }
+
+                if (!isPassable(passability, request, nx * coarseness, ny * coarseness)) {
+                    visited.insert(position);
+                    continue;
+                }
+                PathPoint pathPoint(nx, ny);
+
+
+                if (cameFrom.find(pathPoint) != cameFrom.end()) {
+                    if ((cameFrom[pathPoint].pathLength < parent.pathLength)) {
+                        continue;
+                    }
+                }
+
+                pathPoint.dx = dx;
+                pathPoint.dy = dx;
+
+                const int diagCost = 3;
+                const int straightCost = 2;
+                if (!dx || !dy) {
+                    pathPoint.pathLength = parent.pathLength + straightCost;
+                } else {
+                    pathPoint.pathLength = parent.pathLength + diagCost;
+                }
+
+                pathPoint.distance = pathPoint.pathLength + util::hypot(nx - endX, ny - endY) * PATHFINDING_HEURISTIC_WEIGHT * straightCost;
+                queue.push(pathPoint);
+
+                cameFrom[pathPoint] = parent;
+            }
+        }
+
+        if (tried > PATHFINDING_MAX_NODES) {
+            WARN << "Gave up pathing (" << tried << "nodes in" << clock.getElapsedTime().asMilliseconds() << "ms)";
+            DBG << "visited" << visited.size();
+            DBG << "queue size" << queue.size();
+            return path;
+        }
+    }
+    const int32_t elapsed = clock.getElapsedTime().asMilliseconds();
+    if (elapsed > 10) {
+        DBG << "walked" << tried << "nodes in" << elapsed << "ms";
+        DBG << "visited" << visited.size();
+    }
+
+    if (cameFrom.find(parent) == cameFrom.end()) {
+        WARN << "Failed to find path from" << startX << "," << startY << "to" << endX << "," << endY;
+        DBG << parent.x << parent.y;
+        return path;
+    }
+
+    path.push_back(end);
+
+    while (cameFrom[parent] != currentPosition) {
+        parent = cameFrom[parent];
+        path.emplace_back(parent.x * coarseness, parent.y * coarseness);
+
+        if (cameFrom.find(parent) == cameFrom.end()) {
+            WARN << "invalid path, failed to find previous step";
+            return path;
+        }
+    }
+
+    return path;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PassabilityMap;
+
+struct PathRequest {
+    MapPos start;
+    MapPos end;
+
+    int terrainRestriction = -1;
+    float footprint = 0.f;
+
+    /// The one asking, so it doesn't get in its own way
+    size_t unitId = 0;
+
+    /// How close to the end we need to get
+    float maxDistance = 0.f;
+    Size targetSize;
+
+    int coarseness = 2;
+
+    /// Try again with lower resolutions if nothing is found
+    bool allowCoarser = false;
+};
+
+/// Runs the pathfinding for moving units in worker threads.
+///
+/// Requests are collected during a sim tick, and at the end of it they are
+/// handed to the workers together with a snapshot of the passability, so the
+/// workers never touch the live map. The snapshot shares everything that
+/// hasn't changed with the live map, and is reused as long as nothing changes.
+/// The results are handed back before the units are updated in the next tick,
+/// regardless of how fast the workers are, so the outcome doesn't depend on
+/// the timing.
+class PathfindingQueue
+{
+public:
+    class Job
+    {
+        friend class PathfindingQueue;
+
+    public:
+        /// Set in the tick after the request was dispatched
+        bool isFinished() const noexcept { return m_finished; }
+        const PathRequest &request() const noexcept { return m_request; }
+
+        /// Same order as ActionMove wants, the next waypoint at the back
+        std::vector<MapPos> &path() noexcept { return m_path; }
+
+    private:
+        PathRequest m_request;
+        std::vector<MapPos> m_path;
+        bool m_finished = false;
+    };
+    typedef std::shared_ptr<Job> JobPtr;
+
+    PathfindingQueue();
+    ~PathfindingQueue();
+
+    JobPtr submit(const PathRequest &request);
+
+    /// Starts working on everything submitted since the last time
+    void dispatch(const PassabilityMap &passability);
+
+    /// Waits for the jobs from the last dispatch and hands over their results
+    void collect();
+
+    static std::vector<MapPos> findPath(const PassabilityMap &passability, const PathRequest &request, const int coarseness) noexcept;
+    static bool isPassable(const PassabilityMap &passability, const PathRequest &request, const float x, const float y) noexcept;
+
+private:
+    void runWorker();
+
+    std::vector<std::thread> m_workers;
+
+    /// Only touched from the main thread
+    std::vector<JobPtr> m_submitted;
+    std::vector<JobPtr> m_dispatched;
+    std::shared_ptr<const PassabilityMap> m_lastSnapshot;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobsAvailable;
+    std::condition_variable m_jobsDone;
+
+    // Guarded by m_mutex
+    std::deque<JobPtr> m_queue;
+    std::shared_ptr<const PassabilityMap> m_snapshot;
+    size_t m_unfinished = 0;
+    bool m_quit = false;
+};
@@ -6,6 +6,7 @@
 #include <genie/dat/Unit.h>
 #include <genie/dat/ResourceUsage.h>
 #include <stdint.h>
+#include <cstdlib>
 #include <utility>
 #include <vector>
 
@@ -452,8 +453,40 @@ struct EdgeTileLut {
 };
 } // anonymous namespace
 
+namespace {
+/// Half the width of each row in a line of sight circle, from the top.
+/// -1 for rows that are empty.
+const std::vector<int> &losStencil(const int lineOfSight)
+{
+    static std::vector<std::vector<int>> stencils;
+    if (size_t(lineOfSight) >= stencils.size()) {
+        stencils.resize(lineOfSight + 1);
+    }
+
+    std::vector<int> &stencil = stencils[lineOfSight];
+    if (!stencil.empty()) {
+        return stencil;
+    }
+
+    // Same as the old per-tile check, x*x + y*y < los*los
+    stencil.resize(lineOfSight * 2 + 1, -1);
+    const int radiusSquared = lineOfSight * lineOfSight;
+    for (int y=-lineOfSight; y<=lineOfSight; y++) {
+        int halfWidth = -1;
+        while ((halfWidth + 1) * (halfWidth + 1) + y * y < radiusSquared) {
+            halfWidth++;
+        }
+        stencil[y + lineOfSight] = halfWidth;
+    }
+
+    return stencil;
+}
+} // anonymous namespace
+
 VisibilityMap::VisibilityMap()
 {
+    m_dirtyRegions.resize(Constants::MAP_MAX_SIZE, Constants::MAP_MAX_SIZE);
+
 #ifdef CHEAT_VISIBILITY
     m_visibility.fill(Visible);
 #else
@@ -479,3 +512,157 @@ int VisibilityMap::edgeTileNum(const int tileX, const int tileY, const Visibilit
 
     return edgetileLut.values[edges];
 }
+
+void VisibilityMap::addLineOfSight(const int col, const int row, const int lineOfSight)
+{
+    if (lineOfSight <= 0) {
+        return;
+    }
+
+    const std::vector<int> &stencil = losStencil(lineOfSight);
+    for (int y=-lineOfSight; y<=lineOfSight; y++) {
+        const int halfWidth = stencil[y + lineOfSight];
+        if (halfWidth < 0) {
+            continue;
+        }
+        applySpan(row + y, col - halfWidth, col + halfWidth, true);
+    }
+}
+
+void VisibilityMap::removeLineOfSight(const int col, const int row, const int lineOfSight)
+{
+    if (lineOfSight <= 0) {
+        return;
+    }
+
+    const std::vector<int> &stencil = losStencil(lineOfSight);
+    for (int y=-lineOfSight; y<=lineOfSight; y++) {
+        const int halfWidth = stencil[y + lineOfSight];
+        if (halfWidth < 0) {
+            continue;
+        }
+        applySpan(row + y, col - halfWidth, col + halfWidth, false);
+    }
+}
+
+void VisibilityMap::moveLineOfSight(const int oldCol, const int oldRow, const int newCol, const int newRow, const int lineOfSight)
+{
+    if (oldCol == newCol && oldRow == newRow) {
+        return;
+    }
+
+    if (lineOfSight <= 0) {
+        return;
+    }
+
+    // Doesn't overlap, no point in looking at the differences
+    if (std::abs(oldCol - newCol) > lineOfSight * 2 || std::abs(oldRow - newRow) > lineOfSight * 2) {
+        addLineOfSight(newCol, newRow, lineOfSight);
+        removeLineOfSight(oldCol, oldRow, lineOfSight);
+        return;
+    }
+
+    const std::vector<int> &stencil = losStencil(lineOfSight);
+
+    const int firstRow = std::min(oldRow, newRow) - lineOfSight;
+    const int lastRow = std::max(oldRow, newRow) + lineOfSight;
+    for (int row = firstRow; row <= lastRow; row++) {
+        int oldFirst = 0, oldLast = -1;
+        if (std::abs(row - oldRow) <= lineOfSight) {
+            const int halfWidth = stencil[row - oldRow + lineOfSight];
+            oldFirst = oldCol - halfWidth;
+            oldLast = oldCol + halfWidth;
+        }
+
+        int newFirst = 0, newLast = -1;
+        if (std::abs(row - newRow) <= lineOfSight) {
+            const int halfWidth = stencil[row - newRow + lineOfSight];
+            newFirst = newCol - halfWidth;
+            newLast = newCol + halfWidth;
+        }
+
+        // Add first, so tiles that stay visible don't flicker to explored
+        if (oldFirst > oldLast) {
+            applySpan(row, newFirst, newLast, true);
+        } else if (newFirst <= newLast) {
+            applySpan(row, newFirst, std::min(newLast, oldFirst - 1), true);
+            applySpan(row, std::max(newFirst, oldLast + 1), newLast, true);
+        }
+
+        if (newFirst > newLast) {
+            applySpan(row, oldFirst, oldLast, false);
+        } else if (oldFirst <= oldLast) {
+            applySpan(row, oldFirst, std::min(oldLast, newFirst - 1), false);
+            applySpan(row, std::max(oldFirst, newLast + 1), oldLast, false);
+        }
+    }
+}
+
+size_t VisibilityMap::addDirtyListener()
+{
+    // Everything is new to them
+    DirtyRect rect;
+    rect.add(0, 0);
+    rect.add(Constants::MAP_MAX_SIZE - 1, Constants::MAP_MAX_SIZE - 1);
+
+    if (!m_freeDirtyListeners.empty()) {
+        const size_t listener = m_freeDirtyListeners.back();
+        m_freeDirtyListeners.pop_back();
+        m_dirtyRects[listener] = rect;
+        return listener;
+    }
+
+    m_dirtyRects.push_back(rect);
+
+    return m_dirtyRects.size() - 1;
+}
+
+void VisibilityMap::removeDirtyListener(const size_t listener)
+{
+    if (IS_UNLIKELY(listener >= m_dirtyRects.size())) {
+        WARN << "invalid listener" << listener;
+        return;
+    }
+
+    // The ones after it keep their indices
+    if (listener == m_dirtyRects.size() - 1) {
+        m_dirtyRects.pop_back();
+        return;
+    }
+
+    m_dirtyRects[listener] = DirtyRect();
+    m_freeDirtyListeners.push_back(listener);
+}
+
+VisibilityMap::DirtyRect VisibilityMap::takeDirtyRect(const size_t listener)
+{
+    if (IS_UNLIKELY(listener >= m_dirtyRects.size())) {
+        WARN << "invalid listener" << listener;
+        return {};
+    }
+
+    const DirtyRect rect = m_dirtyRects[listener];
+    m_dirtyRects[listener] = DirtyRect();
+    return rect;
+}
+
+void VisibilityMap::applySpan(const int row, int firstCol, int lastCol, const bool add)
+{
+    if (row < 0 || row >= Constants::MAP_MAX_SIZE) {
+        return;
+    }
+
+    firstCol = std::max(firstCol, 0);
+    lastCol = std::min(lastCol, Constants::MAP_MAX_SIZE - 1);
+
+    const size_t rowOffset = row * Constants::MAP_MAX_SIZE;
+    if (add) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            addLooking(rowOffset + col, col, row);
+        }
+    } else {
+        for (int col = firstCol; col <= lastCol; col++) {
+            removeLooking(rowOffset + col, col, row);
+        }
+    }
+}
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <stddef.h>
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "core/Constants.h"
+#include "core/DirtyRegions.h"
 #include "core/ResourceMap.h"
 #include "core/Types.h"
 #include "core/Utility.h"
@@ -21,14 +24,29 @@ class EffectCommand;
 
 struct VisibilityMap
 {
-    bool isDirty = true; // needs re-render
-
     enum Visibility : int {
         Unexplored = std::numeric_limits<int>::min(),
         Explored = 0,
         Visible
     };
 
+    /// Tiles that changed between Visible/Explored/Unexplored, inclusive
+    struct DirtyRect {
+        int firstCol = std::numeric_limits<int>::max();
+        int firstRow = std::numeric_limits<int>::max();
+        int lastCol = std::numeric_limits<int>::min();
+        int lastRow = std::numeric_limits<int>::min();
+
+        bool isEmpty() const noexcept { return firstCol > lastCol || firstRow > lastRow; }
+
+        inline void add(const int col, const int row) noexcept {
+            firstCol = std::min(firstCol, col);
+            firstRow = std::min(firstRow, row);
+            lastCol = std::max(lastCol, col);
+            lastRow = std::max(lastRow, row);
+        }
+    };
+
     VisibilityMap();
 
     inline Visibility visibilityAt(const MapPos &pos) const {
@@ -56,47 +74,88 @@ struct VisibilityMap
             return;
         }
         m_visibility[index] = Explored;
-        isDirty = true;
+        markDirty(tileX, tileY);
     }
 
     void addUnitLookingAt(const int tileX, const int tileY) {
-        const size_t index = tileY * Constants::MAP_MAX_SIZE + tileX;
-        if (IS_UNLIKELY(index >= m_visibility.size())) {
+        if (IS_UNLIKELY(!isOnMap(tileX, tileY))) {
             return;
         }
+        addLooking(tileY * Constants::MAP_MAX_SIZE + tileX, tileX, tileY);
+    }
+
+    void removeUnitLookingAt(const int tileX, const int tileY) {
+        if (IS_UNLIKELY(!isOnMap(tileX, tileY))) {
+            return;
+        }
+        removeLooking(tileY * Constants::MAP_MAX_SIZE + tileX, tileX, tileY);
+    }
+
+    /// All tiles closer than @p lineOfSight tiles to the center
+    void addLineOfSight(const int col, const int row, const int lineOfSight);
+    void removeLineOfSight(const int col, const int row, const int lineOfSight);
+
+    /// Only touches the tiles that differ between the old and the new area
+    void moveLineOfSight(const int oldCol, const int oldRow, const int newCol, const int newRow, const int lineOfSight);
+
+    int edgeTileNum(const int tileX, const int tileY, const Visibility type) const;
+
+    /// Each one redrawing from this gets their own dirty rect
+    size_t addDirtyListener();
 
+    /// When they stop looking, the slot is reused by the next one added
+    void removeDirtyListener(const size_t listener);
+
+    /// Returns what changed since the last time, and resets it
+    DirtyRect takeDirtyRect(const size_t listener);
+
+    /// For caches that need to know which parts of the map changed
+    const DirtyRegions &dirtyRegions() const noexcept { return m_dirtyRegions; }
+
+private:
+    static inline bool isOnMap(const int tileX, const int tileY) noexcept {
+        return tileX >= 0 && tileY >= 0 && tileX < Constants::MAP_MAX_SIZE && tileY < Constants::MAP_MAX_SIZE;
+    }
+
+    inline void markDirty(const int tileX, const int tileY) noexcept {
+        for (DirtyRect &rect : m_dirtyRects) {
+            rect.add(tileX, tileY);
+        }
+        m_dirtyRegions.markDirty(tileX, tileY);
+    }
+
+    inline void addLooking(const size_t index, const int tileX, const int tileY) noexcept {
         if (m_visibility[index] == Unexplored) {
             m_visibility[index] = Visible;
-            isDirty = true;
+            markDirty(tileX, tileY);
         } else {
             m_visibility[index]++;
 
             if (m_visibility[index] == Visible) {
-                isDirty = true;
+                markDirty(tileX, tileY);
             }
         }
     }
 
-    void removeUnitLookingAt(const int tileX, const int tileY) {
-        const size_t index = tileY * Constants::MAP_MAX_SIZE + tileX;
-        if (IS_UNLIKELY(index >= m_visibility.size())) {
-            return;
-        }
-
+    inline void removeLooking(const size_t index, const int tileX, const int tileY) noexcept {
         if (IS_UNLIKELY(m_visibility[index] == Unexplored)) {
             return;
         }
 
         if (m_visibility[index] == Visible) {
-            isDirty = true;
+            markDirty(tileX, tileY);
         }
 
         m_visibility[index]--;
     }
-    int edgeTileNum(const int tileX, const int tileY, const Visibility type) const;
 
-private:
+    /// Adds or removes along a row, inclusive, clipped to the map
+    void applySpan(const int row, int firstCol, int lastCol, const bool add);
+
     std::array<int, Constants::MAP_MAX_SIZE * Constants::MAP_MAX_SIZE> m_visibility;
+    std::vector<DirtyRect> m_dirtyRects;
+    std::vector<size_t> m_freeDirtyListeners;
+    DirtyRegions m_dirtyRegions;
 };
 
 struct Player
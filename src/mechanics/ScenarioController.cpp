@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -46,6 +47,10 @@ ScenarioController::ScenarioController(GameState *gameState) :
 void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scenario)
 {
     m_triggers.clear();
+    m_triggersToCheck.clear();
+    m_timers = {};
+    m_areaConditions.clear();
+    m_areaBuckets.clear();
 
     if (!scenario) {
         EventManager::deregisterListener(this);
@@ -271,6 +276,21 @@ void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scen
         m_triggers.emplace_back(winTrigger);
     }
 
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
+        for (size_t conditionIndex = 0; conditionIndex < trigger.conditions.size(); conditionIndex++) {
+            if (trigger.conditions[conditionIndex].data.type == genie::TriggerCondition::ObjectsInArea) {
+                indexAreaCondition(triggerIndex, conditionIndex);
+            }
+        }
+
+        if (trigger.enabled) {
+            // Start the timers
+            trigger.enabled = false;
+            setTriggerEnabled(triggerIndex, true);
+        }
+    }
+
     EventManager::registerListener(this, EventManager::UnitCreated);
     EventManager::registerListener(this, EventManager::UnitMoved);
     EventManager::registerListener(this, EventManager::UnitSelected);
@@ -282,43 +302,148 @@ void ScenarioController::setScenario(const std::shared_ptr<genie::ScnFile> &scen
 
 bool ScenarioController::update(Time time)
 {
-    bool updated = false;
-    const Time elapsed = time - m_lastUpdateTime;
     m_lastUpdateTime = time;
-    for (Trigger &trigger : m_triggers) {
-        if (!trigger.enabled) {
+
+    while (!m_timers.empty() && m_timers.top().expiry <= time) {
+        const PendingTimer timer = m_timers.top();
+        m_timers.pop();
+
+        Trigger &trigger = m_triggers[timer.trigger];
+        if (timer.generation != trigger.timerGeneration) { // disabled since it was started
             continue;
         }
 
-        bool conditionsSatisfied = true;
-        for (Condition &condition : trigger.conditions) {
-            if (condition.data.type == genie::TriggerCondition::Timer) {
-                condition.amountRequired -= elapsed;
-            }
+        trigger.conditions[timer.condition].amountRequired = 0;
+        markForCheck(timer.trigger);
+    }
 
-            if (condition.amountRequired > 0) {
-                conditionsSatisfied = false;
-            }
-        }
+    if (m_triggersToCheck.empty()) {
+        return false;
+    }
 
-        if (!conditionsSatisfied) {
+    // Keep the same order as in the scenario
+    std::sort(m_triggersToCheck.begin(), m_triggersToCheck.end());
+
+    bool updated = false;
+    std::vector<size_t> stillSatisfied;
+
+    // Effects can enable or change other triggers, which adds them to the end
+    for (size_t i = 0; i < m_triggersToCheck.size(); i++) {
+        const size_t triggerIndex = m_triggersToCheck[i];
+        Trigger &trigger = m_triggers[triggerIndex];
+        trigger.checkPending = false;
+
+        if (!trigger.isSatisfied()) {
             continue;
         }
 
         updated = true;
 
         if (!trigger.looping) {
-            trigger.enabled = false;
+            setTriggerEnabled(triggerIndex, false);
         }
 
         for (const genie::TriggerEffect &effect : trigger.effects) {
             handleTriggerEffect(effect);
         }
+
+        // Looping ones keep firing as long as the conditions hold
+        if (m_triggers[triggerIndex].enabled) {
+            stillSatisfied.push_back(triggerIndex);
+        }
+    }
+
+    m_triggersToCheck.clear();
+    for (const size_t triggerIndex : stillSatisfied) {
+        markForCheck(triggerIndex);
     }
 
     return updated;
 }
 
+void ScenarioController::setTriggerEnabled(const size_t triggerIndex, const bool enabled)
+{
+    Trigger &trigger = m_triggers[triggerIndex];
+    if (trigger.enabled == enabled) {
+        return;
+    }
+    trigger.enabled = enabled;
+
+    if (!enabled) {
+        // Pause the timers, the ones already queued are ignored
+        trigger.timerGeneration++;
+        for (Condition &condition : trigger.conditions) {
+            if (condition.data.type == genie::TriggerCondition::Timer && condition.amountRequired > 0) {
+                condition.amountRequired = std::max<Time>(condition.timerExpiry - m_lastUpdateTime, 0);
+            }
+        }
+        return;
+    }
+
+    for (size_t conditionIndex = 0; conditionIndex < trigger.conditions.size(); conditionIndex++) {
+        Condition &condition = trigger.conditions[conditionIndex];
+        if (condition.data.type != genie::TriggerCondition::Timer || condition.amountRequired <= 0) {
+            continue;
+        }
+
+        condition.timerExpiry = m_lastUpdateTime + Time(condition.amountRequired);
+
+        PendingTimer timer;
+        timer.expiry = condition.timerExpiry;
+        timer.trigger = triggerIndex;
+        timer.condition = conditionIndex;
+        timer.generation = trigger.timerGeneration;
+        m_timers.push(timer);
+    }
+
+    markForCheck(triggerIndex);
+}
+
+void ScenarioController::markForCheck(const size_t triggerIndex)
+{
+    Trigger &trigger = m_triggers[triggerIndex];
+    if (trigger.checkPending) {
+        return;
+    }
+
+    trigger.checkPending = true;
+    m_triggersToCheck.push_back(triggerIndex);
+}
+
+void ScenarioController::indexAreaCondition(const size_t triggerIndex, const size_t conditionIndex)
+{
+    const genie::TriggerCondition &data = m_triggers[triggerIndex].conditions[conditionIndex].data;
+
+    AreaCondition area;
+    area.trigger = triggerIndex;
+    area.condition = conditionIndex;
+    area.rect = MapRect(MapPos(data.areaFrom.y, data.areaFrom.x), MapPos(data.areaTo.y, data.areaTo.x));
+
+    // The tiles need to be inside the rect, not on the edges, but better safe than sorry
+    const int firstTileX = std::max(int(std::floor(area.rect.x)), 0);
+    const int firstTileY = std::max(int(std::floor(area.rect.y)), 0);
+    const int lastTileX = int(std::ceil(area.rect.x + area.rect.width));
+    const int lastTileY = int(std::ceil(area.rect.y + area.rect.height));
+    if (lastTileX < 0 || lastTileY < 0) {
+        DBG << "Area condition outside of the map" << data;
+        return;
+    }
+
+    area.firstBucketX = firstTileX / AreaBucketSize;
+    area.firstBucketY = firstTileY / AreaBucketSize;
+    area.lastBucketX = lastTileX / AreaBucketSize;
+    area.lastBucketY = lastTileY / AreaBucketSize;
+
+    const uint32_t areaIndex = m_areaConditions.size();
+    m_areaConditions.push_back(area);
+
+    for (int bucketX = area.firstBucketX; bucketX <= area.lastBucketX; bucketX++) {
+        for (int bucketY = area.firstBucketY; bucketY <= area.lastBucketY; bucketY++) {
+            m_areaBuckets[areaBucketKey(bucketX, bucketY)].push_back(areaIndex);
+        }
+    }
+}
+
 void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
 {
     switch(effect.type) {
@@ -329,7 +454,7 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
             return;
         }
         DBG << "enabling trigger" << m_triggers[effect.trigger].name;
-        m_triggers[effect.trigger].enabled = true;
+        setTriggerEnabled(effect.trigger, true);
         break;
     case genie::TriggerEffect::DeactivateTrigger:
         // TODO: display order or normal order?
@@ -338,7 +463,7 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
             return;
         }
         DBG << "disabling trigger" << m_triggers[effect.trigger].name;
-        m_triggers[effect.trigger].enabled = false;
+        setTriggerEnabled(effect.trigger, false);
         break;
     case genie::TriggerEffect::DisplayInstructions:
         AudioPlayer::instance().playStream("scenario/" + effect.soundFile + ".mp3");
@@ -377,18 +502,19 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
     }
     case genie::TriggerEffect::RemoveObject: {
         DBG << "Removing unit" << effect;
-        std::vector<std::weak_ptr<Entity>> entities;
-        entities = m_gameState->map()->entitiesBetween(effect.areaFrom.y,
-                                                              effect.areaFrom.x,
-                                                              effect.areaTo.y,
-                                                              effect.areaTo.x);
-
-        for (const std::weak_ptr<Entity> &entity : entities) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
-            if (!unit) {
-                WARN << "got invalid unit in area for effect";
-                continue;
+        // Removing them changes the map, so find them first
+        std::vector<Unit::Ptr> units;
+        m_gameState->map()->forEachEntityBetween(effect.areaFrom.y,
+                                                 effect.areaFrom.x,
+                                                 effect.areaTo.y,
+                                                 effect.areaTo.x,
+                                                 [&](Entity &entity) {
+            if (entity.isUnit()) {
+                units.push_back(Unit::fromEntity(entity.shared_from_this()));
             }
+        });
+
+        for (const Unit::Ptr &unit : units) {
             if (!checkUnitMatchingEffect(unit, effect)) {
                 continue;
             }
@@ -400,22 +526,22 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
     }
     case genie::TriggerEffect::TaskObject: {
         // again with the wtf swap of x and y
-        std::vector<std::weak_ptr<Entity>> entities;
-        entities = m_gameState->map()->entitiesBetween(effect.areaFrom.y,
-                                                              effect.areaFrom.x,
-                                                              effect.areaTo.y,
-                                                              effect.areaTo.x);
+        std::vector<Unit::Ptr> units;
+        m_gameState->map()->forEachEntityBetween(effect.areaFrom.y,
+                                                 effect.areaFrom.x,
+                                                 effect.areaTo.y,
+                                                 effect.areaTo.x,
+                                                 [&](Entity &entity) {
+            if (entity.isUnit()) {
+                units.push_back(Unit::fromEntity(entity.shared_from_this()));
+            }
+        });
 
         // TODO, not sure if it is right to move to the middle of the tile, but whatevs
         MapPos targetPos(effect.location.y + 0.5, effect.location.x + 0.5);
         targetPos *= Constants::TILE_SIZE;
 
-        for (const std::weak_ptr<Entity> &entity : entities) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
-            if (!unit) {
-                WARN << "got invalid unit in area for effect";
-                continue;
-            }
+        for (const Unit::Ptr &unit : units) {
             if (!checkUnitMatchingEffect(unit, effect)) {
                 continue;
             }
@@ -444,7 +570,8 @@ void ScenarioController::handleTriggerEffect(const genie::TriggerEffect &effect)
 
 void ScenarioController::onUnitCreated(Unit *unit)
 {
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         if (!trigger.enabled) {
             continue;
         }
@@ -454,11 +581,13 @@ void ScenarioController::onUnitCreated(Unit *unit)
             case genie::TriggerCondition::OwnObjects:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired--;
+                    markForCheck(triggerIndex);
                 }
                 continue;
             case genie::TriggerCondition::OwnFewerObjects:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired++;
+                    markForCheck(triggerIndex);
                 }
                 break;
             default:
@@ -470,57 +599,80 @@ void ScenarioController::onUnitCreated(Unit *unit)
 
 void ScenarioController::onUnitMoved(Unit *unit, const MapPos &oldTile, const MapPos &newTile)
 {
-    for (Trigger &trigger : m_triggers) {
-        if (!trigger.enabled) {
-            continue;
+    if (m_areaConditions.empty()) {
+        return;
+    }
+
+    const int oldBucketX = int(std::floor(oldTile.x)) / AreaBucketSize;
+    const int oldBucketY = int(std::floor(oldTile.y)) / AreaBucketSize;
+    const int newBucketX = int(std::floor(newTile.x)) / AreaBucketSize;
+    const int newBucketY = int(std::floor(newTile.y)) / AreaBucketSize;
+
+    // Conditions that don't overlap the bucket of either tile can't contain either of them
+    const auto checkBucket = [&](const int bucketX, const int bucketY, const bool skipOld) {
+        if (bucketX < 0 || bucketY < 0) {
+            return;
         }
 
-        for (Condition &condition : trigger.conditions) {
-            switch(condition.data.type) {
-            case genie::TriggerCondition::BringObjectToArea:
-                WARN << "TODO: move objects to area" << condition.data;
+        const std::unordered_map<uint32_t, std::vector<uint32_t>>::const_iterator it = m_areaBuckets.find(areaBucketKey(bucketX, bucketY));
+        if (it == m_areaBuckets.end()) {
+            return;
+        }
+
+        for (const uint32_t areaIndex : it->second) {
+            const AreaCondition &area = m_areaConditions[areaIndex];
+
+            // Already handled with the bucket of the old tile
+            if (skipOld && oldBucketX >= 0 && oldBucketY >= 0 && area.coversBucket(oldBucketX, oldBucketY)) {
                 continue;
-            case genie::TriggerCondition::ObjectsInArea:
-                break;
-            default:
+            }
+
+            Trigger &trigger = m_triggers[area.trigger];
+            if (!trigger.enabled) {
                 continue;
             }
 
+            Condition &condition = trigger.conditions[area.condition];
             if (!condition.checkUnitMatching(unit)) {
                 continue;
             }
 
-            const MapRect conditionRect(MapPos(condition.data.areaFrom.y, condition.data.areaFrom.x),
-                                        MapPos(condition.data.areaTo.y, condition.data.areaTo.x)
-                );
-
             // Moved out of required area
-            if (conditionRect.contains(oldTile) && !conditionRect.contains(newTile))  {
-                DBG << unit->debugName << "moved to" << newTile << "out of" << conditionRect;
+            if (area.rect.contains(oldTile) && !area.rect.contains(newTile))  {
+                DBG << unit->debugName << "moved to" << newTile << "out of" << area.rect;
                 condition.amountRequired++;
+                markForCheck(area.trigger);
                 continue;
             }
 
             // Moved into area
-            if (!conditionRect.contains(oldTile) && conditionRect.contains(newTile))  {
-                DBG << unit->debugName << "moved to" << newTile << "into" << conditionRect;
+            if (!area.rect.contains(oldTile) && area.rect.contains(newTile))  {
+                DBG << unit->debugName << "moved to" << newTile << "into" << area.rect;
                 condition.amountRequired--;
+                markForCheck(area.trigger);
                 continue;
             }
         }
-    }
+    };
+
+    checkBucket(oldBucketX, oldBucketY, false);
 
+    if (newBucketX != oldBucketX || newBucketY != oldBucketY) {
+        checkBucket(newBucketX, newBucketY, true);
+    }
 }
 
 void ScenarioController::onUnitSelected(Unit *unit)
 {
     // Don't check for trigger enabled here, the player might select before trigger is enabled
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         for (Condition &condition : trigger.conditions) {
             switch(condition.data.type) {
             case genie::TriggerCondition::ObjectSelected:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired--;
+                    markForCheck(triggerIndex);
                     DBG << "select condition match" << unit->spawnId << unit->debugName << unit->id << condition.data << condition.amountRequired;
                 }
                 break;
@@ -534,12 +686,14 @@ void ScenarioController::onUnitSelected(Unit *unit)
 void ScenarioController::onUnitDeselected(const Unit *unit)
 {
     // Don't check for trigger enabled here, the player might select before trigger is enabled
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         for (Condition &condition : trigger.conditions) {
             switch(condition.data.type) {
             case genie::TriggerCondition::ObjectSelected:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired++;
+                    markForCheck(triggerIndex);
                     DBG << "deselect condition match" << unit->spawnId << unit->debugName << unit->id << condition.data << condition.amountRequired;
                 }
                 break;
@@ -558,7 +712,8 @@ void ScenarioController::onPlayerDefeated(Player *player)
 
 void ScenarioController::onAttributeChanged(Player *player, int attributeId, float newValue)
 {
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         if (!trigger.enabled) {
             continue;
         }
@@ -575,6 +730,8 @@ void ScenarioController::onAttributeChanged(Player *player, int attributeId, flo
             }
 
             condition.amountRequired += newValue;
+
+            markForCheck(triggerIndex);
         }
     }
 }
@@ -582,7 +739,8 @@ void ScenarioController::onAttributeChanged(Player *player, int attributeId, flo
 void ScenarioController::onUnitDying(Unit *unit)
 {
     DBG << "unit died" << unit->debugName << unit->spawnId;
-    for (Trigger &trigger : m_triggers) {
+    for (size_t triggerIndex = 0; triggerIndex < m_triggers.size(); triggerIndex++) {
+        Trigger &trigger = m_triggers[triggerIndex];
         if (!trigger.enabled) {
             continue;
         }
@@ -592,12 +750,14 @@ void ScenarioController::onUnitDying(Unit *unit)
             case genie::TriggerCondition::DestroyObject:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired--;
+                    markForCheck(triggerIndex);
                     DBG << "destroy condition match" << unit->spawnId << unit->debugName << unit->id << condition.data << condition.amountRequired;
                 }
                 break;
             case genie::TriggerCondition::OwnFewerObjects:
                 if (condition.checkUnitMatching(unit)) {
                     condition.amountRequired--;
+                    markForCheck(triggerIndex);
                     DBG << "fewer condition match" << unit->spawnId << unit->debugName << unit->id << condition.data << condition.amountRequired;
                 }
                 break;
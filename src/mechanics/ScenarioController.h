@@ -7,6 +7,12 @@
 
 #include <genie/script/scn/Trigger.h>
 
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
 class GameState;
 class Engine;
 struct Unit;
@@ -19,9 +25,12 @@ class ScenarioController : public EventListener
 {
     struct Condition {
         /// For boolean triggers just 0 or 1
-        /// For timers, milliseconds elapsed
+        /// For timers, milliseconds left while the trigger is disabled
         float amountRequired = 0;
 
+        /// For timers while the trigger is enabled
+        Time timerExpiry = 0;
+
         Condition(const genie::TriggerCondition &d) : data(d) {
             if (d.type == genie::TriggerCondition::Timer) {
                 amountRequired = 1000 * data.timer; // it is in milliseconds
@@ -39,6 +48,12 @@ class ScenarioController : public EventListener
     struct Trigger {
         bool enabled = false;
 
+        /// Already in the list of triggers to check in the next update
+        bool checkPending = false;
+
+        /// Bumped when it is disabled, so we can ignore the old timers
+        uint32_t timerGeneration = 0;
+
         Trigger (const genie::Trigger &d) :
             effects(d.effects),
             looping(d.looping),
@@ -96,11 +111,56 @@ private:
 
     void handleTriggerEffect(const genie::TriggerEffect &effect);
 
+    void setTriggerEnabled(const size_t triggerIndex, const bool enabled);
+    void markForCheck(const size_t triggerIndex);
+    void indexAreaCondition(const size_t triggerIndex, const size_t conditionIndex);
+
+    /// Tiles are grouped in square buckets of this size for the area conditions
+    static constexpr int AreaBucketSize = 16;
+
+    static uint32_t areaBucketKey(const int bucketX, const int bucketY) {
+        return (uint32_t(bucketX) << 16) | uint32_t(bucketY);
+    }
+
+    struct AreaCondition {
+        uint32_t trigger = 0;
+        uint32_t condition = 0;
+        MapRect rect;
+
+        int firstBucketX = 0;
+        int firstBucketY = 0;
+        int lastBucketX = 0;
+        int lastBucketY = 0;
+
+        bool coversBucket(const int bucketX, const int bucketY) const {
+            return bucketX >= firstBucketX && bucketX <= lastBucketX && bucketY >= firstBucketY && bucketY <= lastBucketY;
+        }
+    };
+
+    struct PendingTimer {
+        Time expiry = 0;
+        uint32_t trigger = 0;
+        uint32_t condition = 0;
+        uint32_t generation = 0;
+
+        bool operator>(const PendingTimer &other) const { return expiry > other.expiry; }
+    };
+
     // Todo: put these in an std::array based on type, so we don't have to loop over all
 
     std::vector<Trigger> m_triggers;
     Time m_lastUpdateTime = 0;
 
+    /// Only these can have become satisfied since the last update
+    std::vector<size_t> m_triggersToCheck;
+
+    /// Soonest first
+    std::priority_queue<PendingTimer, std::vector<PendingTimer>, std::greater<PendingTimer>> m_timers;
+
+    /// ObjectsInArea conditions, and the buckets of tiles they overlap
+    std::vector<AreaCondition> m_areaConditions;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_areaBuckets;
+
     GameState *m_gameState = nullptr; // ugly raw pointer, but owned by gamestate, so sue me
     Engine *m_engine = nullptr; // samesies
 //    Time m_nextTimerTriggerTarget = -1;
@@ -73,8 +73,11 @@ Unit::Unit(const genie::Unit &data_, const std::shared_ptr<Player> &player_, Uni
     m_renderer->setPlayerColor(player_->playerColor);
     m_renderer->setCivId(player_->civilization.id());
 
+    m_store = unitManager.unitStore();
+    m_storeHandle = m_store->add(this, &data_, playerId);
+
     setUnitData(data_);
-    m_creationProgress = m_data->Creatable.TrainTime;
+    m_store->setCreationProgress(m_storeHandle, m_data->Creatable.TrainTime);
 
     player_->addUnit(this);
 }
@@ -88,8 +91,11 @@ Unit::Unit(const genie::Unit &data_, const std::shared_ptr<Player> &player_, Uni
 {
     m_renderer->setPlayerColor(player_->playerColor);
 
+    m_store = unitManager.unitStore();
+    m_storeHandle = m_store->add(this, &data_, playerId);
+
     setUnitData(data_);
-    m_creationProgress = m_data->Creatable.TrainTime;
+    m_store->setCreationProgress(m_storeHandle, m_data->Creatable.TrainTime);
 
     player_->addUnit(this);
 }
@@ -98,12 +104,14 @@ Unit::~Unit()
 {
     Player::Ptr owner = player.lock();
     if (owner) {
-        forEachVisibleTile([&](const int tileX, const int tileY) {
-            owner->visibility->removeUnitLookingAt(tileX, tileY);
-        });
+        if (m_lineOfSight.added) {
+            owner->visibility->removeLineOfSight(m_lineOfSight.col, m_lineOfSight.row, m_lineOfSight.radius);
+        }
 
         owner->removeUnit(this);
     }
+
+    m_store->remove(m_storeHandle);
 }
 
 void Unit::setAngle(const float angle) noexcept
@@ -124,20 +132,6 @@ bool Unit::update(Time time) noexcept
 
     bool updated = false;
 
-    if (m_prevTime) {
-        int timeDelta = time - m_prevTime;
-
-        if (targetBlinkTimeLeft) {
-            targetBlinkTimeLeft -= timeDelta;
-        }
-
-        if (targetBlinkTimeLeft < 0) {
-            targetBlinkTimeLeft = 0;
-        }
-    }
-
-    m_prevTime = time;
-
     for (Annex &annex : annexes) {
         updated = annex.unit->update(time) || updated;
     }
@@ -260,15 +254,16 @@ bool Unit::checkClick(const ScreenPos &pos) const noexcept
 
 void Unit::setCreationProgress(float progress) noexcept
 {
+    const float previousProgress = m_store->creationProgress(m_storeHandle);
     if (m_data->Type == genie::Unit::BuildingType) {
-        if (m_creationProgress < m_data->Creatable.TrainTime && progress >= m_data->Creatable.TrainTime) {
+        if (previousProgress < m_data->Creatable.TrainTime && progress >= m_data->Creatable.TrainTime) {
             m_renderer->setGraphic(defaultGraphics);
-        } else if (m_creationProgress == m_data->Creatable.TrainTime && progress < m_data->Creatable.TrainTime) {
+        } else if (previousProgress == m_data->Creatable.TrainTime && progress < m_data->Creatable.TrainTime) {
             m_renderer->setGraphic(m_data->Building.ConstructionGraphicID);
         }
     }
 
-    m_creationProgress = std::min(progress, float(m_data->Creatable.TrainTime));
+    m_store->setCreationProgress(m_storeHandle, std::min(progress, float(m_data->Creatable.TrainTime)));
 
     if (m_data->Type == genie::Unit::BuildingType && progress < m_data->Creatable.TrainTime) {
         m_renderer->setAngle(M_PI_2 + 2. * M_PI * (creationProgress()));
@@ -279,7 +274,7 @@ void Unit::setCreationProgress(float progress) noexcept
 
 void Unit::increaseCreationProgress(float progress) noexcept
 {
-    setCreationProgress(m_creationProgress + progress);
+    setCreationProgress(m_store->creationProgress(m_storeHandle) + progress);
 }
 
 float Unit::creationProgress() const noexcept
@@ -288,7 +283,7 @@ float Unit::creationProgress() const noexcept
         return 1;
     }
 
-    return m_creationProgress / float(m_data->Creatable.TrainTime);
+    return m_store->creationProgress(m_storeHandle) / float(m_data->Creatable.TrainTime);
 }
 
 void Unit::takeDamage(const genie::unit::AttackOrArmor &attack, const float damageMultiplier) noexcept
@@ -308,12 +303,13 @@ void Unit::takeDamage(const genie::unit::AttackOrArmor &attack, const float dama
     newDamage *= damageMultiplier;
     newDamage = std::max(newDamage, 1.f);
 
-    m_damageTaken += newDamage;
+    const float damageTaken = m_store->damageTaken(m_storeHandle) + newDamage;
+    m_store->setDamageTaken(m_storeHandle, damageTaken);
 
     if (hitpointsLeft() <= 0) {
         kill();
     } else {
-        const int damagedPercent = 100 * m_damageTaken / data()->HitPoints;
+        const int damagedPercent = 100 * damageTaken / data()->HitPoints;
         const genie::unit::DamageGraphic *graphic = nullptr;
         for (const genie::unit::DamageGraphic &damageGraphic : data()->DamageGraphics) {
             if (damagedPercent < damageGraphic.DamagePercent) {
@@ -343,7 +339,7 @@ void Unit::takeDamage(const genie::unit::AttackOrArmor &attack, const float dama
 
 void Unit::kill() noexcept
 {
-    m_damageTaken = data()->HitPoints;
+    m_store->setDamageTaken(m_storeHandle, data()->HitPoints);
 
     m_renderer->setPlaySounds(true);
     m_renderer->setGraphic(m_data->DyingGraphic);
@@ -358,7 +354,7 @@ void Unit::kill() noexcept
 
 bool Unit::isDying() const noexcept
 {
-    if (m_damageTaken < m_data->HitPoints) {
+    if (m_store->damageTaken(m_storeHandle) < m_data->HitPoints) {
         return false;
     }
 
@@ -382,7 +378,7 @@ bool Unit::isDying() const noexcept
 
 bool Unit::isDead() const noexcept
 {
-    if (m_damageTaken < m_data->HitPoints) {
+    if (m_store->damageTaken(m_storeHandle) < m_data->HitPoints) {
         return false;
     }
 
@@ -422,13 +418,8 @@ void Unit::setPosition(const MapPos &pos, const bool initial) noexcept
         return;
     }
 
-    Player::Ptr owner = player.lock();
-
-    if (!initial && owner) {
-        forEachVisibleTile([&](const int tileX, const int tileY) {
-            owner->visibility->removeUnitLookingAt(tileX, tileY);
-        });
-    }
+    const int oldCol = initial ? -1 : int(position().x / Constants::TILE_SIZE);
+    const int oldRow = initial ? -1 : int(position().y / Constants::TILE_SIZE);
 
     MapPos oldTilePosition = position() / Constants::TILE_SIZE;
     MapPos newTilePosition = pos / Constants::TILE_SIZE;
@@ -440,10 +431,9 @@ void Unit::setPosition(const MapPos &pos, const bool initial) noexcept
 
     Entity::setPosition(pos, initial);
 
+    Player::Ptr owner = player.lock();
     if (owner) {
-        forEachVisibleTile([&](const int tileX, const int tileY) {
-            owner->visibility->addUnitLookingAt(tileX, tileY);
-        });
+        updateLineOfSight(*owner->visibility);
     } else {
         WARN << "No player set!";
     }
@@ -452,14 +442,17 @@ void Unit::setPosition(const MapPos &pos, const bool initial) noexcept
         annex.unit->setPosition(pos + annex.offset, initial);
     }
 
-    if (data()->Type >= genie::Unit::CombatantType) {
-        m_unitManager.onCombatantUnitsMoved();
+    const int newCol = pos.x / Constants::TILE_SIZE;
+    const int newRow = pos.y / Constants::TILE_SIZE;
+    if (oldCol != newCol || oldRow != newRow) {
+        m_unitManager.onUnitMoved(*this, oldCol, oldRow, newCol, newRow);
     }
 }
 
 void Unit::setUnitData(const genie::Unit &data_) noexcept
 {
     m_data = &data_;
+    m_store->setData(m_storeHandle, m_data);
 
     defaultGraphics = AssetManager::Inst()->getGraphic(m_data->StandingGraphic.first);
     if (m_data->Moving.WalkingGraphic >= 0) {
@@ -486,23 +479,35 @@ Size Unit::clearanceSize() const noexcept
     return Size(data()->Size.x * Constants::TILE_SIZE, data()->Size.y * Constants::TILE_SIZE);
 }
 
-void Unit::forEachVisibleTile(std::function<void (const int, const int)> action)
+void Unit::updateLineOfSight(VisibilityMap &visibility) noexcept
 {
-    const int los = data()->LineOfSight;
-    const int tileXOffset = position().x / Constants::TILE_SIZE;
-    const int tileYOffset = position().y / Constants::TILE_SIZE;
-    for (int y=-los; y<= los; y++) {
-        for (int x=-los; x<= los; x++) {
-            if (x*x + y*y < los*los) {
-                action(x + tileXOffset, y + tileYOffset);
-            }
+    const int col = position().x / Constants::TILE_SIZE;
+    const int row = position().y / Constants::TILE_SIZE;
+    const int radius = data()->LineOfSight;
+
+    if (m_lineOfSight.added && m_lineOfSight.radius == radius) {
+        if (m_lineOfSight.col == col && m_lineOfSight.row == row) {
+            return;
+        }
+
+        visibility.moveLineOfSight(m_lineOfSight.col, m_lineOfSight.row, col, row, radius);
+    } else {
+        // Not added yet, or the line of sight changed (e.g. from research)
+        visibility.addLineOfSight(col, row, radius);
+        if (m_lineOfSight.added) {
+            visibility.removeLineOfSight(m_lineOfSight.col, m_lineOfSight.row, m_lineOfSight.radius);
         }
     }
+
+    m_lineOfSight.col = col;
+    m_lineOfSight.row = row;
+    m_lineOfSight.radius = radius;
+    m_lineOfSight.added = true;
 }
 
 float Unit::hitpointsLeft() const noexcept
 {
-    return std::max((data()->HitPoints * creationProgress() - m_damageTaken), 0.f);
+    return std::max((data()->HitPoints * creationProgress() - m_store->damageTaken(m_storeHandle)), 0.f);
 }
 
 float Unit::healthLeft() const noexcept
@@ -29,6 +29,7 @@
 
 #include "Entity.h"
 #include "UnitActionHandler.h"
+#include "UnitStore.h"
 #include "core/Constants.h"
 #include "core/ResourceMap.h"
 #include "core/Types.h"
@@ -44,6 +45,7 @@ class AttackOrArmor;
 
 struct Building;
 struct Player;
+struct VisibilityMap;
 
 class Graphic;
 using GraphicPtr = std::shared_ptr<Graphic>;
@@ -111,7 +113,14 @@ struct Unit : public Entity
     } stance = Stance::Aggressive;
 
     // The blinking animation thing when it is selected as a target
-    int targetBlinkTimeLeft = 0;
+    int targetBlinkTimeLeft() const noexcept { return m_store->targetBlinkTimeLeft(m_storeHandle); }
+    void setTargetBlinkTimeLeft(const int timeLeft) noexcept { m_store->setTargetBlinkTimeLeft(m_storeHandle, timeLeft); }
+
+    /// Counted up by the UnitManager every tick
+    int timeSinceAttack() const noexcept { return m_store->timeSinceAttack(m_storeHandle); }
+    void resetAttackTimer() noexcept { m_store->resetAttackTimer(m_storeHandle); }
+
+    const UnitStore::Handle &storeHandle() const noexcept { return m_storeHandle; }
 
     UnitActionHandler actions;
 
@@ -119,6 +128,12 @@ struct Unit : public Entity
     static inline std::shared_ptr<Unit> fromEntity(const std::weak_ptr<Entity> &entity) noexcept {
         return fromEntity(entity.lock());
     }
+    static inline Unit *fromEntity(Entity *entity) noexcept {
+        if (!entity || !entity->isUnit()) {
+            return nullptr;
+        }
+        return static_cast<Unit*>(entity);
+    }
 
     Unit() = delete;
     Unit(const Unit &unit) = delete;
@@ -196,7 +211,8 @@ struct Unit : public Entity
 protected:
     friend struct UnitActionHandler;
 
-    void forEachVisibleTile(std::function<void(const int, const int)> action);
+    /// Moves what we can see in the visibility map of our owner
+    void updateLineOfSight(VisibilityMap &visibility) noexcept;
 
     Unit(const genie::Unit &data_, const std::shared_ptr<Player> &player_, UnitManager &unitManager, const Type m_type);
     void updateGraphic();
@@ -204,13 +220,21 @@ protected:
     const genie::Unit *m_data = nullptr;
     GraphicPtr movingGraphics;
 
-    float m_creationProgress = 0.f;
-
     UnitManager &m_unitManager;
 
-    float m_damageTaken = 0.f;
-    Time m_prevTime = 0;
+    /// Where the creation progress, damage etc. live
+    std::shared_ptr<UnitStore> m_store;
+    UnitStore::Handle m_storeHandle;
+
     float m_angle = 0.f;
+
+    /// What we have added to the visibility map, so we remove the same
+    struct {
+        int col = 0;
+        int row = 0;
+        int radius = 0;
+        bool added = false;
+    } m_lineOfSight;
 };
 
 
@@ -194,31 +194,34 @@ Task UnitActionHandler::checkForAutoTargets() noexcept
     const int bottom = position.y / Constants::TILE_SIZE + los;
 
     float closestDistance = los * Constants::TILE_SIZE;
-    const std::vector<std::weak_ptr<Entity>> entities = map->entitiesBetween(left, top, right, bottom);
-    for (size_t i=0; i<entities.size(); i++) {
-        Unit::Ptr other = Unit::fromEntity(entities[i]);
+    const std::shared_ptr<Player> ownPlayer = m_unit->player.lock();
+    map->forEachEntityBetween(left, top, right, bottom, [&](Entity &entity) {
+        const Unit *other = Unit::fromEntity(&entity);
         if (!other) {
-            continue;
+            return;
         }
 
         if (other->id == m_unit->id) {
-            continue;
+            return;
         }
         if (other->playerId == UnitManager::GaiaID) {
             // I don't think we should auto-target gaia units?
-            continue;
+            return;
         }
 
         const float distance = other->position().distance(position);
 
         if (distance > closestDistance) {
-            continue;
+            return;
         }
 
+        // Only hold a reference to the ones we actually consider
+        const Unit::Ptr otherPtr = Unit::fromEntity(entity.shared_from_this());
+
         Task potentialTask;
-        potentialTask = findMatchingTask(m_unit->player.lock(), other, m_autoTargetTasks);
+        potentialTask = findMatchingTask(ownPlayer, otherPtr, m_autoTargetTasks);
         if (!potentialTask.data) {
-            continue;
+            return;
         }
 
         // TODO: should only prefer civilians (and I think only wolves? lions?)
@@ -226,16 +229,16 @@ Task UnitActionHandler::checkForAutoTargets() noexcept
         // Maybe check combat level instead? but then suddenly we get wolves trying to find a path to ships
         if (potentialTask.data->ActionType == genie::ActionType::Combat && data->Class == genie::Unit::PredatorAnimal) {
             if (other->data()->Creatable.CreatableType != genie::unit::Creatable::VillagerType) {
-                continue;
+                return;
             }
         }
 
         if (potentialTask.data) {
             newTask = potentialTask;
-            target = other;
+            target = otherPtr;
             closestDistance = distance;
         }
-    }
+    });
 
     if (!newTask.data || !target) {
         return {};
@@ -255,6 +258,7 @@ void UnitActionHandler::removeAction(const ActionPtr &action)
             m_actionQueue.pop_front();
         } else {
             setCurrentAction(nullptr);
+            m_unit->unitManager().onUnitIdle(*m_unit);
             DBG << "no actions queued";
         }
     } else {
@@ -272,6 +276,7 @@ void UnitActionHandler::clearActionQueue() noexcept
     m_actionQueue.clear();
     m_currentAction.reset();
     m_unit->updateGraphic();
+    m_unit->unitManager().onUnitIdle(*m_unit);
 }
 
 int UnitActionHandler::taskGraphicId(const genie::ActionType taskType, const IAction::UnitState state)
@@ -36,6 +36,7 @@
 #include "actions/ActionFly.h"
 #include "actions/IAction.h"
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "core/ResourceMap.h"
 #include "core/Types.h"
 #include "core/Utility.h"
@@ -81,7 +82,7 @@ void UnitFactory::handleDefaultAction(const Unit::Ptr &unit, const genie::Task &
             flyingPosition.z = 10;
             unit->setPosition(flyingPosition);
         }
-        unit->actions.setCurrentAction(std::make_shared<ActionFly>(unit, Task(task, unit->data()->ID)));
+        unit->actions.setCurrentAction(makePooled<ActionFly>(unit, Task(task, unit->data()->ID)));
         break;
     }
 
@@ -198,7 +199,7 @@ DecayingEntity::Ptr UnitFactory::createCorpseFor(const Unit::Ptr &unit)
         DBG << "decaying forever";
         decayTime = std::numeric_limits<float>::infinity();
     }
-    DecayingEntity::Ptr corpse = std::make_shared<DecayingEntity>(corpseData.StandingGraphic.first, decayTime);
+    DecayingEntity::Ptr corpse = makePooled<DecayingEntity>(corpseData.StandingGraphic.first, decayTime);
     corpse->renderer().setPlayerColor(owner->playerColor);
     corpse->setMap(unit->map());
     corpse->setPosition(unit->position());
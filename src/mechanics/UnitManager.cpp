@@ -31,11 +31,14 @@
 #include "audio/AudioPlayer.h"
 #include "core/Constants.h"
 #include "core/Logger.h"
+#include "core/ObjectPool.h"
 #include "core/Utility.h"
 #include "global/EventManager.h"
 #include "mechanics/Player.h"
 #include "render/SfmlRenderTarget.h"
+#include "render/SpriteBatch.h"
 #include "Map.h"
+#include "FlowField.h"
 
 #include <genie/Types.h>
 #include <genie/dat/Unit.h>
@@ -51,15 +54,20 @@
 #include <SFML/Graphics/RenderTexture.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
 #include <utility>
 
 namespace genie {
 class Tech;
 }  // namespace genie
 
-UnitManager::UnitManager()
+static const size_t MIN_FLOW_FIELD_GROUP_SIZE = 4;
+
+UnitManager::UnitManager() :
+    m_unitStore(std::make_shared<UnitStore>())
 {
-    m_outlineOverlay = std::make_unique<sf::RenderTexture>();
 }
 
 UnitManager::~UnitManager()
@@ -74,9 +82,10 @@ void UnitManager::add(const Unit::Ptr &unit, const MapPos &position)
     }
     unit->setMap(m_map);
     unit->setPosition(position, true);
+    m_unitStore->setListIndex(unit->storeHandle(), m_units.size());
     m_units.push_back(unit);
     if (unit->actions.hasAutoTargets()) {
-        m_unitsWithActions.insert(unit);
+        m_autoTargetTracker.addWatcher(unit);
     }
 
     EventManager::unitCreated(unit.get());
@@ -90,16 +99,28 @@ void UnitManager::remove(const Unit::Ptr &unit)
         m_selectedUnits.erase(unit);
     }
 
-    m_unitsWithActions.erase(unit);
+    m_autoTargetTracker.removeWatcher(unit->id);
 
-    UnitVector::iterator it = std::find(m_units.begin(), m_units.end(), unit);
-    if (it != m_units.end()) {
+    if (m_unitStore->listIndex(unit->storeHandle()) != UnitStore::InvalidIndex) {
         EventManager::unitDying(unit.get()); // not sure about this, but whatever
-        m_units.erase(it);
+        removeFromList(unit);
     }
     // TODO: EventManager::unitDisappeared(), we need to check the visibility maps
 }
 
+void UnitManager::removeFromList(const Unit::Ptr &unit)
+{
+    const uint32_t index = m_unitStore->listIndex(unit->storeHandle());
+    m_unitStore->setListIndex(unit->storeHandle(), UnitStore::InvalidIndex);
+
+    // Move the last one into the hole, the order only needs to be the same every time
+    if (index + 1 < m_units.size()) {
+        m_units[index] = std::move(m_units.back());
+        m_unitStore->setListIndex(m_units[index]->storeHandle(), index);
+    }
+    m_units.pop_back();
+}
+
 bool UnitManager::init()
 {
     m_moveTargetMarker = std::make_unique<MoveTargetMarker>();
@@ -112,85 +133,188 @@ bool UnitManager::update(Time time)
 {
     bool updated = false;
 
-    if (m_unitsMoved) {
-        m_unitsMoved = false;
+    std::chrono::steady_clock::time_point sectionStart = std::chrono::steady_clock::now();
+    auto endSection = [&sectionStart](int64_t *total) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        *total += std::chrono::duration_cast<std::chrono::microseconds>(now - sectionStart).count();
+        sectionStart = now;
+    };
 
-        for (const Unit::Ptr &unit : m_unitsWithActions) {
-            Task task = unit->actions.checkForAutoTargets();
-            if (!task.data) {
-                continue;
-            }
-            IAction::assignTask(task, unit);
+    m_unitStore->updateTimers(time);
+
+    // For interpolating when rendering between updates
+    for (const Unit::Ptr &unit : m_units) {
+        unit->storePreviousPosition();
+    }
+    for (const Missile::Ptr &missile : m_missiles) {
+        missile->storePreviousPosition();
+    }
+
+    // Only the ones where something changed in what they can see
+    m_autoTargetTracker.collectDue(&m_autoTargetUnits);
+    for (const Unit::Ptr &unit : m_autoTargetUnits) {
+        Task task = unit->actions.checkForAutoTargets();
+        if (!task.data) {
+            continue;
         }
+        IAction::assignTask(task, unit);
     }
+    m_autoTargetUnits.clear();
+    endSection(&m_updateTimings.autoTargeting);
 
     // Update missiles (siege rockthings, arrows, etc.)
-    std::unordered_set<Missile::Ptr>::iterator missileIterator = m_missiles.begin();
-    while (missileIterator != m_missiles.end()) {
-        const Missile::Ptr &missile = *missileIterator;
+    // They draw random numbers, so keep them in the order they were fired
+    size_t keptMissiles = 0;
+    for (size_t i=0; i<m_missiles.size(); i++) {
+        Missile::Ptr &missile = m_missiles[i];
         updated = missile->update(time) || updated;
         if (!missile->isFlying() && !missile->isExploding()) {
-            missileIterator = m_missiles.erase(missileIterator);
             updated = true;
-        } else {
-            missileIterator++;
+            continue;
+        }
+
+        if (keptMissiles != i) {
+            m_missiles[keptMissiles] = std::move(missile);
         }
+        keptMissiles++;
     }
+    m_missiles.resize(keptMissiles);
+    endSection(&m_updateTimings.missiles);
 
     // Update decaying entities (smoke stuff from siege, corpses, etc.)
-    std::unordered_set<DecayingEntity::Ptr>::iterator decayingEntityIterator = m_decayingEntities.begin();
-    while (decayingEntityIterator != m_decayingEntities.end()) {
-        const DecayingEntity::Ptr &entity = *decayingEntityIterator;
+    size_t keptEntities = 0;
+    for (size_t i=0; i<m_decayingEntities.size(); i++) {
+        DecayingEntity::Ptr &entity = m_decayingEntities[i];
         updated = entity->update(time) || updated;
         if (!entity->decaying()) {
-            decayingEntityIterator = m_decayingEntities.erase(decayingEntityIterator);
             updated = true;
-        } else {
-            decayingEntityIterator++;
+            continue;
         }
+
+        if (keptEntities != i) {
+            m_decayingEntities[keptEntities] = std::move(entity);
+        }
+        keptEntities++;
     }
+    m_decayingEntities.resize(keptEntities);
+    endSection(&m_updateTimings.decayingEntities);
 
-    // Clean up dead units
-    UnitVector::iterator unitIterator = m_units.begin();
-    while (unitIterator != m_units.end()) {
-        const Unit::Ptr &unit = *unitIterator;
+    // Clean up dead units, only the ones without any hitpoints left can be dying or dead
+    m_destroyedUnits.clear();
+    m_unitStore->collectDestroyed(&m_destroyedUnits);
 
-        const bool isDead = unit->isDead();
-        const bool isDying = unit->isDying();
+    for (Unit *destroyedUnit : m_destroyedUnits) {
+        const bool isDead = destroyedUnit->isDead();
+        const bool isDying = destroyedUnit->isDying();
+        if (!isDead && !isDying) {
+            continue;
+        }
 
-        // Remove from selected if it is dying
-        if (isDead || isDying) {
-            m_selectedUnits.erase(unit);
-            EventManager::unitDeselected(unit.get());
+        // Annexes etc. are handled by whoever owns them
+        const uint32_t listIndex = m_unitStore->listIndex(destroyedUnit->storeHandle());
+        if (listIndex == UnitStore::InvalidIndex) {
+            continue;
         }
+        const Unit::Ptr unit = m_units[listIndex];
+
+        // Remove from selected if it is dying
+        m_selectedUnits.erase(unit);
+        EventManager::unitDeselected(unit.get());
 
-        if (isDead) {
-            EventManager::unitDying(unit.get());
+        if (!isDead) {
+            continue;
+        }
 
-            DecayingEntity::Ptr corpse = UnitFactory::Inst().createCorpseFor(unit);
-            if (corpse) {
-                m_decayingEntities.insert(corpse);
-                updated = true;
-            }
-            m_unitsWithActions.erase(unit);
+        EventManager::unitDying(unit.get());
 
-            unitIterator = m_units.erase(unitIterator);
-        } else {
-            unitIterator++;
+        DecayingEntity::Ptr corpse = UnitFactory::Inst().createCorpseFor(unit);
+        if (corpse) {
+            m_decayingEntities.push_back(corpse);
+            updated = true;
         }
+        m_autoTargetTracker.removeWatcher(unit->id);
+
+        removeFromList(unit);
     }
 
+    endSection(&m_updateTimings.cleanup);
+
+    // Paths requested last update, the workers could keep going until now
+    // because they only look at their own copy of the passability
+    m_pathfindingQueue.collect();
+    endSection(&m_updateTimings.pathfinding);
+
     // Update the living units that are left
     for (const Unit::Ptr &unit : m_units) {
         updated = unit->update(time) || updated;
     }
 
     updated = m_moveTargetMarker->update(time) || updated;
+    endSection(&m_updateTimings.units);
+
+    if (m_map) {
+        m_pathfindingQueue.dispatch(m_map->passability());
+    }
+    endSection(&m_updateTimings.pathfinding);
 
     return updated;
 }
 
-void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<std::weak_ptr<Entity>> &visible)
+namespace {
+struct StateHasher {
+    uint64_t hash = 14695981039346656037ULL;
+
+    inline void add(const uint64_t value) noexcept {
+        // FNV-1a, one byte at a time
+        for (int i=0; i<8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    inline void add(const float value) noexcept {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        add(uint64_t(bits));
+    }
+
+    inline void add(const MapPos &position) noexcept {
+        add(position.x);
+        add(position.y);
+        add(position.z);
+    }
+};
+} // anonymous namespace
+
+uint64_t UnitManager::stateHash() const noexcept
+{
+    StateHasher hasher;
+
+    // m_units is in a fixed order, the missiles are not
+    for (const Unit::Ptr &unit : m_units) {
+        hasher.add(uint64_t(unit->id));
+        hasher.add(uint64_t(unit->data()->ID));
+        hasher.add(uint64_t(unit->playerId));
+        hasher.add(unit->position());
+        hasher.add(unit->hitpointsLeft());
+
+        const ActionPtr &action = unit->actions.currentAction();
+        hasher.add(uint64_t(action ? int(action->type) + 1 : 0));
+    }
+
+    uint64_t missilesHash = 0;
+    for (const Missile::Ptr &missile : m_missiles) {
+        StateHasher missileHasher;
+        missileHasher.add(uint64_t(missile->id));
+        missileHasher.add(missile->position());
+        missilesHash += missileHasher.hash;
+    }
+    hasher.add(missilesHash);
+
+    return hasher.hash;
+}
+
+void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<Entity *> &visible, const float tickProgress)
 {
     Player::Ptr humanPlayer = m_humanPlayer.lock();
     if (!humanPlayer) {
@@ -200,6 +324,11 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
     CameraPtr camera = renderTarget->camera();
 
+    // Created when needed, so we can run without a window
+    if (!m_outlineOverlay) {
+        m_outlineOverlay = std::make_unique<sf::RenderTexture>();
+    }
+
     if (Size(m_outlineOverlay->getSize()) != renderTarget->getSize()) {
         m_outlineOverlay->create(renderTarget->getSize().width, renderTarget->getSize().height);
     }
@@ -217,27 +346,25 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
         m_previousCameraPos = camera->targetPosition();
     }
 
+    // Everything is batched, so it ends up as a handful of draw calls
+    SpriteBatch batch(*renderTarget->renderTarget_);
+    SpriteBatch overlayBatch(*m_outlineOverlay);
+
     std::vector<Unit::Ptr> visibleUnits;
     std::vector<Missile::Ptr> visibleMissiles;
-    for (const std::weak_ptr<Entity> &e : visible) {
-        std::shared_ptr<Entity> entity = e.lock();
-        if (!entity) {
-            WARN << "got dead entity";
-            continue;
-        }
-
+    for (Entity *entity : visible) {
         const VisibilityMap::Visibility visibility = humanPlayer->visibility->visibilityAt(entity->position());
         if (visibility == VisibilityMap::Unexplored) {
             continue;
         }
 
         if (entity->isUnit()) {
-            Unit::Ptr unit = Unit::fromEntity(entity);
+            const Unit *unit = Unit::fromEntity(entity);
 
             if (visibility == VisibilityMap::Visible) {
                 entity->isVisible = true;
-                visibleUnits.push_back(unit);
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::Shadow);
+                visibleUnits.push_back(Unit::fromEntity(entity->shared_from_this()));
+                entity->renderer().render(batch, camera->absoluteScreenPos(entity->interpolatedPosition(tickProgress)), RenderType::Shadow);
 
                 continue;
             }
@@ -248,33 +375,32 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 
             entity->isVisible = true;
 
-            entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::InTheShadows);
+            entity->renderer().render(batch, camera->absoluteScreenPos(entity->interpolatedPosition(tickProgress)), RenderType::InTheShadows);
 
             continue;
         }
 
         if (entity->isMissile()) {
-            Missile::Ptr missile = Entity::asMissile(entity);
             if (visibility != VisibilityMap::Visible) {;// && missile->playerId != GaiaID) {
                 continue;
             }
 
             entity->isVisible = true;
 
-            MapPos shadowPosition = entity->position();
+            MapPos shadowPosition = entity->interpolatedPosition(tickProgress);
             shadowPosition.z = m_map->elevationAt(shadowPosition);
-            entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(shadowPosition), RenderType::Shadow);
+            entity->renderer().render(batch, camera->absoluteScreenPos(shadowPosition), RenderType::Shadow);
 
-            visibleMissiles.push_back(missile);
+            visibleMissiles.push_back(Entity::asMissile(entity->shared_from_this()));
 
             continue;
         }
 
         if (entity->isDecayingEntity() || entity->isDoppleganger()) {
             if (visibility == VisibilityMap::Visible) {
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::Base);
+                entity->renderer().render(batch, camera->absoluteScreenPos(entity->interpolatedPosition(tickProgress)), RenderType::Base);
             } else {
-                entity->renderer().render(*renderTarget->renderTarget_, camera->absoluteScreenPos(entity->position()), RenderType::InTheShadows);
+                entity->renderer().render(batch, camera->absoluteScreenPos(entity->interpolatedPosition(tickProgress)), RenderType::InTheShadows);
             }
 
             entity->isVisible = true;
@@ -286,63 +412,51 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
     m_outlineOverlay->clear(sf::Color::Transparent);
 
     for (const Unit::Ptr &unit : visibleUnits) {
-        const ScreenPos unitPosition = camera->absoluteScreenPos(unit->position());
+        const ScreenPos unitPosition = camera->absoluteScreenPos(unit->interpolatedPosition(tickProgress));
         if (!(unit->data()->OcclusionMode & genie::Unit::OccludeOthers)) {
-            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::Outline);
+            unit->renderer().render(overlayBatch, unitPosition, RenderType::Outline);
         } else {
-            unit->renderer().render(*m_outlineOverlay, unitPosition, RenderType::BuildingAlpha);
+            unit->renderer().render(overlayBatch, unitPosition, RenderType::BuildingAlpha);
 
         }
     }
     std::reverse(visibleUnits.begin(), visibleUnits.end());
 
     for (const Unit::Ptr &unit : visibleUnits) {
+        const ScreenPos pos = camera->absoluteScreenPos(unit->interpolatedPosition(tickProgress));
 
-        const bool blinkingAsTarget = unit->targetBlinkTimeLeft > 0 &&
-                (((unit->targetBlinkTimeLeft) / 500) % 2 == 0) &&
+        const int blinkTimeLeft = unit->targetBlinkTimeLeft();
+        const bool blinkingAsTarget = blinkTimeLeft > 0 &&
+                ((blinkTimeLeft / 500) % 2 == 0) &&
                 !unit->isDead() && !unit->isDying();
 
         if (blinkingAsTarget || m_selectedUnits.count(unit)) {
-            sf::RectangleShape rect;
-            sf::CircleShape circle;
-            circle.setFillColor(sf::Color::Transparent);
-            circle.setOutlineThickness(1);
-
             double width = unit->data()->OutlineSize.x * Constants::TILE_SIZE_HORIZONTAL;
             double height =  unit->data()->OutlineSize.y * Constants::TILE_SIZE_VERTICAL;
 
+            // Same as the default for sf::CircleShape
+            size_t pointCount = 30;
+
             if (unit->data()->ObstructionType == genie::Unit::UnitObstruction) {
                 width /= 2.;
                 height /= 2.;
             } else {
-                circle.setPointCount(4);
+                pointCount = 4;
             }
 
 #ifdef DEBUG
+            sf::RectangleShape rect;
             rect.setFillColor(sf::Color::Transparent);
             rect.setOutlineColor(sf::Color::White);
             rect.setOutlineThickness(1);
             rect.setSize(unit->clearanceSize());
-            rect.setPosition(camera->absoluteScreenPos(unit->position()));// + unit->rect().topLeft());
+            rect.setPosition(pos);// + unit->rect().topLeft());
+            overlayBatch.flush();
             m_outlineOverlay->draw(rect);
 #endif
 
-            ScreenPos pos = camera->absoluteScreenPos(unit->position());
-
-            circle.setPosition(pos.x - width, pos.y - height);
-            circle.setRadius(width);
-            circle.setScale(1, height / width);
-            circle.setOutlineColor(sf::Color::Black);
-            renderTarget->draw(circle);
-
-            if (blinkingAsTarget) {
-                circle.setOutlineColor(sf::Color::Green);
-            } else {
-                circle.setOutlineColor(sf::Color::White);
-            }
-            circle.setOutlineThickness(2);
-            circle.setPosition(pos.x - width, pos.y - height + 1);
-            renderTarget->draw(circle);
+            batch.addEllipseOutline(pos, width, height, pointCount, 1, sf::Color::Black);
+            batch.addEllipseOutline(ScreenPos(pos.x, pos.y + 1), width, height, pointCount, 2, blinkingAsTarget ? sf::Color::Green : sf::Color::White);
 
             // TODO: figure out what this is used for in which games
 //            bool showOutline = false;
@@ -369,31 +483,21 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
                 break;
             }
 
-            if (!blinkingAsTarget) {
-                pos.x -= Constants::TILE_SIZE_HORIZONTAL / 8;
-                pos.y -= height + Constants::TILE_SIZE_HEIGHT * unit->data()->HPBarHeight;
-
-                rect.setOutlineColor(sf::Color::Transparent);
-                rect.setPosition(pos);
-
-            }
-
             // draw health indicator
             if (showHealthbar) {
+                ScreenPos healthBarPos = pos;
+                healthBarPos.x -= Constants::TILE_SIZE_HORIZONTAL / 8;
+                healthBarPos.y -= height + Constants::TILE_SIZE_HEIGHT * unit->data()->HPBarHeight;
+
                 if (unit->healthLeft() < 1.) {
-                    rect.setFillColor(sf::Color::Red);
-                    rect.setSize(sf::Vector2f(Constants::TILE_SIZE_HORIZONTAL / 4., 2));
-                    m_outlineOverlay->draw(rect);
+                    overlayBatch.addRectangle(healthBarPos, sf::Vector2f(Constants::TILE_SIZE_HORIZONTAL / 4., 2), sf::Color::Red);
                 }
 
-                rect.setFillColor(sf::Color::Green);
-                rect.setSize(sf::Vector2f(unit->healthLeft() * Constants::TILE_SIZE_HORIZONTAL / 4., 2));
-                m_outlineOverlay->draw(rect);
+                overlayBatch.addRectangle(healthBarPos, sf::Vector2f(unit->healthLeft() * Constants::TILE_SIZE_HORIZONTAL / 4., 2), sf::Color::Green);
             }
         }
 
-        const ScreenPos pos = renderTarget->camera()->absoluteScreenPos(unit->position());
-        unit->renderer().render(*renderTarget->renderTarget_, pos, RenderType::Base);
+        unit->renderer().render(batch, pos, RenderType::Base);
 
 
 #if defined(DEBUG)
@@ -407,6 +511,7 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
             circle.setFillColor(sf::Color::Black);
             circle.setOutlineColor(sf::Color::White);
             circle.setOutlineThickness(1);
+            overlayBatch.flush();
             for (const MapPos &p : moveAction->path()) {
                 ScreenPos pos = camera->absoluteScreenPos(p);
                 circle.setPosition(pos.x, pos.y);
@@ -416,8 +521,11 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
 #endif
     }
 
+    overlayBatch.flush();
     m_outlineOverlay->display();
 
+    batch.flush();
+
     { // this is a bit wrong, on bright buildings it's almost not visible, but haven't found a better solution other than writing a custom shader
         sf::Sprite sprite;
         sprite.setTexture(m_outlineOverlay->getTexture());
@@ -438,7 +546,7 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
     }
     for (const Unit::Ptr &unit : visibleUnits) {
         sf::CircleShape circle;
-        ScreenPos pos = camera->absoluteScreenPos(unit->position());
+        ScreenPos pos = camera->absoluteScreenPos(unit->interpolatedPosition(tickProgress));
         circle.setPosition(pos.x, pos.y);
         circle.setRadius(5);
         circle.setScale(1, 0.5);
@@ -447,12 +555,12 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
     }
 #endif
 
-    m_moveTargetMarker->renderer().render(*renderTarget->renderTarget_,
+    m_moveTargetMarker->renderer().render(batch,
                                           renderTarget->camera()->absoluteScreenPos(m_moveTargetMarker->position()),
                                           RenderType::Base);
 
     for (const Missile::Ptr &missile : visibleMissiles) {
-        missile->renderer().render(*renderTarget->renderTarget_, renderTarget->camera()->absoluteScreenPos(missile->position()), RenderType::Base);
+        missile->renderer().render(batch, renderTarget->camera()->absoluteScreenPos(missile->interpolatedPosition(tickProgress)), RenderType::Base);
     }
 
     if (m_state == State::PlacingBuilding || m_state == State::PlacingWall) {
@@ -462,32 +570,21 @@ void UnitManager::render(const std::shared_ptr<SfmlRenderTarget> &renderTarget,
             const double width = m_buildingsToPlace[0].data->OutlineSize.x * Constants::TILE_SIZE_HORIZONTAL + 1;
             const double height =  m_buildingsToPlace[0].data->OutlineSize.y * Constants::TILE_SIZE_VERTICAL + 1;
 
-            sf::CircleShape circle;
-            circle.setFillColor(sf::Color::Transparent);
-            circle.setOutlineThickness(1);
-            circle.setRadius(width);
-            circle.setPointCount(4);
-            circle.setScale(1, height / width);
-
-            ScreenPos pos = camera->absoluteScreenPos(m_buildingsToPlace[0].position);
-
+            const ScreenPos pos = camera->absoluteScreenPos(m_buildingsToPlace[0].position);
 
-            circle.setPosition(pos.x - width, pos.y - height + 1);
-            circle.setOutlineColor(sf::Color::Black);
-            renderTarget->draw(circle);
-
-            circle.setPosition(pos.x - width, pos.y - height);
-            circle.setOutlineColor(sf::Color::White);
-            renderTarget->draw(circle);
+            batch.addEllipseOutline(ScreenPos(pos.x, pos.y + 1), width, height, 4, 1, sf::Color::Black);
+            batch.addEllipseOutline(pos, width, height, 4, 1, sf::Color::White);
         }
 
         for (const UnplacedBuilding &building : m_buildingsToPlace) {
             building.graphic->setOrientation(building.orientation);
-            building.graphic->render(*renderTarget->renderTarget_,
+            building.graphic->render(batch,
                                         renderTarget->camera()->absoluteScreenPos(building.position),
                                         building.canPlace ? RenderType::ConstructAvailable : RenderType::ConstructUnavailable);
         }
     }
+
+    batch.flush();
 }
 
 bool UnitManager::onLeftClick(const ScreenPos &screenPos, const CameraPtr &camera)
@@ -539,10 +636,10 @@ bool UnitManager::onLeftClick(const ScreenPos &screenPos, const CameraPtr &camer
             if (targetUnit) {
                 Task task = unit->actions.findAnyTask(genie::ActionType::Attack, targetUnit->data()->ID);
                 task.target = targetUnit;
-                action = std::make_shared<ActionAttack>(unit, task);
+                action = makePooled<ActionAttack>(unit, task);
             } else {
                 DBG << "Attacking ground";
-                action = std::make_shared<ActionAttack>(unit, targetPos, unit->actions.findAnyTask(genie::ActionType::Attack, -1));
+                action = makePooled<ActionAttack>(unit, targetPos, unit->actions.findAnyTask(genie::ActionType::Attack, -1));
             }
             unit->actions.setCurrentAction(action);
         }
@@ -592,7 +689,7 @@ void UnitManager::onRightClick(const ScreenPos &screenPos, const CameraPtr &came
         task.target = target;
         IAction::assignTask(task, unit);
         if (target) {
-            target->targetBlinkTimeLeft = 3000; // 3s
+            target->setTargetBlinkTimeLeft(3000); // 3s
         }
         foundTasks = true;
     }
@@ -603,6 +700,10 @@ void UnitManager::onRightClick(const ScreenPos &screenPos, const CameraPtr &came
 
     MapPos mapPos = camera->absoluteMapPos(screenPos).clamped(m_map->pixelSize());
 
+    // Bigger groups share the pathfinding, one flow field per terrain restriction
+    const bool groupMove = m_selectedUnits.size() >= MIN_FLOW_FIELD_GROUP_SIZE;
+    std::unordered_map<int, FlowField::Ptr> flowFields;
+
     bool movedSomeone = false;
     for (const Unit::Ptr &unit : m_selectedUnits) {
         if (unit->playerId != humanPlayer->playerId) {
@@ -610,7 +711,16 @@ void UnitManager::onRightClick(const ScreenPos &screenPos, const CameraPtr &came
         }
 
         unit->actions.clearActionQueue();
-        moveUnitTo(unit, mapPos);
+        if (groupMove && unit->data()->Speed) {
+            const int terrainRestriction = unit->data()->TerrainRestriction;
+            FlowField::Ptr &flowField = flowFields[terrainRestriction];
+            if (!flowField) {
+                flowField = std::make_shared<FlowField>(m_map->passability(), mapPos, terrainRestriction);
+            }
+            unit->actions.setCurrentAction(ActionMove::moveUnitTo(unit, flowField));
+        } else {
+            moveUnitTo(unit, mapPos);
+        }
         movedSomeone = true;
 
         AudioPlayer::instance().playSound(unit->data()->Action.MoveSound, humanPlayer->civilization.id());
@@ -710,9 +820,12 @@ void UnitManager::onMouseMove(const MapPos &mapPos)
         m_buildingsToPlace[0].position = mapPos;
     }
 
+    Player::Ptr humanPlayer = m_humanPlayer.lock();
+    const int playerId = humanPlayer ? humanPlayer->playerId : -1;
+
     for (UnplacedBuilding &building : m_buildingsToPlace) {
         building.position = Unit::snapPositionToGrid(building.position, m_map, building.data);
-        building.canPlace = Building::canPlace(building.position, m_map, building.data);
+        building.canPlace = Building::canPlace(building.position, m_map, building.data, playerId);
     }
 }
 
@@ -19,8 +19,12 @@
 #pragma once
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "Unit.h"
+#include "PathfindingQueue.h"
+#include "AutoTargetTracker.h"
+#include "core/Random.h"
 
 class SfmlRenderTarget;
 
@@ -114,7 +118,8 @@ public:
     void setHumanPlayer(const std::shared_ptr<Player> &player) { m_humanPlayer = player; }
 
     bool update(Time time);
-    void render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<std::weak_ptr<Entity> > &visible);
+    /// @p tickProgress is how far we are towards the next update, for smooth movement
+    void render(const std::shared_ptr<SfmlRenderTarget> &renderTarget, const std::vector<Entity *> &visible, const float tickProgress = 1.f);
 
     bool onLeftClick(const ScreenPos &screenPos, const CameraPtr &camera);
     void onRightClick(const ScreenPos &screenPos, const CameraPtr &camera);
@@ -145,36 +150,71 @@ public:
 
     State state() const { return m_state; }
 
-    void addMissile(const std::shared_ptr<Missile> &missile) { m_missiles.insert(missile); }
-    void addDecayingEntity(const DecayingEntity::Ptr &entity) { m_decayingEntities.insert(entity); }
+    void addMissile(const std::shared_ptr<Missile> &missile) { m_missiles.push_back(missile); }
+    void addDecayingEntity(const DecayingEntity::Ptr &entity) { m_decayingEntities.push_back(entity); }
 
-    void onCombatantUnitsMoved() { m_unitsMoved = true; }
+    /// Pass -1 for the old position if it just appeared
+    void onUnitMoved(const Unit &unit, const int oldCol, const int oldRow, const int newCol, const int newRow) {
+        m_autoTargetTracker.onUnitMoved(unit, oldCol, oldRow, newCol, newRow);
+    }
+    void onUnitIdle(const Unit &unit) { m_autoTargetTracker.onUnitIdle(unit); }
+
+    PathfindingQueue &pathfindingQueue() noexcept { return m_pathfindingQueue; }
+
+    /// Shared with the units, so they can outlive us
+    const std::shared_ptr<UnitStore> &unitStore() const noexcept { return m_unitStore; }
+
+    /// Use this instead of rand(), so games can be replayed
+    Random &random() noexcept { return m_random; }
+
+    /// Hash of the state of all units, to check that simulations are in sync
+    uint64_t stateHash() const noexcept;
+
+    /// Total time spent in the different parts of update(), in microseconds
+    struct UpdateTimings {
+        int64_t pathfinding = 0;
+        int64_t autoTargeting = 0;
+        int64_t missiles = 0;
+        int64_t decayingEntities = 0;
+        int64_t cleanup = 0;
+        int64_t units = 0;
+    };
+    const UpdateTimings &updateTimings() const noexcept { return m_updateTimings; }
 
 private:
     void updateBuildingToPlace();
     void placeBuilding(const UnplacedBuilding &building);
 
+    /// Swaps it with the last one in m_units, must be in there
+    void removeFromList(const Unit::Ptr &unit);
+
     State m_state = State::Default;
 
     void playSound(const Unit::Ptr &unit);
     const Task taskForPosition(const Unit::Ptr &unit, const ScreenPos &pos, const CameraPtr &camera) const noexcept;
 
-    std::unordered_set<std::shared_ptr<Missile>> m_missiles;
-    std::unordered_set<DecayingEntity::Ptr> m_decayingEntities;
+    /// Lots of these come and go all the time, so no per entry allocations,
+    /// finished ones are compacted out so the rest keep their order
+    std::vector<std::shared_ptr<Missile>> m_missiles;
+    std::vector<DecayingEntity::Ptr> m_decayingEntities;
+    std::shared_ptr<UnitStore> m_unitStore;
     UnitVector m_units;
-    UnitSet m_unitsWithActions;
+    std::vector<Unit*> m_destroyedUnits;
     std::unordered_set<Task> m_currentActions;
 
     UnitSet m_selectedUnits;
     MapPtr m_map;
+    PathfindingQueue m_pathfindingQueue;
+    AutoTargetTracker m_autoTargetTracker;
+    Random m_random;
+    UpdateTimings m_updateTimings;
+    UnitVector m_autoTargetUnits;
     std::unique_ptr<sf::RenderTexture> m_outlineOverlay;
     MoveTargetMarker::Ptr m_moveTargetMarker;
 
     std::vector<UnplacedBuilding> m_buildingsToPlace;
     MapPos m_wallPlacingStart;
 
-    bool m_unitsMoved = true;
-
     MapPos m_previousCameraPos;
     std::weak_ptr<Player> m_humanPlayer;
 };
@@ -0,0 +1,121 @@
+#include "UnitStore.h"
+
+#include "core/Logger.h"
+
+#include <genie/dat/Unit.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+/// Long enough for any reload, and doesn't overflow
+static const int s_maxTimeSinceAttack = 1 << 30;
+
+UnitStore::Handle UnitStore::add(Unit *unit, const genie::Unit *data, const int playerId)
+{
+    Handle handle;
+    if (!m_freeIndices.empty()) {
+        handle.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    } else {
+        handle.index = m_slots.size();
+        m_slots.push_back(InvalidIndex);
+        m_generations.push_back(0);
+    }
+    handle.generation = m_generations[handle.index];
+
+    m_slots[handle.index] = m_units.size();
+    m_handleIndices.push_back(handle.index);
+
+    m_units.push_back(unit);
+    m_data.push_back(data);
+    m_playerIds.push_back(playerId);
+    m_damageTaken.push_back(0.f);
+    m_creationProgress.push_back(0.f);
+    m_targetBlinkTimeLeft.push_back(0);
+    m_timeSinceAttack.push_back(s_maxTimeSinceAttack);
+    m_listIndices.push_back(InvalidIndex);
+
+    return handle;
+}
+
+void UnitStore::remove(const Handle handle) noexcept
+{
+    if (IS_UNLIKELY(!contains(handle))) {
+        WARN << "Trying to remove invalid unit handle" << handle.index << handle.generation;
+        return;
+    }
+
+    // Move the last one into the hole, so everything stays packed
+    const uint32_t removedSlot = m_slots[handle.index];
+    const uint32_t lastSlot = m_units.size() - 1;
+    if (removedSlot != lastSlot) {
+        const uint32_t movedIndex = m_handleIndices[lastSlot];
+        m_slots[movedIndex] = removedSlot;
+        m_handleIndices[removedSlot] = movedIndex;
+
+        m_units[removedSlot] = m_units[lastSlot];
+        m_data[removedSlot] = m_data[lastSlot];
+        m_playerIds[removedSlot] = m_playerIds[lastSlot];
+        m_damageTaken[removedSlot] = m_damageTaken[lastSlot];
+        m_creationProgress[removedSlot] = m_creationProgress[lastSlot];
+        m_targetBlinkTimeLeft[removedSlot] = m_targetBlinkTimeLeft[lastSlot];
+        m_timeSinceAttack[removedSlot] = m_timeSinceAttack[lastSlot];
+        m_listIndices[removedSlot] = m_listIndices[lastSlot];
+    }
+
+    m_handleIndices.pop_back();
+    m_units.pop_back();
+    m_data.pop_back();
+    m_playerIds.pop_back();
+    m_damageTaken.pop_back();
+    m_creationProgress.pop_back();
+    m_targetBlinkTimeLeft.pop_back();
+    m_timeSinceAttack.pop_back();
+    m_listIndices.pop_back();
+
+    // Invalidates any old copies of the handle
+    m_slots[handle.index] = InvalidIndex;
+    m_generations[handle.index]++;
+    m_freeIndices.push_back(handle.index);
+}
+
+void UnitStore::setData(const Handle handle, const genie::Unit *data) noexcept
+{
+    m_data[slot(handle)] = data;
+}
+
+void UnitStore::updateTimers(const Time time) noexcept
+{
+    if (!m_lastTimerUpdate) {
+        m_lastTimerUpdate = time;
+        return;
+    }
+
+    const int timeDelta = time - m_lastTimerUpdate;
+    m_lastTimerUpdate = time;
+
+    for (int &timeLeft : m_targetBlinkTimeLeft) {
+        timeLeft = std::max(timeLeft - timeDelta, 0);
+    }
+
+    for (int &timeSince : m_timeSinceAttack) {
+        timeSince = std::min(timeSince + timeDelta, s_maxTimeSinceAttack);
+    }
+}
+
+void UnitStore::collectDestroyed(std::vector<Unit*> *units) const
+{
+    const size_t count = m_units.size();
+    for (size_t i = 0; i < count; i++) {
+        const float hitpoints = m_data[i] ? m_data[i]->HitPoints : 0.f;
+        if (m_damageTaken[i] >= hitpoints) {
+            units->push_back(m_units[i]);
+        }
+    }
+}
+
+void UnitStore::invalidHandle(const Handle handle) noexcept
+{
+    WARN << "Invalid unit handle" << handle.index << handle.generation;
+    std::abort();
+}
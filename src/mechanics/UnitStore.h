@@ -0,0 +1,103 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace genie {
+class Unit;
+}
+
+struct Unit;
+
+/// The per unit state that the simulation goes over every tick, kept in
+/// packed arrays (one per field) instead of inside each Unit, so the systems
+/// that go over all units don't have to chase pointers. The Unit accessors for
+/// these fields go through here.
+///
+/// Units are looked up with handles that stay valid as long as the unit
+/// lives, while their slot in the arrays changes when other units are removed.
+class UnitStore
+{
+public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    struct Handle {
+        uint32_t index = InvalidIndex;
+        uint32_t generation = 0;
+
+        bool isValid() const noexcept { return index != InvalidIndex; }
+    };
+
+    Handle add(Unit *unit, const genie::Unit *data, const int playerId);
+    void remove(const Handle handle) noexcept;
+    inline bool contains(const Handle handle) const noexcept {
+        return handle.index < m_slots.size() && m_generations[handle.index] == handle.generation && m_slots[handle.index] != InvalidIndex;
+    }
+
+    size_t size() const noexcept { return m_units.size(); }
+
+    void setData(const Handle handle, const genie::Unit *data) noexcept;
+
+    inline float damageTaken(const Handle handle) const noexcept { return m_damageTaken[slot(handle)]; }
+    inline void setDamageTaken(const Handle handle, const float damage) noexcept { m_damageTaken[slot(handle)] = damage; }
+
+    inline float creationProgress(const Handle handle) const noexcept { return m_creationProgress[slot(handle)]; }
+    inline void setCreationProgress(const Handle handle, const float progress) noexcept { m_creationProgress[slot(handle)] = progress; }
+
+    inline int targetBlinkTimeLeft(const Handle handle) const noexcept { return m_targetBlinkTimeLeft[slot(handle)]; }
+    inline void setTargetBlinkTimeLeft(const Handle handle, const int timeLeft) noexcept { m_targetBlinkTimeLeft[slot(handle)] = timeLeft; }
+
+    /// For the reload, kept per unit so it doesn't reset when it gets a new task
+    inline int timeSinceAttack(const Handle handle) const noexcept { return m_timeSinceAttack[slot(handle)]; }
+    inline void resetAttackTimer(const Handle handle) noexcept { m_timeSinceAttack[slot(handle)] = 0; }
+
+    /// Where the UnitManager has the unit in its list, InvalidIndex if it
+    /// isn't there (e.g. annexes)
+    inline uint32_t listIndex(const Handle handle) const noexcept { return m_listIndices[slot(handle)]; }
+    inline void setListIndex(const Handle handle, const uint32_t index) noexcept { m_listIndices[slot(handle)] = index; }
+
+    /// Counts down the blink timers and counts up the attack timers of all units
+    void updateTimers(const Time time) noexcept;
+
+    /// Units that have taken at least as much damage as they have hitpoints,
+    /// i. e. they are either dying or dead. The hitpoints are read from the
+    /// data every time, upgrades change them in place.
+    void collectDestroyed(std::vector<Unit*> *units) const;
+
+    /// All units, in the same order as the other arrays
+    const std::vector<Unit*> &units() const noexcept { return m_units; }
+    const std::vector<int> &playerIds() const noexcept { return m_playerIds; }
+
+private:
+    inline uint32_t slot(const Handle handle) const noexcept {
+        if (IS_UNLIKELY(!contains(handle))) {
+            invalidHandle(handle);
+        }
+        return m_slots[handle.index];
+    }
+
+    [[noreturn]] static void invalidHandle(const Handle handle) noexcept;
+
+    /// Indexed by handle index
+    std::vector<uint32_t> m_slots;
+    std::vector<uint32_t> m_generations;
+    std::vector<uint32_t> m_freeIndices;
+
+    /// Everything below is indexed by slot
+    std::vector<uint32_t> m_handleIndices;
+
+    std::vector<Unit*> m_units;
+    std::vector<const genie::Unit*> m_data;
+    std::vector<int> m_playerIds;
+    std::vector<float> m_damageTaken;
+    std::vector<float> m_creationProgress;
+    std::vector<int> m_targetBlinkTimeLeft;
+    std::vector<int> m_timeSinceAttack;
+    std::vector<uint32_t> m_listIndices;
+
+    Time m_lastTimerUpdate = 0;
+};
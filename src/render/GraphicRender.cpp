@@ -20,7 +20,6 @@
 
 #include <SFML/Graphics/BlendMode.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
-#include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <genie/dat/GraphicAttackSound.h>
@@ -34,6 +33,7 @@
 #include "core/Logger.h"
 #include "core/Types.h"
 #include "render/GraphicRender.h"
+#include "render/SpriteBatch.h"
 #include "resource/Graphic.h"
 
 bool GraphicRender::update(Time time, const bool isVisible) noexcept
@@ -111,11 +111,17 @@ inline bool GraphicRender::isValid() const noexcept
 }
 
 void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass) noexcept
+{
+    SpriteBatch batch(renderTarget);
+    render(batch, screenPos, renderpass);
+}
+
+void GraphicRender::render(SpriteBatch &batch, const ScreenPos screenPos, const RenderType renderpass) noexcept
 {
     if (m_frameChanged && m_playSounds) {
         m_frameChanged = false;
 
-        const ScreenPos screenCenter = ScreenPos(renderTarget.getSize().x/2., renderTarget.getSize().y/2.);
+        const ScreenPos screenCenter = ScreenPos(batch.target().getSize().x/2., batch.target().getSize().y/2.);
         const float pan = (screenPos.x - screenCenter.x) / screenCenter.x;
         const float maxDistance = screenCenter.distanceTo(ScreenPos(0, 0));
         const float volume = (maxDistance - screenCenter.distanceTo(screenPos)) / maxDistance;
@@ -127,25 +133,25 @@ void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos scree
             continue;
         }
 
-        delta.graphic->render(renderTarget, screenPos + delta.offset, renderpass);
+        delta.graphic->render(batch, screenPos + delta.offset, renderpass);
     }
 
     if (m_graphic && m_graphic->isValid()) {
-        sf::Sprite sprite;
+        ImageType imageType = ImageType::Base;
         sf::BlendMode blendMode;
 
         switch(renderpass) {
         case RenderType::Base:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::Base));
+            imageType = ImageType::Base;
             break;
         case RenderType::BuildingAlpha:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::Base));
+            imageType = ImageType::Base;
             blendMode = sf::BlendAdd;
             blendMode.colorSrcFactor = sf::BlendMode::Zero;
             blendMode.colorDstFactor = sf::BlendMode::Zero;
             break;
         case RenderType::Outline:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::Outline));
+            imageType = ImageType::Outline;
             blendMode.alphaSrcFactor = sf::BlendMode::Zero;
             blendMode.alphaEquation = sf::BlendMode::Add;
             blendMode.alphaDstFactor = sf::BlendMode::DstAlpha;
@@ -155,26 +161,28 @@ void GraphicRender::render(sf::RenderTarget &renderTarget, const ScreenPos scree
             blendMode.colorDstFactor = sf::BlendMode::Zero;
             break;
         case RenderType::ConstructAvailable:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::Construction));
+            imageType = ImageType::Construction;
             break;
         case RenderType::Shadow:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::Shadow));
+            imageType = ImageType::Shadow;
             break;
         case RenderType::ConstructUnavailable:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::ConstructionUnavailable));
+            imageType = ImageType::ConstructionUnavailable;
             break;
         case RenderType::InTheShadows:
-            sprite.setTexture(m_graphic->texture(m_currentFrame, m_angle, m_playerColor, ImageType::InTheShadows));
+            imageType = ImageType::InTheShadows;
             break;
         }
 
-        sprite.setPosition(screenPos - m_graphic->getHotspot(m_currentFrame, m_angle));
-        renderTarget.draw(sprite, blendMode);
+        const TextureAtlas::Region region = m_graphic->texture(m_currentFrame, m_angle, m_playerColor, imageType);
+        if (region.texture) {
+            batch.addSprite(*region.texture, region.rect, screenPos - m_graphic->getHotspot(m_currentFrame, m_angle), blendMode);
+        }
     }
 
 
     if (m_damageOverlay) {
-        m_damageOverlay->render(renderTarget, screenPos, renderpass);
+        m_damageOverlay->render(batch, screenPos, renderpass);
     }
 }
 
@@ -32,6 +32,8 @@ class GraphicRender;
 class Graphic;
 typedef std::shared_ptr<Graphic> GraphicPtr;
 
+class SpriteBatch;
+
 namespace sf {
 class RenderTarget;
 }
@@ -86,7 +88,9 @@ public:
     bool update(Time time, const bool isVisible) noexcept;
     inline bool isValid() const noexcept;
 
-    virtual void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass) noexcept;
+    /// Draws it right away, prefer the batched version when drawing many
+    void render(sf::RenderTarget &renderTarget, const ScreenPos screenPos, const RenderType renderpass) noexcept;
+    virtual void render(SpriteBatch &batch, const ScreenPos screenPos, const RenderType renderpass) noexcept;
 
     void setPlayerColor(int playerColor) noexcept;
     void setCivId(int civId) noexcept { m_civId = civId; }
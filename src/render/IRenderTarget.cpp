@@ -2,6 +2,7 @@
 
 #include "resource/DataManager.h"
 #include "resource/AssetManager.h"
+#include "resource/PaletteConversion.h"
 #include <genie/resource/Color.h>
 #include <genie/resource/SlpFrame.h>
 #include <genie/resource/PalFile.h>
@@ -46,20 +47,10 @@ Drawable::Image::Ptr IRenderTarget::convertFrameToImage(const genie::SlpFramePtr
     std::vector<Uint8> pixelsBuf(area * 4);
     Uint8 *pixels = pixelsBuf.data();
 
-    const std::vector<genie::Color> &colors = palette.colors_;
-    const std::vector<uint8_t> &pixelindexes = frameData.pixel_indexes;
-    const std::vector<uint8_t> &alphachannel = frameData.alpha_channel;
-    assert(pixelindexes.size() == area);
-    assert(alphachannel.size() == area);
-    for (int i=0; i<area; i++) {
-        const genie::Color &col = colors[pixelindexes[i]];
-        *pixels++ = col.r;
-        *pixels++ = col.g;
-        *pixels++ = col.b;
-        *pixels++ = alphachannel[i];
-    }
+    assert(frameData.pixel_indexes.size() == area);
+    assert(frameData.alpha_channel.size() == area);
+    palette::toRgba(frameData.pixel_indexes.data(), frameData.alpha_channel.data(), palette::makeLut(palette.colors_), reinterpret_cast<uint32_t*>(pixels), area);
 
-    pixels = pixelsBuf.data();
     if (playerId >= 0) {
         genie::PlayerColour pc = DataManager::Inst().getPlayerColor(playerId);
         for (const genie::PlayerColorXY mask : frameData.player_color_mask) {
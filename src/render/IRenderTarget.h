@@ -176,6 +176,9 @@ public:
     Drawable::Image::Ptr convertFrameToImage(const genie::SlpFramePtr &frame, const genie::PalFile &palette, const int playerId = -1);
     virtual void draw(const Drawable::Image::Ptr &image, const ScreenPos &position) = 0;
 
+    /// Replaces the pixels in @p rect of an image from createImage, @p pixels is rect.width * rect.height RGBA
+    virtual void updateImage(const Drawable::Image::Ptr &image, const ScreenRect &rect, const uint8_t *pixels) = 0;
+
     virtual std::shared_ptr<IRenderTarget> createTextureTarget(const Size &size) = 0;
 
     virtual Drawable::Text::Ptr createText() = 0;
@@ -22,7 +22,9 @@
 #include <genie/resource/EdgeFiles.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <vector>
 
 #include "mechanics/Map.h"
@@ -62,7 +64,7 @@ bool MapRenderer::update(Time /*time*/)
     const MapPos cameraPos = renderTarget_->camera()->targetPosition();
 
     if (!m_camChanged && m_lastCameraPos == cameraPos &&
-        (m_textureTarget && m_textureTarget->getSize() == renderTarget_->getSize()) &&
+        m_lastSize == renderTarget_->getSize() &&
         !m_map->tilesUpdated()) {
         return false;
     }
@@ -118,10 +120,10 @@ bool MapRenderer::update(Time /*time*/)
     m_yOffset = offsetSp.y;
 
     m_lastCameraPos = cameraPos;
+    m_lastSize = renderTarget_->getSize();
     m_camChanged = false;
 
-    updateTexture();
-
+    // The chunks check themselves if they need to be redrawn
     m_map->flushDirty();
 
     return true;
@@ -134,13 +136,51 @@ void MapRenderer::display()
         return;
     }
 
-    if (!m_textureTarget || m_textureTarget->getSize() != renderTarget_->getSize() || m_visibilityMap->isDirty) {
-        m_visibilityMap->isDirty = false;
+    if (IS_UNLIKELY(!m_map)) {
+        return;
+    }
+
+    m_frameCount++;
+
+    renderTarget_->clear();
+
+    // Where the top corner of the map ends up on the screen, the chunks are relative to it
+    const ScreenPos origin = renderTarget_->camera()->absoluteScreenPos(MapPos(0, 0, 0));
+
+    const DirtyRegions &terrainRegions = m_map->dirtyRegions();
+    const DirtyRegions &visibilityRegions = m_visibilityMap->dirtyRegions();
+
+    const int firstChunkCol = m_rColBegin / ChunkSize;
+    const int firstChunkRow = m_rRowBegin / ChunkSize;
+    const int lastChunkCol = (m_rColEnd - 1) / ChunkSize;
+    const int lastChunkRow = (m_rRowEnd - 1) / ChunkSize;
+
+    // Same order as the tiles inside the chunks are drawn
+    for (int chunkCol = firstChunkCol; chunkCol <= lastChunkCol; chunkCol++) {
+        for (int chunkRow = lastChunkRow; chunkRow >= firstChunkRow; chunkRow--) {
+            TerrainChunk &chunk = m_chunks[chunkRow * terrainRegions.regionColumns() + chunkCol];
+            chunk.lastUsed = m_frameCount;
 
-        updateTexture();
+            const uint32_t terrainGeneration = terrainRegions.generation(chunkCol, chunkRow);
+            const uint32_t visibilityGeneration = visibilityRegions.generation(chunkCol, chunkRow);
+            if (!chunk.isDrawn || chunk.terrainGeneration != terrainGeneration || chunk.visibilityGeneration != visibilityGeneration) {
+                drawChunk(chunk, chunkCol, chunkRow);
+
+                chunk.terrainGeneration = terrainGeneration;
+                chunk.visibilityGeneration = visibilityGeneration;
+                chunk.isDrawn = true;
+            }
+
+            // Nothing explored in it
+            if (!chunk.texture) {
+                continue;
+            }
+
+            renderTarget_->draw(chunk.texture, origin + chunk.offset);
+        }
     }
 
-    renderTarget_->draw(m_textureTarget);
+    evictChunks();
 }
 
 void MapRenderer::setMap(const MapPtr &map)
@@ -155,6 +195,12 @@ void MapRenderer::setMap(const MapPtr &map)
     m_rRowEnd = m_map->rowCount();
     m_rColEnd = m_map->columnCount();
 
+    // Much faster to generate them all in parallel up front than one by one when drawing
+    if (m_map && renderTarget_) {
+        TerrainSprite::prerenderTiles(*m_map, renderTarget_);
+    }
+
+    m_chunks.clear();
     m_camChanged = true;
 }
 
@@ -165,30 +211,40 @@ void MapRenderer::setVisibilityMap(const std::shared_ptr<VisibilityMap> &visibil
     }
 
     m_visibilityMap = visibilityMap;
+
+    m_chunks.clear();
+    m_camChanged = true;
 }
 
-void MapRenderer::updateTexture()
+void MapRenderer::drawChunk(TerrainChunk &chunk, const int chunkCol, const int chunkRow)
 {
-    if (IS_UNLIKELY(!m_visibilityMap)) {
-        WARN << "no visibility map set";
-        return;
-    }
-
-    if (!m_textureTarget || m_textureTarget->getSize() == renderTarget_->getSize()) {
-        m_textureTarget = renderTarget_->createTextureTarget(renderTarget_->getSize());
-    }
-
-    m_textureTarget->clear();
-
-    Drawable::Circle invalidIndicator;
-    invalidIndicator.radius = Constants::TILE_SIZE;
-    invalidIndicator.pointCount = 4;
-    invalidIndicator.aspectRatio = 0.5;
-    invalidIndicator.filled = true;
-    invalidIndicator.fillColor = Drawable::Red;
+    const int firstCol = chunkCol * ChunkSize;
+    const int firstRow = chunkRow * ChunkSize;
+    const int lastCol = std::min(firstCol + ChunkSize, m_map->columnCount()) - 1;
+    const int lastRow = std::min(firstRow + ChunkSize, m_map->rowCount()) - 1;
+
+    // First figure out what to draw, so we know how big the texture needs to be
+    m_tileDraws.clear();
+
+    float left = std::numeric_limits<float>::max();
+    float top = std::numeric_limits<float>::max();
+    float right = std::numeric_limits<float>::lowest();
+    float bottom = std::numeric_limits<float>::lowest();
+    const auto addDraw = [&](const Drawable::Image::Ptr &image, const ScreenPos &position, const float width, const float height) {
+        m_tileDraws.push_back({image, position});
+        left = std::min(left, position.x);
+        top = std::min(top, position.y);
+        right = std::max(right, position.x + width);
+        bottom = std::max(bottom, position.y + height);
+    };
+    const auto addImage = [&](const Drawable::Image::Ptr &image, const ScreenPos &position) {
+        if (image) {
+            addDraw(image, position, image->size.width, image->size.height);
+        }
+    };
 
-    for (int col = m_rColBegin; col < m_rColEnd; col++) {
-        for (int row = m_rRowEnd-1; row >= m_rRowBegin; row--) {
+    for (int col = firstCol; col <= lastCol; col++) {
+        for (int row = lastRow; row >= firstRow; row--) {
             const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(col, row);
             if (visibility == VisibilityMap::Unexplored) {
                 continue;
@@ -196,19 +252,11 @@ void MapRenderer::updateTexture()
 
             MapTile &mapTile = m_map->getTileAt(col, row);
 
-            MapRect rect;
-            rect.x = col * Constants::TILE_SIZE;
-            rect.y = row * Constants::TILE_SIZE;
-            rect.z = mapTile.elevation * m_elevationHeight;
-            rect.width = Constants::TILE_SIZE;
-            rect.height = Constants::TILE_SIZE;
+            const MapPos tilePos(col * Constants::TILE_SIZE, row * Constants::TILE_SIZE, mapTile.elevation * m_elevationHeight);
 
-            // col and row are in map coordinates, so the top corners when rotated 45° we don't need to draw
-//            if (!renderTarget_->camera()->isVisible(rect)) {
-//                continue;
-//            }
-
-            ScreenPos spos = renderTarget_->camera()->absoluteScreenPos(rect.topLeft());
+            // Relative to the top corner of the map, so it doesn't depend on the camera
+            const ScreenPos tileScreenPos = tilePos.toScreen();
+            ScreenPos spos(tileScreenPos.x, -tileScreenPos.y);
 
             // If we wanted to do this 100% correctly, we would need to use the hotspot from the
             // filtered SLP and then always offset with yOffset, but this is good enough for now.
@@ -217,38 +265,83 @@ void MapRenderer::updateTexture()
                 spos.y -= mapTile.yOffset * 2;
             }
 
-
             TerrainPtr terrain = AssetManager::Inst()->getTerrain(mapTile.terrainId);
 
             if (!terrain || !terrain->isValid()) {
-                invalidIndicator.center = spos + ScreenPos(Constants::TILE_SIZE_HORIZONTAL/2, Constants::TILE_SIZE_VERTICAL/2);
-                m_textureTarget->draw(invalidIndicator);
+                addDraw(nullptr, spos, Constants::TILE_SIZE_HORIZONTAL + 2, Constants::TILE_SIZE_VERTICAL + 2);
                 continue;
             }
 
-            m_textureTarget->draw(terrain->texture(mapTile, m_textureTarget), spos);
-//                invalidIndicator.setPosition(spos);
-//                m_textureTarget.draw(invalidIndicator);
-//            m_textureTarget.draw(terrain->texture(mapTile), spos);
+            addImage(terrain->texture(mapTile, renderTarget_), spos);
 
-            if (m_visibilityMap->visibilityAt(col, row) == VisibilityMap::Explored) {
-                m_textureTarget->draw(shadowMask(mapTile.slopes.self.toGenie(), 0), spos);
+            if (visibility == VisibilityMap::Explored) {
+                addImage(shadowMask(mapTile.slopes.self.toGenie(), 0), spos);
             } else {
-                m_textureTarget->draw(shadowMask(mapTile.slopes.self.toGenie(), m_visibilityMap->edgeTileNum(col, row, VisibilityMap::Explored) * 2 + 1), spos);
+                addImage(shadowMask(mapTile.slopes.self.toGenie(), m_visibilityMap->edgeTileNum(col, row, VisibilityMap::Explored) * 2 + 1), spos);
+            }
+            addImage(unexploredMask(mapTile.slopes.self.toGenie(), m_visibilityMap->edgeTileNum(col, row, VisibilityMap::Unexplored)), spos);
+        }
+    }
+
+    if (m_tileDraws.empty()) {
+        chunk.texture.reset();
+        return;
+    }
+
+    chunk.offset = ScreenPos(std::floor(left), std::floor(top));
+    const Size size(std::ceil(right) - chunk.offset.x, std::ceil(bottom) - chunk.offset.y);
+
+    if (!chunk.texture || chunk.texture->getSize() != size) {
+        chunk.texture = renderTarget_->createTextureTarget(size);
+    }
+    chunk.texture->clear(Drawable::Transparent);
+
+    Drawable::Circle invalidIndicator;
+    invalidIndicator.radius = Constants::TILE_SIZE;
+    invalidIndicator.pointCount = 4;
+    invalidIndicator.aspectRatio = 0.5;
+    invalidIndicator.filled = true;
+    invalidIndicator.fillColor = Drawable::Red;
+
+    for (const TileDraw &draw : m_tileDraws) {
+        const ScreenPos position = draw.position - chunk.offset;
+
+        if (!draw.image) {
+            invalidIndicator.center = position + ScreenPos(Constants::TILE_SIZE_HORIZONTAL/2, Constants::TILE_SIZE_VERTICAL/2);
+            chunk.texture->draw(invalidIndicator);
+            continue;
+        }
+
+        chunk.texture->draw(draw.image, position);
+    }
+
+    // Don't keep the images alive
+    m_tileDraws.clear();
+}
+
+void MapRenderer::evictChunks()
+{
+    while (m_chunks.size() > MaxCachedChunks) {
+        std::unordered_map<int, TerrainChunk>::iterator oldest = m_chunks.end();
+        for (std::unordered_map<int, TerrainChunk>::iterator it = m_chunks.begin(); it != m_chunks.end(); it++) {
+            if (oldest == m_chunks.end() || it->second.lastUsed < oldest->second.lastUsed) {
+                oldest = it;
             }
-            m_textureTarget->draw(unexploredMask(mapTile.slopes.self.toGenie(), m_visibilityMap->edgeTileNum(col, row, VisibilityMap::Unexplored)), spos);
+        }
 
-//            text.setString(std::to_string(col) + "," + std::to_string(row));
-//            text.setPosition(spos.x, spos.y);
-//            m_textureTarget.draw(text);
+        // Everything is on screen
+        if (oldest->second.lastUsed == m_frameCount) {
+            return;
         }
+
+        m_chunks.erase(oldest);
     }
 }
 
 Drawable::Image::Ptr MapRenderer::drawTileSpans(const std::vector<genie::TileSpan> &tileSpans, const uint32_t color) const
 {
-    const int width = 97;
-    const int height = 96;
+    const int width = MaskWidth;
+    const int height = MaskHeight;
     std::vector<uint32_t> pixelsBuf(width * height);
     for (const genie::TileSpan &span : tileSpans) {
         if (IS_UNLIKELY(span.xEnd < span.xStart)) {
@@ -270,28 +363,26 @@ Drawable::Image::Ptr MapRenderer::drawTileSpans(const std::vector<genie::TileSpa
     return renderTarget_->createImage(Size(width, height), reinterpret_cast<uint8_t*>(pixelsBuf.data()));
 }
 
-const Drawable::Image::Ptr &MapRenderer::shadowMask(const genie::Slope slope, const int edges)
+Drawable::Image::Ptr MapRenderer::shadowMask(const genie::Slope slope, const int edges)
 {
     const int cacheIndex = slope * 256 + edges;
-    Drawable::Image::Ptr &texture = m_shadowCaches[cacheIndex];
-    if (texture) {
-        return texture;
+    const Drawable::Image::Ptr *cached = m_shadowCaches.find(cacheIndex);
+    if (cached && *cached) {
+        return *cached;
     }
 
     const genie::VisibilityMask &mask = AssetManager::Inst()->exploredVisibilityMask(slope, edges);
-    texture = drawTileSpans(mask.lines, 0x7f000000);
-    return texture;
+    return m_shadowCaches.insert(cacheIndex, drawTileSpans(mask.lines, 0x7f000000), MaskImageBytes);
 }
 
-const Drawable::Image::Ptr &MapRenderer::unexploredMask(const genie::Slope slope, const int edges)
+Drawable::Image::Ptr MapRenderer::unexploredMask(const genie::Slope slope, const int edges)
 {
     const int cacheIndex = slope * 256 + edges;
-    Drawable::Image::Ptr &texture = m_unexploredMaskCache[cacheIndex];
-    if (texture) {
-        return texture;
+    const Drawable::Image::Ptr *cached = m_unexploredMaskCache.find(cacheIndex);
+    if (cached && *cached) {
+        return *cached;
     }
 
     const genie::VisibilityMask &mask = AssetManager::Inst()->unexploredVisibilityMask(slope, edges);
-    texture = drawTileSpans(mask.lines, 0xff000000);
-    return texture;
+    return m_unexploredMaskCache.insert(cacheIndex, drawTileSpans(mask.lines, 0xff000000), MaskImageBytes);
 }
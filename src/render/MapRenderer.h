@@ -22,8 +22,11 @@
 #include <genie/resource/TileSpan.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "IRenderer.h"
+#include "core/DirtyRegions.h"
+#include "core/LruCache.h"
 #include "core/Types.h"
 #include "render/IRenderTarget.h"
 
@@ -55,13 +58,45 @@ public:
     int lastVisibleColumn() { return m_rColEnd; }
 
 private:
-    void updateTexture();
+    static constexpr int ChunkSize = DirtyRegions::RegionSize;
+
+    /// How many chunks we keep the textures of when they are scrolled out of view
+    static constexpr size_t MaxCachedChunks = 32;
+
+    /// The terrain is drawn in chunks of 16x16 tiles, which are only redrawn
+    /// when something inside them changes. Scrolling just draws them at a
+    /// different offset.
+    struct TerrainChunk {
+        IRenderTargetPtr texture;
+
+        /// Relative to where the top corner of the map is on the screen
+        ScreenPos offset;
+
+        uint32_t terrainGeneration = 0;
+        uint32_t visibilityGeneration = 0;
+        bool isDrawn = false;
+
+        uint64_t lastUsed = 0;
+    };
+
+    struct TileDraw {
+        Drawable::Image::Ptr image; // null for the invalid indicator
+        ScreenPos position;
+    };
+
+    void drawChunk(TerrainChunk &chunk, const int chunkCol, const int chunkRow);
+    void evictChunks();
 
     Drawable::Image::Ptr drawTileSpans(const std::vector<genie::TileSpan> &tileSpans, const uint32_t color) const;
-    const Drawable::Image::Ptr &shadowMask(const genie::Slope slope, const int edges);
-    const Drawable::Image::Ptr &unexploredMask(const genie::Slope slope, const int edges);
+    static constexpr int MaskWidth = 97;
+    static constexpr int MaskHeight = 96;
+    static constexpr size_t MaskImageBytes = MaskWidth * MaskHeight * 4;
+
+    Drawable::Image::Ptr shadowMask(const genie::Slope slope, const int edges);
+    Drawable::Image::Ptr unexploredMask(const genie::Slope slope, const int edges);
 
     MapPos m_lastCameraPos;
+    Size m_lastSize;
     bool m_camChanged;
     std::shared_ptr<VisibilityMap> m_visibilityMap;
 
@@ -71,10 +106,12 @@ private:
     int m_rRowBegin, m_rRowEnd;
     int m_rColBegin, m_rColEnd;
 
-    std::unordered_map<int, Drawable::Image::Ptr> m_shadowCaches;
-    std::unordered_map<int, Drawable::Image::Ptr> m_unexploredMaskCache;
+    LruCache<int, Drawable::Image::Ptr> m_shadowCaches { CacheManager::CacheType::MapMasks };
+    LruCache<int, Drawable::Image::Ptr> m_unexploredMaskCache { CacheManager::CacheType::MapMasks };
 
-    IRenderTargetPtr m_textureTarget;
+    std::unordered_map<int, TerrainChunk> m_chunks;
+    std::vector<TileDraw> m_tileDraws;
+    uint64_t m_frameCount = 0;
 
     const int m_elevationHeight;
 };
@@ -270,6 +270,22 @@ void SfmlRenderTarget::draw(const Drawable::Image::Ptr &image, const ScreenPos &
     renderTarget_->draw(sprite);
 }
 
+void SfmlRenderTarget::updateImage(const Drawable::Image::Ptr &image, const ScreenRect &rect, const uint8_t *pixels)
+{
+    if (!image || !pixels) {
+        WARN << "can't update null image";
+        return;
+    }
+
+    if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > image->size.width || rect.y + rect.height > image->size.height) {
+        WARN << "update" << rect << "outside of image" << image->size;
+        return;
+    }
+
+    const std::shared_ptr<SfmlImage> sfmlImage = std::static_pointer_cast<SfmlImage>(image);
+    sfmlImage->texture->update(pixels, unsigned(rect.width), unsigned(rect.height), unsigned(rect.x), unsigned(rect.y));
+}
+
 
 std::shared_ptr<IRenderTarget> SfmlRenderTarget::createTextureTarget(const Size &size)
 {
@@ -82,6 +82,7 @@ public:
 
     Drawable::Image::Ptr createImage(const Size &size, const uint8_t *bytes) override;
     void draw(const Drawable::Image::Ptr &image, const ScreenPos &position) override;
+    void updateImage(const Drawable::Image::Ptr &image, const ScreenRect &rect, const uint8_t *pixels) override;
     void draw(const std::shared_ptr<IRenderTarget> &renderTarget, const ScreenPos &pos = ScreenPos(0, 0)) override;
 
     //----------------------------------------------------------------------------
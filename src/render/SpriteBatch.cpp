@@ -0,0 +1,153 @@
+#include "SpriteBatch.h"
+
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <cmath>
+
+SpriteBatch::SpriteBatch(sf::RenderTarget &target) :
+    m_target(target)
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    flush();
+}
+
+void SpriteBatch::addSprite(const sf::Texture &texture, const sf::IntRect &rect, const ScreenPos &position, const sf::BlendMode &blendMode)
+{
+    if (rect.width <= 0 || rect.height <= 0) {
+        return;
+    }
+
+    setState(&texture, blendMode);
+
+    const sf::Vector2f topLeft(position.x, position.y);
+    const sf::Vector2f bottomRight(position.x + rect.width, position.y + rect.height);
+    addQuad(topLeft, bottomRight, sf::FloatRect(rect), sf::Color::White);
+}
+
+void SpriteBatch::addRectangle(const ScreenPos &position, const sf::Vector2f &size, const sf::Color &color)
+{
+    setState(nullptr, sf::BlendAlpha);
+
+    const sf::Vector2f topLeft(position.x, position.y);
+    addQuad(topLeft, topLeft + size, sf::FloatRect(), color);
+}
+
+void SpriteBatch::addEllipseOutline(const ScreenPos &center, const float radiusX, const float radiusY, const size_t pointCount, const float thickness, const sf::Color &color)
+{
+    if (pointCount < 3 || radiusX <= 0) {
+        return;
+    }
+
+    setState(nullptr, sf::BlendAlpha);
+
+    // Calculate it the same way as sf::Shape, on a circle, and then squash it
+    std::vector<sf::Vector2f> points(pointCount);
+    for (size_t i=0; i<pointCount; i++) {
+        const float angle = i * 2 * M_PI / pointCount - M_PI_2;
+        points[i] = sf::Vector2f(std::cos(angle) * radiusX, std::sin(angle) * radiusX);
+    }
+
+    const float scaleY = radiusY / radiusX;
+    const auto toScreen = [&](const sf::Vector2f &point) {
+        return sf::Vector2f(center.x + point.x, center.y + point.y * scaleY);
+    };
+
+    const auto normal = [](const sf::Vector2f &a, const sf::Vector2f &b) {
+        sf::Vector2f n(a.y - b.y, b.x - a.x);
+        const float length = std::sqrt(n.x * n.x + n.y * n.y);
+        if (length != 0.f) {
+            n /= length;
+        }
+        return n;
+    };
+
+    std::vector<sf::Vector2f> inner(pointCount);
+    std::vector<sf::Vector2f> outer(pointCount);
+    for (size_t i=0; i<pointCount; i++) {
+        const sf::Vector2f &previous = points[(i + pointCount - 1) % pointCount];
+        const sf::Vector2f &current = points[i];
+        const sf::Vector2f &next = points[(i + 1) % pointCount];
+
+        sf::Vector2f n1 = normal(previous, current);
+        sf::Vector2f n2 = normal(current, next);
+
+        // Make sure they point outwards, the center is at 0,0
+        if (n1.x * -current.x + n1.y * -current.y > 0) {
+            n1 = -n1;
+        }
+        if (n2.x * -current.x + n2.y * -current.y > 0) {
+            n2 = -n2;
+        }
+
+        const float factor = 1.f + (n1.x * n2.x + n1.y * n2.y);
+        const sf::Vector2f direction = (n1 + n2) / factor;
+
+        inner[i] = toScreen(current);
+        outer[i] = toScreen(current + direction * thickness);
+    }
+
+    for (size_t i=0; i<pointCount; i++) {
+        const size_t next = (i + 1) % pointCount;
+
+        m_vertices.emplace_back(inner[i], color);
+        m_vertices.emplace_back(outer[i], color);
+        m_vertices.emplace_back(inner[next], color);
+
+        m_vertices.emplace_back(inner[next], color);
+        m_vertices.emplace_back(outer[i], color);
+        m_vertices.emplace_back(outer[next], color);
+    }
+}
+
+void SpriteBatch::flush()
+{
+    if (m_vertices.empty()) {
+        return;
+    }
+
+    sf::RenderStates states(m_blendMode);
+    states.texture = m_texture;
+    m_target.draw(m_vertices.data(), m_vertices.size(), sf::Triangles, states);
+    m_drawCalls++;
+
+    // Keeps the capacity, so we don't need to allocate again
+    m_vertices.clear();
+}
+
+void SpriteBatch::setState(const sf::Texture *texture, const sf::BlendMode &blendMode)
+{
+    if (texture == m_texture && blendMode == m_blendMode) {
+        return;
+    }
+
+    flush();
+
+    m_texture = texture;
+    m_blendMode = blendMode;
+}
+
+void SpriteBatch::addQuad(const sf::Vector2f &topLeft, const sf::Vector2f &bottomRight, const sf::FloatRect &textureRect, const sf::Color &color)
+{
+    const float left = textureRect.left;
+    const float top = textureRect.top;
+    const float right = textureRect.left + textureRect.width;
+    const float bottom = textureRect.top + textureRect.height;
+
+    const sf::Vertex topLeftVertex(topLeft, color, sf::Vector2f(left, top));
+    const sf::Vertex topRightVertex(sf::Vector2f(bottomRight.x, topLeft.y), color, sf::Vector2f(right, top));
+    const sf::Vertex bottomLeftVertex(sf::Vector2f(topLeft.x, bottomRight.y), color, sf::Vector2f(left, bottom));
+    const sf::Vertex bottomRightVertex(bottomRight, color, sf::Vector2f(right, bottom));
+
+    m_vertices.push_back(topLeftVertex);
+    m_vertices.push_back(topRightVertex);
+    m_vertices.push_back(bottomLeftVertex);
+
+    m_vertices.push_back(bottomLeftVertex);
+    m_vertices.push_back(topRightVertex);
+    m_vertices.push_back(bottomRightVertex);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "core/Types.h"
+
+#include <SFML/Graphics/BlendMode.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace sf {
+class RenderTarget;
+class Texture;
+}
+
+/// Collects sprites and shapes and draws them with as few draw calls as
+/// possible.
+///
+/// Things are drawn in the order they are added. Everything in a row that
+/// uses the same texture and blend mode is drawn in one go, and since the
+/// graphics share texture pages (see TextureAtlas) most of the units end
+/// up in the same draw call.
+///
+/// Remember to flush() before drawing anything directly on the target.
+class SpriteBatch
+{
+public:
+    explicit SpriteBatch(sf::RenderTarget &target);
+    ~SpriteBatch();
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch &operator=(const SpriteBatch&) = delete;
+
+    sf::RenderTarget &target() noexcept { return m_target; }
+
+    void addSprite(const sf::Texture &texture, const sf::IntRect &rect, const ScreenPos &position, const sf::BlendMode &blendMode = sf::BlendAlpha);
+    void addRectangle(const ScreenPos &position, const sf::Vector2f &size, const sf::Color &color);
+
+    /// Same as the outline of a sf::CircleShape with radius @p radiusX scaled vertically
+    void addEllipseOutline(const ScreenPos &center, const float radiusX, const float radiusY, const size_t pointCount, const float thickness, const sf::Color &color);
+
+    void flush();
+
+    /// Number of draw calls issued so far
+    size_t drawCalls() const noexcept { return m_drawCalls; }
+
+private:
+    void setState(const sf::Texture *texture, const sf::BlendMode &blendMode);
+    void addQuad(const sf::Vector2f &topLeft, const sf::Vector2f &bottomRight, const sf::FloatRect &textureRect, const sf::Color &color);
+
+    sf::RenderTarget &m_target;
+
+    std::vector<sf::Vertex> m_vertices;
+    const sf::Texture *m_texture = nullptr;
+    sf::BlendMode m_blendMode = sf::BlendAlpha;
+
+    size_t m_drawCalls = 0;
+};
@@ -26,6 +26,8 @@
 
 #include <core/Utility.h>
 #include <genie/resource/DrsFile.h>
+#include <genie/resource/SlpFile.h>
+#include <genie/resource/Color.h>
 #include <genie/resource/PalFile.h>
 #include <genie/resource/UIFile.h>
 #include <genie/resource/BlendomaticFile.h>
@@ -97,19 +99,11 @@ std::shared_ptr<genie::UIFile> AssetManager::getUIFile(const std::string &name)
 
 std::shared_ptr<uint8_t[]> AssetManager::getWavPtr(uint32_t id)
 {
-    std::weak_ptr<uint8_t[]> weakPtr = m_wavCache[id];
-    std::shared_ptr<uint8_t[]> wavPtr = weakPtr.lock();
-    if (wavPtr) {
-        return wavPtr;
-    }
-
-    m_wavCache.erase(id);
-
-    for (const std::shared_ptr<genie::DrsFile> &drsFile : m_soundFiles) {
-        wavPtr = drsFile->getWavPtr(id);
-        if (wavPtr) {
-            m_wavCache[id] = wavPtr;
-            return wavPtr;
+    // Points straight into the mapped file, so no need to cache it
+    for (const uint32_t archive : m_soundArchives) {
+        const DrsIndex::Entry *entry = m_drsIndex.find(DrsIndex::FileType::Wav, id, archive);
+        if (entry) {
+            return m_drsIndex.sharedData(*entry);
         }
     }
     DBG << "failed to find wav file for" << id;
@@ -119,23 +113,23 @@ std::shared_ptr<uint8_t[]> AssetManager::getWavPtr(uint32_t id)
 //------------------------------------------------------------------------------
 genie::SlpFilePtr AssetManager::getSlp(uint32_t id, const ResourceType type)
 {
-    genie::SlpFilePtr slp_ptr;
-    if (m_nonExistentSlps.count(id)) {
-        return slp_ptr;
-    }
+    const DrsIndex::Entry *entry = nullptr;
 
     switch (type) {
     case ResourceType::Interface:
-        return m_interfaceFile->getSlpFile(id);
+        entry = m_drsIndex.find(DrsIndex::FileType::Slp, id, m_interfaceArchive);
+        return entry ? loadSlp(*entry) : nullptr;
     case ResourceType::Graphics:
-        return m_graphicsFile->getSlpFile(id);
+        entry = m_drsIndex.find(DrsIndex::FileType::Slp, id, m_graphicsArchive);
+        return entry ? loadSlp(*entry) : nullptr;
     case ResourceType::Terrain:
-        return m_terrainFile->getSlpFile(id);
+        entry = m_drsIndex.find(DrsIndex::FileType::Slp, id, m_terrainArchive);
+        return entry ? loadSlp(*entry) : nullptr;
     case ResourceType::GameData:
-        for (const std::shared_ptr<genie::DrsFile> &drsFile : m_gamedataFiles) {
-            slp_ptr = drsFile->getSlpFile(id);
-            if (slp_ptr) {
-                return slp_ptr;
+        for (const uint32_t archive : m_gamedataArchives) {
+            entry = m_drsIndex.find(DrsIndex::FileType::Slp, id, archive);
+            if (entry) {
+                return loadSlp(*entry);
             }
         }
         DBG << "failed to find" << id << "in gamedata files, falling back to all files";
@@ -146,51 +140,98 @@ genie::SlpFilePtr AssetManager::getSlp(uint32_t id, const ResourceType type)
         break;
     }
 
-    if (slp_ptr) {
-        return slp_ptr;
+    entry = m_drsIndex.find(DrsIndex::FileType::Slp, id);
+    if (entry) {
+        return loadSlp(*entry);
     }
 
-    for (const std::shared_ptr<genie::DrsFile> &drsFile : m_allFiles) {
-        slp_ptr = drsFile->getSlpFile(id);
-        if (slp_ptr) {
-            return slp_ptr;
+    std::lock_guard<std::mutex> lock(m_slpMutex);
+    if (m_nonExistentSlps.insert(id).second) {
+        DBG << "No slp file with id" << id << "found!";
+    }
+    return nullptr;
+}
+
+namespace {
+/// Keeps the stream the SLP is read from alive as long as the SLP, the
+/// frames are read from it when they are used
+struct MappedSlpFile {
+    MappedSlpFile(const DrsIndex &index, const DrsIndex::Entry &entry) :
+        stream(index, entry),
+        slp(entry.size)
+    {}
+
+    DrsIndex::Stream stream;
+    genie::SlpFile slp;
+};
+}
+
+genie::SlpFilePtr AssetManager::loadSlp(const DrsIndex::Entry &entry)
+{
+    const uint32_t entryIndex = m_drsIndex.entryIndex(entry);
+
+    {
+        std::lock_guard<std::mutex> lock(m_slpMutex);
+        genie::SlpFilePtr cached = m_slpCache[entryIndex].lock();
+        if (cached) {
+            return cached;
         }
     }
 
-    m_nonExistentSlps.insert(id);
+    // Each one gets its own stream, so parsing can happen in parallel
+    std::shared_ptr<MappedSlpFile> mapped = std::make_shared<MappedSlpFile>(m_drsIndex, entry);
+    mapped->slp.setGameVersion(m_gameVersion);
+    mapped->slp.readObject(mapped->stream);
+    genie::SlpFilePtr slp(mapped, &mapped->slp);
 
-    DBG << "No slp file with id" << id << "found!";
-    return slp_ptr;
+    std::lock_guard<std::mutex> lock(m_slpMutex);
+    std::weak_ptr<genie::SlpFile> &cached = m_slpCache[entryIndex];
+
+    // Someone else might have loaded it in the meantime
+    genie::SlpFilePtr existing = cached.lock();
+    if (existing) {
+        return existing;
+    }
+
+    cached = slp;
+    return slp;
 }
 
 //------------------------------------------------------------------------------
 GraphicPtr AssetManager::getGraphic(uint32_t id)
 {
-    GraphicPtr graph;
-
-    if (graphics_.find(id) != graphics_.end()) {
-        graph = graphics_[id];
-    } else {
-        graph = std::make_shared<Graphic>(DataManager::Inst().getGraphic(id), id);
-
-        graphics_[id] = graph;
+    const GraphicPtr *cached = graphics_.find(id);
+    if (cached) {
+        return *cached;
     }
 
+    GraphicPtr graph = std::make_shared<Graphic>(DataManager::Inst().getGraphic(id), id);
+    graphics_.insert(id, graph, graph->memoryUsage());
+
     return graph;
 }
 
 //------------------------------------------------------------------------------
-const TerrainPtr &AssetManager::getTerrain(uint32_t id)
+TerrainPtr AssetManager::getTerrain(uint32_t id)
 {
-    if (terrains_.find(id) != terrains_.end()) {
-        return terrains_[id];
+    const TerrainPtr *cached = terrains_.find(id);
+    if (cached) {
+        return *cached;
     }
 
     TerrainPtr terrain = std::make_shared<TerrainSprite>(id);
+    terrains_.insert(id, terrain, terrain->memoryUsage());
 
-    terrains_[id] = terrain;
+    return terrain;
+}
 
-    return terrains_[id];
+TerrainPtr AssetManager::loadedTerrain(uint32_t id) const
+{
+    const TerrainPtr *terrain = terrains_.peek(id);
+    if (!terrain) {
+        return nullptr;
+    }
+    return *terrain;
 }
 
 const genie::PalFile &AssetManager::getPalette(const std::string &name)
@@ -325,25 +366,25 @@ bool AssetManager::initializeInternal(const std::string &dataPath, const genie::
                                                      { "gamedata_x1_p1.drs" },
                                                  });
 
-    m_gamedataFiles = loadDrs(gamedataFiles);
+    m_gamedataFiles = loadDrs(gamedataFiles, &m_gamedataArchives);
     if (m_gamedataFiles.empty()) {
         WARN << "Failed to find any gamedata files in" << dataPath;
         return false;
     }
 
-    m_interfaceFile = loadDrs("interfac.drs");
+    m_interfaceFile = loadDrs("interfac.drs", &m_interfaceArchive);
     if (!m_interfaceFile) {
         WARN << "Failed to load interface file";
         return false;
     }
 
-    m_graphicsFile = loadDrs("graphics.drs");
+    m_graphicsFile = loadDrs("graphics.drs", &m_graphicsArchive);
     if (!m_graphicsFile) {
         WARN << "Failed to load graphics file";
         return false;
     }
 
-    m_terrainFile = loadDrs("terrain.drs");
+    m_terrainFile = loadDrs("terrain.drs", &m_terrainArchive);
     if (!m_terrainFile) {
         WARN << "Failed to load terrain file";
         return false;
@@ -354,14 +395,14 @@ bool AssetManager::initializeInternal(const std::string &dataPath, const genie::
                                                   { "sounds_x1.drs" },
                                               });
 
-    m_soundFiles = loadDrs(soundFiles);
+    m_soundFiles = loadDrs(soundFiles, &m_soundArchives);
 
     if (m_soundFiles.empty()) {
         WARN << "Failed to find any sound files in" << dataPath;
         return false;
     }
 
-    DBG << "Loaded" << m_allFiles.size() << "files";
+    DBG << "Loaded" << m_allFiles.size() << "files," << m_drsIndex.entryCount() << "resources";
 
     return true;
 }
@@ -667,14 +708,40 @@ int AssetManager::filenameID(const std::string &filename)
     return idMap.at(filename);
 }
 
-size_t AssetManager::terrainCacheSize() const
+bool AssetManager::enableDiskCache(const std::string &directory)
 {
-    size_t ret = 0;
-    for (const std::pair<uint32_t, TerrainPtr> t : terrains_) {
-        ret += t.second->cacheSize();
+    if (m_isHd) {
+        // The HD files are all over the place, not worth the trouble
+        DBG << "Not caching decoded graphics for HD";
+        return false;
     }
 
-    return ret;
+    TIME_THIS;
+
+    // Everything the pixels are generated from, so we start over if any of it changes
+    uint64_t sourceHash = DiskCache::fingerprintFile(DataManager::Inst().datFilePath(), DiskCache::FormatVersion);
+
+    // SLPs can be found in any of the archives, e. g. terrains are looked up
+    // in the gamedata ones first
+    for (uint32_t archive = 0; archive < m_drsIndex.archiveCount(); archive++) {
+        sourceHash = DiskCache::fingerprintFile(m_drsIndex.archivePath(archive), sourceHash);
+    }
+
+    for (const std::string &filename : {
+             blendomaticFilename(),
+             std::string("PatternMasks.dat"),
+             std::string("view_icm.dat"),
+             std::string("lightMaps.dat"),
+         }) {
+        sourceHash = DiskCache::fingerprintFile(findFile(filename, m_dataPath), sourceHash);
+    }
+
+    for (const genie::Color &color : getPalette().colors_) {
+        const uint8_t rgb[3] = { color.r, color.g, color.b };
+        sourceHash = DiskCache::hash(rgb, sizeof(rgb), sourceHash);
+    }
+
+    return m_diskCache.open(directory, m_dataPath, sourceHash);
 }
 
 std::string AssetManager::findFile(const std::string &filename, const std::string &folder)
@@ -710,22 +777,24 @@ bool AssetManager::missingData() const
 }
 
 //------------------------------------------------------------------------------
-DrsFileVector AssetManager::loadDrs(const std::vector<std::string> &filenames)
+DrsFileVector AssetManager::loadDrs(const std::vector<std::string> &filenames, std::vector<uint32_t> *archives)
 {
     DrsFileVector files;
 
     for (const std::string &filename : filenames) {
-        std::shared_ptr<genie::DrsFile> file = loadDrs(filename);
+        uint32_t archive = DrsIndex::InvalidIndex;
+        std::shared_ptr<genie::DrsFile> file = loadDrs(filename, &archive);
         if (!file) {
             continue;
         }
         files.push_back(file);
+        archives->push_back(archive);
     }
 
     return files;
 }
 
-DrsFilePtr AssetManager::loadDrs(const std::string &filename)
+DrsFilePtr AssetManager::loadDrs(const std::string &filename, uint32_t *archive)
 {
     std::string filePath = findFile(filename, m_dataPath);
 
@@ -733,6 +802,12 @@ DrsFilePtr AssetManager::loadDrs(const std::string &filename)
         return nullptr;
     }
 
+    *archive = m_drsIndex.addArchive(filePath);
+    if (*archive == DrsIndex::InvalidIndex) {
+        WARN << "Failed to index" << filePath;
+        return nullptr;
+    }
+
     std::shared_ptr<genie::DrsFile> file = std::make_shared<genie::DrsFile>();
     file->setGameVersion(m_gameVersion);
     file->load(filePath);
@@ -27,10 +27,16 @@
 #include <unordered_set>
 #include <fstream>
 #include <sstream>
+#include <mutex>
 
 #include <genie/Types.h>
 #include <genie/resource/Slope.h>
 
+#include "DiskCache.h"
+#include "DrsIndex.h"
+#include "core/LruCache.h"
+#include "TextureAtlas.h"
+
 class ColorPalette;
 class BinaFile;
 class TerrainSprite;
@@ -67,9 +73,7 @@ using BlkEdgeFilePtr = std::shared_ptr<BlkEdgeFile>;
 
 // ours
 using GraphicPtr = std::shared_ptr<Graphic>;
-using GraphicMap = std::unordered_map<uint32_t, GraphicPtr>;
 using TerrainPtr = std::shared_ptr<TerrainSprite>;
-using TerrainMap = std::unordered_map<uint32_t, TerrainPtr>;
 
 //------------------------------------------------------------------------------
 /// The resource manager is the primary interface for getting recourses. At
@@ -162,7 +166,10 @@ public:
     /// @param id id of the resource
     /// @return resource pointer to the object
     //
-    const TerrainPtr &getTerrain(uint32_t id);
+    TerrainPtr getTerrain(uint32_t id);
+
+    /// Doesn't load it if it isn't already, so it can be used from other threads
+    TerrainPtr loadedTerrain(uint32_t id) const;
 
     const genie::PalFile &getPalette(const std::string &name);
     virtual const genie::PalFile &getPalette(uint32_t id = 50500);
@@ -176,7 +183,14 @@ public:
 
     static int filenameID(const std::string &filename);
 
-    size_t terrainCacheSize() const;
+    /// Where the frames of the graphics are stored on the GPU
+    TextureAtlas &textureAtlas() noexcept { return m_textureAtlas; }
+
+    /// Decoded graphics and terrain tiles from earlier runs, if enabled
+    DiskCache &diskCache() noexcept { return m_diskCache; }
+
+    /// Starts using (or creating) a cache in @p directory, for the data files we have loaded
+    bool enableDiskCache(const std::string &directory);
 
     static std::string findFile(const std::string &filename, const std::string &folder);
 
@@ -196,8 +210,11 @@ protected:
     bool initializeInternal(const std::string &gamePath, const genie::GameVersion gameVersion);
 
 private:
-    DrsFileVector loadDrs(const std::vector<std::string> &filenames);
-    DrsFilePtr loadDrs(const std::string &filename);
+    DrsFileVector loadDrs(const std::vector<std::string> &filenames, std::vector<uint32_t> *archives);
+    DrsFilePtr loadDrs(const std::string &filename, uint32_t *archive);
+
+    /// Parses it straight from the mapped DRS file, or returns the one we already have
+    SlpFilePtr loadSlp(const DrsIndex::Entry &entry);
 
     DrsFileVector m_gamedataFiles;
     DrsFileVector m_soundFiles;
@@ -208,6 +225,15 @@ private:
 
     DrsFileVector m_allFiles;
 
+    /// SLPs and WAVs are read through this, the DrsFiles above are only used
+    /// for the rest (palettes, UI files and scenarios)
+    DrsIndex m_drsIndex;
+    std::vector<uint32_t> m_gamedataArchives;
+    std::vector<uint32_t> m_soundArchives;
+    uint32_t m_interfaceArchive = DrsIndex::InvalidIndex;
+    uint32_t m_graphicsArchive = DrsIndex::InvalidIndex;
+    uint32_t m_terrainArchive = DrsIndex::InvalidIndex;
+
     BlendomaticFilePtr blendomatic_file_;
 
     SlpTemplateFilePtr m_stemplatesFile;
@@ -219,15 +245,24 @@ private:
     BlkEdgeFilePtr m_blkEdgeFile;
 
     //TODO: All resources into one map?
-    GraphicMap graphics_;
+    // Only thrown out when no one else is using them
+    LruCache<uint32_t, GraphicPtr> graphics_ { CacheManager::CacheType::Graphics, [](const GraphicPtr &graphic) { return graphic.use_count() > 1; } };
+
+    LruCache<uint32_t, TerrainPtr> terrains_ { CacheManager::CacheType::Terrains, [](const TerrainPtr &terrain) { return terrain.use_count() > 1; } };
+
+    /// Guards m_slpCache and m_nonExistentSlps, so SLPs can be loaded from other threads
+    std::mutex m_slpMutex;
 
-    TerrainMap terrains_;
+    /// Keyed on the index of the entry in the DrsIndex
+    std::unordered_map<uint32_t, std::weak_ptr<genie::SlpFile>> m_slpCache;
 
-    std::unordered_map<uint32_t, std::weak_ptr<uint8_t[]>> m_wavCache;
+    TextureAtlas m_textureAtlas;
+    DiskCache m_diskCache;
 
     genie::GameVersion m_gameVersion;
     std::string m_dataPath;
     std::string m_gamePath;
+    /// Only so we don't spam the log with the same missing ids
     std::unordered_set<uint32_t> m_nonExistentSlps;
 
     static std::unique_ptr<AssetManager> m_instance;
@@ -0,0 +1,295 @@
+#include "DatSnapshot.h"
+
+#include "MappedFile.h"
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <genie/dat/DatFile.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+static const uint32_t s_magic = 0x53444F46; // "FODS"
+
+struct SnapshotHeader {
+    uint32_t magic = s_magic;
+    uint32_t version = DatSnapshot::FormatVersion;
+    uint32_t gameVersion = 0;
+    uint32_t reserved = 0;
+    uint64_t sourceHash = 0;
+
+    /// Of everything after the header, so we notice if it got cut off
+    uint64_t dataSize = 0;
+};
+
+namespace {
+
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::ostream &stream) : m_stream(stream) {}
+
+    void writeUint32(const uint32_t value)
+    {
+        // Explicit byte order, so the files are the same everywhere
+        const uint8_t bytes[4] = {
+            uint8_t(value & 0xFF),
+            uint8_t((value >> 8) & 0xFF),
+            uint8_t((value >> 16) & 0xFF),
+            uint8_t((value >> 24) & 0xFF)
+        };
+        m_stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+        m_written += sizeof(bytes);
+    }
+
+    template<typename T>
+    void writeObject(T &object)
+    {
+        m_buffer.str(std::string());
+        object.writeObject(m_buffer);
+
+        const std::string serialized = m_buffer.str();
+        writeUint32(uint32_t(serialized.size()));
+        m_stream.write(serialized.data(), std::streamsize(serialized.size()));
+        m_written += serialized.size();
+    }
+
+    template<typename T>
+    void writeObjects(std::vector<T> &objects)
+    {
+        writeUint32(uint32_t(objects.size()));
+        for (T &object : objects) {
+            writeObject(object);
+        }
+    }
+
+    uint64_t written() const noexcept { return m_written; }
+
+private:
+    std::ostream &m_stream;
+    std::ostringstream m_buffer;
+    uint64_t m_written = 0;
+};
+
+/// Every object gets its own stream over just its bytes, so broken files
+/// can't make genieutils read outside of it
+class SnapshotReader
+{
+public:
+    SnapshotReader(const uint8_t *data, const size_t size, const genie::GameVersion gameVersion) :
+        m_data(data),
+        m_size(size),
+        m_gameVersion(gameVersion)
+    {}
+
+    bool isValid() const noexcept { return m_valid; }
+    bool atEnd() const noexcept { return m_position == m_size; }
+
+    uint32_t readUint32() noexcept
+    {
+        if (IS_UNLIKELY(!m_valid || m_size - m_position < 4)) {
+            m_valid = false;
+            return 0;
+        }
+
+        const uint8_t *bytes = m_data + m_position;
+        m_position += 4;
+        return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    }
+
+    template<typename T>
+    void readObject(T *object)
+    {
+        const uint32_t size = readUint32();
+        if (IS_UNLIKELY(!m_valid || m_size - m_position < size)) {
+            m_valid = false;
+            return;
+        }
+
+        MemoryStream stream(m_data + m_position, size);
+        object->setGameVersion(m_gameVersion);
+        object->readObject(stream);
+
+        if (IS_UNLIKELY(!stream || size_t(stream.tellg()) != size)) {
+            m_valid = false;
+            return;
+        }
+
+        m_position += size;
+    }
+
+    template<typename T>
+    void readObjects(std::vector<T> *objects)
+    {
+        const uint32_t count = readUint32();
+
+        // Each object has at least its size stored
+        if (IS_UNLIKELY(!m_valid || (m_size - m_position) / 4 < count)) {
+            m_valid = false;
+            return;
+        }
+
+        objects->resize(count);
+        for (T &object : *objects) {
+            readObject(&object);
+            if (IS_UNLIKELY(!m_valid)) {
+                return;
+            }
+        }
+    }
+
+private:
+    const uint8_t *m_data = nullptr;
+    const size_t m_size = 0;
+    size_t m_position = 0;
+    bool m_valid = true;
+    const genie::GameVersion m_gameVersion;
+};
+
+} // namespace
+
+bool DatSnapshot::load(const std::string &path, const uint64_t sourceHash, genie::DatFile *datFile)
+{
+    TIME_THIS;
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    if (file.size() < sizeof(header)) {
+        WARN << "Snapshot" << path << "too small";
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != s_magic || header.version != FormatVersion) {
+        DBG << "Snapshot" << path << "is from a different version";
+        return false;
+    }
+
+    if (header.sourceHash != sourceHash || header.gameVersion != uint32_t(datFile->getGameVersion())) {
+        DBG << "Snapshot" << path << "is outdated";
+        return false;
+    }
+
+    if (header.dataSize != file.size() - sizeof(header)) {
+        WARN << "Snapshot" << path << "is truncated";
+        return false;
+    }
+
+    // Read everything into temporaries first, so we don't leave the dat file half loaded
+    std::vector<genie::Civ> civs;
+    std::vector<genie::UnitHeader> unitHeaders;
+    std::vector<genie::Graphic> graphics;
+    std::vector<genie::Tech> techs;
+    std::vector<genie::Effect> effects;
+    std::vector<genie::TerrainRestriction> terrainRestrictions;
+    genie::TerrainBlock terrainBlock;
+    std::vector<genie::PlayerColour> playerColours;
+    std::vector<genie::Sound> sounds;
+
+    SnapshotReader reader(file.data() + sizeof(header), size_t(header.dataSize), datFile->getGameVersion());
+
+    try {
+        reader.readObjects(&civs);
+        reader.readObjects(&unitHeaders);
+        reader.readObjects(&graphics);
+        reader.readObjects(&techs);
+        reader.readObjects(&effects);
+
+        // The size of the terrain restrictions isn't stored with them, the DatFile normally sets it
+        const uint32_t terrainsUsed = reader.readUint32();
+        if (reader.isValid()) {
+            genie::TerrainRestriction::setTerrainCount(terrainsUsed);
+        }
+        reader.readObjects(&terrainRestrictions);
+
+        reader.readObject(&terrainBlock);
+        reader.readObjects(&playerColours);
+        reader.readObjects(&sounds);
+
+        if (!reader.isValid() || !reader.atEnd()) {
+            WARN << "Invalid snapshot" << path;
+            return false;
+        }
+
+        datFile->TerrainsUsed1 = terrainsUsed;
+    } catch (const std::exception &e) {
+        WARN << "Failed to read snapshot" << path << e.what();
+        return false;
+    }
+
+    datFile->Civs = std::move(civs);
+    datFile->UnitHeaders = std::move(unitHeaders);
+    datFile->Graphics = std::move(graphics);
+    datFile->Techs = std::move(techs);
+    datFile->Effects = std::move(effects);
+    datFile->TerrainRestrictions = std::move(terrainRestrictions);
+    datFile->TerrainBlock = std::move(terrainBlock);
+    datFile->PlayerColours = std::move(playerColours);
+    datFile->Sounds = std::move(sounds);
+
+    return true;
+}
+
+bool DatSnapshot::store(const std::string &path, const uint64_t sourceHash, genie::DatFile *datFile)
+{
+    TIME_THIS;
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    if (error) {
+        WARN << "Failed to create folder for" << path << error.message();
+        return false;
+    }
+
+    SnapshotHeader header;
+    header.gameVersion = uint32_t(datFile->getGameVersion());
+    header.sourceHash = sourceHash;
+
+    // Write to a temporary file first, so no one sees a half written file
+    const std::string tempPath = path + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        SnapshotWriter writer(file);
+        writer.writeObjects(datFile->Civs);
+        writer.writeObjects(datFile->UnitHeaders);
+        writer.writeObjects(datFile->Graphics);
+        writer.writeObjects(datFile->Techs);
+        writer.writeObjects(datFile->Effects);
+        writer.writeUint32(datFile->TerrainsUsed1);
+        writer.writeObjects(datFile->TerrainRestrictions);
+        writer.writeObject(datFile->TerrainBlock);
+        writer.writeObjects(datFile->PlayerColours);
+        writer.writeObjects(datFile->Sounds);
+
+        // Now we know how much we wrote
+        header.dataSize = writer.written();
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        if (!file) {
+            WARN << "Failed to write" << tempPath;
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        WARN << "Failed to store" << path << error.message();
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
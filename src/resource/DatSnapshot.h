@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace genie {
+class DatFile;
+}
+
+/// The parts of the DAT file we actually use (civs with their units, tasks,
+/// graphics, techs, effects, terrains etc.), stored uncompressed in one flat
+/// file so we don't have to decompress and parse all of it on every start.
+///
+/// Written after loading the DAT file the normal way, and on the next start
+/// it is memory mapped and read back if the fingerprint of the DAT file still
+/// matches. Each object is stored with its size, so nothing is read from
+/// outside of it even if the file is broken.
+class DatSnapshot
+{
+public:
+    /// Needs to be bumped when what we store or how changes
+    static constexpr uint32_t FormatVersion = 1;
+
+    /// @p datFile is only changed if the whole snapshot could be read
+    static bool load(const std::string &path, const uint64_t sourceHash, genie::DatFile *datFile);
+
+    static bool store(const std::string &path, const uint64_t sourceHash, genie::DatFile *datFile);
+};
@@ -35,6 +35,8 @@
 #include "genie/dat/Graphic.h"
 #include "genie/dat/Terrain.h"
 
+#include "DatSnapshot.h"
+#include "DiskCache.h"
 #include "LanguageManager.h"
 
 #include <filesystem>
@@ -222,7 +224,7 @@ const genie::Civ &DataManager::civilization(unsigned int id) const
     return dat_file_.Civs[id];
 }
 
-bool DataManager::initialize(const std::string &gamePath)
+bool DataManager::initialize(const std::string &gamePath, const std::string &cachePath)
 {
     std::vector<std::pair<std::string, genie::GameVersion>> datFilenames({
 //        {"empires2_x2_p1.dat", genie::GV_TC  }, // forgotten kingdoms, TODO
@@ -261,7 +263,36 @@ bool DataManager::initialize(const std::string &gamePath)
         return false;
     }
 
+    m_datFilePath = filePath;
+
+    if (cachePath.empty()) {
+        dat_file_.load(filePath);
+        return true;
+    }
+
+    // In the same folder as the decoded graphics, so installs sharing a cache
+    // directory keep their own
+    const std::string snapshotFolder = DiskCache::installDirectory(cachePath, dataPath);
+    std::error_code error;
+    std::filesystem::create_directories(snapshotFolder, error);
+    if (error) {
+        WARN << "Failed to create cache folder" << snapshotFolder << error.message();
+        dat_file_.load(filePath);
+        return true;
+    }
+
+    const std::string snapshotPath = snapshotFolder + "/" + std::filesystem::path(filePath).filename().string() + ".snapshot";
+    const uint64_t sourceHash = DiskCache::fingerprintFile(filePath, DatSnapshot::FormatVersion);
+    if (DatSnapshot::load(snapshotPath, sourceHash, &dat_file_)) {
+        DBG << "Loaded game data from" << snapshotPath;
+        return true;
+    }
+
     dat_file_.load(filePath);
 
+    if (!DatSnapshot::store(snapshotPath, sourceHash, &dat_file_)) {
+        WARN << "Failed to store snapshot of game data";
+    }
+
     return true;
 }
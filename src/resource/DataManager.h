@@ -45,7 +45,9 @@ class Unit;
 class DataManager
 {
 public:
-    bool initialize(const std::string &gamePath);
+    /// @param cachePath where to store a snapshot of the parsed data for the
+    /// next start, empty to always parse the DAT file
+    bool initialize(const std::string &gamePath, const std::string &cachePath = std::string());
 
     DataManager(const DataManager &) = delete;
     DataManager &operator=(const DataManager &) = delete;
@@ -62,9 +64,12 @@ public:
     const std::vector<genie::Task> &getTasks(unsigned int id) const;
 
     const std::vector<genie::Tech> &allTechs() const { return dat_file_.Techs; }
+    const std::vector<genie::Graphic> &allGraphics() const { return dat_file_.Graphics; }
+    const std::vector<genie::TerrainRestriction> &terrainRestrictions() const { return dat_file_.TerrainRestrictions; }
     const genie::TerrainBlock &terrainBlock() const { return dat_file_.TerrainBlock; }
 
     bool isHd() const { return m_isHd; }
+    const std::string &datFilePath() const { return m_datFilePath; }
     genie::GameVersion gameVersion() const;
     static std::string gameName(const genie::GameVersion version);
     static std::string genieVersionString(const genie::GameVersion version);
@@ -79,6 +84,7 @@ private:
 
     genie::DatFile dat_file_;
     bool m_isHd = false;
+    std::string m_datFilePath;
 };
 
 inline LogPrinter operator <<(LogPrinter os, const genie::GameVersion version) {
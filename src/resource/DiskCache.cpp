@@ -0,0 +1,452 @@
+#include "DiskCache.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DISKCACHE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t s_magic = 0x43414F46; // "FOAC"
+
+/// How much of the source files we hash
+static const size_t s_fingerprintSize = 64 * 1024;
+
+/// If the disk can't keep up we rather decode it again next time than pile up memory
+static const size_t s_maxPendingBytes = 64 * 1024 * 1024;
+
+struct CacheFileHeader {
+    uint32_t magic = s_magic;
+    uint32_t version = DiskCache::FormatVersion;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t keySize = 0;
+    uint32_t reserved = 0;
+};
+
+static std::string hexString(const uint64_t value)
+{
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+/// Checks the header and key, and returns the pixels if it's all right
+static const uint8_t *validatePixels(const uint8_t *data, const size_t size, const DiskCache::Key &key, uint32_t *width, uint32_t *height)
+{
+    CacheFileHeader header;
+    if (size < sizeof(header)) {
+        return nullptr;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != s_magic || header.version != DiskCache::FormatVersion) {
+        return nullptr;
+    }
+
+    const std::vector<uint8_t> &keyBytes = key.bytes();
+    if (header.keySize != keyBytes.size()) {
+        return nullptr;
+    }
+
+    const size_t pixelsOffset = sizeof(header) + header.keySize;
+    if (size != pixelsOffset + size_t(header.width) * size_t(header.height) * 4) {
+        return nullptr;
+    }
+
+    if (memcmp(data + sizeof(header), keyBytes.data(), keyBytes.size()) != 0) {
+        return nullptr;
+    }
+
+    *width = header.width;
+    *height = header.height;
+    return data + pixelsOffset;
+}
+
+//------------------------------------------------------------------------------
+
+DiskCache::Key &DiskCache::Key::add(const uint32_t value)
+{
+    // Explicit byte order, so the files are the same everywhere
+    m_bytes.push_back(value & 0xFF);
+    m_bytes.push_back((value >> 8) & 0xFF);
+    m_bytes.push_back((value >> 16) & 0xFF);
+    m_bytes.push_back((value >> 24) & 0xFF);
+    return *this;
+}
+
+uint64_t DiskCache::Key::hash() const noexcept
+{
+    return DiskCache::hash(m_bytes.data(), m_bytes.size(), 0);
+}
+
+//------------------------------------------------------------------------------
+
+DiskCache::Image::~Image()
+{
+    reset();
+}
+
+DiskCache::Image::Image(Image &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+DiskCache::Image &DiskCache::Image::operator=(Image &&other) noexcept
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    reset();
+
+    m_mapping = other.m_mapping;
+    m_mappingSize = other.m_mappingSize;
+    m_buffer = std::move(other.m_buffer);
+    m_pixels = other.m_pixels;
+    m_width = other.m_width;
+    m_height = other.m_height;
+
+    other.m_mapping = nullptr;
+    other.m_mappingSize = 0;
+    other.m_pixels = nullptr;
+    other.m_width = 0;
+    other.m_height = 0;
+
+    return *this;
+}
+
+void DiskCache::Image::reset() noexcept
+{
+#ifdef DISKCACHE_MMAP
+    if (m_mapping) {
+        munmap(m_mapping, m_mappingSize);
+    }
+#endif
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_buffer.clear();
+    m_pixels = nullptr;
+    m_width = 0;
+    m_height = 0;
+}
+
+//------------------------------------------------------------------------------
+
+std::string DiskCache::defaultPath()
+{
+#if defined(WIN32) || defined(__WIN32) || defined(__WIN32__)
+    return (std::filesystem::current_path() / "cache").string();
+#else
+    const char *cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome && cacheHome[0] != '\0') {
+        return std::string(cacheHome) + "/freeaoe";
+    }
+
+    const char *home = getenv("HOME");
+    if (home && home[0] != '\0') {
+        return std::string(home) + "/.cache/freeaoe";
+    }
+
+    return (std::filesystem::temp_directory_path() / "freeaoe").string();
+#endif
+}
+
+uint64_t DiskCache::hash(const void *data, const size_t size, const uint64_t seed) noexcept
+{
+    // FNV-1a, it's not going to be the bottleneck
+    uint64_t hash = 0xcbf29ce484222325ULL ^ seed;
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i=0; i<size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t DiskCache::fingerprintFile(const std::string &path, const uint64_t seed) noexcept
+{
+    uint64_t fingerprint = hash(path.data(), path.size(), seed);
+
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        DBG << "Can't get size of" << path << error.message();
+        return fingerprint;
+    }
+    fingerprint = hash(&size, sizeof(size), fingerprint);
+
+    const int64_t modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (!error) {
+        fingerprint = hash(&modified, sizeof(modified), fingerprint);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> start(std::min<uint64_t>(size, s_fingerprintSize));
+    if (file.read(start.data(), start.size())) {
+        fingerprint = hash(start.data(), start.size(), fingerprint);
+    }
+
+    return fingerprint;
+}
+
+DiskCache::~DiskCache()
+{
+    stopWriter();
+}
+
+std::string DiskCache::installDirectory(const std::string &directory, const std::string &installPath)
+{
+    return (std::filesystem::path(directory) / hexString(hash(installPath.data(), installPath.size(), 0))).string();
+}
+
+bool DiskCache::open(const std::string &directory, const std::string &installPath, const uint64_t sourceHash)
+{
+    stopWriter();
+    m_path.clear();
+
+    if (directory.empty()) {
+        return false;
+    }
+
+    const std::filesystem::path installFolder = installDirectory(directory, installPath);
+    const std::string folderName = "v" + std::to_string(FormatVersion) + "-" + hexString(sourceHash);
+    const std::filesystem::path path = installFolder / folderName;
+
+    std::error_code error;
+    std::filesystem::create_directories(path, error);
+    if (error) {
+        WARN << "Failed to create cache folder" << path.string() << error.message();
+        return false;
+    }
+
+    // Clean out caches from other versions or older source files of this
+    // install, they can't be used anymore
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(installFolder, error)) {
+        const std::string name = entry.path().filename().string();
+        if (name == folderName || !entry.is_directory(error)) {
+            continue;
+        }
+
+        // Don't delete anything we didn't create
+        const size_t separator = name.find('-');
+        if (name.size() < 2 || name[0] != 'v' || separator == std::string::npos || name.size() - separator - 1 != 16) {
+            continue;
+        }
+
+        DBG << "Removing outdated cache" << entry.path().string();
+        std::filesystem::remove_all(entry.path(), error);
+        if (error) {
+            WARN << "Failed to remove" << entry.path().string() << error.message();
+        }
+    }
+
+    m_path = path.string();
+    DBG << "Caching images in" << m_path;
+
+    m_quit = false;
+    m_writer = std::thread(&DiskCache::runWriter, this);
+
+    return true;
+}
+
+DiskCache::Image DiskCache::load(const Key &key) const
+{
+    Image image;
+    if (!isOpen()) {
+        return image;
+    }
+
+    const std::string path = filePath(key);
+
+#ifdef DISKCACHE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        m_misses++;
+        return image;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        m_misses++;
+        return image;
+    }
+
+    void *mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (mapping == MAP_FAILED) {
+        WARN << "Failed to map" << path;
+        m_misses++;
+        return image;
+    }
+
+    image.m_mapping = mapping;
+    image.m_mappingSize = size_t(info.st_size);
+    image.m_pixels = validatePixels(static_cast<const uint8_t*>(mapping), image.m_mappingSize, key, &image.m_width, &image.m_height);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        m_misses++;
+        return image;
+    }
+
+    image.m_buffer.resize(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(image.m_buffer.data()), image.m_buffer.size())) {
+        m_misses++;
+        return Image();
+    }
+    image.m_pixels = validatePixels(image.m_buffer.data(), image.m_buffer.size(), key, &image.m_width, &image.m_height);
+#endif
+
+    if (!image.m_pixels) {
+        DBG << "Invalid cache file" << path;
+        m_misses++;
+        return Image();
+    }
+
+    m_hits++;
+    return image;
+}
+
+void DiskCache::store(const Key &key, const uint32_t width, const uint32_t height, const uint8_t *pixels)
+{
+    if (!isOpen() || !pixels) {
+        return;
+    }
+
+    CacheFileHeader header;
+    header.width = width;
+    header.height = height;
+    header.keySize = uint32_t(key.bytes().size());
+
+    const std::vector<uint8_t> &keyBytes = key.bytes();
+    const size_t pixelsSize = size_t(width) * size_t(height) * 4;
+
+    PendingWrite pending;
+    pending.path = filePath(key);
+
+    {
+        std::lock_guard<std::mutex> guard(m_writeMutex);
+
+        // Loaded again before it got written
+        if (m_pendingPaths.count(pending.path)) {
+            return;
+        }
+
+        if (m_pendingBytes + pixelsSize > s_maxPendingBytes) {
+            DBG << "Too much waiting to be written, skipping" << pending.path;
+            return;
+        }
+    }
+
+    pending.data.resize(sizeof(header) + keyBytes.size() + pixelsSize);
+    memcpy(pending.data.data(), &header, sizeof(header));
+    memcpy(pending.data.data() + sizeof(header), keyBytes.data(), keyBytes.size());
+    memcpy(pending.data.data() + sizeof(header) + keyBytes.size(), pixels, pixelsSize);
+
+    {
+        std::lock_guard<std::mutex> guard(m_writeMutex);
+        if (!m_pendingPaths.insert(pending.path).second) {
+            return;
+        }
+        m_pendingBytes += pending.data.size();
+        m_pendingWrites.push_back(std::move(pending));
+    }
+    m_writesAvailable.notify_one();
+}
+
+void DiskCache::flush()
+{
+    std::unique_lock<std::mutex> lock(m_writeMutex);
+    m_writesDone.wait(lock, [this]() { return m_pendingWrites.empty() && !m_writing; });
+}
+
+void DiskCache::runWriter()
+{
+    while (true) {
+        PendingWrite pending;
+        {
+            std::unique_lock<std::mutex> lock(m_writeMutex);
+            m_writesAvailable.wait(lock, [this]() { return m_quit || !m_pendingWrites.empty(); });
+
+            // Finish what's queued before quitting, it's already decoded
+            if (m_pendingWrites.empty()) {
+                return;
+            }
+
+            pending = std::move(m_pendingWrites.front());
+            m_pendingWrites.pop_front();
+            m_writing = true;
+        }
+
+        write(pending);
+
+        {
+            std::lock_guard<std::mutex> guard(m_writeMutex);
+            m_pendingPaths.erase(pending.path);
+            m_pendingBytes -= pending.data.size();
+            m_writing = false;
+        }
+        m_writesDone.notify_all();
+    }
+}
+
+void DiskCache::write(const PendingWrite &pending)
+{
+    // Write to a temporary file first, so no one sees a half written file
+    const std::string tempPath = pending.path + ".tmp" + std::to_string(m_tempCounter++);
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(pending.data.data()), std::streamsize(pending.data.size()));
+
+        if (!file) {
+            WARN << "Failed to write" << tempPath;
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, pending.path, error);
+    if (error) {
+        WARN << "Failed to store" << pending.path << error.message();
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void DiskCache::stopWriter()
+{
+    if (!m_writer.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_writeMutex);
+        m_quit = true;
+    }
+    m_writesAvailable.notify_all();
+
+    m_writer.join();
+}
+
+std::string DiskCache::filePath(const Key &key) const
+{
+    return m_path + "/" + hexString(key.hash()) + ".rgba";
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/// Stores decoded images on disk, so we don't have to decode the SLPs and
+/// blend the terrain tiles again on the next start.
+///
+/// Each image is stored as raw RGBA in its own file, named after the hash of
+/// its key, and is memory mapped when loaded. The key is stored in the file as
+/// well and checked when loading, so hash collisions just count as misses.
+///
+/// Each game install gets its own folder, named after a hash of its path, so
+/// different installs don't throw away each other's images. Inside that all
+/// the files live in a folder named after the format version and a hash of the
+/// source files (DRS files, palette etc.), so when any of those change we
+/// start over in a new folder and the old ones of that install are deleted.
+///
+/// Loading and storing can be done from multiple threads. The files are
+/// written in a background thread, so storing doesn't block the rendering.
+class DiskCache
+{
+public:
+    static constexpr uint32_t FormatVersion = 1;
+
+    enum class KeyType : uint32_t {
+        Graphic = 1,
+        TerrainTile = 2
+    };
+
+    /// Everything that affects the pixels of an image needs to be added.
+    class Key
+    {
+    public:
+        explicit Key(const KeyType type) { add(uint32_t(type)); }
+
+        Key &add(const uint32_t value);
+        Key &add(const int32_t value) { return add(uint32_t(value)); }
+
+        uint64_t hash() const noexcept;
+        const std::vector<uint8_t> &bytes() const noexcept { return m_bytes; }
+
+    private:
+        std::vector<uint8_t> m_bytes;
+    };
+
+    /// Pixels loaded from the cache, stays mapped until destroyed.
+    class Image
+    {
+    public:
+        Image() = default;
+        ~Image();
+
+        Image(Image &&other) noexcept;
+        Image &operator=(Image &&other) noexcept;
+        Image(const Image&) = delete;
+        Image &operator=(const Image&) = delete;
+
+        bool isValid() const noexcept { return m_pixels != nullptr; }
+        uint32_t width() const noexcept { return m_width; }
+        uint32_t height() const noexcept { return m_height; }
+        const uint8_t *pixels() const noexcept { return m_pixels; }
+
+    private:
+        friend class DiskCache;
+        void reset() noexcept;
+
+        void *m_mapping = nullptr;
+        size_t m_mappingSize = 0;
+        std::vector<uint8_t> m_buffer; // if we can't mmap
+
+        const uint8_t *m_pixels = nullptr;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+    };
+
+    /// Something like ~/.cache/freeaoe
+    static std::string defaultPath();
+
+    static uint64_t hash(const void *data, const size_t size, const uint64_t seed) noexcept;
+
+    /// Fast, doesn't read the whole file. Uses the size, the modification time
+    /// and the start of the file (which for DRS files contains the table of
+    /// all the resources in it).
+    static uint64_t fingerprintFile(const std::string &path, const uint64_t seed) noexcept;
+
+    DiskCache() = default;
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache &operator=(const DiskCache&) = delete;
+
+    /// Folder under @p directory for everything cached for one install of
+    /// the game, so several installs can share a cache directory
+    static std::string installDirectory(const std::string &directory, const std::string &installPath);
+
+    /// @param installPath where the game files are, to keep installs apart
+    /// @param sourceHash hash of everything the images are generated from
+    bool open(const std::string &directory, const std::string &installPath, const uint64_t sourceHash);
+    bool isOpen() const noexcept { return !m_path.empty(); }
+
+    /// Returns an invalid image if it's not cached
+    Image load(const Key &key) const;
+
+    /// Copies the pixels and queues them for writing.
+    /// @param pixels width * height RGBA pixels
+    void store(const Key &key, const uint32_t width, const uint32_t height, const uint8_t *pixels);
+
+    /// Waits for everything queued to be written
+    void flush();
+
+    size_t hits() const noexcept { return m_hits; }
+    size_t misses() const noexcept { return m_misses; }
+
+private:
+    struct PendingWrite {
+        std::string path;
+        std::vector<uint8_t> data;
+    };
+
+    std::string filePath(const Key &key) const;
+
+    void runWriter();
+    void write(const PendingWrite &pending);
+    void stopWriter();
+
+    std::string m_path;
+
+    std::thread m_writer;
+    std::mutex m_writeMutex;
+    std::condition_variable m_writesAvailable;
+    std::condition_variable m_writesDone;
+
+    // Guarded by m_writeMutex
+    std::deque<PendingWrite> m_pendingWrites;
+    std::unordered_set<std::string> m_pendingPaths;
+    size_t m_pendingBytes = 0;
+    bool m_writing = false;
+    bool m_quit = false;
+
+    mutable std::atomic<size_t> m_hits = 0;
+    mutable std::atomic<size_t> m_misses = 0;
+    std::atomic<uint32_t> m_tempCounter = 0;
+};
@@ -0,0 +1,196 @@
+#include "DrsIndex.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <cstring>
+
+/// AoE and AoK have 40 bytes of copyright text at the start, SWGB has 60
+static const size_t s_copyrightSizes[] = { 40, 60 };
+
+/// Version and file type after the copyright, then the number of tables and
+/// the offset of the first file
+static const size_t s_headerSize = 4 + 12 + 4 + 4;
+
+/// Type, offset of the entries and the number of entries
+static const size_t s_tableHeaderSize = 4 + 4 + 4;
+
+/// Id, offset and size
+static const size_t s_entrySize = 4 + 4 + 4;
+
+static inline uint32_t readUint32(const uint8_t *data) noexcept
+{
+    return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+/// The extension is stored backwards and padded with spaces, e. g. " pls"
+static DrsIndex::FileType tableType(const uint8_t *data) noexcept
+{
+    char extension[4];
+    for (int i=0; i<4; i++) {
+        extension[i] = char(data[3 - i]);
+    }
+
+    if (memcmp(extension, "slp ", 4) == 0) {
+        return DrsIndex::FileType::Slp;
+    }
+    if (memcmp(extension, "wav ", 4) == 0) {
+        return DrsIndex::FileType::Wav;
+    }
+    if (memcmp(extension, "bina", 4) == 0) {
+        return DrsIndex::FileType::Binary;
+    }
+
+    return DrsIndex::FileType::Unknown;
+}
+
+//------------------------------------------------------------------------------
+
+DrsIndex::Stream::Stream(const DrsIndex &index, const Entry &entry) :
+    MemoryStream(index.data(entry), entry.size, index.m_archives[entry.archive])
+{
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t DrsIndex::addArchive(const std::string &path)
+{
+    TIME_THIS;
+
+    std::shared_ptr<MappedFile> archive = std::make_shared<MappedFile>();
+    if (!archive->open(path)) {
+        WARN << "Failed to open" << path;
+        return InvalidIndex;
+    }
+
+    const uint32_t archiveIndex = uint32_t(m_archives.size());
+    std::vector<std::pair<FileType, Entry>> entries;
+    if (!parseTables(*archive, archiveIndex, &entries)) {
+        WARN << "Invalid DRS file" << path;
+        return InvalidIndex;
+    }
+
+    m_archives.push_back(std::move(archive));
+
+    m_entries.reserve(m_entries.size() + entries.size());
+    for (const std::pair<FileType, Entry> &entry : entries) {
+        addEntry(entry.first, entry.second);
+    }
+
+    return archiveIndex;
+}
+
+bool DrsIndex::parseTables(const MappedFile &archive, const uint32_t archiveIndex, std::vector<std::pair<FileType, Entry>> *entries) const
+{
+    const uint8_t *data = archive.data();
+    const size_t size = archive.size();
+
+    // The version is something like "1.00"
+    size_t headerStart = 0;
+    for (const size_t copyrightSize : s_copyrightSizes) {
+        if (size >= copyrightSize + s_headerSize && data[copyrightSize + 1] == '.') {
+            headerStart = copyrightSize;
+            break;
+        }
+    }
+    if (!headerStart) {
+        WARN << "Failed to find DRS header in" << archive.path();
+        return false;
+    }
+
+    const uint32_t tableCount = readUint32(data + headerStart + 4 + 12);
+    const size_t tablesStart = headerStart + s_headerSize;
+    if (tablesStart + size_t(tableCount) * s_tableHeaderSize > size) {
+        WARN << "Invalid table count" << tableCount << "in" << archive.path();
+        return false;
+    }
+
+    for (uint32_t table = 0; table < tableCount; table++) {
+        const uint8_t *tableHeader = data + tablesStart + table * s_tableHeaderSize;
+        const FileType type = tableType(tableHeader);
+        const uint32_t entriesOffset = readUint32(tableHeader + 4);
+        const uint32_t entryCount = readUint32(tableHeader + 8);
+
+        if (type == FileType::Unknown) {
+            DBG << "Skipping unknown table type in" << archive.path();
+            continue;
+        }
+
+        if (size_t(entriesOffset) + size_t(entryCount) * s_entrySize > size) {
+            WARN << "Invalid table" << table << "in" << archive.path();
+            return false;
+        }
+
+        for (uint32_t i = 0; i < entryCount; i++) {
+            const uint8_t *entryData = data + entriesOffset + i * s_entrySize;
+
+            Entry entry;
+            entry.id = readUint32(entryData);
+            entry.offset = readUint32(entryData + 4);
+            entry.size = readUint32(entryData + 8);
+            entry.archive = archiveIndex;
+
+            if (IS_UNLIKELY(size_t(entry.offset) + size_t(entry.size) > size)) {
+                WARN << "Resource" << entry.id << "goes outside" << archive.path();
+                continue;
+            }
+
+            entries->emplace_back(type, entry);
+        }
+    }
+
+    return true;
+}
+
+void DrsIndex::addEntry(const FileType type, const Entry &entry)
+{
+    const uint32_t entryIndex = uint32_t(m_entries.size());
+    m_entries.push_back(entry);
+
+    const std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> inserted = m_index.try_emplace(key(type, entry.id), entryIndex);
+    if (inserted.second) {
+        return;
+    }
+
+    // Keep the order the archives were added in, there's rarely more than one
+    uint32_t last = inserted.first->second;
+    while (m_entries[last].next != InvalidIndex) {
+        last = m_entries[last].next;
+    }
+    m_entries[last].next = entryIndex;
+}
+
+const DrsIndex::Entry *DrsIndex::find(const FileType type, const uint32_t id) const noexcept
+{
+    const std::unordered_map<uint64_t, uint32_t>::const_iterator it = m_index.find(key(type, id));
+    if (it == m_index.end()) {
+        return nullptr;
+    }
+    return &m_entries[it->second];
+}
+
+const DrsIndex::Entry *DrsIndex::find(const FileType type, const uint32_t id, const uint32_t archive) const noexcept
+{
+    const Entry *entry = find(type, id);
+    while (entry) {
+        if (entry->archive == archive) {
+            return entry;
+        }
+        if (entry->next == InvalidIndex) {
+            return nullptr;
+        }
+        entry = &m_entries[entry->next];
+    }
+    return nullptr;
+}
+
+const uint8_t *DrsIndex::data(const Entry &entry) const noexcept
+{
+    return m_archives[entry.archive]->data() + entry.offset;
+}
+
+std::shared_ptr<uint8_t[]> DrsIndex::sharedData(const Entry &entry) const
+{
+    const std::shared_ptr<MappedFile> &archive = m_archives[entry.archive];
+    return std::shared_ptr<uint8_t[]>(archive, const_cast<uint8_t*>(archive->data() + entry.offset));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// All the resources in all the DRS files in one index, so finding one is a
+/// single hash lookup instead of asking each file in turn.
+///
+/// The files are memory mapped read only, and resources are parsed straight
+/// from the mapping without copying them out first. Archives are only added
+/// while loading, after that nothing changes so lookups and reading can be
+/// done from several threads at once.
+class DrsIndex
+{
+public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    enum class FileType : uint32_t {
+        Slp,
+        Wav,
+        Binary, // palettes, UI files, scenarios etc.
+        Unknown
+    };
+
+    struct Entry {
+        uint32_t id = 0;
+        uint32_t archive = 0;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+
+        /// Index of the next entry with the same type and id, from a later archive
+        uint32_t next = InvalidIndex;
+    };
+
+    /// Reads a single resource straight from the mapped file, keeps the
+    /// mapping alive as long as it lives.
+    class Stream : public MemoryStream
+    {
+    public:
+        Stream(const DrsIndex &index, const Entry &entry);
+    };
+
+    DrsIndex() = default;
+    DrsIndex(const DrsIndex&) = delete;
+    DrsIndex &operator=(const DrsIndex&) = delete;
+
+    /// Maps the file and adds all the resources in it. Resources that are
+    /// already in an earlier archive are still preferred when looking up.
+    /// @return the index of the archive, or InvalidIndex if it failed
+    uint32_t addArchive(const std::string &path);
+
+    /// Returns nullptr if it doesn't exist. Looks in the archives in the order
+    /// they were added.
+    const Entry *find(const FileType type, const uint32_t id) const noexcept;
+
+    /// Only looks in one archive
+    const Entry *find(const FileType type, const uint32_t id, const uint32_t archive) const noexcept;
+
+    /// Stays valid as long as the index exists
+    const uint8_t *data(const Entry &entry) const noexcept;
+
+    /// Points straight into the mapped file, keeps it mapped as long as it
+    /// lives. Read only, even though the type doesn't say so.
+    std::shared_ptr<uint8_t[]> sharedData(const Entry &entry) const;
+
+    /// Used to cache things parsed from the entries
+    uint32_t entryIndex(const Entry &entry) const noexcept { return uint32_t(&entry - m_entries.data()); }
+
+    size_t archiveCount() const noexcept { return m_archives.size(); }
+    const std::string &archivePath(const uint32_t archive) const noexcept { return m_archives[archive]->path(); }
+    size_t entryCount() const noexcept { return m_entries.size(); }
+
+private:
+    static uint64_t key(const FileType type, const uint32_t id) noexcept {
+        return (uint64_t(type) << 32) | id;
+    }
+
+    /// Only reads, so nothing is left behind if the file turns out to be broken halfway through
+    bool parseTables(const MappedFile &archive, const uint32_t archiveIndex, std::vector<std::pair<FileType, Entry>> *entries) const;
+    void addEntry(const FileType type, const Entry &entry);
+
+    std::vector<std::shared_ptr<MappedFile>> m_archives;
+    std::vector<Entry> m_entries;
+
+    /// First entry for each type and id
+    std::unordered_map<uint64_t, uint32_t> m_index;
+};
@@ -35,13 +35,15 @@
 #include <algorithm>
 
 #include "AssetManager.h"
+#include "DiskCache.h"
+#include "PaletteConversion.h"
 #include "Resource.h"
 
 namespace genie {
 class GraphicAngleSound;
 }  // namespace genie
 
-const sf::Texture Graphic::nullImage;
+const TextureAtlas::Region Graphic::nullImage;
 
 //------------------------------------------------------------------------------
 Graphic::Graphic(const genie::Graphic &data, const int id) :
@@ -76,20 +78,19 @@ sf::Image Graphic::slpFrameToImage(const genie::SlpFramePtr &frame, int8_t playe
         return img;
     }
 
-    const size_t byteCount = size_t(width) * size_t(height) * 4;
-
     switch(imageType) {
     case ImageType::Base:
         img = Resource::convertFrameToImage(frame, palette, playerColor);
         break;
     case ImageType::Shadow: {
-        img.create(width, height, sf::Color::Transparent);
+        std::vector<uint32_t> pixels(size_t(width) * size_t(height), 0);
 
-        const sf::Color shadow(0, 0, 0, 128);
+        const uint32_t shadow = uint32_t(128) << 24;
         for (const genie::XY pos : frameData.shadow_mask) {
-            img.setPixel(pos.x, pos.y, shadow);
+            pixels[pos.y * width + pos.x] = shadow;
         }
 
+        img.create(width, height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
         break;
     }
     case ImageType::Outline: {
@@ -97,99 +98,44 @@ sf::Image Graphic::slpFrameToImage(const genie::SlpFramePtr &frame, int8_t playe
             img.create(1, 1, sf::Color::Transparent);
             return img;
         }
-        img.create(width, height, sf::Color::Transparent);
+        std::vector<uint32_t> pixels(size_t(width) * size_t(height), 0);
 
         const genie::PlayerColour pc = DataManager::Inst().getPlayerColor(playerColor);
-        genie::Color outlineColor = palette[pc.UnitOutlineColor];
-        const sf::Color outline(outlineColor.r, outlineColor.g, outlineColor.b);
+        const genie::Color outlineColor = palette[pc.UnitOutlineColor];
+        const uint32_t outline = uint32_t(outlineColor.r) | uint32_t(outlineColor.g) << 8 | uint32_t(outlineColor.b) << 16 | uint32_t(255) << 24;
 
         for (const genie::XY pos : frameData.outline_pc_mask) {
-            img.setPixel(pos.x, pos.y, outline);
+            pixels[pos.y * width + pos.x] = outline;
         }
 
+        img.create(width, height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
         break;
     }
     case ImageType::ConstructionUnavailable: {
-        // fuck msvc
-        std::vector<Uint8> pixelsBuf(byteCount);
-        Uint8 *pixels = pixelsBuf.data();
-
-        for (uint32_t row = 0; row < height; row++) {
-            for (uint32_t col = 0; col < width; col++) {
-                const uint8_t paletteIndex = frameData.pixel_indexes[row * width + col];
-                assert(paletteIndex < palette.colors_.size());
-
-                const genie::Color &g_color = palette.colors_[paletteIndex];
-                const size_t pixelPos = (row * width + col) * 4;
-
-                if ((row + col) % 2 == 1) {
-                    pixels[pixelPos    ] = g_color.r;
-                    pixels[pixelPos + 1] = g_color.g;
-                    pixels[pixelPos + 2] = g_color.b;
-                    pixels[pixelPos + 3] = frameData.alpha_channel[row * width + col];
-                } else {
-                    pixels[pixelPos    ] = 255;
-                    pixels[pixelPos + 1] = 0;
-                    pixels[pixelPos + 2] = 0;
-                    pixels[pixelPos + 3] = frameData.alpha_channel[row * width + col]/2;
-                }
-            }
-        }
+        std::vector<uint32_t> pixels(size_t(width) * size_t(height));
 
-        img.create(width, height, pixels);
+        const palette::Lut lut = palette::makeLut(palette.colors_);
+        palette::toRgbaCheckerboard(frameData.pixel_indexes.data(), frameData.alpha_channel.data(), lut, palette::solidColor(255, 0, 0), pixels.data(), width, height);
+
+        img.create(width, height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
         break;
     }
     case ImageType::Construction: {
-        // fuck msvc
-        std::vector<Uint8> pixelsBuf(byteCount);
-        Uint8 *pixels = pixelsBuf.data();
-
-        for (uint32_t row = 0; row < height; row++) {
-            for (uint32_t col = 0; col < width; col++) {
-                const uint8_t paletteIndex = frameData.pixel_indexes[row * width + col];
-                assert(paletteIndex < palette.colors_.size());
-
-                const genie::Color &g_color = palette.colors_[paletteIndex];
-                const size_t pixelPos = (row * width + col) * 4;
-
-                if ((row + col) % 2 == 1) {
-                    pixels[pixelPos    ] = g_color.r;
-                    pixels[pixelPos + 1] = g_color.g;
-                    pixels[pixelPos + 2] = g_color.b;
-                    pixels[pixelPos + 3] = frameData.alpha_channel[row * width + col];
-                } else {
-                    pixels[pixelPos    ] = g_color.r/2;
-                    pixels[pixelPos + 1] = g_color.g/2;
-                    pixels[pixelPos + 2] = g_color.b/2;
-                    pixels[pixelPos + 3] = frameData.alpha_channel[row * width + col]/2;
-                }
-            }
-        }
+        std::vector<uint32_t> pixels(size_t(width) * size_t(height));
+
+        const palette::Lut lut = palette::makeLut(palette.colors_);
+        palette::toRgbaCheckerboard(frameData.pixel_indexes.data(), frameData.alpha_channel.data(), lut, palette::halfBrightness(lut), pixels.data(), width, height);
 
-        img.create(width, height, pixels);
+        img.create(width, height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
         break;
     }
     case ImageType::InTheShadows: {
-        // fuck msvc
-        std::vector<Uint8> pixelsBuf(byteCount);
-        Uint8 *pixels = pixelsBuf.data();
-
-        for (uint32_t row = 0; row < height; row++) {
-            for (uint32_t col = 0; col < width; col++) {
-                const uint8_t paletteIndex = frameData.pixel_indexes[row * width + col];
-                assert(paletteIndex < palette.colors_.size());
-
-                const genie::Color &g_color = palette.colors_[paletteIndex];
-                const size_t pixelPos = (row * width + col) * 4;
-
-                pixels[pixelPos    ] = g_color.r / 2;
-                pixels[pixelPos + 1] = g_color.g / 2;
-                pixels[pixelPos + 2] = g_color.b / 2;
-                pixels[pixelPos + 3] = frameData.alpha_channel[row * width + col];
-            }
-        }
+        std::vector<uint32_t> pixels(size_t(width) * size_t(height));
+
+        const palette::Lut lut = palette::halfBrightness(palette::makeLut(palette.colors_));
+        palette::toRgba(frameData.pixel_indexes.data(), frameData.alpha_channel.data(), lut, pixels.data(), pixels.size());
 
-        img.create(width, height, pixels);
+        img.create(width, height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
         break;
     }
     default:
@@ -200,7 +146,7 @@ sf::Image Graphic::slpFrameToImage(const genie::SlpFramePtr &frame, int8_t playe
     return img;
 }
 
-const sf::Texture &Graphic::texture(uint32_t frameNum, float angleRadians, int8_t playerColor, const ImageType imageType) noexcept
+TextureAtlas::Region Graphic::texture(uint32_t frameNum, float angleRadians, int8_t playerColor, const ImageType imageType) noexcept
 {
     if (!slp_) {
         return nullImage;
@@ -215,8 +161,22 @@ const sf::Texture &Graphic::texture(uint32_t frameNum, float angleRadians, int8_
     state.frame = frameInfo.frameNum;
     state.flipped = frameInfo.mirrored;
 
-    if (m_cache.count(state)) {
-        return m_cache[state];
+    TextureAtlas &atlas = AssetManager::Inst()->textureAtlas();
+
+    GraphicFrameKey frameKey;
+    frameKey.graphicId = graphicId;
+    frameKey.state = state;
+
+    // The page might have been evicted, then we just decode it again
+    FrameIndex &index = frameIndex();
+    std::unordered_map<GraphicFrameKey, TextureAtlas::Region>::iterator cachedRegion = index.regions.find(frameKey);
+    if (cachedRegion != index.regions.end()) {
+        if (atlas.isValid(cachedRegion->second)) {
+            atlas.touch(cachedRegion->second);
+            return cachedRegion->second;
+        }
+
+        index.regions.erase(cachedRegion);
     }
 
     if (state.frame >= slp_->getFrameCount()) {
@@ -224,16 +184,76 @@ const sf::Texture &Graphic::texture(uint32_t frameNum, float angleRadians, int8_
         state.frame = 0;
     }
 
-    sf::Image img = slpFrameToImage(slp_->getFrame(state.frame), playerColor, imageType);
+    DiskCache &diskCache = AssetManager::Inst()->diskCache();
+    DiskCache::Key cacheKey(DiskCache::KeyType::Graphic);
+    cacheKey.add(m_data.SLP).add(state.frame).add(int32_t(playerColor)).add(uint32_t(imageType));
+
+    sf::Image img;
+    const DiskCache::Image cached = diskCache.load(cacheKey);
+    if (cached.isValid()) {
+        img.create(cached.width(), cached.height(), cached.pixels());
+    } else {
+        img = slpFrameToImage(slp_->getFrame(state.frame), playerColor, imageType);
+        diskCache.store(cacheKey, img.getSize().x, img.getSize().y, img.getPixelsPtr());
+    }
 
     if (state.flipped) {
         img.flipHorizontally();
     }
 
-    m_cache[state].loadFromImage(img);
+    const TextureAtlas::Region region = atlas.add(img);
+    index.insert(frameKey, region);
+
+    return region;
+
+}
+
+Graphic::FrameIndex &Graphic::frameIndex()
+{
+    static FrameIndex index;
+    return index;
+}
+
+void Graphic::FrameIndex::insert(const GraphicFrameKey &key, const TextureAtlas::Region &region)
+{
+    if (region.page >= pages.size()) {
+        pages.resize(region.page + 1);
+    }
+
+    // The atlas has cleared the page for reuse, so forget everything that was on it
+    Page &page = pages[region.page];
+    if (page.generation != region.generation) {
+        for (const GraphicFrameKey &evictedKey : page.keys) {
+            std::unordered_map<GraphicFrameKey, TextureAtlas::Region>::iterator it = regions.find(evictedKey);
+            if (it != regions.end() && it->second.page == region.page && it->second.generation != region.generation) {
+                regions.erase(it);
+            }
+        }
+        page.keys.clear();
+        page.generation = region.generation;
+    }
+
+    page.keys.push_back(key);
+    regions[key] = region;
+}
 
-    return m_cache[state];
+size_t Graphic::memoryUsage() const noexcept
+{
+    size_t bytes = sizeof(Graphic);
+    if (!slp_) {
+        return bytes;
+    }
+
+    bytes += slp_->fileData().size();
+
+    // The frames are decoded when they are first used, and then kept around
+    // as palette indices and masks, so assume they all will be
+    static const size_t decodedBytesPerPixel = 2;
+    for (uint32_t frame = 0; frame < slp_->getFrameCount(); frame++) {
+        bytes += size_t(slp_->frameWidth(frame)) * size_t(slp_->frameHeight(frame)) * decodedBytesPerPixel;
+    }
 
+    return bytes;
 }
 
 Size Graphic::size(uint32_t frame_num, float angle) const noexcept
@@ -20,6 +20,7 @@
 
 #include "core/Logger.h"
 #include "core/Types.h"
+#include "TextureAtlas.h"
 
 #include <genie/dat/Graphic.h>
 #include <SFML/Graphics/Texture.hpp>
@@ -104,6 +105,25 @@ template<> struct hash<GraphicState>
 };
 }
 
+/// The frames of all the graphics are indexed together
+struct GraphicFrameKey {
+    int graphicId = -1;
+    GraphicState state;
+
+    bool operator==(const GraphicFrameKey &other) const noexcept {
+        return graphicId == other.graphicId && state == other.state;
+    }
+};
+
+namespace std {
+template<> struct hash<GraphicFrameKey>
+{
+    size_t operator()(const GraphicFrameKey &k) const noexcept {
+        return hash<int>()(k.graphicId) * 31 ^ hash<GraphicState>()(k.state);
+    }
+};
+}
+
 
 //------------------------------------------------------------------------------
 /// A graphic resource contains one or more frames and data stored to
@@ -113,7 +133,7 @@ template<> struct hash<GraphicState>
 class Graphic
 {
 public:
-    static const sf::Texture nullImage;
+    static const TextureAtlas::Region nullImage;
 
     const int graphicId = -1;
 
@@ -137,7 +157,8 @@ public:
 //    const sf::Texture &getImage(uint32_t frame_num = 0, float angle = 0, uint8_t playerId = 0, const ImageType type = ImageType::Base);
 //    const sf::Texture &overlayImage(uint32_t frame_num, float angle, uint8_t playerId);
 
-    const sf::Texture &texture(uint32_t frameNum = 0, float angleRadians = 0, int8_t playerColor = 0, const ImageType imageType = ImageType::Base) noexcept;
+    /// The frame is packed into an atlas page, so use the rect of the region when drawing
+    TextureAtlas::Region texture(uint32_t frameNum = 0, float angleRadians = 0, int8_t playerColor = 0, const ImageType imageType = ImageType::Base) noexcept;
 
     Size size(uint32_t frame_num, float angle) const noexcept;
     ScreenRect rect(uint32_t frame_num, float angle) const noexcept;
@@ -183,6 +204,9 @@ public:
         return slp_ != nullptr || !m_data.Deltas.empty();
     }
 
+    /// Roughly how much memory this keeps alive, with the SLP and its frames
+    size_t memoryUsage() const noexcept;
+
     inline bool runOnce() const noexcept { return m_runOnce; }
     inline void setRunOnce(const bool once) noexcept { m_runOnce = once; }
 
@@ -203,9 +227,23 @@ private:
     };
     FrameInfo calcFrameInfo(uint32_t num, float angle) const noexcept;
 
-    genie::SlpFilePtr slp_;
+    /// Where the frames are in the atlas. The atlas has the memory budget
+    /// and throws out whole pages, so this just follows along.
+    struct FrameIndex {
+        struct Page {
+            uint32_t generation = 0;
+            std::vector<GraphicFrameKey> keys;
+        };
+
+        std::unordered_map<GraphicFrameKey, TextureAtlas::Region> regions;
+        std::vector<Page> pages;
 
-    std::unordered_map<GraphicState, sf::Texture> m_cache;
+        void insert(const GraphicFrameKey &key, const TextureAtlas::Region &region);
+    };
+
+    static FrameIndex &frameIndex();
+
+    genie::SlpFilePtr slp_;
 
     const genie::Graphic &m_data;
     bool m_runOnce = false;
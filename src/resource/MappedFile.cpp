@@ -0,0 +1,128 @@
+#include "MappedFile.h"
+
+#include "core/Logger.h"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPEDFILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+#ifdef MAPPEDFILE_MMAP
+    if (m_mapping) {
+        munmap(m_mapping, m_size);
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    if (isOpen()) {
+        WARN << "Already opened" << m_path;
+        return false;
+    }
+
+    m_path = path;
+
+#ifdef MAPPEDFILE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        DBG << "Failed to open" << path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        WARN << "Failed to get size of" << path;
+        ::close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (mapping == MAP_FAILED) {
+        WARN << "Failed to map" << path;
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_size = size_t(info.st_size);
+    m_data = static_cast<const uint8_t*>(mapping);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        DBG << "Failed to open" << path;
+        return false;
+    }
+
+    m_buffer.resize(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size())) {
+        WARN << "Failed to read" << path;
+        m_buffer.clear();
+        return false;
+    }
+    m_size = m_buffer.size();
+    m_data = m_buffer.data();
+#endif
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+MemoryStreamBuffer::MemoryStreamBuffer(const uint8_t *data, const size_t size, std::shared_ptr<const void> owner) :
+    m_owner(std::move(owner))
+{
+    // The streambuf interface wants non-const, but we never write through it
+    char *start = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+    setg(start, start, start + size);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type position = 0;
+    switch(direction) {
+    case std::ios_base::beg:
+        position = offset;
+        break;
+    case std::ios_base::cur:
+        position = (gptr() - eback()) + offset;
+        break;
+    case std::ios_base::end:
+        position = (egptr() - eback()) + offset;
+        break;
+    default:
+        return pos_type(off_type(-1));
+    }
+
+    if (position < 0 || position > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + position, egptr());
+    return pos_type(position);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+MemoryStream::MemoryStream(const uint8_t *data, const size_t size, std::shared_ptr<const void> owner) :
+    MemoryStreamBuffer(data, size, std::move(owner)),
+    std::istream(static_cast<MemoryStreamBuffer*>(this))
+{
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/// A file mapped read only into memory, or just read into memory if we can't
+/// map it.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile &operator=(const MappedFile&) = delete;
+
+    bool open(const std::string &path);
+    bool isOpen() const noexcept { return m_data != nullptr; }
+
+    const uint8_t *data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    const std::string &path() const noexcept { return m_path; }
+
+private:
+    std::string m_path;
+
+    void *m_mapping = nullptr;
+    std::vector<uint8_t> m_buffer; // if we can't mmap
+
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/// Reads straight from a block of memory, without copying it first
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+    /// @param owner kept alive as long as the buffer, so the memory stays valid
+    MemoryStreamBuffer(const uint8_t *data, const size_t size, std::shared_ptr<const void> owner);
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+
+private:
+    std::shared_ptr<const void> m_owner;
+};
+
+class MemoryStream : private MemoryStreamBuffer, public std::istream
+{
+public:
+    MemoryStream(const uint8_t *data, const size_t size, std::shared_ptr<const void> owner = nullptr);
+};
@@ -0,0 +1,273 @@
+#include "PaletteConversion.h"
+
+#include <genie/resource/Color.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PALETTE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace palette {
+
+static inline uint32_t pack(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a) noexcept
+{
+    return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 | uint32_t(a) << 24;
+}
+
+Lut makeLut(const std::vector<genie::Color> &colors) noexcept
+{
+    Lut lut{};
+    const size_t count = std::min(colors.size(), lut.size());
+    for (size_t i=0; i<count; i++) {
+        lut[i] = pack(colors[i].r, colors[i].g, colors[i].b, 0);
+    }
+    return lut;
+}
+
+Lut halfBrightness(const Lut &lut) noexcept
+{
+    Lut half;
+    for (size_t i=0; i<lut.size(); i++) {
+        // Shift all channels at once, and mask away what got shifted in from the neighbor
+        half[i] = (lut[i] >> 1) & 0x007F7F7F;
+    }
+    return half;
+}
+
+Lut solidColor(const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    Lut lut;
+    lut.fill(pack(r, g, b, 0));
+    return lut;
+}
+
+//------------------------------------------------------------------------------
+// Plain versions, also used for the ends of rows in the vectorized versions
+
+static void toRgbaScalar(const uint8_t *indices, const uint8_t *alpha, const Lut &lut, uint32_t *out, const size_t count) noexcept
+{
+    for (size_t i=0; i<count; i++) {
+        out[i] = lut[indices[i]] | uint32_t(alpha[i]) << 24;
+    }
+}
+
+static void checkerboardRowScalar(const uint8_t *indices, const uint8_t *alpha, const Lut &oddLut, const Lut &evenLut, uint32_t *out, const int firstCol, const int endCol, const int row) noexcept
+{
+    for (int col=firstCol; col<endCol; col++) {
+        if ((row + col) % 2 == 1) {
+            out[col] = oddLut[indices[col]] | uint32_t(alpha[col]) << 24;
+        } else {
+            out[col] = evenLut[indices[col]] | uint32_t(alpha[col] / 2) << 24;
+        }
+    }
+}
+
+#ifdef PALETTE_X86_KERNELS
+
+//------------------------------------------------------------------------------
+// SSE2 doesn't have gather, so we look up the colors one by one and do the
+// rest four pixels at a time
+
+__attribute__((target("sse2")))
+static inline __m128i gatherSse2(const uint8_t *indices, const Lut &lut) noexcept
+{
+    return _mm_set_epi32(lut[indices[3]], lut[indices[2]], lut[indices[1]], lut[indices[0]]);
+}
+
+/// Four alpha values shifted up into the top byte of each 32 bit lane
+__attribute__((target("sse2")))
+static inline __m128i alphaSse2(const uint8_t *alpha) noexcept
+{
+    const int32_t packed = int32_t(alpha[0]) | int32_t(alpha[1]) << 8 | int32_t(alpha[2]) << 16 | int32_t(uint32_t(alpha[3]) << 24);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = _mm_unpacklo_epi8(zero, _mm_cvtsi32_si128(packed));
+    return _mm_unpacklo_epi16(zero, words);
+}
+
+__attribute__((target("sse2")))
+static void toRgbaSse2(const uint8_t *indices, const uint8_t *alpha, const Lut &lut, uint32_t *out, const size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_or_si128(gatherSse2(indices + i, lut), alphaSse2(alpha + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), pixels);
+    }
+
+    toRgbaScalar(indices + i, alpha + i, lut, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void checkerboardSse2(const uint8_t *indices, const uint8_t *alpha, const Lut &oddLut, const Lut &evenLut, uint32_t *out, const int width, const int height) noexcept
+{
+    const __m128i alphaMask = _mm_set1_epi32(int32_t(0xFF000000));
+    const __m128i oddLanes = _mm_set_epi32(-1, 0, -1, 0);
+    const __m128i evenLanes = _mm_set_epi32(0, -1, 0, -1);
+
+    for (int row=0; row<height; row++) {
+        const uint8_t *rowIndices = indices + size_t(row) * width;
+        const uint8_t *rowAlpha = alpha + size_t(row) * width;
+        uint32_t *rowOut = out + size_t(row) * width;
+
+        // Which of the lanes get the odd colors only depends on the row, since we step 4 at a time
+        const __m128i fullLanes = (row % 2 == 0) ? oddLanes : evenLanes;
+
+        int col = 0;
+        for (; col + 4 <= width; col += 4) {
+            const __m128i alphaFull = alphaSse2(rowAlpha + col);
+            const __m128i alphaHalf = _mm_and_si128(_mm_srli_epi32(alphaFull, 1), alphaMask);
+
+            const __m128i full = _mm_or_si128(gatherSse2(rowIndices + col, oddLut), alphaFull);
+            const __m128i half = _mm_or_si128(gatherSse2(rowIndices + col, evenLut), alphaHalf);
+
+            const __m128i pixels = _mm_or_si128(_mm_and_si128(fullLanes, full), _mm_andnot_si128(fullLanes, half));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rowOut + col), pixels);
+        }
+
+        checkerboardRowScalar(rowIndices, rowAlpha, oddLut, evenLut, rowOut, col, width, row);
+    }
+}
+
+//------------------------------------------------------------------------------
+// AVX2 can do the lookups as well, eight pixels at a time
+
+__attribute__((target("avx2")))
+static inline __m256i gatherAvx2(const uint8_t *indices, const Lut &lut) noexcept
+{
+    const __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices)));
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut.data()), lanes, 4);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alphaAvx2(const uint8_t *alpha) noexcept
+{
+    const __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha)));
+    return _mm256_slli_epi32(lanes, 24);
+}
+
+__attribute__((target("avx2")))
+static void toRgbaAvx2(const uint8_t *indices, const uint8_t *alpha, const Lut &lut, uint32_t *out, const size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i pixels = _mm256_or_si256(gatherAvx2(indices + i, lut), alphaAvx2(alpha + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), pixels);
+    }
+
+    toRgbaScalar(indices + i, alpha + i, lut, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void checkerboardAvx2(const uint8_t *indices, const uint8_t *alpha, const Lut &oddLut, const Lut &evenLut, uint32_t *out, const int width, const int height) noexcept
+{
+    const __m256i alphaMask = _mm256_set1_epi32(int32_t(0xFF000000));
+    const __m256i oddLanes = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m256i evenLanes = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+
+    for (int row=0; row<height; row++) {
+        const uint8_t *rowIndices = indices + size_t(row) * width;
+        const uint8_t *rowAlpha = alpha + size_t(row) * width;
+        uint32_t *rowOut = out + size_t(row) * width;
+
+        const __m256i fullLanes = (row % 2 == 0) ? oddLanes : evenLanes;
+
+        int col = 0;
+        for (; col + 8 <= width; col += 8) {
+            const __m256i alphaFull = alphaAvx2(rowAlpha + col);
+            const __m256i alphaHalf = _mm256_and_si256(_mm256_srli_epi32(alphaFull, 1), alphaMask);
+
+            const __m256i full = _mm256_or_si256(gatherAvx2(rowIndices + col, oddLut), alphaFull);
+            const __m256i half = _mm256_or_si256(gatherAvx2(rowIndices + col, evenLut), alphaHalf);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rowOut + col), _mm256_blendv_epi8(half, full, fullLanes));
+        }
+
+        checkerboardRowScalar(rowIndices, rowAlpha, oddLut, evenLut, rowOut, col, width, row);
+    }
+}
+
+#endif // PALETTE_X86_KERNELS
+
+//------------------------------------------------------------------------------
+
+static Kernel detectKernel() noexcept
+{
+#ifdef PALETTE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Kernel::SSE2;
+    }
+#endif
+    return Kernel::Scalar;
+}
+
+static const Kernel s_supportedKernel = detectKernel();
+static std::atomic<Kernel> s_kernel = s_supportedKernel;
+
+Kernel kernel() noexcept
+{
+    return s_kernel;
+}
+
+void setKernel(const Kernel kernel) noexcept
+{
+    // Don't let anyone crash us by asking for something the CPU can't do
+    s_kernel = std::min(kernel, s_supportedKernel);
+}
+
+const char *kernelName(const Kernel kernel) noexcept
+{
+    switch(kernel) {
+    case Kernel::Scalar:
+        return "scalar";
+    case Kernel::SSE2:
+        return "SSE2";
+    case Kernel::AVX2:
+        return "AVX2";
+    }
+    return "invalid";
+}
+
+void toRgba(const uint8_t *indices, const uint8_t *alpha, const Lut &lut, uint32_t *out, const size_t count) noexcept
+{
+    switch(s_kernel.load(std::memory_order_relaxed)) {
+#ifdef PALETTE_X86_KERNELS
+    case Kernel::AVX2:
+        toRgbaAvx2(indices, alpha, lut, out, count);
+        return;
+    case Kernel::SSE2:
+        toRgbaSse2(indices, alpha, lut, out, count);
+        return;
+#endif
+    default:
+        toRgbaScalar(indices, alpha, lut, out, count);
+        return;
+    }
+}
+
+void toRgbaCheckerboard(const uint8_t *indices, const uint8_t *alpha, const Lut &oddLut, const Lut &evenLut, uint32_t *out, const int width, const int height) noexcept
+{
+    switch(s_kernel.load(std::memory_order_relaxed)) {
+#ifdef PALETTE_X86_KERNELS
+    case Kernel::AVX2:
+        checkerboardAvx2(indices, alpha, oddLut, evenLut, out, width, height);
+        return;
+    case Kernel::SSE2:
+        checkerboardSse2(indices, alpha, oddLut, evenLut, out, width, height);
+        return;
+#endif
+    default:
+        for (int row=0; row<height; row++) {
+            const size_t offset = size_t(row) * width;
+            checkerboardRowScalar(indices + offset, alpha + offset, oddLut, evenLut, out + offset, 0, width, row);
+        }
+        return;
+    }
+}
+
+} // namespace palette
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace genie {
+struct Color;
+}
+
+/// Converting palette indices to RGBA, with SSE2/AVX2 versions picked at
+/// runtime when the CPU supports them.
+///
+/// The pixels are written as uint32_t in the byte order sf::Image expects
+/// (R, G, B, A in memory), directly into the buffer passed in.
+namespace palette {
+
+using Lut = std::array<uint32_t, 256>;
+
+/// Alpha is left at 0, it is filled in from the alpha channel of the frame
+Lut makeLut(const std::vector<genie::Color> &colors) noexcept;
+
+/// Same colors with half the brightness
+Lut halfBrightness(const Lut &lut) noexcept;
+
+/// Same color for every index
+Lut solidColor(const uint8_t r, const uint8_t g, const uint8_t b) noexcept;
+
+/// out[i] = lut[indices[i]] with alpha[i] as the alpha
+void toRgba(const uint8_t *indices, const uint8_t *alpha, const Lut &lut, uint32_t *out, const size_t count) noexcept;
+
+/// Pixels where row + column is odd use @p oddLut, the others use @p evenLut
+/// and get half the alpha.
+void toRgbaCheckerboard(const uint8_t *indices, const uint8_t *alpha, const Lut &oddLut, const Lut &evenLut, uint32_t *out, const int width, const int height) noexcept;
+
+enum class Kernel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+/// What the CPU supports, unless overridden
+Kernel kernel() noexcept;
+
+/// For benchmarking and testing the different versions
+void setKernel(const Kernel kernel) noexcept;
+
+const char *kernelName(const Kernel kernel) noexcept;
+
+} // namespace palette
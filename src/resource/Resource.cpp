@@ -17,6 +17,7 @@
 */
 
 #include "Resource.h"
+#include "PaletteConversion.h"
 
 #include <SFML/Config.hpp>
 #include <SFML/Graphics/Color.hpp>
@@ -81,18 +82,10 @@ sf::Image Resource::convertFrameToImage(const genie::SlpFramePtr &frame,
 
         }
     } else {
-        const std::vector<genie::Color> &colors = palette.colors_;
-        const std::vector<uint8_t> &pixelindexes = frameData.pixel_indexes;
-        const std::vector<uint8_t> &alphachannel = frameData.alpha_channel;
-        for (int i=0; i<area; i++) {
-            const genie::Color &col = colors[pixelindexes[i]];
-            *pixels++ = col.r;
-            *pixels++ = col.g;
-            *pixels++ = col.b;
-            *pixels++ = alphachannel[i];
-        }
+        assert(area <= frameData.pixel_indexes.size());
+        assert(area <= frameData.alpha_channel.size());
+        palette::toRgba(frameData.pixel_indexes.data(), frameData.alpha_channel.data(), palette::makeLut(palette.colors_), reinterpret_cast<uint32_t*>(pixels), area);
 
-        pixels = pixelsBuf.data();
         if (playerColor >= 0) {
             const genie::PlayerColour &pc = DataManager::Inst().getPlayerColor(playerColor);
             for (const genie::PlayerColorXY mask : frameData.player_color_mask) {
@@ -27,6 +27,7 @@
 #include "core/Logger.h"
 #include "core/Types.h"
 #include "core/Utility.h"
+#include "mechanics/Map.h"
 
 #include <genie/resource/BlendomaticFile.h>
 #include <genie/resource/Color.h>
@@ -41,6 +42,9 @@
 #include <assert.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -119,18 +123,174 @@ uint8_t TerrainSprite::blendMode(const uint8_t ownMode, const uint8_t neighborMo
 
 
 
-const Drawable::Image::Ptr &TerrainSprite::texture(const MapTile &tile, const IRenderTargetPtr &renderer)
+Drawable::Image::Ptr TerrainSprite::texture(const MapTile &tile, const IRenderTargetPtr &renderer)
 {
     // The original graphics code in aoe was apparently hand-written assembly according to people on the internet,
     // and since I'm too lazy and too dumb to optimize this properly we just cache heavily instead
-    const std::unordered_map<MapTile, Drawable::Image::Ptr>::const_iterator it = m_textures.find(tile);
-    if (it != m_textures.end()) {
-        return it->second;
+    const Drawable::Image::Ptr *cached = tileCache().find(tile);
+    if (cached) {
+        return *cached;
     }
     if (IS_UNLIKELY(!m_slp)) {
         return Drawable::Image::null;
     }
 
+    // rasterize() doesn't load anything, and this keeps them from getting evicted until we're done
+    std::vector<TerrainPtr> blendTerrains;
+    for (const Blend &blend : tile.blends) {
+        blendTerrains.push_back(AssetManager::Inst()->getTerrain(blend.terrainId));
+    }
+
+    return upload(tile, loadOrRasterize(tile), renderer);
+}
+
+Drawable::Image::Ptr TerrainSprite::upload(const MapTile &tile, const TileImage &image, const IRenderTargetPtr &renderer)
+{
+    Drawable::Image::Ptr texture;
+
+    if (IS_LIKELY(renderer && !image.isEmpty())) {
+        texture = renderer->createImage(Size(image.width, image.height), image.data());
+    } else if (!renderer) {
+        WARN << "no renderer!";
+    }
+
+    tileCache().insert(tile, texture, size_t(image.width) * size_t(image.height) * 4);
+
+    return texture;
+}
+
+LruCache<MapTile, Drawable::Image::Ptr> &TerrainSprite::tileCache()
+{
+    // All terrains together, so they share a budget
+    static LruCache<MapTile, Drawable::Image::Ptr> cache(CacheManager::CacheType::TerrainTiles);
+    return cache;
+}
+
+void TerrainSprite::prerenderTiles(const Map &map, const IRenderTargetPtr &renderer)
+{
+    TIME_THIS;
+
+    struct Job {
+        TerrainPtr terrain;
+        const MapTile *tile = nullptr;
+        TileImage image;
+    };
+    std::vector<Job> jobs;
+
+    // So they don't get evicted while the threads are using them
+    std::unordered_set<TerrainPtr> blendTerrains;
+
+    // Find the unique tiles, and load everything they need while we're still on one thread
+    std::unordered_set<MapTile> seen;
+    for (int col = 0; col < map.columnCount(); col++) {
+        for (int row = 0; row < map.rowCount(); row++) {
+            const MapTile &tile = map.getTileAt(col, row);
+            const TerrainPtr terrain = AssetManager::Inst()->getTerrain(tile.terrainId);
+            if (!terrain || !terrain->m_slp || tileCache().contains(tile)) {
+                continue;
+            }
+            if (!seen.insert(tile).second) {
+                continue;
+            }
+
+            for (const Blend &blend : tile.blends) {
+                blendTerrains.insert(AssetManager::Inst()->getTerrain(blend.terrainId));
+                AssetManager::Inst()->getBlendmode(blend.blendMode);
+            }
+
+            Job job;
+            job.terrain = terrain;
+            job.tile = &tile;
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    if (jobs.empty()) {
+        return;
+    }
+
+    AssetManager::Inst()->getPalette();
+
+    DBG << "Generating" << jobs.size() << "tiles";
+
+    std::atomic<size_t> nextJob = 0;
+    const auto work = [&]() {
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            jobs[i].image = jobs[i].terrain->loadOrRasterize(*jobs[i].tile);
+        }
+    };
+
+    const size_t threadCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, jobs.size());
+    std::vector<std::thread> threads;
+    for (size_t i=1; i<threadCount; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    // Textures need to be created on the thread with the GL context
+    if (!renderer) {
+        WARN << "no renderer, not creating textures";
+        return;
+    }
+    for (const Job &job : jobs) {
+        job.terrain->upload(*job.tile, job.image, renderer);
+    }
+}
+
+TerrainSprite::TileImage TerrainSprite::loadOrRasterize(const MapTile &tile) const
+{
+    DiskCache &diskCache = AssetManager::Inst()->diskCache();
+    const DiskCache::Key cacheKey = diskCacheKey(tile);
+
+    TileImage image;
+    image.cached = diskCache.load(cacheKey);
+    if (image.cached.isValid()) {
+        image.width = image.cached.width();
+        image.height = image.cached.height();
+        return image;
+    }
+
+    image = rasterize(tile);
+    if (!image.pixels.empty()) {
+        diskCache.store(cacheKey, image.width, image.height, image.pixels.data());
+    }
+
+    return image;
+}
+
+DiskCache::Key TerrainSprite::diskCacheKey(const MapTile &tile) const
+{
+    DiskCache::Key key(DiskCache::KeyType::TerrainTile);
+    key.add(id).add(tile.frame);
+
+    for (const Slope slope : {
+             tile.slopes.self,
+             tile.slopes.north, tile.slopes.south,
+             tile.slopes.west, tile.slopes.east,
+             tile.slopes.southWest, tile.slopes.southEast,
+             tile.slopes.northWest, tile.slopes.northEast
+         }) {
+        key.add(uint32_t(slope.direction));
+    }
+
+    key.add(uint32_t(tile.blends.size()));
+    for (const Blend &blend : tile.blends) {
+        key.add(blend.terrainId).add(blend.bits).add(uint32_t(blend.blendMode)).add(blend.frame);
+    }
+
+    return key;
+}
+
+TerrainSprite::TileImage TerrainSprite::rasterize(const MapTile &tile) const
+{
+    TileImage image;
+    if (IS_UNLIKELY(!m_slp)) {
+        return image;
+    }
+
     // This defines lightning textures (e. g. to darken edges)
     std::shared_ptr<genie::PatternMasksFile> patternmasksFile = AssetManager::Inst()->patternmasksFile();
 
@@ -173,7 +333,11 @@ const Drawable::Image::Ptr &TerrainSprite::texture(const MapTile &tile, const IR
         }
 
 
-        const TerrainPtr blendTerrain = AssetManager::Inst()->getTerrain(tileBlend.terrainId);
+        const TerrainPtr blendTerrain = AssetManager::Inst()->loadedTerrain(tileBlend.terrainId);
+        if (IS_UNLIKELY(!blendTerrain || !blendTerrain->m_slp)) {
+            WARN << "Blend terrain" << tileBlend.terrainId << "not loaded";
+            continue;
+        }
         const std::vector<uint8_t> &blendData = blendTerrain->m_slp->fileData();
 
         int alphaOffset = 0;
@@ -237,8 +401,10 @@ const Drawable::Image::Ptr &TerrainSprite::texture(const MapTile &tile, const IR
 
     const int width = m_slp->frameWidth(tile.frame);
     const int area = width * filter.height;
-    std::vector<Uint8> pixelsBuf(area * 4, 0);
-    uint32_t *pixels = reinterpret_cast<uint32_t*>(pixelsBuf.data());
+    image.width = width;
+    image.height = filter.height;
+    image.pixels.resize(area * 4, 0);
+    uint32_t *pixels = reinterpret_cast<uint32_t*>(image.pixels.data());
 
     for (uint32_t y=0; y<filter.height; y++) {
         int xPos = slpTemplate.left_edges_[y];
@@ -272,13 +438,7 @@ const Drawable::Image::Ptr &TerrainSprite::texture(const MapTile &tile, const IR
     addOutline(pixels, width, filter.height);
 #endif
 
-    if (IS_LIKELY(renderer)) {
-        m_textures[tile] = renderer->createImage(Size(width, filter.height), reinterpret_cast<uint8_t*>(pixels));
-    } else {
-        WARN << "no renderer!";
-    }
-
-    return m_textures[tile];
+    return image;
 }
 
 #if PNG_TERRAIN_TEXTURES
@@ -362,6 +522,15 @@ sf::Sprite TerrainSprite::sprite(const MapTile &tile, const IRenderTargetPtr &re
 }
 #endif
 
+size_t TerrainSprite::memoryUsage() const noexcept
+{
+    size_t bytes = sizeof(TerrainSprite);
+    if (m_slp) {
+        bytes += m_slp->fileData().size();
+    }
+    return bytes;
+}
+
 bool TerrainSprite::isValid() const noexcept
 {
 #if PNG_TERRAIN_TEXTURES
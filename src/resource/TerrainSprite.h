@@ -19,7 +19,9 @@
 #pragma once
 
 #include "render/IRenderTarget.h"
+#include "core/LruCache.h"
 #include "mechanics/MapTile.h"
+#include "resource/DiskCache.h"
 
 #if PNG_TERRAIN_TEXTURES
 #include <SFML/Graphics/Sprite.hpp>
@@ -28,10 +30,12 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace sf {
 class Texture;
 }  // namespace sf
+class Map;
 class TerrainSprite;
 typedef std::shared_ptr<TerrainSprite> TerrainPtr;
 
@@ -75,19 +79,46 @@ public:
 
     bool isValid() const noexcept;
 
-    size_t cacheSize() const { return m_textures.size(); }
+    /// Roughly how much memory this keeps alive, the tiles are rasterized
+    /// straight from the SLP data so that is most of it
+    size_t memoryUsage() const noexcept;
 
-    const Drawable::Image::Ptr &texture(const MapTile &tile, const IRenderTargetPtr &renderer);
+    Drawable::Image::Ptr texture(const MapTile &tile, const IRenderTargetPtr &renderer);
+
+    /// Generates the textures for all the tiles on the map that aren't cached yet.
+    /// The pixels are generated on all cores, and then uploaded from this thread.
+    static void prerenderTiles(const Map &map, const IRenderTargetPtr &renderer);
 
 private:
-    void addOutline(uint32_t *pixels, const int width, const int height) noexcept;
+    struct TileImage {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> pixels;
+
+        /// If it was stored on disk by an earlier run we use that instead of the pixels
+        DiskCache::Image cached;
+
+        const uint8_t *data() const noexcept { return cached.isValid() ? cached.pixels() : pixels.data(); }
+        bool isEmpty() const noexcept { return !cached.isValid() && pixels.empty(); }
+    };
+
+    /// Only touches data that is already loaded, so it can run in other threads.
+    /// All the terrains and blend modes used by the tile need to be loaded first.
+    TileImage rasterize(const MapTile &tile) const;
+
+    /// Same as rasterize(), but checks the disk cache first and stores it there afterwards
+    TileImage loadOrRasterize(const MapTile &tile) const;
+    DiskCache::Key diskCacheKey(const MapTile &tile) const;
+    Drawable::Image::Ptr upload(const MapTile &tile, const TileImage &image, const IRenderTargetPtr &renderer);
+
+    static LruCache<MapTile, Drawable::Image::Ptr> &tileCache();
+
+    static void addOutline(uint32_t *pixels, const int width, const int height) noexcept;
 
     genie::SlpFilePtr m_slp;
 
     int m_tileSquareCount = 1;
 
-    std::unordered_map<MapTile, Drawable::Image::Ptr> m_textures;
-
 #if PNG_TERRAIN_TEXTURES
     bool m_isPng = false;
     std::string m_pngPath;
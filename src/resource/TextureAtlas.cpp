@@ -0,0 +1,186 @@
+#include "TextureAtlas.h"
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+
+#include <SFML/Graphics/Image.hpp>
+
+#include <algorithm>
+
+// Space between the images, so they don't bleed into each other
+static const unsigned ATLAS_PADDING = 1;
+
+TextureAtlas::TextureAtlas(const size_t memoryBudget) :
+    m_memoryBudget(memoryBudget)
+{
+}
+
+void TextureAtlas::setMemoryBudget(const size_t bytes)
+{
+    m_memoryBudget = bytes;
+    evictIfNeeded(m_pages.size());
+}
+
+size_t TextureAtlas::memoryUsed() const noexcept
+{
+    size_t used = 0;
+    for (const std::unique_ptr<Page> &page : m_pages) {
+        const sf::Vector2u size = page->texture.getSize();
+        used += size_t(size.x) * size_t(size.y) * 4;
+    }
+    return used;
+}
+
+TextureAtlas::Region TextureAtlas::add(const sf::Image &image)
+{
+    const sf::Vector2u size = image.getSize();
+    if (IS_UNLIKELY(size.x == 0 || size.y == 0)) {
+        return {};
+    }
+
+    size_t pageIndex = m_pages.size();
+    sf::Vector2u position;
+
+    if (size.x + ATLAS_PADDING > PageSize || size.y + ATLAS_PADDING > PageSize) {
+        // Reuse an evicted oversized page, so the indices don't grow forever
+        for (size_t i=0; i<m_pages.size(); i++) {
+            if (m_pages[i]->isOversized && m_pages[i]->usedHeight == 0) {
+                pageIndex = i;
+                break;
+            }
+        }
+
+        if (pageIndex == m_pages.size()) {
+            m_pages.push_back(std::make_unique<Page>());
+            m_pages.back()->isOversized = true;
+        }
+
+        if (!m_pages[pageIndex]->texture.create(size.x, size.y)) {
+            WARN << "Failed to create texture of size" << size.x << size.y;
+            return {};
+        }
+
+        m_pages[pageIndex]->usedHeight = size.y;
+    } else {
+        // Try the most recently used pages first, they are the least likely to be evicted
+        std::vector<size_t> candidates;
+        for (size_t i=0; i<m_pages.size(); i++) {
+            if (!m_pages[i]->isOversized) {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](const size_t a, const size_t b) {
+            return m_pages[a]->lastUsed > m_pages[b]->lastUsed;
+        });
+
+        for (const size_t candidate : candidates) {
+            if (allocate(*m_pages[candidate], size.x, size.y, &position)) {
+                pageIndex = candidate;
+                break;
+            }
+        }
+
+        if (pageIndex == m_pages.size()) {
+            m_pages.push_back(std::make_unique<Page>());
+
+            if (IS_UNLIKELY(!allocate(*m_pages.back(), size.x, size.y, &position))) {
+                WARN << "Failed to fit" << size.x << size.y << "in empty page";
+                return {};
+            }
+        }
+
+        // Evicted pages don't have a texture anymore
+        Page &page = *m_pages[pageIndex];
+        if (page.texture.getSize().x == 0 && !page.texture.create(PageSize, PageSize)) {
+            WARN << "Failed to create atlas page";
+            page.shelves.clear();
+            page.usedHeight = 0;
+            return {};
+        }
+    }
+
+    Page &page = *m_pages[pageIndex];
+    page.texture.update(image, position.x, position.y);
+    page.lastUsed = ++m_useCounter;
+
+    Region region;
+    region.texture = &page.texture;
+    region.rect = sf::IntRect(position.x, position.y, size.x, size.y);
+    region.page = pageIndex;
+    region.generation = page.generation;
+
+    evictIfNeeded(pageIndex);
+
+    return region;
+}
+
+bool TextureAtlas::allocate(Page &page, const unsigned width, const unsigned height, sf::Vector2u *position)
+{
+    const unsigned paddedWidth = width + ATLAS_PADDING;
+    const unsigned paddedHeight = height + ATLAS_PADDING;
+
+    // Find the shelf that wastes the least height
+    Shelf *bestShelf = nullptr;
+    for (Shelf &shelf : page.shelves) {
+        if (shelf.height < paddedHeight || shelf.usedWidth + paddedWidth > PageSize) {
+            continue;
+        }
+
+        // Don't put tiny things in huge shelves
+        if (shelf.height > paddedHeight * 2 && shelf.height - paddedHeight > 16) {
+            continue;
+        }
+
+        if (!bestShelf || shelf.height < bestShelf->height) {
+            bestShelf = &shelf;
+        }
+    }
+
+    if (!bestShelf) {
+        if (page.usedHeight + paddedHeight > PageSize) {
+            return false;
+        }
+
+        Shelf shelf;
+        shelf.y = page.usedHeight;
+        shelf.height = paddedHeight;
+        page.shelves.push_back(shelf);
+        page.usedHeight += paddedHeight;
+
+        bestShelf = &page.shelves.back();
+    }
+
+    position->x = bestShelf->usedWidth;
+    position->y = bestShelf->y;
+    bestShelf->usedWidth += paddedWidth;
+
+    return true;
+}
+
+void TextureAtlas::evictIfNeeded(const size_t keepPage)
+{
+    while (memoryUsed() > m_memoryBudget) {
+        size_t oldest = m_pages.size();
+        for (size_t i=0; i<m_pages.size(); i++) {
+            if (i == keepPage || m_pages[i]->usedHeight == 0) {
+                continue;
+            }
+
+            if (oldest == m_pages.size() || m_pages[i]->lastUsed < m_pages[oldest]->lastUsed) {
+                oldest = i;
+            }
+        }
+
+        if (oldest == m_pages.size()) {
+            return;
+        }
+
+        Page &page = *m_pages[oldest];
+        page.texture = sf::Texture();
+        page.shelves.clear();
+        page.usedHeight = 0;
+        page.generation++;
+
+        m_evictions++;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sf {
+class Image;
+}
+
+/// Packs lots of small images (the frames of the graphics) into a few big
+/// textures, so drawing doesn't need to switch textures all the time.
+///
+/// The images are placed in rows (shelves) on each page. When the pages use
+/// more memory than the budget the least recently used page is cleared and
+/// reused, so whoever has regions on it needs to check isValid() and add the
+/// image again if it is gone.
+class TextureAtlas
+{
+public:
+    static constexpr unsigned PageSize = 2048;
+
+    struct Region {
+        const sf::Texture *texture = nullptr;
+        sf::IntRect rect;
+
+        uint32_t page = 0;
+        uint32_t generation = 0;
+    };
+
+    explicit TextureAtlas(const size_t memoryBudget = 256 * 1024 * 1024);
+
+    /// In bytes, pages are 16MB each
+    void setMemoryBudget(const size_t bytes);
+    size_t memoryBudget() const noexcept { return m_memoryBudget; }
+    size_t memoryUsed() const noexcept;
+
+    Region add(const sf::Image &image);
+
+    /// Returns false if the page with the region has been evicted
+    inline bool isValid(const Region &region) const noexcept {
+        return region.texture && region.page < m_pages.size() && m_pages[region.page]->generation == region.generation;
+    }
+
+    /// Marks it as recently used, so it doesn't get evicted
+    inline void touch(const Region &region) noexcept {
+        m_pages[region.page]->lastUsed = ++m_useCounter;
+    }
+
+    size_t pageCount() const noexcept { return m_pages.size(); }
+    size_t evictionCount() const noexcept { return m_evictions; }
+
+private:
+    struct Shelf {
+        unsigned y = 0;
+        unsigned height = 0;
+        unsigned usedWidth = 0;
+    };
+
+    struct Page {
+        sf::Texture texture;
+        std::vector<Shelf> shelves;
+        unsigned usedHeight = 0;
+
+        uint64_t lastUsed = 0;
+        uint32_t generation = 0;
+
+        /// Images that don't fit in a normal page get their own
+        bool isOversized = false;
+    };
+
+    bool allocate(Page &page, const unsigned width, const unsigned height, sf::Vector2u *position);
+    void evictIfNeeded(const size_t keepPage);
+
+    std::vector<std::unique_ptr<Page>> m_pages;
+    size_t m_memoryBudget = 0;
+    uint64_t m_useCounter = 0;
+    size_t m_evictions = 0;
+};
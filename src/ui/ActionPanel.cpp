@@ -614,6 +614,9 @@ void ActionPanel::handleButtonClick(const ActionPanel::InterfaceButton &button)
 
         for (const Unit::Ptr &unit : m_selectedUnits) {
             unit->stance = newStance;
+
+            // Might want to attack something now
+            unit->unitManager().onUnitIdle(*unit);
         }
 
         updateButtons();
@@ -21,6 +21,8 @@
 #include <SFML/Window/Event.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <functional>
 #include <vector>
 
@@ -33,6 +35,13 @@ Minimap::Minimap(const IRenderTargetPtr &renderTarget) :
 
 }
 
+Minimap::~Minimap()
+{
+    if (m_visibilityMap) {
+        m_visibilityMap->removeDirtyListener(m_visibilityListener);
+    }
+}
+
 void Minimap::setMap(const std::shared_ptr<Map> &map)
 {
     if (map == m_map) {
@@ -56,7 +65,7 @@ void Minimap::setMap(const std::shared_ptr<Map> &map)
 
     m_lastCameraPos = MapPos(-1, -1);
     m_terrainUpdated = true;
-
+    m_geometryDirty = true;
 }
 
 void Minimap::setUnitManager(const std::shared_ptr<UnitManager> &unitManager)
@@ -79,7 +88,15 @@ void Minimap::setVisibilityMap(const std::shared_ptr<VisibilityMap> &visibilityM
         return;
     }
 
+    if (m_visibilityMap) {
+        m_visibilityMap->removeDirtyListener(m_visibilityListener);
+    }
+
     m_visibilityMap = visibilityMap;
+
+    if (m_visibilityMap) {
+        m_visibilityListener = m_visibilityMap->addDirtyListener();
+    }
 }
 
 void Minimap::updateUnits()
@@ -110,9 +127,9 @@ void Minimap::updateCamera()
     m_cameraRect.y = m_rect.y + cameraPos.y * scaleY + center.y - m_cameraRect.height / 2;
 }
 
-Drawable::Color Minimap::unitColor(const std::shared_ptr<Unit> &unit)
+Drawable::Color Minimap::unitColor(const Unit &unit)
 {
-    if (unit->selected) {
+    if (unit.selected) {
         return Drawable::White;
     }
 
@@ -121,9 +138,9 @@ Drawable::Color Minimap::unitColor(const std::shared_ptr<Unit> &unit)
         //TODO
         break;
     case MinimapMode::Diplomatic:
-        if (unit->playerId == UnitManager::GaiaID) {
+        if (unit.playerId == UnitManager::GaiaID) {
             return Drawable::Color(128, 192, 128);
-        } else if (unit->playerId == 1) { ///TODO fixme get the human player
+        } else if (unit.playerId == 1) { ///TODO fixme get the human player
             return Drawable::Blue;
         } else {
             return Drawable::Red;
@@ -142,10 +159,10 @@ Drawable::Color Minimap::unitColor(const std::shared_ptr<Unit> &unit)
 
 bool Minimap::init()
 {
-    m_terrainTexture = m_renderTarget->createTextureTarget(m_rect.size());
-    DBG << "creating texture target with size" << m_rect.size();
+    // The images are created when we get a map
+    m_geometryDirty = true;
     m_terrainUpdated = true;
-    return m_terrainTexture != nullptr;
+    return true;
 }
 
 bool Minimap::handleEvent(sf::Event event)
@@ -187,168 +204,438 @@ bool Minimap::handleEvent(sf::Event event)
     return true;
 }
 
-bool Minimap::update(Time /*time*/)
+void Minimap::updateGeometry()
 {
-    if (IS_UNLIKELY(!m_visibilityMap)) {
-        WARN << "no visibility map set";
-        return false;
-    }
+    TIME_THIS;
+
+    m_imageWidth = int(m_rect.width);
+    m_imageHeight = int(m_rect.height);
+    m_mapCols = m_map->columnCount();
+    m_mapRows = m_map->rowCount();
+    m_cellCols = (m_mapCols + CellSize - 1) / CellSize;
+    m_cellRows = (m_mapRows + CellSize - 1) / CellSize;
+
+    const MapRect mapDimensions(0, 0, m_mapCols, m_mapRows);
+    m_scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
+    m_scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
+
+    const size_t pixelCount = size_t(m_imageWidth) * size_t(m_imageHeight);
+    const size_t tileCount = size_t(m_mapCols) * size_t(m_mapRows);
+    const size_t cellCount = size_t(m_cellCols) * size_t(m_cellRows);
+
+    // The tiles are diamonds with the top left of their bounding box at
+    // MapPos(row * scaleX, col * scaleY).toScreen(), moved down to the
+    // center, so undo that to find the tile under each pixel.
+    const float aspectRatio = m_rect.height / m_rect.width;
+    const float radius = m_scaleY;
+    const float centerY = m_rect.height / 2;
+
+    // The black background diamond
+    const float backgroundRadius = std::floor(m_rect.width / 2);
+
+    m_pixelTiles.assign(pixelCount, -1);
+    m_pixelCells.assign(pixelCount, 0);
+    m_terrainPixels.assign(pixelCount, Drawable::Transparent);
+
+    std::vector<uint32_t> tilePixelCounts(tileCount + 1, 0);
+    std::vector<uint32_t> cellPixelCounts(cellCount + 1, 0);
+
+    for (int y = 0; y < m_imageHeight; y++) {
+        for (int x = 0; x < m_imageWidth; x++) {
+            const size_t pixel = size_t(y) * m_imageWidth + x;
+
+            const float screenX = x + 0.5f - radius;
+            const float screenY = 2.f * (y + 0.5f - centerY + m_scaleY / 2 - radius * aspectRatio);
+            const float col = (screenX + screenY) / 2.f / m_scaleY;
+            const float row = (screenX - screenY) / 2.f / m_scaleX;
+
+            const int tileCol = int(std::floor(col + 0.5f));
+            const int tileRow = int(std::floor(row + 0.5f));
+
+            if (tileCol >= 0 && tileRow >= 0 && tileCol < m_mapCols && tileRow < m_mapRows) {
+                const int32_t tile = tileRow * m_mapCols + tileCol;
+                m_pixelTiles[pixel] = tile;
+                tilePixelCounts[tile]++;
+            }
 
-    if (m_lastCameraPos != m_renderTarget->camera()->m_target) {
-        updateCamera();
-        m_lastCameraPos = m_renderTarget->camera()->m_target;
-    }
+            const int cellCol = std::clamp(tileCol, 0, m_mapCols - 1) / CellSize;
+            const int cellRow = std::clamp(tileRow, 0, m_mapRows - 1) / CellSize;
+            m_pixelCells[pixel] = cellRow * m_cellCols + cellCol;
+            cellPixelCounts[m_pixelCells[pixel]]++;
 
-    if (!m_map || (!m_unitsUpdated && !m_terrainUpdated)) {
-        return false;
+            const float backgroundDistance = std::abs(x + 0.5f - backgroundRadius) / backgroundRadius
+                                           + std::abs(y + 0.5f - backgroundRadius * aspectRatio) / (backgroundRadius * aspectRatio);
+            if (backgroundDistance <= 1.f) {
+                m_terrainPixels[pixel] = Drawable::Black;
+            }
+        }
     }
 
-    const MapRect mapDimensions(0, 0, m_map->columnCount(), m_map->rowCount());
+    // Bucket the pixels per tile and per cell
+    const auto buildIndex = [pixelCount](const std::vector<uint32_t> &counts, const auto &bucketOf, std::vector<uint32_t> *offsets, std::vector<uint32_t> *pixels) {
+        offsets->assign(counts.size(), 0);
+        for (size_t i = 1; i < counts.size(); i++) {
+            (*offsets)[i] = (*offsets)[i - 1] + counts[i - 1];
+        }
 
-    if (m_terrainUpdated) {
-        DBG << "redrawing terrain";
-        if (!m_terrainTexture ||  m_terrainTexture->getSize() != m_rect.size()) {
-            DBG << "recreating terrain";
-            m_terrainTexture = m_renderTarget->createTextureTarget(m_rect.size());
+        pixels->resize(offsets->back());
+        std::vector<uint32_t> positions(offsets->begin(), offsets->end() - 1);
+        for (size_t pixel = 0; pixel < pixelCount; pixel++) {
+            const int64_t bucket = bucketOf(pixel);
+            if (bucket < 0) {
+                continue;
+            }
+            (*pixels)[positions[bucket]++] = pixel;
         }
+    };
+    buildIndex(tilePixelCounts, [this](const size_t pixel) { return int64_t(m_pixelTiles[pixel]); }, &m_tilePixelOffsets, &m_tilePixels);
+    buildIndex(cellPixelCounts, [this](const size_t pixel) { return int64_t(m_pixelCells[pixel]); }, &m_cellPixelOffsets, &m_cellPixels);
+
+    m_unitPixels.assign(pixelCount, Drawable::Transparent);
+    m_cellHashes.assign(cellCount, 0);
+
+    paintTerrainTiles(0, 0, m_mapCols - 1, m_mapRows - 1);
+    m_terrainDirty = DirtyPixels();
+
+    // Everything is up to date now
+    const DirtyRegions &regions = m_map->dirtyRegions();
+    m_terrainRegionGenerations.resize(size_t(regions.regionColumns()) * regions.regionRows());
+    for (int regionRow = 0; regionRow < regions.regionRows(); regionRow++) {
+        for (int regionCol = 0; regionCol < regions.regionColumns(); regionCol++) {
+            m_terrainRegionGenerations[regionRow * regions.regionColumns() + regionCol] = regions.generation(regionCol, regionRow);
+        }
+    }
 
-        m_terrainTexture->clear(Drawable::Transparent);
-
-        const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
-        const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
-
-        Drawable::Circle background;
-        background.aspectRatio = m_rect.height / m_rect.width;
-        background.radius = std::floor(m_rect.width / 2);
-        background.pointCount = 4;
-        background.fillColor = Drawable::Black;
-        background.filled = true;
-        background.borderSize = 0;
-        m_terrainTexture->draw(background);
-
-        Drawable::Circle tileShape;
-        tileShape.aspectRatio =  m_rect.height / m_rect.width;
-        tileShape.radius = scaleY;
-        tileShape.filled = true;
-        tileShape.pointCount = 4;
-        tileShape.borderSize = 0;
-        const ScreenPos center(m_rect.width/2, m_rect.height/2);
-
-        const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
-        for (int col = 0; col < m_map->columnCount(); col++) {
-            for (int row = 0; row < m_map->rowCount(); row++) {
-                const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(col, row);
-                if (visibility == VisibilityMap::Unexplored) {
-                    continue;
-                }
+    const Size imageSize(m_imageWidth, m_imageHeight);
+    m_terrainImage = m_renderTarget->createImage(imageSize, reinterpret_cast<const uint8_t*>(m_terrainPixels.data()));
+    m_unitsImage = m_renderTarget->createImage(imageSize, reinterpret_cast<const uint8_t*>(m_unitPixels.data()));
+    m_unitsDirty = DirtyPixels();
 
+    m_geometryDirty = false;
+}
+
+void Minimap::paintTerrainTiles(const int firstCol, const int firstRow, const int lastCol, const int lastRow)
+{
+    const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
+    for (int row = std::max(firstRow, 0); row <= std::min(lastRow, m_mapRows - 1); row++) {
+        for (int col = std::max(firstCol, 0); col <= std::min(lastCol, m_mapCols - 1); col++) {
+            const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(col, row);
+
+            Drawable::Color fillColor = Drawable::Black;
+            if (visibility != VisibilityMap::Unexplored) {
                 const MapTile &tile = m_map->getTileAt(col, row);
                 const genie::Terrain &terrain = DataManager::Inst().getTerrain(tile.terrainId);
                 const genie::Color &color = colors[terrain.Colors[0]];
                 if (visibility == VisibilityMap::Explored) {
-                    tileShape.fillColor = Drawable::Color(color.r/2, color.g/2, color.b/2);
+                    fillColor = Drawable::Color(color.r/2, color.g/2, color.b/2);
                 } else {
-                    tileShape.fillColor = Drawable::Color(color.r, color.g, color.b);
+                    fillColor = Drawable::Color(color.r, color.g, color.b);
                 }
+            }
 
-                // WTF TODO FIXME why the fuck is flipping row and col the correct here..
-                const ScreenPos pos = MapPos(row * scaleX, col * scaleY).toScreen();
-                tileShape.center = ScreenPos(pos.x, pos.y + center.y - scaleY / 2);
-                m_terrainTexture->draw(tileShape);
+            const size_t tile = size_t(row) * m_mapCols + col;
+            for (uint32_t i = m_tilePixelOffsets[tile]; i < m_tilePixelOffsets[tile + 1]; i++) {
+                const uint32_t pixel = m_tilePixels[i];
+                m_terrainPixels[pixel] = fillColor;
+                m_terrainDirty.add(pixel % m_imageWidth, pixel / m_imageWidth);
+            }
+        }
+    }
+}
 
+void Minimap::paintChangedTerrainRegions()
+{
+    const DirtyRegions &regions = m_map->dirtyRegions();
+    if (size_t(regions.regionColumns()) * regions.regionRows() != m_terrainRegionGenerations.size()) {
+        m_geometryDirty = true;
+        return;
+    }
+
+    for (int regionRow = 0; regionRow < regions.regionRows(); regionRow++) {
+        for (int regionCol = 0; regionCol < regions.regionColumns(); regionCol++) {
+            const uint32_t generation = regions.generation(regionCol, regionRow);
+            uint32_t &paintedGeneration = m_terrainRegionGenerations[regionRow * regions.regionColumns() + regionCol];
+            if (generation == paintedGeneration) {
+                continue;
             }
+
+            const int firstCol = regionCol * DirtyRegions::RegionSize;
+            const int firstRow = regionRow * DirtyRegions::RegionSize;
+            paintTerrainTiles(firstCol, firstRow, firstCol + DirtyRegions::RegionSize - 1, firstRow + DirtyRegions::RegionSize - 1);
+            paintedGeneration = generation;
         }
+    }
+}
 
-        m_terrainTexture->display();
+bool Minimap::unitMarker(const Entity &entity, ScreenRect *marker, bool *isDiamond, Drawable::Color *color)
+{
+    if (!entity.isUnit()) {
+        return false;
+    }
+    const Unit &unit = static_cast<const Unit&>(entity);
 
-        m_terrainUpdated = false;
+    const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(unit.position());
+    if (visibility == VisibilityMap::Unexplored) {
+        return false;
+    }
+    if (visibility == VisibilityMap::Explored && unit.playerId != UnitManager::GaiaID) {
+        return false;
     }
 
-    if (m_unitsUpdated && m_unitManager) {
-        TIME_THIS;
+    const genie::Unit::MinimapModes mode = genie::Unit::MinimapModes(unit.data()->MinimapMode);
+    if (mode == genie::Unit::MinimapInvisible) {
+        return false;
+    }
+    if (mode == genie::Unit::MinimapFlying) {
+        return false;
+    }
 
-        if (!m_unitsTexture || m_unitsTexture->getSize() != m_rect.size()) {
-            m_unitsTexture = m_renderTarget->createTextureTarget(m_rect.size());
-        }
-        m_unitsTexture->clear(Drawable::Transparent);
+    if (mode != genie::Unit::MinimapUnit && mode != genie::Unit::MinimapBuilding && mode != genie::Unit::MinimapLargeTerrain) {
+        DBG << "Unhandled minimap mode" << int(mode) << unit.data()->MinimapColor;
+        return false;
+    }
 
+    const MapPos mapPos = unit.position();
+    ScreenPos pos = MapPos(mapPos.y / Constants::TILE_SIZE, mapPos.x / Constants::TILE_SIZE - 1).toScreen();
+    const float size = std::max(unit.data()->OutlineSize.x * m_scaleX * 2, 2.f);
+    pos.x = pos.x * m_scaleX - size/2;
+    pos.y = pos.y * m_scaleY + m_rect.height/2 - size/2;
+
+    // WARN: according to genieutils this is the inverted of what the game officially does,
+    // but squares on the minimap look soooo ugly
+    if (mode == genie::Unit::MinimapBuilding) {
+        *marker = ScreenRect(pos, Size(size, size));
+        *isDiamond = false;
+        *color = unitColor(unit);
+    } else if (mode == genie::Unit::MinimapUnit) {
+        // Same as a Drawable::Circle with four points, the position is the top left
+        *marker = ScreenRect(pos, Size(size * 2, size * 2 * m_rect.height / m_rect.width));
+        *isDiamond = true;
+        *color = unitColor(unit);
+    } else {
+        *marker = ScreenRect(pos, Size(size, size));
+        *isDiamond = false;
+        const genie::Color &paletteColor = AssetManager::Inst()->getPalette(50500).getColors()[unit.data()->MinimapColor];
+        *color = Drawable::Color(paletteColor.r, paletteColor.g, paletteColor.b);
+    }
 
-        const MapRect mapDimensions(0, 0, m_map->columnCount(), m_map->rowCount());
-        const float scaleX = m_rect.boundingMapRect().width / mapDimensions.width / 2;
-        const float scaleY = m_rect.boundingMapRect().height / mapDimensions.height / 2;
+    return true;
+}
 
-        const ScreenPos center(m_rect.width/2, m_rect.height/2);
+void Minimap::paintUnitCell(const int cellCol, const int cellRow)
+{
+    const uint32_t cell = cellRow * m_cellCols + cellCol;
 
-        Drawable::Circle diamondSprite;
-        diamondSprite.pointCount = 4;
-        diamondSprite.radius = scaleY;
-        diamondSprite.aspectRatio = m_rect.height / m_rect.width;
-        diamondSprite.filled = true;
-        diamondSprite.borderSize = 0;
+    for (uint32_t i = m_cellPixelOffsets[cell]; i < m_cellPixelOffsets[cell + 1]; i++) {
+        const uint32_t pixel = m_cellPixels[i];
+        m_unitPixels[pixel] = Drawable::Transparent;
+        m_unitsDirty.add(pixel % m_imageWidth, pixel / m_imageWidth);
+    }
 
-        Drawable::Rect rectangleSprite;
-        rectangleSprite.filled = true;
-        rectangleSprite.borderSize = 0;
+    // Units close to the edge of the neighboring cells can spill over into this one
+    const int firstCol = std::max(cellCol - 1, 0) * CellSize;
+    const int firstRow = std::max(cellRow - 1, 0) * CellSize;
+    const int lastCol = std::min((cellCol + 2) * CellSize, m_mapCols);
+    const int lastRow = std::min((cellRow + 2) * CellSize, m_mapRows);
+
+    m_map->forEachEntityBetween(firstCol, firstRow, lastCol, lastRow, [&](const Entity &entity) {
+        ScreenRect marker;
+        bool isDiamond = false;
+        Drawable::Color color;
+        if (!unitMarker(entity, &marker, &isDiamond, &color)) {
+            return;
+        }
 
-        const std::vector<genie::Color> &colors = AssetManager::Inst()->getPalette(50500).getColors();
+        const int firstX = std::max(int(std::floor(marker.x)), 0);
+        const int firstY = std::max(int(std::floor(marker.y)), 0);
+        const int lastX = std::min(int(std::ceil(marker.x + marker.width)), m_imageWidth - 1);
+        const int lastY = std::min(int(std::ceil(marker.y + marker.height)), m_imageHeight - 1);
 
-        for (const Unit::Ptr &unit : m_unitManager->units()) {
-            const VisibilityMap::Visibility visibility = m_visibilityMap->visibilityAt(unit->position());
-            if (visibility == VisibilityMap::Unexplored) {
-                continue;
-            }
-            if (visibility == VisibilityMap::Explored && unit->playerId != UnitManager::GaiaID) {
-                continue;
-            }
+        const float halfWidth = marker.width / 2;
+        const float halfHeight = marker.height / 2;
+        const float centerX = marker.x + halfWidth;
+        const float centerY = marker.y + halfHeight;
 
-            const genie::Unit::MinimapModes mode = genie::Unit::MinimapModes(unit->data()->MinimapMode);
-            if (mode == genie::Unit::MinimapInvisible) {
-                continue;
+        for (int y = firstY; y <= lastY; y++) {
+            for (int x = firstX; x <= lastX; x++) {
+                const size_t pixel = size_t(y) * m_imageWidth + x;
+                if (m_pixelCells[pixel] != cell) {
+                    continue;
+                }
+
+                if (isDiamond) {
+                    const float distance = std::abs(x + 0.5f - centerX) / halfWidth + std::abs(y + 0.5f - centerY) / halfHeight;
+                    if (distance > 1.f) {
+                        continue;
+                    }
+                } else if (!marker.contains(x + 0.5f, y + 0.5f)) {
+                    continue;
+                }
+
+                m_unitPixels[pixel] = color;
             }
-            if (mode == genie::Unit::MinimapFlying) {
-                continue;
+        }
+    });
+}
+
+bool Minimap::refreshUnits()
+{
+    TIME_THIS;
+
+    // Hash what each cell would draw, and only redraw the ones that changed
+    std::vector<bool> changedCells(m_cellHashes.size(), false);
+    bool anyChanged = false;
+
+    for (int cellRow = 0; cellRow < m_cellRows; cellRow++) {
+        for (int cellCol = 0; cellCol < m_cellCols; cellCol++) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            const auto addToHash = [&hash](const uint64_t value) {
+                hash ^= value;
+                hash *= 0x100000001b3ULL;
+            };
+
+            m_map->forEachEntityBetween(cellCol * CellSize, cellRow * CellSize,
+                                        std::min((cellCol + 1) * CellSize, m_mapCols),
+                                        std::min((cellRow + 1) * CellSize, m_mapRows),
+                                        [&](const Entity &entity) {
+                ScreenRect marker;
+                bool isDiamond = false;
+                Drawable::Color color;
+                if (!unitMarker(entity, &marker, &isDiamond, &color)) {
+                    return;
+                }
+
+                addToHash(entity.id);
+                addToHash(uint64_t(int64_t(marker.x)) << 32 | uint32_t(int32_t(marker.y)));
+                addToHash(uint64_t(int64_t(marker.width)) << 32 | uint32_t(int32_t(marker.height)));
+                addToHash(uint64_t(color.r) << 24 | uint64_t(color.g) << 16 | uint64_t(color.b) << 8 | uint64_t(isDiamond));
+            });
+
+            const size_t cell = size_t(cellRow) * m_cellCols + cellCol;
+            if (m_cellHashes[cell] != hash) {
+                m_cellHashes[cell] = hash;
+                changedCells[cell] = true;
+                anyChanged = true;
             }
+        }
+    }
 
-            if (mode != genie::Unit::MinimapUnit && mode != genie::Unit::MinimapBuilding && mode != genie::Unit::MinimapLargeTerrain) {
-                DBG << "Unhandled minimap mode" << int(mode) << unit->data()->MinimapColor;
-                continue;
+    if (!anyChanged) {
+        return false;
+    }
+
+    for (int cellRow = 0; cellRow < m_cellRows; cellRow++) {
+        for (int cellCol = 0; cellCol < m_cellCols; cellCol++) {
+            bool neighborChanged = false;
+            for (int row = std::max(cellRow - 1, 0); row <= std::min(cellRow + 1, m_cellRows - 1) && !neighborChanged; row++) {
+                for (int col = std::max(cellCol - 1, 0); col <= std::min(cellCol + 1, m_cellCols - 1); col++) {
+                    if (changedCells[row * m_cellCols + col]) {
+                        neighborChanged = true;
+                        break;
+                    }
+                }
             }
 
-            const MapPos mapPos = unit->position();
-            ScreenPos pos = MapPos(mapPos.y / Constants::TILE_SIZE, mapPos.x / Constants::TILE_SIZE - 1).toScreen();
-            float size = std::max(unit->data()->OutlineSize.x * scaleX * 2, 2.f);
-            pos.x = pos.x * scaleX - size/2;
-            pos.y = pos.y * scaleY + center.y - size/2;
-
-            // WARN: according to genieutils this is the inverted of what the game officially does,
-            // but squares on the minimap look soooo ugly
-            if (mode == genie::Unit::MinimapBuilding) {
-                rectangleSprite.rect = ScreenRect(pos, Size(size, size));
-                rectangleSprite.fillColor = unitColor(unit);
-                m_unitsTexture->draw(rectangleSprite);
-            } else if (mode == genie::Unit::MinimapUnit) {
-                diamondSprite.fillColor = unitColor(unit);
-                diamondSprite.center = pos;
-                diamondSprite.radius = size;
-                m_unitsTexture->draw(diamondSprite);
-            } else if (mode == genie::Unit::MinimapLargeTerrain) {
-                rectangleSprite.rect = ScreenRect(pos, Size(size, size));
-                const genie::Color &color = colors[unit->data()->MinimapColor];
-                rectangleSprite.fillColor = Drawable::Color(color.r, color.g, color.b);
-                m_unitsTexture->draw(rectangleSprite);
+            if (neighborChanged) {
+                paintUnitCell(cellCol, cellRow);
             }
         }
-        m_unitsTexture->display();
-        m_unitsUpdated = false;
     }
 
     return true;
 }
 
+void Minimap::uploadPixels(const Drawable::Image::Ptr &image, const std::vector<Drawable::Color> &pixels, DirtyPixels *dirty)
+{
+    if (dirty->isEmpty() || !image) {
+        return;
+    }
+
+    static_assert(sizeof(Drawable::Color) == 4);
+
+    const int width = dirty->lastX - dirty->firstX + 1;
+    const int height = dirty->lastY - dirty->firstY + 1;
+
+    m_uploadBuffer.resize(size_t(width) * size_t(height) * 4);
+    for (int y = 0; y < height; y++) {
+        const Drawable::Color *source = &pixels[size_t(dirty->firstY + y) * m_imageWidth + dirty->firstX];
+        memcpy(&m_uploadBuffer[size_t(y) * width * 4], source, size_t(width) * 4);
+    }
+
+    m_renderTarget->updateImage(image, ScreenRect(dirty->firstX, dirty->firstY, width, height), m_uploadBuffer.data());
+    *dirty = DirtyPixels();
+}
+
+bool Minimap::update(Time time)
+{
+    if (IS_UNLIKELY(!m_visibilityMap)) {
+        WARN << "no visibility map set";
+        return false;
+    }
+
+    if (!m_map) {
+        return false;
+    }
+
+    if (m_lastCameraPos != m_renderTarget->camera()->m_target) {
+        updateCamera();
+        m_lastCameraPos = m_renderTarget->camera()->m_target;
+    }
+
+    const VisibilityMap::DirtyRect visibilityChanged = m_visibilityMap->takeDirtyRect(m_visibilityListener);
+
+    if (m_geometryDirty || m_map->columnCount() != m_mapCols || m_map->rowCount() != m_mapRows) {
+        DBG << "redrawing terrain";
+        updateGeometry();
+        m_terrainUpdated = false;
+        m_unitsUpdated = true;
+        m_lastUnitsRefresh = 0;
+    }
+
+    bool updated = false;
+
+    if (m_terrainUpdated) {
+        paintChangedTerrainRegions();
+        m_terrainUpdated = false;
+
+        // Something changed the size of the map
+        if (m_geometryDirty) {
+            return true;
+        }
+    }
+
+    // Only redraw the tiles that were revealed or hidden
+    if (!visibilityChanged.isEmpty()) {
+        paintTerrainTiles(visibilityChanged.firstCol, visibilityChanged.firstRow, visibilityChanged.lastCol, visibilityChanged.lastRow);
+        m_unitsUpdated = true;
+    }
+
+    if (!m_terrainDirty.isEmpty()) {
+        uploadPixels(m_terrainImage, m_terrainPixels, &m_terrainDirty);
+        updated = true;
+    }
+
+    if (m_unitsUpdated && m_unitManager && time - m_lastUnitsRefresh >= UnitsRefreshInterval) {
+        m_lastUnitsRefresh = time;
+        m_unitsUpdated = false;
+
+        if (refreshUnits()) {
+            uploadPixels(m_unitsImage, m_unitPixels, &m_unitsDirty);
+            updated = true;
+        }
+    }
+
+    return updated;
+}
+
 void Minimap::draw()
 {
-    m_renderTarget->draw(m_terrainTexture, m_rect.topLeft());
-    m_renderTarget->draw(m_unitsTexture, m_rect.topLeft());
+    if (m_terrainImage) {
+        m_renderTarget->draw(m_terrainImage, m_rect.topLeft());
+    }
+    if (m_unitsImage) {
+        m_renderTarget->draw(m_unitsImage, m_rect.topLeft());
+    }
 
     if (m_rect.isEmpty()) {
         return;
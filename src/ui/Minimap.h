@@ -1,7 +1,10 @@
 #ifndef MINIMAP_H
 #define MINIMAP_H
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "core/Types.h"
 #include "mechanics/IState.h"
@@ -9,6 +12,7 @@
 
 class Map;
 class UnitManager;
+struct Entity;
 namespace sf {
 class Event;
 }  // namespace sf
@@ -26,6 +30,7 @@ public:
     };
 
     Minimap(const IRenderTargetPtr &renderTarget);
+    ~Minimap();
 
     void setMap(const std::shared_ptr<Map> &map);
     void setUnitManager(const std::shared_ptr<UnitManager> &unitManager);
@@ -39,10 +44,49 @@ public:
     ScreenRect rect() const { return m_rect; }
 
 private:
+    /// Redraw the units at most this often
+    static constexpr Time UnitsRefreshInterval = 100;
+
+    /// The units are redrawn in square cells of tiles
+    static constexpr int CellSize = 16;
+
+    /// Bounding box of the pixels we have changed, so we only upload those
+    struct DirtyPixels {
+        int firstX = 0;
+        int firstY = 0;
+        int lastX = -1;
+        int lastY = -1;
+
+        bool isEmpty() const noexcept { return lastX < firstX || lastY < firstY; }
+
+        void add(const int x, const int y) noexcept {
+            if (isEmpty()) {
+                firstX = lastX = x;
+                firstY = lastY = y;
+                return;
+            }
+            firstX = std::min(firstX, x);
+            firstY = std::min(firstY, y);
+            lastX = std::max(lastX, x);
+            lastY = std::max(lastY, y);
+        }
+    };
+
     void updateUnits();
     void updateTerrain();
     void updateCamera();
-    Drawable::Color unitColor(const std::shared_ptr<Unit> &unit);
+
+    void updateGeometry();
+    void paintTerrainTiles(const int firstCol, const int firstRow, const int lastCol, const int lastRow);
+    void paintChangedTerrainRegions();
+
+    bool refreshUnits();
+    void paintUnitCell(const int cellCol, const int cellRow);
+    bool unitMarker(const Entity &entity, ScreenRect *marker, bool *isDiamond, Drawable::Color *color);
+
+    void uploadPixels(const Drawable::Image::Ptr &image, const std::vector<Drawable::Color> &pixels, DirtyPixels *dirty);
+
+    Drawable::Color unitColor(const Unit &unit);
 
     bool m_unitsUpdated = false;
     bool m_terrainUpdated = false;
@@ -50,12 +94,46 @@ private:
     std::shared_ptr<UnitManager> m_unitManager;
     IRenderTargetPtr m_renderTarget;
     ScreenRect m_rect;
-    IRenderTargetPtr m_terrainTexture;
-    IRenderTargetPtr m_unitsTexture;
     MapPos m_lastCameraPos;
     ScreenRect m_cameraRect;
     bool m_mousePressed = false;
     std::shared_ptr<VisibilityMap> m_visibilityMap;
+    size_t m_visibilityListener = 0;
+
+    /// Set when the map or the size changes, and everything needs to be set up again
+    bool m_geometryDirty = true;
+    int m_imageWidth = 0;
+    int m_imageHeight = 0;
+    int m_mapCols = 0;
+    int m_mapRows = 0;
+    int m_cellCols = 0;
+    int m_cellRows = 0;
+    float m_scaleX = 1.f;
+    float m_scaleY = 1.f;
+
+    /// Index of the tile each pixel shows, -1 if outside the map
+    std::vector<int32_t> m_pixelTiles;
+    /// Same for the cells, but the pixels outside the map go to the closest one
+    std::vector<uint32_t> m_pixelCells;
+
+    /// The pixels covered by each tile and by each cell
+    std::vector<uint32_t> m_tilePixelOffsets;
+    std::vector<uint32_t> m_tilePixels;
+    std::vector<uint32_t> m_cellPixelOffsets;
+    std::vector<uint32_t> m_cellPixels;
+
+    std::vector<Drawable::Color> m_terrainPixels;
+    Drawable::Image::Ptr m_terrainImage;
+    DirtyPixels m_terrainDirty;
+    std::vector<uint32_t> m_terrainRegionGenerations;
+
+    std::vector<Drawable::Color> m_unitPixels;
+    Drawable::Image::Ptr m_unitsImage;
+    DirtyPixels m_unitsDirty;
+    std::vector<uint64_t> m_cellHashes;
+    Time m_lastUnitsRefresh = 0;
+
+    std::vector<uint8_t> m_uploadBuffer;
 
     MinimapMode m_mode = MinimapMode::Diplomatic; // easiest, so sue me
 };
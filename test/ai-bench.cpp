@@ -0,0 +1,270 @@
+#include <genie/dat/ResourceType.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ai/AiRule.h"
+#include "ai/AiScript.h"
+#include "ai/ScriptLoader.h"
+#include "ai/conditions/Conditions.h"
+#include "core/Logger.h"
+#include "global/EventManager.h"
+#include "mechanics/Player.h"
+#include "resource/DataManager.h"
+
+// Loads a real .per script and feeds it random resource, goal and trading
+// price changes. First the old way, where every rule checks all of its
+// conditions again each time one of them signals, then through the compiled
+// rule network that checks each changed condition once per tick.
+
+namespace {
+
+struct Scenario {
+    uint64_t ticks = 1000;
+    int changesPerTick = 20;
+    uint64_t seed = 0;
+};
+
+struct Result {
+    size_t evaluations = 0;
+    size_t firings = 0;
+    double microsecondsPerTick = 0.;
+};
+
+/// Counts how often the conditions are checked, without changing them
+struct CountingRule {
+    std::shared_ptr<ai::AiRule> rule;
+    size_t *evaluations = nullptr;
+    size_t *firings = nullptr;
+
+    /// What AiRule::onConditionSatisfied() used to do
+    void onConditionSatisfied()
+    {
+        for (const std::shared_ptr<ai::Condition> &condition : rule->conditions()) {
+            (*evaluations)++;
+            if (!condition->satisfied(rule.get())) {
+                return;
+            }
+        }
+        (*firings)++;
+    }
+};
+
+class ChangeGenerator
+{
+public:
+    ChangeGenerator(const uint64_t seed, Player *player, ai::AiScript *script) :
+        m_random(seed),
+        m_player(player),
+        m_script(script)
+    {
+    }
+
+    void apply()
+    {
+        static const genie::ResourceType resources[] = {
+            genie::ResourceType::FoodStorage,
+            genie::ResourceType::WoodStorage,
+            genie::ResourceType::StoneStorage,
+            genie::ResourceType::GoldStorage,
+            genie::ResourceType::PopulationHeadroom,
+            genie::ResourceType::CurrentPopulation,
+        };
+        static const genie::ResourceType commodities[] = {
+            genie::ResourceType::FoodStorage,
+            genie::ResourceType::WoodStorage,
+            genie::ResourceType::StoneStorage,
+        };
+
+        switch (m_random() % 8) {
+        case 0:
+            m_script->setGoal(1 + m_random() % 40, m_random() % 4);
+            break;
+        case 1:
+            EventManager::tradingPriceChanged(commodities[m_random() % 3], 50 + m_random() % 100);
+            break;
+        default: {
+            const genie::ResourceType type = resources[m_random() % 6];
+            const float current = m_player->resourcesAvailable(type);
+            m_player->setAvailableResource(type, std::max(current + float(int(m_random() % 200) - 90), 0.f));
+            break;
+        }
+        }
+    }
+
+private:
+    std::mt19937_64 m_random;
+    Player *m_player;
+    ai::AiScript *m_script;
+};
+
+void resetPlayer(Player *player)
+{
+    for (const genie::ResourceType type : {genie::ResourceType::FoodStorage, genie::ResourceType::WoodStorage, genie::ResourceType::StoneStorage, genie::ResourceType::GoldStorage}) {
+        player->setAvailableResource(type, 200);
+    }
+    player->setAvailableResource(genie::ResourceType::PopulationHeadroom, 5);
+    player->setAvailableResource(genie::ResourceType::CurrentPopulation, 3);
+}
+
+/// How AiRule did it before
+Result runPerRule(const Scenario &scenario, Player *player, ai::AiScript *script)
+{
+    resetPlayer(player);
+
+    Result result;
+
+    std::vector<std::unique_ptr<CountingRule>> rules;
+    for (const std::shared_ptr<ai::AiRule> &rule : script->rules) {
+        rules.push_back(std::make_unique<CountingRule>());
+        rules.back()->rule = rule;
+        rules.back()->evaluations = &result.evaluations;
+        rules.back()->firings = &result.firings;
+
+        for (const std::shared_ptr<ai::Condition> &condition : rule->conditions()) {
+            condition->connect(ai::Condition::SatisfiedChanged, rules.back().get(), &CountingRule::onConditionSatisfied);
+        }
+    }
+
+    ChangeGenerator changes(scenario.seed, player, script);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t tick = 0; tick < scenario.ticks; tick++) {
+        for (int i=0; i<scenario.changesPerTick; i++) {
+            changes.apply();
+        }
+    }
+    result.microsecondsPerTick = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / scenario.ticks;
+
+    for (const std::unique_ptr<CountingRule> &rule : rules) {
+        for (const std::shared_ptr<ai::Condition> &condition : rule->rule->conditions()) {
+            condition->disconnect(rule.get());
+        }
+    }
+
+    return result;
+}
+
+/// How AiScript does it now
+Result runNetwork(const Scenario &scenario, Player *player, ai::AiScript *script)
+{
+    resetPlayer(player);
+
+    // Start from a clean slate, with everything checked once
+    script->compile();
+    script->update();
+
+    const size_t evaluationsBefore = script->ruleNetwork().stats().evaluations;
+    const size_t firingsBefore = script->ruleNetwork().stats().firings;
+
+    ChangeGenerator changes(scenario.seed, player, script);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t tick = 0; tick < scenario.ticks; tick++) {
+        for (int i=0; i<scenario.changesPerTick; i++) {
+            changes.apply();
+        }
+        script->update();
+    }
+
+    Result result;
+    result.microsecondsPerTick = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / scenario.ticks;
+    result.evaluations = script->ruleNetwork().stats().evaluations - evaluationsBefore;
+    result.firings = script->ruleNetwork().stats().firings - firingsBefore;
+    return result;
+}
+
+void printResult(const char *name, const Result &result, const Scenario &scenario)
+{
+    printf("  %-10s %12.1f checks/tick %10.1f fired/tick %10.2f us/tick\n", name,
+           double(result.evaluations) / scenario.ticks,
+           double(result.firings) / scenario.ticks,
+           result.microsecondsPerTick);
+}
+
+void printUsage(const char *name)
+{
+    WARN << "Usage:" << name << "<game path> <script.per> [--ticks N] [--changes N] [--seed N]";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)  {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string gamePath = argv[1];
+    const std::string scriptPath = argv[2];
+    Scenario scenario;
+
+    for (int i=3; i<argc; i++) {
+        const std::string argument = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        const std::string value = argv[++i];
+        if (argument == "--ticks") {
+            scenario.ticks = std::max<uint64_t>(std::stoull(value), 1);
+        } else if (argument == "--changes") {
+            scenario.changesPerTick = std::max(std::stoi(value), 1);
+        } else if (argument == "--seed") {
+            scenario.seed = std::stoull(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::string dataPath = gamePath + "/Data/";
+    if (!std::filesystem::exists(dataPath)) {
+        WARN << "Data path does not exist";
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(dataPath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+
+    std::shared_ptr<Player> player = std::make_shared<Player>(1, 1);
+    ai::AiScript script(player.get());
+
+    std::ifstream in(scriptPath);
+    if (!in.good()) {
+        WARN << "Failed to open" << scriptPath;
+        return 1;
+    }
+
+    ai::ScriptLoader loader(&script, player->playerId);
+    if (loader.parse(in, std::cout) != 0) {
+        WARN << "Failed to parse" << scriptPath;
+        return 1;
+    }
+
+    const ai::RuleNetwork::Stats &stats = script.ruleNetwork().stats();
+    printf("%zu rules, %zu conditions, %zu distinct\n", stats.rules, stats.conditionReferences, stats.conditions);
+    printf("%llu ticks, %d changes per tick\n", (unsigned long long)scenario.ticks, scenario.changesPerTick);
+
+    // The rule network is still connected during this one, that only costs
+    // it a flag check per signal
+    const Result perRule = runPerRule(scenario, player.get(), &script);
+    printResult("per rule", perRule, scenario);
+
+    const Result network = runNetwork(scenario, player.get(), &script);
+    printResult("network", network, scenario);
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>
 
+#include "core/CacheManager.h"
 #include "core/Logger.h"
 #include "mechanics/Map.h"
 #include "mechanics/MapTile.h"
@@ -28,6 +29,10 @@ void testLoadTiles()
     map.create(scenarioFile->map);
     map.updateMapData();
 
+    DBG << "Timing how long it takes to generate the pixels for all tiles on all cores";
+
+    TerrainSprite::prerenderTiles(map, nullptr);
+
     DBG << "Timing how long it takes to generate textures for all tiles";
 
     {
@@ -40,7 +45,7 @@ void testLoadTiles()
             }
         }
     }
-    DBG << "Cache size/rendered tiles" << AssetManager::Inst()->terrainCacheSize();
+    DBG << "Cache size/rendered tiles" << CacheManager::Inst().stats(CacheManager::CacheType::TerrainTiles).entries;
 
     DBG << "Timing fetching from cache (less than 10ms isn't printed)";
 
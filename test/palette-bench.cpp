@@ -0,0 +1,257 @@
+#include <genie/dat/Graphic.h>
+#include <genie/resource/Color.h>
+#include <genie/resource/PalFile.h>
+#include <genie/resource/SlpFile.h>
+#include <genie/resource/SlpFrame.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "core/Logger.h"
+#include "resource/AssetManager.h"
+#include "resource/DataManager.h"
+#include "resource/PaletteConversion.h"
+
+// Converts all the 8 bit frames of all the graphics in graphics.drs, with the
+// old per-pixel loops and with the different versions in PaletteConversion,
+// and checks that they produce the same pixels.
+
+namespace {
+
+struct Frame {
+    int width = 0;
+    int height = 0;
+    const std::vector<uint8_t> *indices = nullptr;
+    const std::vector<uint8_t> *alpha = nullptr;
+};
+
+enum class Variant {
+    Base,
+    Construction,
+    ConstructionUnavailable,
+    InTheShadows,
+    VariantCount
+};
+
+const char *variantName(const Variant variant)
+{
+    switch(variant) {
+    case Variant::Base:
+        return "base";
+    case Variant::Construction:
+        return "construction";
+    case Variant::ConstructionUnavailable:
+        return "unavailable";
+    case Variant::InTheShadows:
+        return "in the shadows";
+    default:
+        return "invalid";
+    }
+}
+
+/// How it was done before, pixel by pixel
+void convertReference(const Frame &frame, const std::vector<genie::Color> &colors, const Variant variant, uint8_t *pixels)
+{
+    for (int row = 0; row < frame.height; row++) {
+        for (int col = 0; col < frame.width; col++) {
+            const size_t index = size_t(row) * frame.width + col;
+            const genie::Color &color = colors[(*frame.indices)[index]];
+            const uint8_t alpha = (*frame.alpha)[index];
+            uint8_t *pixel = pixels + index * 4;
+
+            const bool odd = (row + col) % 2 == 1;
+            switch(variant) {
+            case Variant::Base:
+                pixel[0] = color.r; pixel[1] = color.g; pixel[2] = color.b; pixel[3] = alpha;
+                break;
+            case Variant::Construction:
+                if (odd) {
+                    pixel[0] = color.r; pixel[1] = color.g; pixel[2] = color.b; pixel[3] = alpha;
+                } else {
+                    pixel[0] = color.r/2; pixel[1] = color.g/2; pixel[2] = color.b/2; pixel[3] = alpha/2;
+                }
+                break;
+            case Variant::ConstructionUnavailable:
+                if (odd) {
+                    pixel[0] = color.r; pixel[1] = color.g; pixel[2] = color.b; pixel[3] = alpha;
+                } else {
+                    pixel[0] = 255; pixel[1] = 0; pixel[2] = 0; pixel[3] = alpha/2;
+                }
+                break;
+            case Variant::InTheShadows:
+                pixel[0] = color.r / 2; pixel[1] = color.g / 2; pixel[2] = color.b / 2; pixel[3] = alpha;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+void convertKernel(const Frame &frame, const palette::Lut &lut, const palette::Lut &halfLut, const palette::Lut &redLut, const Variant variant, uint32_t *pixels)
+{
+    switch(variant) {
+    case Variant::Base:
+        palette::toRgba(frame.indices->data(), frame.alpha->data(), lut, pixels, size_t(frame.width) * frame.height);
+        break;
+    case Variant::Construction:
+        palette::toRgbaCheckerboard(frame.indices->data(), frame.alpha->data(), lut, halfLut, pixels, frame.width, frame.height);
+        break;
+    case Variant::ConstructionUnavailable:
+        palette::toRgbaCheckerboard(frame.indices->data(), frame.alpha->data(), lut, redLut, pixels, frame.width, frame.height);
+        break;
+    case Variant::InTheShadows:
+        palette::toRgba(frame.indices->data(), frame.alpha->data(), halfLut, pixels, size_t(frame.width) * frame.height);
+        break;
+    default:
+        break;
+    }
+}
+
+double millisecondsSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)  {
+        WARN << "Usage:" << argv[0] << "<game path> [iterations]";
+        return 1;
+    }
+
+    const std::string dataPath = std::string(argv[1]) + "/Data/";
+    const int iterations = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 5;
+
+    if (!std::filesystem::exists(dataPath)) {
+        WARN << "Data path does not exist";
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(dataPath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+
+    AssetManager::create(DataManager::Inst().isHd());
+    if (!AssetManager::Inst()->initialize(dataPath, DataManager::Inst().gameVersion())) {
+        WARN << "Failed to load game assets";
+        return 1;
+    }
+
+    std::set<int> slpIds;
+    for (const genie::Graphic &graphic : DataManager::Inst().allGraphics()) {
+        if (graphic.SLP >= 0) {
+            slpIds.insert(graphic.SLP);
+        }
+    }
+
+    // Keep the files alive, the frames point into them
+    std::vector<genie::SlpFilePtr> slps;
+    std::vector<Frame> frames;
+    size_t pixelCount = 0;
+    size_t largestFrame = 0;
+    for (const int id : slpIds) {
+        genie::SlpFilePtr slp = AssetManager::Inst()->getSlp(id, AssetManager::ResourceType::Graphics);
+        if (!slp) {
+            continue;
+        }
+        slps.push_back(slp);
+
+        for (uint32_t i=0; i<slp->getFrameCount(); i++) {
+            const genie::SlpFramePtr &slpFrame = slp->getFrame(i);
+            if (!slpFrame || slpFrame->is32bit()) {
+                continue;
+            }
+
+            Frame frame;
+            frame.width = slpFrame->getWidth();
+            frame.height = slpFrame->getHeight();
+            frame.indices = &slpFrame->img_data.pixel_indexes;
+            frame.alpha = &slpFrame->img_data.alpha_channel;
+
+            const size_t area = size_t(frame.width) * frame.height;
+            if (area == 0 || frame.indices->size() < area || frame.alpha->size() < area) {
+                continue;
+            }
+
+            frames.push_back(frame);
+            pixelCount += area;
+            largestFrame = std::max(largestFrame, area);
+        }
+    }
+
+    printf("%zu SLPs, %zu frames, %.1f megapixels\n", slps.size(), frames.size(), pixelCount / 1000000.);
+    if (frames.empty()) {
+        return 1;
+    }
+
+    std::vector<genie::Color> colors = AssetManager::Inst()->getPalette(50500).colors_;
+    colors.resize(256); // the old code assumed there were enough
+
+    const palette::Lut lut = palette::makeLut(colors);
+    const palette::Lut halfLut = palette::halfBrightness(lut);
+    const palette::Lut redLut = palette::solidColor(255, 0, 0);
+
+    std::vector<uint8_t> referencePixels(largestFrame * 4);
+    std::vector<uint32_t> kernelPixels(largestFrame);
+
+    const palette::Kernel supported = palette::kernel();
+    bool allMatch = true;
+
+    for (int variantNum = 0; variantNum < int(Variant::VariantCount); variantNum++) {
+        const Variant variant = Variant(variantNum);
+        printf("%s:\n", variantName(variant));
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i=0; i<iterations; i++) {
+            for (const Frame &frame : frames) {
+                convertReference(frame, colors, variant, referencePixels.data());
+            }
+        }
+        const double referenceTime = millisecondsSince(start) / iterations;
+        printf("  %-10s %8.2f ms\n", "reference", referenceTime);
+
+        for (int kernelNum = 0; kernelNum <= int(supported); kernelNum++) {
+            const palette::Kernel kernel = palette::Kernel(kernelNum);
+            palette::setKernel(kernel);
+
+            size_t mismatches = 0;
+            for (const Frame &frame : frames) {
+                convertReference(frame, colors, variant, referencePixels.data());
+                convertKernel(frame, lut, halfLut, redLut, variant, kernelPixels.data());
+                if (memcmp(referencePixels.data(), kernelPixels.data(), size_t(frame.width) * frame.height * 4) != 0) {
+                    mismatches++;
+                }
+            }
+
+            start = std::chrono::steady_clock::now();
+            for (int i=0; i<iterations; i++) {
+                for (const Frame &frame : frames) {
+                    convertKernel(frame, lut, halfLut, redLut, variant, kernelPixels.data());
+                }
+            }
+            const double kernelTime = millisecondsSince(start) / iterations;
+
+            printf("  %-10s %8.2f ms %6.2fx", palette::kernelName(kernel), kernelTime, referenceTime / kernelTime);
+            if (mismatches > 0) {
+                printf("  %zu frames DIFFER", mismatches);
+                allMatch = false;
+            }
+            printf("\n");
+        }
+    }
+
+    palette::setKernel(supported);
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "actions/ActionAttack.h"
+#include "actions/ActionMove.h"
+#include "core/ObjectPool.h"
+#include "mechanics/Entity.h"
+#include "mechanics/Missile.h"
+#include "render/GraphicRender.h"
+
+// Simulates the churn of a big archery fight: every archer fires a volley
+// every few ticks, which means a new attack and move action, an arrow that
+// flies for a while and leaves a smoke trail behind it. Done once the old
+// way (make_shared into unordered_sets) and once with the pools and vectors
+// UnitManager uses now, counting the heap allocations per tick.
+//
+// The real objects need game data, so these only have the same size and
+// alignment as them. They do make the same allocations the real constructors
+// do though (renderer, debug name, attacks, path), the pools only get rid of
+// the ones for the objects themselves. What the pathfinder allocates while
+// looking for the path isn't counted.
+
+static size_t s_allocations = 0;
+
+void *operator new(size_t size)
+{
+    s_allocations++;
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    s_allocations++;
+    const size_t align = std::max(size_t(alignment), sizeof(void*));
+    void *pointer = aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept { free(pointer); }
+
+namespace {
+
+template<typename T>
+struct SizedLike {
+    alignas(T) unsigned char storage[sizeof(T)];
+};
+
+size_t s_entityCount = 0;
+
+/// What the Entity constructor allocates
+struct FakeEntity {
+    FakeEntity(const std::string &name, const int ticks) :
+        debugName(name + " #" + std::to_string(s_entityCount++)),
+        renderer(std::make_unique<SizedLike<GraphicRender>>()),
+        ticksLeft(ticks)
+    {}
+
+    const std::string debugName;
+    std::unique_ptr<SizedLike<GraphicRender>> renderer;
+    int ticksLeft = 0;
+};
+
+/// Copies the attacks of the unit firing it
+struct FakeMissile : FakeEntity, SizedLike<Missile> {
+    FakeMissile(const std::vector<genie::unit::AttackOrArmor> &sourceAttacks, const int ticks) :
+        FakeEntity("Arrow (363)", ticks),
+        attacks(sourceAttacks)
+    {}
+
+    std::vector<genie::unit::AttackOrArmor> attacks;
+};
+
+struct FakeDecayingEntity : FakeEntity, SizedLike<DecayingEntity> {
+    explicit FakeDecayingEntity(const int ticks) :
+        FakeEntity("Eye Candy Things", ticks)
+    {}
+};
+
+struct FakeActionAttack : SizedLike<ActionAttack> {
+};
+
+/// Gets the path the pathfinder found moved in
+struct FakeActionMove : SizedLike<ActionMove> {
+    explicit FakeActionMove(std::vector<MapPos> &&foundPath) :
+        path(std::move(foundPath))
+    {}
+
+    std::vector<MapPos> path;
+};
+
+/// A short walk to get in range
+std::vector<MapPos> findPath()
+{
+    return std::vector<MapPos>(4);
+}
+
+struct Scenario {
+    int archers = 200;
+    int ticks = 2000;
+    int volleyInterval = 20;
+    int arrowFlightTicks = 15;
+    int trailInterval = 3;
+    int trailLifetime = 10;
+
+    /// Melee, pierce and the bonus against spearmen
+    std::vector<genie::unit::AttackOrArmor> archerAttacks = std::vector<genie::unit::AttackOrArmor>(3);
+};
+
+struct Result {
+    double allocationsPerTick = 0.;
+    double microsecondsPerTick = 0.;
+};
+
+/// How UnitManager did it before
+Result runShared(const Scenario &scenario)
+{
+    std::unordered_set<std::shared_ptr<FakeMissile>> missiles;
+    std::unordered_set<std::shared_ptr<FakeDecayingEntity>> decayingEntities;
+    std::vector<std::shared_ptr<FakeActionAttack>> attackActions(scenario.archers);
+    std::vector<std::shared_ptr<FakeActionMove>> moveActions(scenario.archers);
+
+    const size_t allocationsBefore = s_allocations;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int tick = 0; tick < scenario.ticks; tick++) {
+        if (tick % scenario.volleyInterval == 0) {
+            for (int i=0; i<scenario.archers; i++) {
+                attackActions[i] = std::make_shared<FakeActionAttack>();
+                moveActions[i] = std::make_shared<FakeActionMove>(findPath());
+                missiles.insert(std::make_shared<FakeMissile>(scenario.archerAttacks, scenario.arrowFlightTicks));
+            }
+        }
+
+        std::unordered_set<std::shared_ptr<FakeMissile>>::iterator missileIterator = missiles.begin();
+        while (missileIterator != missiles.end()) {
+            FakeMissile &missile = **missileIterator;
+            if (missile.ticksLeft % scenario.trailInterval == 0) {
+                decayingEntities.insert(std::make_shared<FakeDecayingEntity>(scenario.trailLifetime));
+            }
+            if (--missile.ticksLeft <= 0) {
+                missileIterator = missiles.erase(missileIterator);
+            } else {
+                missileIterator++;
+            }
+        }
+
+        std::unordered_set<std::shared_ptr<FakeDecayingEntity>>::iterator entityIterator = decayingEntities.begin();
+        while (entityIterator != decayingEntities.end()) {
+            if (--(*entityIterator)->ticksLeft <= 0) {
+                entityIterator = decayingEntities.erase(entityIterator);
+            } else {
+                entityIterator++;
+            }
+        }
+    }
+
+    Result result;
+    result.microsecondsPerTick = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / scenario.ticks;
+    result.allocationsPerTick = double(s_allocations - allocationsBefore) / scenario.ticks;
+    return result;
+}
+
+/// How UnitManager does it now
+Result runPooled(const Scenario &scenario)
+{
+    std::vector<std::shared_ptr<FakeMissile>> missiles;
+    std::vector<std::shared_ptr<FakeDecayingEntity>> decayingEntities;
+    std::vector<std::shared_ptr<FakeActionAttack>> attackActions(scenario.archers);
+    std::vector<std::shared_ptr<FakeActionMove>> moveActions(scenario.archers);
+
+    const size_t allocationsBefore = s_allocations;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int tick = 0; tick < scenario.ticks; tick++) {
+        if (tick % scenario.volleyInterval == 0) {
+            for (int i=0; i<scenario.archers; i++) {
+                attackActions[i] = makePooled<FakeActionAttack>();
+                moveActions[i] = makePooled<FakeActionMove>(findPath());
+                missiles.push_back(makePooled<FakeMissile>(scenario.archerAttacks, scenario.arrowFlightTicks));
+            }
+        }
+
+        for (size_t i=0; i<missiles.size();) {
+            FakeMissile &missile = *missiles[i];
+            if (missile.ticksLeft % scenario.trailInterval == 0) {
+                decayingEntities.push_back(makePooled<FakeDecayingEntity>(scenario.trailLifetime));
+            }
+            if (--missile.ticksLeft <= 0) {
+                if (i + 1 < missiles.size()) {
+                    missiles[i] = std::move(missiles.back());
+                }
+                missiles.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        for (size_t i=0; i<decayingEntities.size();) {
+            if (--decayingEntities[i]->ticksLeft <= 0) {
+                if (i + 1 < decayingEntities.size()) {
+                    decayingEntities[i] = std::move(decayingEntities.back());
+                }
+                decayingEntities.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    Result result;
+    result.microsecondsPerTick = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / scenario.ticks;
+    result.allocationsPerTick = double(s_allocations - allocationsBefore) / scenario.ticks;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Scenario scenario;
+    if (argc > 1) {
+        scenario.archers = std::max(std::stoi(argv[1]), 1);
+    }
+    if (argc > 2) {
+        scenario.ticks = std::max(std::stoi(argv[2]), 1);
+    }
+
+    printf("%d archers, %d ticks\n", scenario.archers, scenario.ticks);
+    printf("object sizes: missile %zu, decaying entity %zu, attack %zu, move %zu bytes\n",
+           sizeof(Missile), sizeof(DecayingEntity), sizeof(ActionAttack), sizeof(ActionMove));
+
+    const Result shared = runShared(scenario);
+    printf("  %-8s %10.1f allocations/tick %10.2f us/tick\n", "shared", shared.allocationsPerTick, shared.microsecondsPerTick);
+
+    const Result pooled = runPooled(scenario);
+    printf("  %-8s %10.1f allocations/tick %10.2f us/tick\n", "pooled", pooled.allocationsPerTick, pooled.microsecondsPerTick);
+
+    // What is left, the pools can't do anything about these
+    size_t allocationsBefore = s_allocations;
+    { FakeMissile missile(scenario.archerAttacks, 0); }
+    const size_t missileAllocations = s_allocations - allocationsBefore;
+    allocationsBefore = s_allocations;
+    { FakeDecayingEntity entity(0); }
+    const size_t decayingAllocations = s_allocations - allocationsBefore;
+    allocationsBefore = s_allocations;
+    { FakeActionMove move(findPath()); }
+    const size_t moveAllocations = s_allocations - allocationsBefore;
+    printf("allocated by constructors: missile %zu, decaying entity %zu, move %zu\n", missileAllocations, decayingAllocations, moveAllocations);
+
+    const SlabPool::Stats stats = SlabPool::totalStats();
+    printf("pools: %zu allocations from %zu slabs, peak %zu blocks\n", stats.allocations, stats.slabAllocations, stats.peakBlocks);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <genie/script/ScnFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+#include "core/Logger.h"
+#include "core/Utility.h"
+#include "debug/SampleGameFactory.h"
+#include "mechanics/GameState.h"
+#include "mechanics/UnitManager.h"
+#include "resource/AssetManager.h"
+#include "resource/DataManager.h"
+#include "resource/LanguageManager.h"
+
+// Runs the simulation without any window, as fast as possible.
+
+static void printUsage(const char *name)
+{
+    WARN << "Usage:" << name << "<game path> [--ticks N] [--seed N] [--scenario file.scn|file.cpx] [--sample basic|all]";
+}
+
+static long peakMemoryKb()
+{
+#ifdef __unix__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return -1;
+}
+
+static genie::ScnFilePtr loadScenario(const std::string &path)
+{
+    try {
+        const std::string extension = util::toLowercase(std::filesystem::path(path).extension().string());
+        if (extension == ".cpx" || extension == ".cpn") {
+            genie::CpxFile cpxFile;
+            cpxFile.setFileName(path);
+            cpxFile.load();
+            return cpxFile.getScnFile(0);
+        }
+
+        genie::ScnFilePtr scenario = std::make_shared<genie::ScnFile>();
+        scenario->load(path);
+        return scenario;
+    } catch (const std::exception &error) {
+        WARN << "Failed to load" << path << ":" << error.what();
+    }
+
+    return nullptr;
+}
+
+static void printTime(const char *name, const int64_t microseconds, const uint64_t ticks)
+{
+    printf("  %-18s %10.1f ms total %8.3f ms/tick\n", name, microseconds / 1000., microseconds / 1000. / ticks);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)  {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string gamePath = argv[1];
+    uint64_t tickCount = 1000;
+    uint64_t seed = 0;
+    std::string scenarioPath;
+
+    for (int i=2; i<argc; i++) {
+        const std::string argument = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        const std::string value = argv[++i];
+        if (argument == "--ticks") {
+            tickCount = std::stoull(value);
+        } else if (argument == "--seed") {
+            seed = std::stoull(value);
+        } else if (argument == "--scenario") {
+            scenarioPath = value;
+        } else if (argument == "--sample") {
+            SampleGameFactory::Inst().setSampleFromAlias(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::string dataPath = gamePath + "/Data/";
+    if (!std::filesystem::exists(dataPath)) {
+        WARN << "Data path does not exist";
+        return 1;
+    }
+
+    if (!LanguageManager::Inst()->initialize(gamePath)) {
+        WARN << "Failed to load language.dll";
+        return 1;
+    }
+
+    if (!DataManager::Inst().initialize(dataPath)) {
+        WARN << "Failed to load game data";
+        return 1;
+    }
+
+    AssetManager::create(DataManager::Inst().isHd());
+    if (!AssetManager::Inst()->initialize(dataPath, DataManager::Inst().gameVersion())) {
+        WARN << "Failed to load game assets";
+        return 1;
+    }
+
+    // No render target, so no window or GPU needed
+    std::shared_ptr<GameState> gameState = std::make_shared<GameState>(nullptr);
+    gameState->setRandomSeed(seed);
+
+    if (!scenarioPath.empty()) {
+        genie::ScnFilePtr scenario = loadScenario(scenarioPath);
+        if (!scenario) {
+            return 1;
+        }
+        gameState->setScenario(scenario);
+    }
+
+    const std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+    if (!gameState->init()) {
+        WARN << "Failed to set up game";
+        return 1;
+    }
+    const std::chrono::steady_clock::duration loadTime = std::chrono::steady_clock::now() - loadStart;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i=0; i<tickCount; i++) {
+        gameState->tick();
+
+        if (gameState->result != GameState::Result::Running) {
+            DBG << "Game ended after" << gameState->tickCount() << "ticks";
+            break;
+        }
+    }
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+    const uint64_t ticksRun = std::max<uint64_t>(gameState->tickCount(), 1);
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+
+    printf("setup:        %.1f ms\n", std::chrono::duration<double, std::milli>(loadTime).count());
+    printf("units:        %zu\n", gameState->unitManager()->units().size());
+    printf("ticks:        %llu (%.1f s of game time)\n", (unsigned long long)ticksRun, gameState->simulationTime() / 1000.);
+    printf("elapsed:      %.3f s\n", seconds);
+    printf("ticks/sec:    %.1f (%.1fx real time)\n", ticksRun / seconds, (ticksRun / seconds) / (1000. / GameState::TickLength));
+    printf("state hash:   %016llx\n", (unsigned long long)gameState->stateHash());
+
+    const UnitManager::UpdateTimings &timings = gameState->unitManager()->updateTimings();
+    printf("subsystems:\n");
+    printTime("pathfinding", timings.pathfinding, ticksRun);
+    printTime("auto targeting", timings.autoTargeting, ticksRun);
+    printTime("missiles", timings.missiles, ticksRun);
+    printTime("decaying entities", timings.decayingEntities, ticksRun);
+    printTime("cleanup", timings.cleanup, ticksRun);
+    printTime("units", timings.units, ticksRun);
+    printTime("scenario", gameState->scenarioTime(), ticksRun);
+
+    const long peakMemory = peakMemoryKb();
+    if (peakMemory >= 0) {
+        printf("peak RSS:     %.1f MB\n", peakMemory / 1024.);
+    }
+
+    return 0;
+}